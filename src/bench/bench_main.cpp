@@ -0,0 +1,52 @@
+#include <QCoreApplication>
+#include "bench_util.h"
+#include "boot_benchmark.h"
+#include "edl_benchmark.h"
+#include "mtk_benchmark.h"
+#include "sparse_benchmark.h"
+
+namespace {
+
+// 一种基准测试模式：命令行中出现 argument 时运行 run
+struct BenchMode {
+    const char *argument;
+    int (*run)(const QStringList &arguments);
+    bool sharesAppIdentity;     // 与界面程序使用相同的应用名，共用内嵌工具的缓存目录
+    const char *description;
+};
+
+const BenchMode BENCH_MODES[] = {
+    {"--sparse-bench", &SparseBenchmark::run, false, "sparse image scan/encode/decode throughput"},
+    {"--edl-bench", &EdlBenchmark::run, false, "Sahara/Firehose path on a loopback 9008 device"},
+    {"--mtk-bench", &MtkBenchmark::run, false, "BROM/DA path on a loopback MTK device"},
+    {"--boot-bench", &BootBenchmark::run, true, "reboot and mode switch timing on connected devices"},
+};
+
+} // namespace
+
+// 基准测试和协议模拟器单独构建为 PhoneToolboxBench，不随界面程序发布
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QStringList arguments = app.arguments();
+
+    for (const BenchMode &mode : BENCH_MODES) {
+        const int index = arguments.indexOf(QLatin1String(mode.argument));
+        if (index < 1) {
+            continue;
+        }
+        if (mode.sharesAppIdentity) {
+            app.setApplicationName("Phone Toolbox");
+            app.setOrganizationName("PhoneToolbox");
+        }
+        // 各模式只解析自己的选项
+        arguments.removeAt(index);
+        return mode.run(arguments);
+    }
+
+    BenchUtil::out() << "Usage: PhoneToolboxBench <mode> [options]\n";
+    for (const BenchMode &mode : BENCH_MODES) {
+        BenchUtil::out() << QString("  %1 %2\n").arg(QLatin1String(mode.argument), -16).arg(mode.description);
+    }
+    return 1;
+}
@@ -0,0 +1,56 @@
+#include "bench_util.h"
+#include <QElapsedTimer>
+#include <QFile>
+#include <QRandomGenerator>
+
+QTextStream &BenchUtil::out()
+{
+    static QTextStream stream(stdout);
+    return stream;
+}
+
+double BenchUtil::megabytesPerSecond(qint64 bytes, qint64 nanoseconds)
+{
+    return nanoseconds > 0 ? (bytes / (1024.0 * 1024.0)) / (nanoseconds / 1e9) : 0.0;
+}
+
+void BenchUtil::keepBest(qint64 &best, qint64 elapsed)
+{
+    if (best < 0 || elapsed < best) {
+        best = elapsed;
+    }
+}
+
+qint64 BenchUtil::bestOf(int iterations, const std::function<bool()> &run)
+{
+    qint64 best = -1;
+    for (int i = 0; i < iterations; ++i) {
+        QElapsedTimer timer;
+        timer.start();
+        if (!run()) {
+            return -1;
+        }
+        keepBest(best, timer.nsecsElapsed());
+    }
+    return best;
+}
+
+QByteArray BenchUtil::randomData(qint64 size, quint32 seed)
+{
+    QByteArray data(static_cast<qsizetype>((size + 3) / 4 * 4), Qt::Uninitialized);
+    QRandomGenerator(seed).fillRange(reinterpret_cast<quint32*>(data.data()), data.size() / 4);
+    data.resize(static_cast<qsizetype>(size));
+    return data;
+}
+
+bool BenchUtil::writeFile(const QString &path, const QByteArray &data)
+{
+    QFile file(path);
+    return file.open(QIODevice::WriteOnly | QIODevice::Truncate) && file.write(data) == data.size();
+}
+
+QByteArray BenchUtil::readFile(const QString &path)
+{
+    QFile file(path);
+    return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+}
@@ -0,0 +1,30 @@
+#ifndef BENCH_UTIL_H
+#define BENCH_UTIL_H
+
+#include <QByteArray>
+#include <QString>
+#include <QTextStream>
+#include <functional>
+
+// 各基准测试共用的输出、计时和测试数据工具
+class BenchUtil
+{
+public:
+    // 标准输出，结果按表格逐行打印
+    static QTextStream &out();
+
+    static double megabytesPerSecond(qint64 bytes, qint64 nanoseconds);
+
+    // 保留较短的耗时，best 为 -1 表示还没有结果
+    static void keepBest(qint64 &best, qint64 elapsed);
+    // 多次运行取最快的一次 (纳秒)，减少页缓存和调度带来的波动；任意一次失败时返回 -1
+    static qint64 bestOf(int iterations, const std::function<bool()> &run);
+
+    // 按种子生成的伪随机数据，同一种子每次结果相同
+    static QByteArray randomData(qint64 size, quint32 seed);
+    static bool writeFile(const QString &path, const QByteArray &data);
+    // 文件不存在或无法读取时返回空
+    static QByteArray readFile(const QString &path);
+};
+
+#endif // BENCH_UTIL_H
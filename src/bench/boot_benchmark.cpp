@@ -0,0 +1,480 @@
+#include "boot_benchmark.h"
+#include "bench_util.h"
+#include "adb_embedded.h"
+#include "device_detector.h"
+#include "restart_tool.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMap>
+#include <QPair>
+#include <QSet>
+#include <QTextStream>
+#include <QTimer>
+#include <algorithm>
+
+namespace {
+
+const int DEFAULT_CYCLES = 5;
+const int DEFAULT_TIMEOUT = 300;            // 单个步骤的超时 (秒)
+const int DISCOVERY_TIME = 5000;            // 开始前等待设备被检测到的时间
+const int BOOT_POLL_INTERVAL = 250;
+
+// 一轮中的一步：在 from 模式下重启到 target，等待设备以 lands 模式重新出现
+struct Step {
+    const char *name;
+    DeviceDetector::DeviceMode from;
+    RestartTool::RestartMode target;
+    DeviceDetector::DeviceMode lands;
+    const char *landedPhase;
+    bool waitBootCompleted;     // 出现后继续等待 sys.boot_completed=1
+};
+
+const Step SYSTEM_STEPS[] = {
+    {"reboot", DeviceDetector::MODE_ADB, RestartTool::MODE_SYSTEM, DeviceDetector::MODE_ADB, "adb", true},
+};
+
+const Step BOOTLOADER_STEPS[] = {
+    {"bootloader", DeviceDetector::MODE_ADB, RestartTool::MODE_BOOTLOADER, DeviceDetector::MODE_FASTBOOT,
+     "fastboot", false},
+    {"fastboot_reboot", DeviceDetector::MODE_FASTBOOT, RestartTool::MODE_SYSTEM, DeviceDetector::MODE_ADB,
+     "adb", true},
+};
+
+struct Options {
+    int cycles = DEFAULT_CYCLES;
+    QString scenario = "all";
+    QList<Step> steps;
+    QStringList serials;
+    int timeoutMs = DEFAULT_TIMEOUT * 1000;
+    QString csvPath = "boot_benchmark.csv";
+    QString jsonPath = "boot_benchmark.json";
+};
+
+// 一个阶段的耗时，均从该步命令发出时刻算起
+struct Sample {
+    QString serial;
+    QString model;
+    int cycle = 0;
+    QString metric;         // 步骤.阶段，如 bootloader.fastboot
+    qint64 startMs = 0;     // 命令发出时刻，距基准测试开始
+    qint64 elapsedMs = 0;
+};
+
+struct Failure {
+    QString serial;
+    QString model;
+    int cycle = 0;
+    QString step;
+    QString reason;
+};
+
+struct DeviceRun {
+    QString serial;
+    QString model;
+    bool started = false;       // 首次开机完成检查已通过
+    bool finished = false;
+    int cycle = 0;
+    int step = 0;
+    qint64 stepStartMs = 0;
+    bool landed = false;
+    quint64 generation = 0;     // 每步递增，作废上一步遗留的超时和开机轮询
+};
+
+// nearest-rank 百分位
+qint64 percentile(const QList<qint64> &sorted, int p)
+{
+    if (sorted.isEmpty()) {
+        return 0;
+    }
+    qsizetype rank = (static_cast<qint64>(p) * sorted.size() + 99) / 100;
+    return sorted.at(qBound<qsizetype>(0, rank - 1, sorted.size() - 1));
+}
+
+class Runner : public QObject
+{
+public:
+    explicit Runner(const Options &options)
+        : m_options(options)
+    {
+        m_restartTool.setDeviceDetector(&m_detector);
+        connect(&m_detector, &DeviceDetector::deviceConnected, this, [this](const DeviceInfo &info) {
+            m_models.insert(info.serialNumber, info.model.isEmpty() ? info.serialNumber : info.model);
+            onDeviceMode(info.serialNumber, static_cast<DeviceDetector::DeviceMode>(info.mode));
+        });
+        connect(&m_detector, &DeviceDetector::deviceModeChanged, this, &Runner::onDeviceMode);
+        connect(&m_restartTool, &RestartTool::restartFinished, this, &Runner::onRestartFinished);
+        connect(&m_restartTool, &RestartTool::outputMessage, this, [](const QString &message, bool isError) {
+            if (isError) {
+                BenchUtil::out() << message << "\n";
+                BenchUtil::out().flush();
+            }
+        });
+    }
+
+    void start()
+    {
+        m_clock.start();
+        m_detector.startMonitoring();
+        BenchUtil::out() << "Waiting " << DISCOVERY_TIME / 1000 << " s for devices...\n";
+        BenchUtil::out().flush();
+        QTimer::singleShot(DISCOVERY_TIME, this, [this]() { beginRuns(); });
+    }
+
+    int exitCode() const
+    {
+        return m_samples.isEmpty() || !m_failures.isEmpty() || !m_reportsWritten ? 1 : 0;
+    }
+
+private:
+    void beginRuns()
+    {
+        QStringList serials = m_options.serials;
+        if (serials.isEmpty()) {
+            for (auto it = m_adbDevices.constBegin(); it != m_adbDevices.constEnd(); ++it) {
+                serials.append(*it);
+            }
+        }
+        for (const QString &serial : std::as_const(serials)) {
+            if (!m_adbDevices.contains(serial)) {
+                BenchUtil::out() << "skip " << serial << ": not connected in ADB mode\n";
+                continue;
+            }
+            DeviceRun run;
+            run.serial = serial;
+            run.model = m_models.value(serial, serial);
+            m_runs.insert(serial, run);
+        }
+        if (m_runs.isEmpty()) {
+            BenchUtil::out() << "No ADB devices available\n";
+            QCoreApplication::exit(exitCode());
+            return;
+        }
+
+        BenchUtil::out() << "Boot benchmark: " << m_runs.size() << " devices, " << m_options.cycles
+              << " cycles, scenario " << m_options.scenario << "\n";
+        BenchUtil::out().flush();
+        // 从已开机完成的状态开始，避免上一次重启的余波计入第一轮
+        for (auto it = m_runs.begin(); it != m_runs.end(); ++it) {
+            pollBootCompleted(it.key(), it.value().generation);
+        }
+    }
+
+    void startStep(DeviceRun &run)
+    {
+        const Step &step = m_options.steps.at(run.step);
+        ++run.generation;
+        run.landed = false;
+        run.stepStartMs = m_clock.elapsed();
+        BenchUtil::out() << QString("[%1] cycle %2/%3 %4\n").arg(run.serial).arg(run.cycle + 1)
+            .arg(m_options.cycles).arg(step.name);
+        BenchUtil::out().flush();
+
+        const QString serial = run.serial;
+        const quint64 generation = run.generation;
+        QTimer::singleShot(m_options.timeoutMs, this, [this, serial, generation]() {
+            DeviceRun *run = activeRun(serial, generation);
+            if (run) {
+                fail(*run, QString("timed out after %1 s").arg(m_options.timeoutMs / 1000));
+            }
+        });
+        m_restartTool.restartDevice(serial, step.from, step.target);
+    }
+
+    void onRestartFinished(const QString &serial, bool success)
+    {
+        // 设备已重新出现时命令结果不再有意义 (可能已进入下一步)
+        DeviceRun *run = activeRun(serial);
+        if (!run || !run->started || run->landed) {
+            return;
+        }
+        if (!success) {
+            fail(*run, "reboot command failed");
+            return;
+        }
+        record(*run, "command");
+    }
+
+    void onDeviceMode(const QString &serial, DeviceDetector::DeviceMode mode)
+    {
+        if (mode == DeviceDetector::MODE_ADB) {
+            m_adbDevices.insert(serial);
+        }
+        DeviceRun *run = activeRun(serial);
+        if (!run || !run->started || run->landed) {
+            return;
+        }
+        const Step &step = m_options.steps.at(run->step);
+        if (mode != step.lands) {
+            return;
+        }
+        run->landed = true;
+        record(*run, step.landedPhase);
+        if (step.waitBootCompleted) {
+            pollBootCompleted(serial, run->generation);
+        } else {
+            advance(*run);
+        }
+    }
+
+    void pollBootCompleted(const QString &serial, quint64 generation)
+    {
+        AdbEmbedded::instance().shellAsync(serial, "getprop sys.boot_completed")
+            .then(this, [this, serial, generation](const AdbCommandResult &result) {
+                DeviceRun *run = activeRun(serial, generation);
+                if (!run) {
+                    return;
+                }
+                if (!result.succeeded() || result.stdOut.trimmed() != "1") {
+                    QTimer::singleShot(BOOT_POLL_INTERVAL, this, [this, serial, generation]() {
+                        pollBootCompleted(serial, generation);
+                    });
+                    return;
+                }
+                if (!run->started) {
+                    run->started = true;
+                    startStep(*run);
+                    return;
+                }
+                record(*run, "boot_completed");
+                advance(*run);
+            });
+    }
+
+    void advance(DeviceRun &run)
+    {
+        if (++run.step >= m_options.steps.size()) {
+            run.step = 0;
+            ++run.cycle;
+        }
+        if (run.cycle >= m_options.cycles) {
+            finish(run);
+            return;
+        }
+        startStep(run);
+    }
+
+    void record(const DeviceRun &run, const QString &phase)
+    {
+        Sample sample;
+        sample.serial = run.serial;
+        sample.model = run.model;
+        sample.cycle = run.cycle;
+        sample.metric = QString("%1.%2").arg(m_options.steps.at(run.step).name, phase);
+        sample.startMs = run.stepStartMs;
+        sample.elapsedMs = m_clock.elapsed() - run.stepStartMs;
+        m_samples.append(sample);
+        BenchUtil::out() << QString("[%1]   %2 %3 ms\n").arg(run.serial, sample.metric).arg(sample.elapsedMs);
+        BenchUtil::out().flush();
+    }
+
+    void fail(DeviceRun &run, const QString &reason)
+    {
+        Failure failure;
+        failure.serial = run.serial;
+        failure.model = run.model;
+        failure.cycle = run.cycle;
+        failure.step = m_options.steps.at(run.step).name;
+        failure.reason = reason;
+        m_failures.append(failure);
+        BenchUtil::out() << QString("[%1] cycle %2 %3 failed: %4\n")
+            .arg(run.serial).arg(run.cycle + 1).arg(failure.step, reason);
+        // 设备状态未知，不再继续该设备的后续轮次
+        finish(run);
+    }
+
+    void finish(DeviceRun &run)
+    {
+        run.finished = true;
+        ++run.generation;
+        for (const DeviceRun &other : std::as_const(m_runs)) {
+            if (!other.finished) {
+                return;
+            }
+        }
+        writeReports();
+        QCoreApplication::exit(exitCode());
+    }
+
+    DeviceRun *activeRun(const QString &serial, quint64 generation)
+    {
+        DeviceRun *run = activeRun(serial);
+        return run && run->generation == generation ? run : nullptr;
+    }
+
+    DeviceRun *activeRun(const QString &serial)
+    {
+        auto it = m_runs.find(serial);
+        return it == m_runs.end() || it.value().finished ? nullptr : &it.value();
+    }
+
+    void writeReports()
+    {
+        // 按机型和阶段汇总，同型号的多台设备合并统计
+        QMap<QPair<QString, QString>, QList<qint64>> groups;
+        QMap<QString, QSet<QString>> devicesByModel;
+        for (const Sample &sample : std::as_const(m_samples)) {
+            groups[qMakePair(sample.model, sample.metric)].append(sample.elapsedMs);
+            devicesByModel[sample.model].insert(sample.serial);
+        }
+
+        QFile csv(m_options.csvPath);
+        bool csvOk = csv.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text);
+        QTextStream csvStream(&csv);
+        if (csvOk) {
+            csvStream << "model,metric,devices,samples,min_ms,p50_ms,p95_ms,p99_ms,max_ms,mean_ms\n";
+        }
+
+        QJsonArray summary;
+        BenchUtil::out() << "\n" << QString("%1 %2 %3 %4 %5 %6 %7\n")
+            .arg(QStringLiteral("model"), -20).arg(QStringLiteral("metric"), -28).arg(QStringLiteral("n"), 4)
+            .arg(QStringLiteral("p50"), 8).arg(QStringLiteral("p95"), 8).arg(QStringLiteral("p99"), 8)
+            .arg(QStringLiteral("max"), 8);
+        for (auto it = groups.begin(); it != groups.end(); ++it) {
+            QList<qint64> &values = it.value();
+            std::sort(values.begin(), values.end());
+            qint64 total = 0;
+            for (qint64 value : std::as_const(values)) {
+                total += value;
+            }
+            const QString &model = it.key().first;
+            const QString &metric = it.key().second;
+            const qint64 p50 = percentile(values, 50);
+            const qint64 p95 = percentile(values, 95);
+            const qint64 p99 = percentile(values, 99);
+            const double mean = static_cast<double>(total) / values.size();
+            const int devices = devicesByModel.value(model).size();
+
+            if (csvOk) {
+                QString escapedModel = model;
+                escapedModel.replace('"', "\"\"");
+                csvStream << '"' << escapedModel << "\"," << metric << ',' << devices << ',' << values.size()
+                          << ',' << values.first() << ',' << p50 << ',' << p95 << ',' << p99
+                          << ',' << values.last() << ',' << QString::number(mean, 'f', 1) << '\n';
+            }
+
+            QJsonObject row;
+            row["model"] = model;
+            row["metric"] = metric;
+            row["devices"] = devices;
+            row["samples"] = values.size();
+            row["min_ms"] = values.first();
+            row["p50_ms"] = p50;
+            row["p95_ms"] = p95;
+            row["p99_ms"] = p99;
+            row["max_ms"] = values.last();
+            row["mean_ms"] = mean;
+            summary.append(row);
+
+            BenchUtil::out() << QString("%1 %2 %3 %4 %5 %6 %7\n")
+                .arg(model.left(20), -20).arg(metric, -28).arg(values.size(), 4)
+                .arg(p50, 8).arg(p95, 8).arg(p99, 8).arg(values.last(), 8);
+        }
+
+        QJsonArray samples;
+        for (const Sample &sample : std::as_const(m_samples)) {
+            QJsonObject object;
+            object["serial"] = sample.serial;
+            object["model"] = sample.model;
+            object["cycle"] = sample.cycle + 1;
+            object["metric"] = sample.metric;
+            object["start_ms"] = sample.startMs;
+            object["elapsed_ms"] = sample.elapsedMs;
+            samples.append(object);
+        }
+        QJsonArray failures;
+        for (const Failure &failure : std::as_const(m_failures)) {
+            QJsonObject object;
+            object["serial"] = failure.serial;
+            object["model"] = failure.model;
+            object["cycle"] = failure.cycle + 1;
+            object["step"] = failure.step;
+            object["reason"] = failure.reason;
+            failures.append(object);
+        }
+
+        QJsonObject root;
+        root["clock"] = "monotonic";
+        root["cycles"] = m_options.cycles;
+        root["scenario"] = m_options.scenario;
+        root["summary"] = summary;
+        root["samples"] = samples;
+        root["failures"] = failures;
+
+        QFile json(m_options.jsonPath);
+        bool jsonOk = json.open(QIODevice::WriteOnly | QIODevice::Truncate)
+            && json.write(QJsonDocument(root).toJson()) >= 0;
+
+        BenchUtil::out() << m_samples.size() << " samples, " << m_failures.size() << " failures\n";
+        if (!csvOk) {
+            BenchUtil::out() << "Cannot write " << m_options.csvPath << "\n";
+        }
+        if (!jsonOk) {
+            BenchUtil::out() << "Cannot write " << m_options.jsonPath << "\n";
+        }
+        BenchUtil::out().flush();
+        m_reportsWritten = csvOk && jsonOk;
+    }
+
+    Options m_options;
+    DeviceDetector m_detector;
+    RestartTool m_restartTool;
+    QElapsedTimer m_clock;                  // 单调时钟，所有时间戳以此为基准
+    QMap<QString, DeviceRun> m_runs;
+    QSet<QString> m_adbDevices;             // 检测到的 ADB 模式设备
+    QHash<QString, QString> m_models;       // 序列号 -> 型号
+    QList<Sample> m_samples;
+    QList<Failure> m_failures;
+    bool m_reportsWritten = false;
+};
+
+} // namespace
+
+int BootBenchmark::run(const QStringList &arguments)
+{
+    Options options;
+    for (int i = 1; i < arguments.size(); ++i) {
+        const QString &argument = arguments.at(i);
+        const bool hasValue = i + 1 < arguments.size();
+        if (argument == "--cycles" && hasValue) {
+            options.cycles = qMax(1, arguments.at(++i).toInt());
+        } else if (argument == "--scenario" && hasValue) {
+            options.scenario = arguments.at(++i);
+        } else if (argument == "--serial" && hasValue) {
+            options.serials.append(arguments.at(++i));
+        } else if (argument == "--timeout" && hasValue) {
+            options.timeoutMs = qMax(1, arguments.at(++i).toInt()) * 1000;
+        } else if (argument == "--csv" && hasValue) {
+            options.csvPath = arguments.at(++i);
+        } else if (argument == "--json" && hasValue) {
+            options.jsonPath = arguments.at(++i);
+        } else {
+            BenchUtil::out() << "Unknown argument: " << argument << "\n";
+            return 1;
+        }
+    }
+
+    if (options.scenario == "system" || options.scenario == "all") {
+        for (const Step &step : SYSTEM_STEPS) {
+            options.steps.append(step);
+        }
+    }
+    if (options.scenario == "bootloader" || options.scenario == "all") {
+        for (const Step &step : BOOTLOADER_STEPS) {
+            options.steps.append(step);
+        }
+    }
+    if (options.steps.isEmpty()) {
+        BenchUtil::out() << "Unknown scenario: " << options.scenario << "\n";
+        return 1;
+    }
+
+    Runner runner(options);
+    runner.start();
+    QCoreApplication::exec();
+    return runner.exitCode();
+}
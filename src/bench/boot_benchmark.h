@@ -0,0 +1,18 @@
+#ifndef BOOT_BENCHMARK_H
+#define BOOT_BENCHMARK_H
+
+#include <QStringList>
+
+// 开机与模式切换耗时基准测试：
+// PhoneToolboxBench --boot-bench [--cycles N] [--scenario system|bootloader|all] [--serial S ...]
+//                                [--timeout 秒] [--csv 路径] [--json 路径]
+// 对每台 ADB 设备执行 N 轮重启，通过 RestartTool 发送命令、由 DeviceDetector 事件判断设备重新出现，
+// 开机完成以 sys.boot_completed=1 为准；各阶段以单调时钟计时，按机型输出 p50/p95/p99 汇总
+class BootBenchmark
+{
+public:
+    // 需要已创建的 QCoreApplication，运行事件循环直到全部设备完成，返回进程退出码
+    static int run(const QStringList &arguments);
+};
+
+#endif // BOOT_BENCHMARK_H
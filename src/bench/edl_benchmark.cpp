@@ -0,0 +1,147 @@
+#include "edl_benchmark.h"
+#include "bench_util.h"
+#include "modes/edl_9008.h"
+#include "edl_loopback.h"
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTemporaryDir>
+
+namespace {
+
+const int DEFAULT_ITERATIONS = 3;
+const qint64 DEFAULT_IMAGE_MIB = 64;
+const qint64 PROGRAMMER_SIZE = 768 * 1024;
+const qint64 DEFAULT_CHUNKS_KIB[] = {64, 256, 1024, 4096};
+const char PARTITION_LABEL[] = "userdata";
+
+struct Timings {
+    qint64 uploadNs = -1;
+    qint64 programNs = -1;
+    qint64 readNs = -1;
+};
+
+// 一轮完整流程：新的模拟设备上传 programmer，写入镜像后读回，三段分别计时
+bool runOnce(qint64 chunkSize, const QString &programmerPath, const QString &imagePath,
+             const QString &outputPath, const QByteArray &programmer, const QByteArray &image,
+             Timings &timings, QString *error)
+{
+    auto transport = std::make_unique<LoopbackEdlTransport>(programmer.size());
+    transport->addPartition(PARTITION_LABEL, image.size());
+    LoopbackEdlTransport *device = transport.get();
+
+    EDL9008 edl;
+    EDL9008::Options options;
+    options.chunkSize = chunkSize;
+    options.maxPayloadSize = chunkSize;
+    edl.setOptions(options);
+    edl.open(std::move(transport));
+
+    QElapsedTimer timer;
+    timer.start();
+    if (!edl.loadProgrammer(programmerPath, error)) {
+        return false;
+    }
+    BenchUtil::keepBest(timings.uploadNs, timer.nsecsElapsed());
+    if (device->programmer() != programmer) {
+        *error = "programmer received by the device differs from the file";
+        return false;
+    }
+
+    // 第一次查找分区会读取 GPT，放在计时之外
+    FirehosePartition partition;
+    if (!edl.findPartition(PARTITION_LABEL, partition, error)) {
+        return false;
+    }
+
+    timer.restart();
+    if (!edl.programPartition(PARTITION_LABEL, imagePath, error)) {
+        return false;
+    }
+    BenchUtil::keepBest(timings.programNs, timer.nsecsElapsed());
+    if (device->partitionData(PARTITION_LABEL) != image) {
+        *error = "partition content differs from the image after program";
+        return false;
+    }
+
+    timer.restart();
+    if (!edl.readPartition(PARTITION_LABEL, outputPath, error)) {
+        return false;
+    }
+    BenchUtil::keepBest(timings.readNs, timer.nsecsElapsed());
+    if (BenchUtil::readFile(outputPath) != image) {
+        *error = "data read back differs from the image";
+        return false;
+    }
+    QFile::remove(outputPath);
+    return true;
+}
+
+} // namespace
+
+int EdlBenchmark::run(const QStringList &arguments)
+{
+    int iterations = DEFAULT_ITERATIONS;
+    qint64 imageSize = DEFAULT_IMAGE_MIB * 1024 * 1024;
+    QList<qint64> chunkSizes;
+    for (int i = 1; i < arguments.size(); ++i) {
+        const QString &argument = arguments.at(i);
+        if (argument == "--iterations" && i + 1 < arguments.size()) {
+            iterations = qMax(1, arguments.at(++i).toInt());
+        } else if (argument == "--size" && i + 1 < arguments.size()) {
+            imageSize = qMax<qint64>(1, arguments.at(++i).toLongLong()) * 1024 * 1024;
+        } else if (argument == "--chunk" && i + 1 < arguments.size()) {
+            chunkSizes.append(qMax<qint64>(4, arguments.at(++i).toLongLong()) * 1024);
+        } else {
+            BenchUtil::out() << "Unknown argument: " << argument << "\n";
+            return 1;
+        }
+    }
+    if (chunkSizes.isEmpty()) {
+        for (qint64 kib : DEFAULT_CHUNKS_KIB) {
+            chunkSizes.append(kib * 1024);
+        }
+    }
+
+    QTemporaryDir workDirectory;
+    if (!workDirectory.isValid()) {
+        BenchUtil::out() << "Cannot create temporary directory\n";
+        return 1;
+    }
+    const QString programmerPath = QDir(workDirectory.path()).filePath("prog_firehose.elf");
+    const QString imagePath = QDir(workDirectory.path()).filePath("userdata.img");
+    const QString outputPath = QDir(workDirectory.path()).filePath("readback.img");
+    const QByteArray programmer = BenchUtil::randomData(PROGRAMMER_SIZE, 9008);
+    const QByteArray image = BenchUtil::randomData(imageSize, 20240611);
+    if (!BenchUtil::writeFile(programmerPath, programmer) || !BenchUtil::writeFile(imagePath, image)) {
+        BenchUtil::out() << "Cannot create benchmark files in " << workDirectory.path() << "\n";
+        return 1;
+    }
+
+    BenchUtil::out() << QString("EDL loopback benchmark, %1 MiB image, best of %2 runs\n")
+        .arg(imageSize / (1024 * 1024)).arg(iterations);
+    BenchUtil::out() << QString("%1 %2 %3 %4\n").arg("chunk", -9).arg("sahara MB/s", 12)
+        .arg("program MB/s", 13).arg("read MB/s", 10);
+    BenchUtil::out().flush();
+
+    bool ok = true;
+    for (qint64 chunkSize : std::as_const(chunkSizes)) {
+        Timings timings;
+        QString error;
+        bool verified = true;
+        for (int i = 0; i < iterations && verified; ++i) {
+            verified = runOnce(chunkSize, programmerPath, imagePath, outputPath, programmer, image,
+                               timings, &error);
+        }
+
+        BenchUtil::out() << QString("%1 %2 %3 %4 %5\n")
+            .arg(QString("%1 KiB").arg(chunkSize / 1024), -9)
+            .arg(BenchUtil::megabytesPerSecond(programmer.size(), timings.uploadNs), 12, 'f', 1)
+            .arg(BenchUtil::megabytesPerSecond(image.size(), timings.programNs), 13, 'f', 1)
+            .arg(BenchUtil::megabytesPerSecond(image.size(), timings.readNs), 10, 'f', 1)
+            .arg(verified ? "verified" : "FAILED: " + error);
+        BenchUtil::out().flush();
+        ok = verified && ok;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,17 @@
+#ifndef EDL_BENCHMARK_H
+#define EDL_BENCHMARK_H
+
+#include <QStringList>
+
+// EDL 刷写路径基准测试：PhoneToolboxBench --edl-bench [--iterations N] [--size MiB] [--chunk KiB ...]
+// 不需要设备，在 LoopbackEdlTransport 上依次执行 loadProgrammer、programPartition、readPartition，
+// 对每个传输块大小测量 Sahara 上传、写入和读取的吞吐量，并校验写入和读回的数据与镜像一致
+// 模拟器只做内存复制，结果反映协议处理和缓冲流水线的开销，不代表 USB 速度
+class EdlBenchmark
+{
+public:
+    // 返回进程退出码
+    static int run(const QStringList &arguments);
+};
+
+#endif // EDL_BENCHMARK_H
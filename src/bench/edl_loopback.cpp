@@ -0,0 +1,339 @@
+#include "edl_loopback.h"
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
+#include <QtEndian>
+#include <cstring>
+
+namespace {
+
+// 与 SaharaClient 使用的命令码和包格式一致
+const quint32 SAHARA_HELLO = 0x01;
+const quint32 SAHARA_HELLO_RESP = 0x02;
+const quint32 SAHARA_END_IMAGE_TX = 0x04;
+const quint32 SAHARA_DONE = 0x05;
+const quint32 SAHARA_DONE_RESP = 0x06;
+const quint32 SAHARA_READ_DATA_64 = 0x12;
+const quint32 SAHARA_VERSION = 2;
+const quint32 SAHARA_IMAGE_TX_COMPLETE = 1;
+const int SAHARA_HELLO_SIZE = 0x30;
+const int SAHARA_HEADER_SIZE = 8;
+const quint64 SAHARA_CHUNK_SIZE = 64 * 1024;
+
+const char DATA_END_TAG[] = "</data>";
+
+void append32(QByteArray &packet, quint32 value)
+{
+    char buffer[4];
+    qToLittleEndian(value, buffer);
+    packet.append(buffer, sizeof(buffer));
+}
+
+void append64(QByteArray &packet, quint64 value)
+{
+    char buffer[8];
+    qToLittleEndian(value, buffer);
+    packet.append(buffer, sizeof(buffer));
+}
+
+quint32 field32(const char *data, qint64 size, int offset)
+{
+    return offset + 4 <= size ? qFromLittleEndian<quint32>(data + offset) : 0;
+}
+
+} // namespace
+
+LoopbackEdlTransport::LoopbackEdlTransport(qint64 programmerSize, int sectorSize, qint64 maxPayloadSize)
+    : m_state(State::SaharaHello)
+    , m_sectorSize(sectorSize)
+    , m_maxPayloadSize(maxPayloadSize)
+    , m_programmerSize(programmerSize)
+    , m_chunkRemaining(0)
+    , m_storage(sectorSize)
+    , m_rawOffset(0)
+    , m_rawRemaining(0)
+    , m_rawRead(false)
+{
+    // 设备上电后先发出 HELLO：version, version_compatible, max_cmd_len, mode
+    QByteArray hello;
+    append32(hello, SAHARA_HELLO);
+    append32(hello, SAHARA_HELLO_SIZE);
+    append32(hello, SAHARA_VERSION);
+    append32(hello, 1);
+    append32(hello, 0);
+    append32(hello, 0);
+    hello.append(SAHARA_HELLO_SIZE - hello.size(), '\0');
+    queuePacket(hello);
+}
+
+void LoopbackEdlTransport::addPartition(const QString &label, qint64 bytes)
+{
+    m_storage.addPartition(label, bytes);
+}
+
+QByteArray LoopbackEdlTransport::programmer() const
+{
+    return m_programmer;
+}
+
+QByteArray LoopbackEdlTransport::partitionData(const QString &label) const
+{
+    return m_storage.partitionData(label);
+}
+
+qint64 LoopbackEdlTransport::write(const char *data, qint64 size, int timeout)
+{
+    switch (m_state) {
+    case State::SaharaHello:
+    case State::SaharaImage:
+    case State::SaharaDone:
+        return handleSahara(data, size) ? size : -1;
+
+    case State::FirehoseProgram: {
+        qint64 length = static_cast<qint64>(qMin<quint64>(m_rawRemaining, static_cast<quint64>(size)));
+        std::memcpy(m_storage.data() + m_rawOffset, data, static_cast<size_t>(length));
+        m_rawOffset += length;
+        m_rawRemaining -= length;
+        if (m_rawRemaining == 0) {
+            m_state = State::FirehoseCommand;
+            queueResponse(true);
+        }
+        // 超出 program 长度的数据按命令处理
+        if (length < size) {
+            return length + write(data + length, size - length, timeout);
+        }
+        return size;
+    }
+
+    case State::FirehoseCommand: {
+        m_input.append(data, static_cast<int>(size));
+        int end;
+        while ((end = m_input.indexOf(DATA_END_TAG)) >= 0) {
+            int length = end + static_cast<int>(sizeof(DATA_END_TAG) - 1);
+            QByteArray document = m_input.left(length);
+            m_input.remove(0, length);
+            handleCommand(document);
+        }
+        return size;
+    }
+
+    case State::Closed:
+        break;
+    }
+    return -1;
+}
+
+qint64 LoopbackEdlTransport::read(char *data, qint64 maxSize, int timeout)
+{
+    Q_UNUSED(timeout)
+    if (m_state == State::Closed) {
+        return -1;
+    }
+
+    // 一次读取只返回一个包或一段原始数据，与 USB 批量传输相同
+    if (!m_output.isEmpty()) {
+        qint64 length = qMin<qint64>(maxSize, m_output.size());
+        std::memcpy(data, m_output.constData(), static_cast<size_t>(length));
+        m_output.remove(0, static_cast<int>(length));
+        return length;
+    }
+
+    if (m_rawRead && m_rawRemaining > 0) {
+        qint64 length = static_cast<qint64>(qMin<quint64>(m_rawRemaining,
+            static_cast<quint64>(qMin(maxSize, m_maxPayloadSize))));
+        std::memcpy(data, m_storage.constData() + m_rawOffset, static_cast<size_t>(length));
+        m_rawOffset += length;
+        m_rawRemaining -= length;
+        if (m_rawRemaining == 0) {
+            m_rawRead = false;
+            queueResponse(true);
+        }
+        return length;
+    }
+
+    // 没有待读数据，相当于 USB 读取超时
+    return -1;
+}
+
+void LoopbackEdlTransport::close()
+{
+    m_state = State::Closed;
+    m_input.clear();
+    m_output.clear();
+}
+
+bool LoopbackEdlTransport::handleSahara(const char *data, qint64 size)
+{
+    if (m_state == State::SaharaImage) {
+        if (static_cast<quint64>(size) > m_chunkRemaining) {
+            return false;
+        }
+        m_programmer.append(data, static_cast<int>(size));
+        m_chunkRemaining -= size;
+        if (m_chunkRemaining == 0) {
+            requestNextChunk();
+        }
+        return true;
+    }
+
+    quint32 command = field32(data, size, 0);
+    if (m_state == State::SaharaHello && command == SAHARA_HELLO_RESP) {
+        m_state = State::SaharaImage;
+        requestNextChunk();
+        return true;
+    }
+    if (m_state == State::SaharaDone && command == SAHARA_DONE) {
+        QByteArray response;
+        append32(response, SAHARA_DONE_RESP);
+        append32(response, SAHARA_HEADER_SIZE + 4);
+        append32(response, SAHARA_IMAGE_TX_COMPLETE);
+        queuePacket(response);
+        m_state = State::FirehoseCommand;
+        return true;
+    }
+    return false;
+}
+
+void LoopbackEdlTransport::requestNextChunk()
+{
+    const quint64 offset = static_cast<quint64>(m_programmer.size());
+    if (offset >= static_cast<quint64>(m_programmerSize)) {
+        // image_id, status
+        QByteArray end;
+        append32(end, SAHARA_END_IMAGE_TX);
+        append32(end, SAHARA_HEADER_SIZE + 8);
+        append32(end, 0);
+        append32(end, 0);
+        queuePacket(end);
+        m_state = State::SaharaDone;
+        return;
+    }
+
+    m_chunkRemaining = qMin<quint64>(SAHARA_CHUNK_SIZE, static_cast<quint64>(m_programmerSize) - offset);
+    QByteArray request;
+    append32(request, SAHARA_READ_DATA_64);
+    append32(request, SAHARA_HEADER_SIZE + 24);
+    append64(request, 0);
+    append64(request, offset);
+    append64(request, m_chunkRemaining);
+    queuePacket(request);
+}
+
+void LoopbackEdlTransport::handleCommand(const QByteArray &document)
+{
+    QString command;
+    QMap<QString, QString> attributes;
+    QXmlStreamReader xml(document);
+    while (!xml.atEnd() && command.isEmpty()) {
+        if (xml.readNext() != QXmlStreamReader::StartElement || xml.name() == QLatin1String("data")) {
+            continue;
+        }
+        command = xml.name().toString();
+        for (const QXmlStreamAttribute &attribute : xml.attributes()) {
+            attributes[attribute.name().toString()] = attribute.value().toString();
+        }
+    }
+
+    if (command == "configure") {
+        const int expected = attributes.value("MemoryName").compare("emmc", Qt::CaseInsensitive) == 0 ? 512 : 4096;
+        if (expected != m_sectorSize) {
+            queueResponse(false, QString("Storage has %1 byte sectors").arg(m_sectorSize));
+            return;
+        }
+        // 请求的上限超出设备能力时 NAK 并给出支持的值
+        const qint64 requested = attributes.value("MaxPayloadSizeToTargetInBytes").toLongLong();
+        QMap<QString, QString> extra;
+        if (requested <= 0 || requested > m_maxPayloadSize) {
+            extra["MaxPayloadSizeToTargetInBytesSupported"] = QString::number(m_maxPayloadSize);
+            queueResponse(false, "Requested payload size not supported", extra);
+            return;
+        }
+        extra["MaxPayloadSizeToTargetInBytes"] = QString::number(requested);
+        queueResponse(true, QString(), extra);
+    } else if (command == "read" || command == "program") {
+        quint64 offset;
+        quint64 length;
+        if (!checkRange(attributes, offset, length)) {
+            return;
+        }
+        m_rawOffset = offset;
+        m_rawRemaining = length;
+        QMap<QString, QString> extra;
+        extra["rawmode"] = "true";
+        queueResponse(true, QString(), extra);
+        if (command == "read") {
+            m_rawRead = true;
+        } else {
+            m_state = State::FirehoseProgram;
+        }
+    } else if (command == "erase") {
+        quint64 offset;
+        quint64 length;
+        if (checkRange(attributes, offset, length)) {
+            std::memset(m_storage.data() + offset, 0, static_cast<size_t>(length));
+            queueResponse(true);
+        }
+    } else if (command == "power") {
+        queueResponse(true);
+    } else {
+        queueResponse(false, "Unsupported command: " + command);
+    }
+}
+
+bool LoopbackEdlTransport::checkRange(const QMap<QString, QString> &attributes, quint64 &offset, quint64 &length)
+{
+    const int lun = attributes.value("physical_partition_number").toInt();
+    const int sectorSize = attributes.value("SECTOR_SIZE_IN_BYTES").toInt();
+    const quint64 start = attributes.value("start_sector").toULongLong();
+    const quint64 count = attributes.value("num_partition_sectors").toULongLong();
+    const quint64 total = m_storage.size() / m_sectorSize;
+
+    if (lun != 0) {
+        queueResponse(false, QString("LUN %1 not present").arg(lun));
+        return false;
+    }
+    if (sectorSize != m_sectorSize) {
+        queueResponse(false, QString("Sector size %1 does not match storage").arg(sectorSize));
+        return false;
+    }
+    if (count == 0 || start >= total || count > total - start) {
+        queueResponse(false, QString("Sectors %1+%2 beyond end of storage").arg(start).arg(count));
+        return false;
+    }
+    offset = start * m_sectorSize;
+    length = count * m_sectorSize;
+    return true;
+}
+
+void LoopbackEdlTransport::queuePacket(const QByteArray &packet)
+{
+    m_output.append(packet);
+}
+
+void LoopbackEdlTransport::queueResponse(bool ack, const QString &log, const QMap<QString, QString> &extra)
+{
+    // NAK 之前先发一条 <log>，与 programmer 的行为一致
+    if (!log.isEmpty()) {
+        QByteArray xml;
+        QXmlStreamWriter writer(&xml);
+        writer.writeStartDocument();
+        writer.writeStartElement("data");
+        writer.writeEmptyElement("log");
+        writer.writeAttribute("value", log);
+        writer.writeEndElement();
+        writer.writeEndDocument();
+        m_output.append(xml);
+    }
+
+    QByteArray xml;
+    QXmlStreamWriter writer(&xml);
+    writer.writeStartDocument();
+    writer.writeStartElement("data");
+    writer.writeEmptyElement("response");
+    writer.writeAttribute("value", ack ? "ACK" : "NAK");
+    for (auto it = extra.constBegin(); it != extra.constEnd(); ++it) {
+        writer.writeAttribute(it.key(), it.value());
+    }
+    writer.writeEndElement();
+    writer.writeEndDocument();
+    m_output.append(xml);
+}
@@ -0,0 +1,66 @@
+#ifndef EDL_LOOPBACK_H
+#define EDL_LOOPBACK_H
+
+#include <QByteArray>
+#include <QMap>
+#include <QString>
+#include "loopback_storage.h"
+#include "modes/edl_transport.h"
+
+// 在本地内存中模拟 9008 设备的 EdlTransport，用于基准测试和无设备时验证协议流程
+// 先按 Sahara 接收 programmer，DONE 之后切换为 Firehose，读写的是带 GPT 的内存存储 (只有 LUN 0)
+// 所有应答在 write() 中同步生成，read() 依次取出；没有待读数据时按超时返回 -1
+class LoopbackEdlTransport : public EdlTransport
+{
+public:
+    // programmerSize 为 Sahara 阶段请求的镜像长度，真实设备从 ELF 头解析得到
+    LoopbackEdlTransport(qint64 programmerSize, int sectorSize = 4096,
+                         qint64 maxPayloadSize = 16 * 1024 * 1024);
+
+    // 在 GPT 中追加一个分区，须在传输开始前调用
+    void addPartition(const QString &label, qint64 bytes);
+
+    // Sahara 阶段收到的 programmer
+    QByteArray programmer() const;
+    // 分区的当前内容，不存在时返回空
+    QByteArray partitionData(const QString &label) const;
+
+    qint64 write(const char *data, qint64 size, int timeout) override;
+    qint64 read(char *data, qint64 maxSize, int timeout) override;
+    void close() override;
+
+private:
+    enum class State {
+        SaharaHello,        // 等待 HELLO_RESP
+        SaharaImage,        // 接收 READ_DATA 请求的数据
+        SaharaDone,         // 等待 DONE
+        FirehoseCommand,    // 等待 <data> 命令
+        FirehoseProgram,    // 接收 program 的原始扇区数据
+        Closed
+    };
+
+    bool handleSahara(const char *data, qint64 size);
+    void requestNextChunk();
+    void handleCommand(const QByteArray &document);
+    bool checkRange(const QMap<QString, QString> &attributes, quint64 &offset, quint64 &length);
+    void queuePacket(const QByteArray &packet);
+    void queueResponse(bool ack, const QString &log = QString(), const QMap<QString, QString> &extra = {});
+
+    State m_state;
+    int m_sectorSize;
+    qint64 m_maxPayloadSize;
+
+    qint64 m_programmerSize;
+    QByteArray m_programmer;
+    quint64 m_chunkRemaining;       // 当前 READ_DATA 请求尚未收到的字节
+
+    QByteArray m_input;             // 尚未凑成完整文档的命令
+    QByteArray m_output;            // 待主机读取的包或 XML 文档
+    LoopbackStorage m_storage;
+
+    quint64 m_rawOffset;            // 进行中的 read/program 在存储中的位置
+    quint64 m_rawRemaining;
+    bool m_rawRead;
+};
+
+#endif // EDL_LOOPBACK_H
@@ -0,0 +1,96 @@
+#include "loopback_storage.h"
+#include <QtEndian>
+#include <cstring>
+
+namespace {
+
+const int GPT_HEADER_SIZE = 92;
+const quint64 GPT_ENTRIES_LBA = 2;
+const quint32 GPT_ENTRY_COUNT = 128;
+const quint32 GPT_ENTRY_SIZE = 128;
+const int GPT_ENTRY_NAME_CHARS = 36;
+
+} // namespace
+
+LoopbackStorage::LoopbackStorage(int sectorSize)
+    : m_sectorSize(sectorSize)
+    , m_nextSector(GPT_ENTRIES_LBA + (static_cast<quint64>(GPT_ENTRY_COUNT) * GPT_ENTRY_SIZE + sectorSize - 1) / sectorSize)
+{
+    writeGpt();
+}
+
+int LoopbackStorage::sectorSize() const
+{
+    return m_sectorSize;
+}
+
+void LoopbackStorage::addPartition(const QString &label, qint64 bytes)
+{
+    Partition partition;
+    partition.firstSector = m_nextSector;
+    partition.sectorCount = static_cast<quint64>((bytes + m_sectorSize - 1) / m_sectorSize);
+    m_nextSector += partition.sectorCount;
+    m_partitions.insert(label, partition);
+    m_partitionOrder.append(label);
+    writeGpt();
+}
+
+QByteArray LoopbackStorage::partitionData(const QString &label) const
+{
+    auto it = m_partitions.constFind(label);
+    if (it == m_partitions.constEnd()) {
+        return QByteArray();
+    }
+    return m_data.mid(static_cast<qsizetype>(it->firstSector * m_sectorSize),
+                      static_cast<qsizetype>(it->sectorCount * m_sectorSize));
+}
+
+char *LoopbackStorage::data()
+{
+    return m_data.data();
+}
+
+const char *LoopbackStorage::constData() const
+{
+    return m_data.constData();
+}
+
+quint64 LoopbackStorage::size() const
+{
+    return static_cast<quint64>(m_data.size());
+}
+
+bool LoopbackStorage::contains(quint64 offset, quint64 length) const
+{
+    return length > 0 && offset < size() && length <= size() - offset;
+}
+
+void LoopbackStorage::writeGpt()
+{
+    m_data.resize(static_cast<qsizetype>(m_nextSector * m_sectorSize), '\0');
+
+    char *header = m_data.data() + m_sectorSize;
+    std::memset(header, 0, static_cast<size_t>(m_sectorSize));
+    std::memcpy(header, "EFI PART", 8);
+    qToLittleEndian<quint32>(0x00010000, header + 8);
+    qToLittleEndian<quint32>(GPT_HEADER_SIZE, header + 12);
+    qToLittleEndian<quint64>(1, header + 24);
+    qToLittleEndian<quint64>(GPT_ENTRIES_LBA, header + 72);
+    qToLittleEndian<quint32>(GPT_ENTRY_COUNT, header + 80);
+    qToLittleEndian<quint32>(GPT_ENTRY_SIZE, header + 84);
+
+    char *entries = m_data.data() + GPT_ENTRIES_LBA * m_sectorSize;
+    std::memset(entries, 0, static_cast<size_t>(GPT_ENTRY_COUNT) * GPT_ENTRY_SIZE);
+    for (int i = 0; i < m_partitionOrder.size() && i < static_cast<int>(GPT_ENTRY_COUNT); ++i) {
+        const QString &label = m_partitionOrder.at(i);
+        const Partition partition = m_partitions.value(label);
+        char *entry = entries + static_cast<qsizetype>(i) * GPT_ENTRY_SIZE;
+        // 分区类型 GUID 非零即视为已使用
+        entry[0] = 1;
+        qToLittleEndian<quint64>(partition.firstSector, entry + 32);
+        qToLittleEndian<quint64>(partition.firstSector + partition.sectorCount - 1, entry + 40);
+        for (int c = 0; c < label.size() && c < GPT_ENTRY_NAME_CHARS - 1; ++c) {
+            qToLittleEndian<quint16>(label.at(c).unicode(), entry + 56 + c * 2);
+        }
+    }
+}
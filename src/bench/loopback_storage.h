@@ -0,0 +1,44 @@
+#ifndef LOOPBACK_STORAGE_H
+#define LOOPBACK_STORAGE_H
+
+#include <QByteArray>
+#include <QList>
+#include <QMap>
+#include <QString>
+
+// 回环模拟器的内存存储：LBA 1 为 GPT 头，分区项数组从 LBA 2 开始，分区依次排在其后
+// GPT 只填写 GptParser 使用的字段，不计算 CRC
+class LoopbackStorage
+{
+public:
+    explicit LoopbackStorage(int sectorSize);
+
+    int sectorSize() const;
+
+    // 在 GPT 中追加一个分区，存储随之扩大；须在传输开始前调用
+    void addPartition(const QString &label, qint64 bytes);
+    // 分区的当前内容，不存在时返回空
+    QByteArray partitionData(const QString &label) const;
+
+    char *data();
+    const char *constData() const;
+    quint64 size() const;
+    // 字节区间非空且在存储之内
+    bool contains(quint64 offset, quint64 length) const;
+
+private:
+    struct Partition {
+        quint64 firstSector = 0;
+        quint64 sectorCount = 0;
+    };
+
+    void writeGpt();
+
+    int m_sectorSize;
+    QByteArray m_data;
+    QMap<QString, Partition> m_partitions;
+    QList<QString> m_partitionOrder;
+    quint64 m_nextSector;
+};
+
+#endif // LOOPBACK_STORAGE_H
@@ -0,0 +1,207 @@
+#include "mtk_benchmark.h"
+#include "bench_util.h"
+#include "modes/mtk_da.h"
+#include "mtk_loopback.h"
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QtEndian>
+#include <cstring>
+
+namespace {
+
+const int DEFAULT_ITERATIONS = 3;
+const qint64 DEFAULT_IMAGE_MIB = 64;
+const qint64 DEFAULT_TRANSFERS_KIB[] = {16, 64, 256, 1024, 4096};
+const char PARTITION_LABEL[] = "userdata";
+
+// 合成 DA 文件：一个与模拟器 HW code 相同的条目，两个阶段的数据依次放在条目表之后
+const quint16 HW_CODE = 0x0766;
+const quint32 STAGE1_ADDRESS = 0x200000;
+const quint32 STAGE2_ADDRESS = 0x40000000;
+const qint64 STAGE1_SIZE = 200 * 1024;      // 两个阶段的大小均含签名
+const qint64 STAGE2_SIZE = 320 * 1024;
+const quint32 SIGNATURE_LENGTH = 0x100;
+const char DA_FILE_MAGIC[] = "MTK_DOWNLOAD_AGENT";
+const int DA_ENTRY_COUNT_OFFSET = 0x68;
+const int DA_ENTRIES_OFFSET = 0x6c;
+const quint16 DA_ENTRY_MAGIC = 0xdada;
+const int DA_ENTRY_HW_CODE = 0x02;
+const int DA_ENTRY_REGION_COUNT = 0x12;
+const int DA_ENTRY_REGIONS = 0x14;
+const int DA_REGION_SIZE = 20;
+const int DA_DATA_OFFSET = 0x1000;
+
+struct Timings {
+    qint64 writeNs = -1;
+    qint64 readNs = -1;
+    qint64 writeTransferSize = 0;   // 传输结束时自动调整到的大小
+    qint64 readTransferSize = 0;
+};
+
+void writeRegion(QByteArray &file, int index, quint32 offset, quint32 length, quint32 address)
+{
+    char *region = file.data() + DA_ENTRIES_OFFSET + DA_ENTRY_REGIONS + index * DA_REGION_SIZE;
+    qToLittleEndian<quint32>(offset, region);
+    qToLittleEndian<quint32>(length, region + 4);
+    qToLittleEndian<quint32>(address, region + 8);
+    qToLittleEndian<quint32>(SIGNATURE_LENGTH, region + 16);
+}
+
+// 按 MTKDA 解析的布局生成 DA 文件，区段 1、2 分别为第一、第二阶段 (均带签名)
+QByteArray buildDaFile(const QByteArray &stage1, const QByteArray &stage2)
+{
+    QByteArray file(DA_DATA_OFFSET, '\0');
+    std::memcpy(file.data(), DA_FILE_MAGIC, sizeof(DA_FILE_MAGIC) - 1);
+    qToLittleEndian<quint32>(1, file.data() + DA_ENTRY_COUNT_OFFSET);
+    char *entry = file.data() + DA_ENTRIES_OFFSET;
+    qToLittleEndian<quint16>(DA_ENTRY_MAGIC, entry);
+    qToLittleEndian<quint16>(HW_CODE, entry + DA_ENTRY_HW_CODE);
+    qToLittleEndian<quint16>(3, entry + DA_ENTRY_REGION_COUNT);
+    writeRegion(file, 1, DA_DATA_OFFSET, static_cast<quint32>(stage1.size()), STAGE1_ADDRESS);
+    writeRegion(file, 2, static_cast<quint32>(DA_DATA_OFFSET + stage1.size()), static_cast<quint32>(stage2.size()),
+                STAGE2_ADDRESS);
+    file.append(stage1);
+    file.append(stage2);
+    return file;
+}
+
+// 一轮完整流程：新的模拟设备经 MTKDA 加载 DA，写入镜像后读回，每次传输都从 transferSize 开始
+bool runOnce(qint64 transferSize, int bufferCount, const QString &daPath, const QString &imagePath,
+             const QString &outputPath, const QByteArray &stage1, const QByteArray &stage2,
+             const QByteArray &image, Timings &timings, QString *error)
+{
+    auto transport = std::make_unique<LoopbackMtkTransport>(HW_CODE);
+    transport->addPartition(PARTITION_LABEL, image.size());
+    LoopbackMtkTransport *device = transport.get();
+
+    MTKDA mtk;
+    MTKDA::Options options;
+    options.bufferCount = bufferCount;
+    options.transferSize = transferSize;
+    mtk.setOptions(options);
+    mtk.open(std::move(transport));
+
+    if (!mtk.loadDownloadAgent(daPath, error)) {
+        return false;
+    }
+    // 第二阶段经 BOOT_TO 发送时不带签名
+    if (device->stage1() != stage1 || device->stage2() != stage2.chopped(SIGNATURE_LENGTH)) {
+        *error = "DA received by the device differs from the DA file";
+        return false;
+    }
+
+    // 第一次查找分区会读取 GPT，放在计时之外；之后重设传输大小
+    MtkPartition partition;
+    if (!mtk.findPartition(PARTITION_LABEL, partition, error)) {
+        return false;
+    }
+    mtk.setOptions(options);
+
+    QElapsedTimer timer;
+    timer.start();
+    if (!mtk.writePartition(PARTITION_LABEL, imagePath, error)) {
+        return false;
+    }
+    qint64 elapsed = timer.nsecsElapsed();
+    if (timings.writeNs < 0 || elapsed < timings.writeNs) {
+        timings.writeNs = elapsed;
+        timings.writeTransferSize = mtk.transferSize();
+    }
+    if (device->partitionData(PARTITION_LABEL) != image) {
+        *error = "partition content differs from the image after WRITE_DATA";
+        return false;
+    }
+
+    mtk.setOptions(options);
+    timer.restart();
+    if (!mtk.readPartition(PARTITION_LABEL, outputPath, error)) {
+        return false;
+    }
+    elapsed = timer.nsecsElapsed();
+    if (timings.readNs < 0 || elapsed < timings.readNs) {
+        timings.readNs = elapsed;
+        timings.readTransferSize = mtk.transferSize();
+    }
+    if (BenchUtil::readFile(outputPath) != image) {
+        *error = "data read back differs from the image";
+        return false;
+    }
+    QFile::remove(outputPath);
+    return true;
+}
+
+} // namespace
+
+int MtkBenchmark::run(const QStringList &arguments)
+{
+    int iterations = DEFAULT_ITERATIONS;
+    int bufferCount = MtkDaClient::DEFAULT_BUFFER_COUNT;
+    qint64 imageSize = DEFAULT_IMAGE_MIB * 1024 * 1024;
+    QList<qint64> transferSizes;
+    for (int i = 1; i < arguments.size(); ++i) {
+        const QString &argument = arguments.at(i);
+        if (argument == "--iterations" && i + 1 < arguments.size()) {
+            iterations = qMax(1, arguments.at(++i).toInt());
+        } else if (argument == "--size" && i + 1 < arguments.size()) {
+            imageSize = qMax<qint64>(1, arguments.at(++i).toLongLong()) * 1024 * 1024;
+        } else if (argument == "--buffers" && i + 1 < arguments.size()) {
+            bufferCount = qMax(2, arguments.at(++i).toInt());
+        } else if (argument == "--transfer" && i + 1 < arguments.size()) {
+            transferSizes.append(arguments.at(++i).toLongLong() * 1024);
+        } else {
+            BenchUtil::out() << "Unknown argument: " << argument << "\n";
+            return 1;
+        }
+    }
+    if (transferSizes.isEmpty()) {
+        for (qint64 kib : DEFAULT_TRANSFERS_KIB) {
+            transferSizes.append(kib * 1024);
+        }
+    }
+
+    QTemporaryDir workDirectory;
+    if (!workDirectory.isValid()) {
+        BenchUtil::out() << "Cannot create temporary directory\n";
+        return 1;
+    }
+    const QString daPath = QDir(workDirectory.path()).filePath("MTK_AllInOne_DA.bin");
+    const QString imagePath = QDir(workDirectory.path()).filePath("userdata.img");
+    const QString outputPath = QDir(workDirectory.path()).filePath("readback.img");
+    const QByteArray stage1 = BenchUtil::randomData(STAGE1_SIZE, 6765);
+    const QByteArray stage2 = BenchUtil::randomData(STAGE2_SIZE, 6768);
+    const QByteArray image = BenchUtil::randomData(imageSize, 20240611);
+    if (!BenchUtil::writeFile(daPath, buildDaFile(stage1, stage2)) || !BenchUtil::writeFile(imagePath, image)) {
+        BenchUtil::out() << "Cannot create benchmark files in " << workDirectory.path() << "\n";
+        return 1;
+    }
+
+    BenchUtil::out() << QString("MTK DA loopback benchmark, %1 MiB image, %2 buffers, best of %3 runs\n")
+        .arg(imageSize / (1024 * 1024)).arg(bufferCount).arg(iterations);
+    BenchUtil::out() << QString("%1 %2 %3 %4 %5\n").arg("transfer", -10).arg("write MB/s", 11)
+        .arg("settled", 10).arg("read MB/s", 11).arg("settled", 10);
+    BenchUtil::out().flush();
+
+    bool ok = true;
+    for (qint64 transferSize : std::as_const(transferSizes)) {
+        Timings timings;
+        QString error;
+        bool verified = true;
+        for (int i = 0; i < iterations && verified; ++i) {
+            verified = runOnce(transferSize, bufferCount, daPath, imagePath, outputPath, stage1, stage2,
+                               image, timings, &error);
+        }
+
+        BenchUtil::out() << QString("%1 %2 %3 %4 %5 %6\n")
+            .arg(QString("%1 KiB").arg(transferSize / 1024), -10)
+            .arg(BenchUtil::megabytesPerSecond(image.size(), timings.writeNs), 11, 'f', 1)
+            .arg(QString("%1 KiB").arg(timings.writeTransferSize / 1024), 10)
+            .arg(BenchUtil::megabytesPerSecond(image.size(), timings.readNs), 11, 'f', 1)
+            .arg(QString("%1 KiB").arg(timings.readTransferSize / 1024), 10)
+            .arg(verified ? "verified" : "FAILED: " + error);
+        BenchUtil::out().flush();
+        ok = verified && ok;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,17 @@
+#ifndef MTK_BENCHMARK_H
+#define MTK_BENCHMARK_H
+
+#include <QStringList>
+
+// MTK DA 读写路径基准测试：PhoneToolboxBench --mtk-bench [--iterations N] [--size MiB] [--buffers N] [--transfer KiB ...]
+// 不需要设备，用合成的 DA 文件在带 GPT 的 LoopbackMtkTransport 上依次执行 MTKDA 的 loadDownloadAgent、
+// writePartition、readPartition，对每个初始传输大小输出吞吐量和自动调整后的传输大小，并校验写入和读回的数据
+// 模拟器只做内存复制，结果反映协议处理和缓冲流水线的开销，不代表 USB 速度
+class MtkBenchmark
+{
+public:
+    // 返回进程退出码
+    static int run(const QStringList &arguments);
+};
+
+#endif // MTK_BENCHMARK_H
@@ -0,0 +1,452 @@
+#include "mtk_loopback.h"
+#include <QtEndian>
+#include <cstring>
+
+namespace {
+
+// 与 MtkBromClient/MtkDaClient 使用的命令码和包格式一致
+const quint8 BROM_JUMP_DA = 0xd5;
+const quint8 BROM_SEND_DA = 0xd7;
+const quint8 BROM_GET_HW_CODE = 0xfd;
+const quint8 START_SEQUENCE[] = {0xa0, 0x0a, 0x50, 0x05};
+
+const quint32 DA_FORMAT = 0x010003;
+const quint32 DA_WRITE_DATA = 0x010004;
+const quint32 DA_READ_DATA = 0x010005;
+const quint32 DA_BOOT_TO = 0x010008;
+const quint32 DA_DEVICE_CTRL = 0x010009;
+const quint32 DA_SETUP_ENVIRONMENT = 0x010100;
+const quint32 DA_SETUP_HW_INIT_PARAMS = 0x010101;
+const quint32 DA_GET_PACKET_LENGTH = 0x040007;
+
+const quint32 PACKET_MAGIC = 0xfeeeeeef;
+const quint32 DT_PROTOCOL_FLOW = 1;
+const quint32 SYNC_SIGNAL = 0x434e5953;
+const char DA_SYNC_CHAR = static_cast<char>(0xc0);
+const int HEADER_SIZE = 12;
+const int STORAGE_PARAMETER_SIZE = 24;
+
+const quint32 STATUS_OK = 0;
+const quint32 STATUS_UNSUPPORTED = 0xc0010004;
+const quint32 STATUS_INVALID_RANGE = 0xc0030003;
+const quint32 STATUS_CHECKSUM_ERROR = 0xc0040003;
+
+void append16BigEndian(QByteArray &data, quint16 value)
+{
+    char buffer[2];
+    qToBigEndian(value, buffer);
+    data.append(buffer, sizeof(buffer));
+}
+
+void append32(QByteArray &data, quint32 value)
+{
+    char buffer[4];
+    qToLittleEndian(value, buffer);
+    data.append(buffer, sizeof(buffer));
+}
+
+// 与 BROM 相同：按小端 16 位字异或，奇数长度时最后一个字节单独异或
+quint16 bromChecksum(const QByteArray &data)
+{
+    quint16 checksum = 0;
+    qsizetype i = 0;
+    for (; i + 1 < data.size(); i += 2) {
+        checksum ^= qFromLittleEndian<quint16>(data.constData() + i);
+    }
+    if (i < data.size()) {
+        checksum ^= static_cast<quint8>(data.at(i));
+    }
+    return checksum;
+}
+
+} // namespace
+
+LoopbackMtkTransport::LoopbackMtkTransport(quint16 hwCode, quint32 packetLength, int sectorSize)
+    : m_state(State::Handshake)
+    , m_hwCode(hwCode)
+    , m_packetLength(packetLength)
+    , m_handshakeIndex(0)
+    , m_bromCommand(0)
+    , m_bromParameterCount(0)
+    , m_stage1Remaining(0)
+    , m_syncPending(false)
+    , m_daCommand(0)
+    , m_storage(sectorSize)
+    , m_rawOffset(0)
+    , m_rawRemaining(0)
+    , m_packetRemaining(0)
+    , m_expectedChecksum(0)
+    , m_checksum(0)
+{
+}
+
+void LoopbackMtkTransport::addPartition(const QString &label, qint64 bytes)
+{
+    m_storage.addPartition(label, bytes);
+}
+
+QByteArray LoopbackMtkTransport::stage1() const
+{
+    return m_stage1;
+}
+
+QByteArray LoopbackMtkTransport::stage2() const
+{
+    return m_stage2;
+}
+
+QByteArray LoopbackMtkTransport::partitionData(const QString &label) const
+{
+    return m_storage.partitionData(label);
+}
+
+qint64 LoopbackMtkTransport::write(const char *data, qint64 size, int timeout)
+{
+    Q_UNUSED(timeout)
+    switch (m_state) {
+    case State::Handshake:
+    case State::BromCommand:
+    case State::BromParameter:
+    case State::BromDaData:
+        return writeBrom(data, size);
+    case State::Closed:
+        return -1;
+    default:
+        return writeDa(data, size);
+    }
+}
+
+qint64 LoopbackMtkTransport::read(char *data, qint64 maxSize, int timeout)
+{
+    Q_UNUSED(timeout)
+    if (m_state == State::Closed) {
+        return -1;
+    }
+
+    if (m_output.isEmpty() && m_syncPending) {
+        m_syncPending = false;
+        m_output.append(DA_SYNC_CHAR);
+    }
+    if (!m_output.isEmpty()) {
+        qint64 length = qMin<qint64>(maxSize, m_output.size());
+        std::memcpy(data, m_output.constData(), static_cast<size_t>(length));
+        m_output.remove(0, static_cast<int>(length));
+        return length;
+    }
+
+    // 数据包负载直接从用户区取出
+    if (m_packetRemaining > 0) {
+        qint64 length = static_cast<qint64>(qMin<quint64>(m_packetRemaining, static_cast<quint64>(maxSize)));
+        std::memcpy(data, m_storage.constData() + m_rawOffset, static_cast<size_t>(length));
+        m_rawOffset += length;
+        m_rawRemaining -= length;
+        m_packetRemaining -= length;
+        return length;
+    }
+
+    // 没有待读数据，相当于 USB 读取超时
+    return -1;
+}
+
+void LoopbackMtkTransport::close()
+{
+    m_state = State::Closed;
+    m_input.clear();
+    m_output.clear();
+}
+
+qint64 LoopbackMtkTransport::writeBrom(const char *data, qint64 size)
+{
+    for (qint64 i = 0; i < size; ++i) {
+        const quint8 byte = static_cast<quint8>(data[i]);
+        switch (m_state) {
+        case State::Handshake:
+            // 每个字节回复取反值，序列不符时从头开始
+            m_output.append(static_cast<char>(~byte));
+            m_handshakeIndex = byte == START_SEQUENCE[m_handshakeIndex] ? m_handshakeIndex + 1 : 0;
+            if (m_handshakeIndex == static_cast<int>(sizeof(START_SEQUENCE))) {
+                m_state = State::BromCommand;
+            }
+            break;
+
+        case State::BromCommand:
+            m_output.append(static_cast<char>(byte));
+            m_bromCommand = byte;
+            m_bromParameters.clear();
+            if (byte == BROM_GET_HW_CODE) {
+                append16BigEndian(m_output, m_hwCode);
+                append16BigEndian(m_output, 0);
+            } else if (byte == BROM_SEND_DA) {
+                // 地址、长度、签名长度
+                m_bromParameterCount = 3;
+                m_state = State::BromParameter;
+            } else if (byte == BROM_JUMP_DA) {
+                m_bromParameterCount = 1;
+                m_state = State::BromParameter;
+            }
+            break;
+
+        case State::BromParameter:
+            m_output.append(static_cast<char>(byte));
+            m_bromParameters.append(static_cast<char>(byte));
+            if (m_bromParameters.size() == m_bromParameterCount * 4) {
+                handleBromParameters();
+            }
+            break;
+
+        case State::BromDaData: {
+            const qint64 length = qMin(size - i, m_stage1Remaining);
+            m_stage1.append(data + i, static_cast<int>(length));
+            m_stage1Remaining -= length;
+            i += length - 1;
+            if (m_stage1Remaining == 0) {
+                append16BigEndian(m_output, bromChecksum(m_stage1));
+                append16BigEndian(m_output, 0);
+                m_state = State::BromCommand;
+            }
+            break;
+        }
+
+        default:
+            // JUMP_DA 之后的数据按 DA 协议处理
+            return i + writeDa(data + i, size - i);
+        }
+    }
+    return size;
+}
+
+void LoopbackMtkTransport::handleBromParameters()
+{
+    append16BigEndian(m_output, 0);
+    if (m_bromCommand == BROM_SEND_DA) {
+        m_stage1.clear();
+        m_stage1Remaining = qFromBigEndian<quint32>(m_bromParameters.constData() + 4);
+        m_state = m_stage1Remaining > 0 ? State::BromDaData : State::BromCommand;
+    } else {
+        m_syncPending = true;
+        m_state = State::DaCommand;
+    }
+}
+
+qint64 LoopbackMtkTransport::writeDa(const char *data, qint64 size)
+{
+    const qint64 total = size;
+    while (size > 0) {
+        // 写入数据包的负载直接写进用户区，不经过输入缓冲
+        if (m_state == State::DaWriteData && m_packetRemaining > 0) {
+            qint64 length = static_cast<qint64>(qMin<quint64>(m_packetRemaining, static_cast<quint64>(size)));
+            streamWriteData(data, length);
+            data += length;
+            size -= length;
+            continue;
+        }
+
+        m_input.append(data, static_cast<int>(size));
+        size = 0;
+        if (!processPackets()) {
+            return -1;
+        }
+    }
+    return total;
+}
+
+bool LoopbackMtkTransport::processPackets()
+{
+    while (m_input.size() >= HEADER_SIZE) {
+        if (qFromLittleEndian<quint32>(m_input.constData()) != PACKET_MAGIC) {
+            return false;
+        }
+        const quint32 length = qFromLittleEndian<quint32>(m_input.constData() + 8);
+
+        if (m_state == State::DaWriteData) {
+            if (length == 0 || length > m_rawRemaining) {
+                return false;
+            }
+            m_input.remove(0, HEADER_SIZE);
+            m_packetRemaining = length;
+            m_checksum = 0;
+            qint64 buffered = qMin<qint64>(m_input.size(), length);
+            QByteArray head = m_input.left(static_cast<int>(buffered));
+            m_input.remove(0, static_cast<int>(buffered));
+            streamWriteData(head.constData(), head.size());
+            continue;
+        }
+
+        if (m_input.size() < HEADER_SIZE + static_cast<qint64>(length)) {
+            break;
+        }
+        QByteArray payload = m_input.mid(HEADER_SIZE, static_cast<int>(length));
+        m_input.remove(0, HEADER_SIZE + static_cast<int>(length));
+        handleDaPacket(payload);
+    }
+    return true;
+}
+
+void LoopbackMtkTransport::handleDaPacket(const QByteArray &payload)
+{
+    const quint32 value = payload.size() >= 4 ? qFromLittleEndian<quint32>(payload.constData()) : 0;
+    quint64 offset = 0;
+    quint64 length = 0;
+
+    switch (m_state) {
+    case State::DaCommand:
+        switch (value) {
+        case DA_SETUP_ENVIRONMENT:
+        case DA_SETUP_HW_INIT_PARAMS:
+        case DA_BOOT_TO:
+        case DA_READ_DATA:
+        case DA_WRITE_DATA:
+        case DA_FORMAT:
+            queueStatus(STATUS_OK);
+            m_daCommand = value;
+            m_state = State::DaParameter;
+            break;
+        case DA_DEVICE_CTRL:
+            queueStatus(STATUS_OK);
+            break;
+        case DA_GET_PACKET_LENGTH: {
+            queueStatus(STATUS_OK);
+            QByteArray lengths;
+            append32(lengths, m_packetLength);
+            append32(lengths, m_packetLength);
+            queuePacket(lengths);
+            queueStatus(STATUS_OK);
+            break;
+        }
+        default:
+            queueStatus(STATUS_UNSUPPORTED);
+            break;
+        }
+        break;
+
+    case State::DaParameter:
+        m_state = State::DaCommand;
+        if (m_daCommand == DA_SETUP_HW_INIT_PARAMS) {
+            // 初始化完成后发出同步信号
+            queueStatus(STATUS_OK);
+            QByteArray sync;
+            append32(sync, SYNC_SIGNAL);
+            queuePacket(sync);
+        } else if (m_daCommand == DA_BOOT_TO) {
+            // 地址和长度之后直接是 DA 数据，不回复状态
+            m_state = State::DaBootData;
+        } else if (m_daCommand == DA_READ_DATA) {
+            if (handleStorageParameter(payload, offset, length)) {
+                m_rawOffset = offset;
+                m_rawRemaining = length;
+                queueDataPacket();
+                m_state = State::DaReadAck;
+            }
+        } else if (m_daCommand == DA_WRITE_DATA) {
+            if (handleStorageParameter(payload, offset, length)) {
+                m_rawOffset = offset;
+                m_rawRemaining = length;
+                m_state = State::DaWriteFlag;
+            }
+        } else if (m_daCommand == DA_FORMAT) {
+            if (handleStorageParameter(payload, offset, length)) {
+                std::memset(m_storage.data() + offset, 0, static_cast<size_t>(length));
+                queueStatus(STATUS_OK);
+            }
+        } else {
+            queueStatus(STATUS_OK);
+        }
+        break;
+
+    case State::DaBootData:
+        m_stage2 = payload;
+        queueStatus(STATUS_OK);
+        m_state = State::DaCommand;
+        break;
+
+    case State::DaReadAck:
+        if (m_rawRemaining > 0) {
+            queueDataPacket();
+        } else {
+            queueStatus(STATUS_OK);
+            m_state = State::DaCommand;
+        }
+        break;
+
+    case State::DaWriteFlag:
+        m_state = State::DaWriteChecksum;
+        break;
+
+    case State::DaWriteChecksum:
+        m_expectedChecksum = value;
+        m_state = State::DaWriteData;
+        break;
+
+    default:
+        break;
+    }
+}
+
+bool LoopbackMtkTransport::handleStorageParameter(const QByteArray &payload, quint64 &offset, quint64 &length)
+{
+    // 存储类型、分区类型、偏移、长度
+    if (payload.size() < STORAGE_PARAMETER_SIZE) {
+        queueStatus(STATUS_INVALID_RANGE);
+        return false;
+    }
+    offset = qFromLittleEndian<quint64>(payload.constData() + 8);
+    length = qFromLittleEndian<quint64>(payload.constData() + 16);
+    if (!m_storage.contains(offset, length)) {
+        queueStatus(STATUS_INVALID_RANGE);
+        return false;
+    }
+    queueStatus(STATUS_OK);
+    return true;
+}
+
+void LoopbackMtkTransport::streamWriteData(const char *data, qint64 size)
+{
+    std::memcpy(m_storage.data() + m_rawOffset, data, static_cast<size_t>(size));
+    const uchar *bytes = reinterpret_cast<const uchar*>(data);
+    for (qint64 i = 0; i < size; ++i) {
+        m_checksum += bytes[i];
+    }
+    m_rawOffset += size;
+    m_rawRemaining -= size;
+    m_packetRemaining -= size;
+    if (m_packetRemaining > 0) {
+        return;
+    }
+
+    // 每个数据包回复一次状态，全部写完后再回复整个命令的状态
+    if ((m_checksum & 0xffff) != m_expectedChecksum) {
+        queueStatus(STATUS_CHECKSUM_ERROR);
+        m_state = State::DaCommand;
+        return;
+    }
+    queueStatus(STATUS_OK);
+    if (m_rawRemaining > 0) {
+        m_state = State::DaWriteFlag;
+    } else {
+        queueStatus(STATUS_OK);
+        m_state = State::DaCommand;
+    }
+}
+
+void LoopbackMtkTransport::queueDataPacket()
+{
+    m_packetRemaining = qMin<quint64>(m_packetLength, m_rawRemaining);
+    append32(m_output, PACKET_MAGIC);
+    append32(m_output, DT_PROTOCOL_FLOW);
+    append32(m_output, static_cast<quint32>(m_packetRemaining));
+}
+
+void LoopbackMtkTransport::queuePacket(const QByteArray &payload)
+{
+    append32(m_output, PACKET_MAGIC);
+    append32(m_output, DT_PROTOCOL_FLOW);
+    append32(m_output, static_cast<quint32>(payload.size()));
+    m_output.append(payload);
+}
+
+void LoopbackMtkTransport::queueStatus(quint32 status)
+{
+    QByteArray payload;
+    append32(payload, status);
+    queuePacket(payload);
+}
@@ -0,0 +1,84 @@
+#ifndef MTK_LOOPBACK_H
+#define MTK_LOOPBACK_H
+
+#include <QByteArray>
+#include <QString>
+#include "loopback_storage.h"
+#include "modes/mtk_transport.h"
+
+// 在本地内存中模拟 MTK 下载端口的 MtkTransport，用于基准测试和无设备时验证协议流程
+// BROM 阶段处理握手、GET_HW_CODE、SEND_DA (回显参数并返回校验和) 和 JUMP_DA，
+// 之后按 XFlash DA 协议响应初始化、BOOT_TO、GET_PACKET_LENGTH 以及对内存用户区的 READ_DATA/WRITE_DATA/FORMAT，
+// 用户区带 GPT，按 eMMC 的 512 字节扇区排布
+// 所有应答在 write() 中同步生成，read() 依次取出；没有待读数据时按超时返回 -1
+class LoopbackMtkTransport : public MtkTransport
+{
+public:
+    explicit LoopbackMtkTransport(quint16 hwCode = 0x0766, quint32 packetLength = 0x100000, int sectorSize = 512);
+
+    // 在 GPT 中追加一个分区，须在传输开始前调用
+    void addPartition(const QString &label, qint64 bytes);
+
+    // SEND_DA 收到的 DA 第一阶段 (含签名) 和 BOOT_TO 收到的第二阶段
+    QByteArray stage1() const;
+    QByteArray stage2() const;
+    // 分区的当前内容，不存在时返回空
+    QByteArray partitionData(const QString &label) const;
+
+    qint64 write(const char *data, qint64 size, int timeout) override;
+    qint64 read(char *data, qint64 maxSize, int timeout) override;
+    void close() override;
+
+private:
+    enum class State {
+        Handshake,
+        BromCommand,
+        BromParameter,      // 逐字节回显命令的大端参数
+        BromDaData,         // 接收 SEND_DA 的数据
+        DaCommand,
+        DaParameter,        // 等待当前命令的参数包
+        DaBootData,         // 等待 BOOT_TO 的 DA 数据包
+        DaReadAck,          // 等待主机确认已收到的数据包
+        DaWriteFlag,        // WRITE_DATA 每个数据包前依次为 0、校验和、数据
+        DaWriteChecksum,
+        DaWriteData,
+        Closed
+    };
+
+    qint64 writeBrom(const char *data, qint64 size);
+    void handleBromParameters();
+    qint64 writeDa(const char *data, qint64 size);
+    bool processPackets();
+    void handleDaPacket(const QByteArray &payload);
+    bool handleStorageParameter(const QByteArray &payload, quint64 &offset, quint64 &length);
+    void streamWriteData(const char *data, qint64 size);
+    void queueDataPacket();
+    void queuePacket(const QByteArray &payload);
+    void queueStatus(quint32 status);
+
+    State m_state;
+    quint16 m_hwCode;
+    quint32 m_packetLength;
+    int m_handshakeIndex;
+
+    quint8 m_bromCommand;
+    int m_bromParameterCount;
+    QByteArray m_bromParameters;
+    qint64 m_stage1Remaining;
+    QByteArray m_stage1;
+    QByteArray m_stage2;
+    bool m_syncPending;             // JUMP_DA 应答被取走后 DA 才发出同步字节
+
+    quint32 m_daCommand;
+    QByteArray m_input;             // 尚未凑成完整数据包的输入
+    QByteArray m_output;            // 待主机读取的回显、状态或数据包头
+    LoopbackStorage m_storage;
+
+    quint64 m_rawOffset;            // 进行中的读写在用户区中的位置
+    quint64 m_rawRemaining;         // 整个读写命令尚未传输的字节
+    quint64 m_packetRemaining;      // 当前数据包尚未传输的字节
+    quint32 m_expectedChecksum;
+    quint32 m_checksum;
+};
+
+#endif // MTK_LOOPBACK_H
@@ -0,0 +1,312 @@
+#include "sparse_benchmark.h"
+#include "bench_util.h"
+#include "block_scan.h"
+#include "sparse_image.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QProcess>
+#include <QProcessEnvironment>
+#include <QRandomGenerator>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <cstring>
+#include <functional>
+
+namespace {
+
+const int DEFAULT_ITERATIONS = 5;
+const qint64 GENERATED_IMAGE_SIZE = 256 * 1024 * 1024;
+const int TOOL_TIMEOUT = 120000;
+
+struct BenchImage {
+    QString name;
+    QString path;
+};
+
+QString toolsDirectory()
+{
+    return qEnvironmentVariable("PTB_TOOLS_DIR");
+}
+
+// 优先使用工具目录中的二进制，其次 PATH
+QString findTool(const QString &name)
+{
+    QString directory = toolsDirectory();
+    if (!directory.isEmpty() && QFileInfo(QDir(directory).filePath(name)).isExecutable()) {
+        return QDir(directory).filePath(name);
+    }
+    return QStandardPaths::findExecutable(name);
+}
+
+bool runTool(const QString &program, const QStringList &arguments, QString *error)
+{
+    // 工具目录中预编译的 Android 工具依赖同目录下的 mke2fs.conf 和 lib64 中的 libc++；
+    // 从 PATH 找到的工具使用系统自带的配置和库，环境保持不变
+    QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+    const QString directory = toolsDirectory();
+    if (!directory.isEmpty() && QFileInfo(program).absoluteDir() == QDir(directory)) {
+        environment.insert("MKE2FS_CONFIG", QDir(directory).filePath("mke2fs.conf"));
+        environment.insert("LD_LIBRARY_PATH", QDir(directory).filePath("lib64"));
+        environment.insert("DYLD_LIBRARY_PATH", QDir(directory).filePath("lib64"));
+    }
+
+    QProcess process;
+    process.setProcessEnvironment(environment);
+    process.setProcessChannelMode(QProcess::MergedChannels);
+    process.start(program, arguments);
+    if (!process.waitForFinished(TOOL_TIMEOUT) || process.exitStatus() != QProcess::NormalExit
+        || process.exitCode() != 0) {
+        if (error) {
+            *error = QString("%1 failed: %2").arg(QFileInfo(program).fileName(),
+                process.errorString() + " " + QString::fromLocal8Bit(process.readAll()).trimmed());
+        }
+        return false;
+    }
+    return true;
+}
+
+bool writeFile(const QString &path, qint64 size, const std::function<void(char*, qint64)> &fill)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    QByteArray buffer(1024 * 1024, Qt::Uninitialized);
+    for (qint64 done = 0; done < size; done += buffer.size()) {
+        fill(buffer.data(), buffer.size());
+        if (file.write(buffer) != buffer.size()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 测试文件系统的内容：不可压缩数据、全零文件和重复文本，接近真实分区的混合
+bool createContent(const QString &directory)
+{
+    QDir().mkpath(directory);
+    QRandomGenerator random(20240611);
+    return writeFile(directory + "/random.bin", 48 * 1024 * 1024, [&random](char *data, qint64 size) {
+            random.fillRange(reinterpret_cast<quint32*>(data), size / 4);
+        })
+        && writeFile(directory + "/zero.bin", 16 * 1024 * 1024, [](char *data, qint64 size) {
+            std::memset(data, 0, static_cast<size_t>(size));
+        })
+        && writeFile(directory + "/text.txt", 8 * 1024 * 1024, [](char *data, qint64 size) {
+            static const char line[] = "ro.product.model=PhoneToolbox sparse benchmark\n";
+            for (qint64 i = 0; i < size; ++i) {
+                data[i] = line[i % (sizeof(line) - 1)];
+            }
+        });
+}
+
+bool createEmptyImage(const QString &path)
+{
+    QFile file(path);
+    return file.open(QIODevice::WriteOnly) && file.resize(GENERATED_IMAGE_SIZE);
+}
+
+QList<BenchImage> generateImages(const QString &directory)
+{
+    QList<BenchImage> images;
+    const QString content = directory + "/content";
+    if (!createContent(content)) {
+        BenchUtil::out() << "Cannot create benchmark content in " << directory << "\n";
+        return images;
+    }
+
+    struct Generator {
+        const char *name;
+        const char *tool;
+        bool needsEmptyImage;
+        std::function<QStringList(const QString &image)> arguments;
+    };
+    const Generator generators[] = {
+        {"ext4", "mke2fs", true, [&content](const QString &image) {
+            return QStringList{"-F", "-q", "-t", "ext4", "-b", "4096", "-d", content, image};
+        }},
+        {"f2fs", "make_f2fs", true, [](const QString &image) {
+            return QStringList{"-f", image};
+        }},
+        {"erofs", "mkfs.erofs", false, [&content](const QString &image) {
+            return QStringList{image, content};
+        }},
+    };
+
+    for (const Generator &generator : generators) {
+        const QString tool = findTool(generator.tool);
+        if (tool.isEmpty()) {
+            BenchUtil::out() << "skip " << generator.name << ": " << generator.tool << " not found\n";
+            continue;
+        }
+
+        const QString image = QString("%1/%2.img").arg(directory, generator.name);
+        QString error;
+        if (generator.needsEmptyImage && !createEmptyImage(image)) {
+            BenchUtil::out() << "skip " << generator.name << ": cannot create " << image << "\n";
+            continue;
+        }
+        if (!runTool(tool, generator.arguments(image), &error)) {
+            BenchUtil::out() << "skip " << generator.name << ": " << error << "\n";
+            continue;
+        }
+        images.append({generator.name, image});
+    }
+    return images;
+}
+
+qint64 scanBlocks(const uchar *data, qint64 size, bool (*scan)(const uchar*, qint64, quint32&))
+{
+    const qint64 blockSize = SparseImage::DEFAULT_BLOCK_SIZE;
+    qint64 fillBlocks = 0;
+    for (qint64 offset = 0; offset + blockSize <= size; offset += blockSize) {
+        quint32 value;
+        if (scan(data + offset, blockSize, value)) {
+            ++fillBlocks;
+        }
+    }
+    return fillBlocks;
+}
+
+bool writeEncoded(const SparseImage &sparse, const uchar *source, const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+    SparseImage::Download encoded;
+    if (!sparse.encode(encoded)) {
+        return false;
+    }
+    for (const SparseImage::Segment &segment : encoded.segments) {
+        const qint64 size = segment.size();
+        const char *data = segment.bytes.isEmpty()
+            ? reinterpret_cast<const char*>(source + segment.sourceOffset) : segment.bytes.constData();
+        if (file.write(data, size) != size) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool benchImage(const BenchImage &image, int iterations, const QString &workDirectory)
+{
+    QFile raw(image.path);
+    if (!raw.open(QIODevice::ReadOnly) || raw.size() == 0) {
+        BenchUtil::out() << image.name << ": cannot open " << image.path << "\n";
+        return false;
+    }
+    const qint64 rawSize = raw.size();
+    const uchar *rawData = raw.map(0, rawSize);
+    if (!rawData) {
+        BenchUtil::out() << image.name << ": cannot map " << image.path << "\n";
+        return false;
+    }
+
+    // 先完整读一遍，使后续各项都在页缓存上比较
+    qint64 fillBlocks = scanBlocks(rawData, rawSize, &BlockScan::fillValueScalar);
+    qint64 scalarNs = BenchUtil::bestOf(iterations, [&]() {
+        return scanBlocks(rawData, rawSize, &BlockScan::fillValueScalar) == fillBlocks;
+    });
+    qint64 vectorNs = BenchUtil::bestOf(iterations, [&]() {
+        return scanBlocks(rawData, rawSize, &BlockScan::fillValue) == fillBlocks;
+    });
+
+    SparseImage encoded;
+    qint64 encodeNs = BenchUtil::bestOf(iterations, [&]() {
+        if (!encoded.load(rawData, rawSize)) {
+            return false;
+        }
+        encoded.scan(rawData);
+        return true;
+    });
+
+    // 编码结果写成 sparse 文件，再按 sparse 文件解码，逐字节与原镜像比较
+    const QString sparsePath = QDir(workDirectory).filePath(QFileInfo(image.path).completeBaseName() + ".simg");
+    bool verified = false;
+    qint64 decodeNs = -1;
+    qint64 sparseSize = 0;
+    if (encodeNs >= 0 && writeEncoded(encoded, rawData, sparsePath)) {
+        QFile sparseFile(sparsePath);
+        const uchar *sparseData = sparseFile.open(QIODevice::ReadOnly) ? sparseFile.map(0, sparseFile.size()) : nullptr;
+        sparseSize = sparseFile.size();
+        if (sparseData) {
+            decodeNs = BenchUtil::bestOf(iterations, [&]() {
+                SparseImage decoded;
+                qint64 position = 0;
+                verified = decoded.load(sparseData, sparseSize) && decoded.isSparse()
+                    && decoded.expand(sparseData, [&](const char *data, qint64 size) {
+                        // 原镜像之后只能是补齐最后一块的零
+                        qint64 compared = qBound<qint64>(0, rawSize - position, size);
+                        bool same = std::memcmp(data, rawData + position, static_cast<size_t>(compared)) == 0;
+                        for (qint64 i = compared; same && i < size; ++i) {
+                            same = data[i] == 0;
+                        }
+                        position += size;
+                        return same;
+                    })
+                    && position >= rawSize;
+                return verified;
+            });
+        }
+    }
+    QFile::remove(sparsePath);
+
+    BenchUtil::out() << QString("%1 %2 MiB, %3 fill blocks of %4\n")
+        .arg(image.name, -6).arg(rawSize / (1024 * 1024))
+        .arg(fillBlocks).arg((rawSize + SparseImage::DEFAULT_BLOCK_SIZE - 1) / SparseImage::DEFAULT_BLOCK_SIZE);
+    BenchUtil::out() << QString("  scan scalar   %1 MB/s\n").arg(BenchUtil::megabytesPerSecond(rawSize, scalarNs), 9, 'f', 1);
+    BenchUtil::out() << QString("  scan %1 %2 MB/s (%3x)\n")
+        .arg(QString::fromLatin1(BlockScan::instructionSet()), -8)
+        .arg(BenchUtil::megabytesPerSecond(rawSize, vectorNs), 9, 'f', 1)
+        .arg(vectorNs > 0 ? static_cast<double>(scalarNs) / vectorNs : 0.0, 0, 'f', 2);
+    BenchUtil::out() << QString("  encode        %1 MB/s -> %2 MiB sparse (%3% of raw)\n")
+        .arg(BenchUtil::megabytesPerSecond(rawSize, encodeNs), 9, 'f', 1)
+        .arg(encoded.encodedSize() / (1024.0 * 1024.0), 0, 'f', 1)
+        .arg(100.0 * encoded.encodedSize() / rawSize, 0, 'f', 1);
+    BenchUtil::out() << QString("  decode        %1 MB/s, %2\n")
+        .arg(BenchUtil::megabytesPerSecond(rawSize, decodeNs), 9, 'f', 1)
+        .arg(verified ? "verified" : "MISMATCH");
+    BenchUtil::out().flush();
+    return verified;
+}
+
+} // namespace
+
+int SparseBenchmark::run(const QStringList &arguments)
+{
+    int iterations = DEFAULT_ITERATIONS;
+    QList<BenchImage> images;
+    for (int i = 1; i < arguments.size(); ++i) {
+        const QString &argument = arguments.at(i);
+        if (argument == "--iterations" && i + 1 < arguments.size()) {
+            iterations = qMax(1, arguments.at(++i).toInt());
+        } else {
+            images.append({QFileInfo(argument).fileName(), argument});
+        }
+    }
+
+    QTemporaryDir workDirectory;
+    if (!workDirectory.isValid()) {
+        BenchUtil::out() << "Cannot create temporary directory\n";
+        return 1;
+    }
+    if (images.isEmpty()) {
+        const QString directory = toolsDirectory();
+        BenchUtil::out() << "Generating test images with tools from " << (directory.isEmpty() ? QString("PATH") : directory) << "\n";
+        images = generateImages(workDirectory.path());
+        if (images.isEmpty()) {
+            BenchUtil::out() << "No benchmark images available\n";
+            return 1;
+        }
+    }
+
+    BenchUtil::out() << "Sparse codec benchmark, best of " << iterations << " runs, block scan: "
+          << BlockScan::instructionSet() << "\n";
+    bool ok = true;
+    for (const BenchImage &image : std::as_const(images)) {
+        ok = benchImage(image, iterations, workDirectory.path()) && ok;
+    }
+    return ok ? 0 : 1;
+}
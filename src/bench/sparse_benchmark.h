@@ -0,0 +1,17 @@
+#ifndef SPARSE_BENCHMARK_H
+#define SPARSE_BENCHMARK_H
+
+#include <QStringList>
+
+// sparse 编解码基准测试：PhoneToolboxBench --sparse-bench [--iterations N] [镜像...]
+// 未指定镜像时用 mke2fs/make_f2fs/mkfs.erofs 生成 ext4/f2fs/erofs 测试镜像，
+// 工具先在 PTB_TOOLS_DIR 环境变量指定的目录 (如源码树中的 third_party/adb_binaries/linux) 中查找，其次 PATH
+// 对每个镜像分别测量逐字扫描与向量化扫描、编码、流式解码的吞吐量，并校验解码结果与原镜像一致
+class SparseBenchmark
+{
+public:
+    // 返回进程退出码
+    static int run(const QStringList &arguments);
+};
+
+#endif // SPARSE_BENCHMARK_H
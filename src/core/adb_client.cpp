@@ -0,0 +1,337 @@
+#include "adb_client.h"
+#include <QTcpSocket>
+#include <QHostAddress>
+#include <QMutexLocker>
+#include <QtEndian>
+#include <QDebug>
+#include <climits>
+
+namespace {
+
+// shell v2 协议数据包类型
+enum ShellPacketId {
+    SHELL_STDIN = 0,
+    SHELL_STDOUT = 1,
+    SHELL_STDERR = 2,
+    SHELL_EXIT = 3
+};
+
+int remainingMs(const QDeadlineTimer &deadline)
+{
+    qint64 remaining = deadline.remainingTime();
+    if (remaining < 0) {
+        return -1;
+    }
+    return static_cast<int>(qMin<qint64>(remaining, INT_MAX));
+}
+
+void setError(QString *error, const QString &message)
+{
+    if (error) {
+        *error = message;
+    }
+}
+
+} // namespace
+
+AdbClient::AdbClient(quint16 port)
+    : m_port(port)
+{
+}
+
+quint16 AdbClient::port() const
+{
+    return m_port;
+}
+
+QString AdbClient::connectionError()
+{
+    return QStringLiteral("connection");
+}
+
+QByteArray AdbClient::frameRequest(const QString &request)
+{
+    QByteArray payload = request.toUtf8();
+    return QByteArray::number(payload.size(), 16).rightJustified(4, '0') + payload;
+}
+
+bool AdbClient::cachedShellV2Support(const QString &serial, bool &supported)
+{
+    QMutexLocker locker(&m_featureMutex);
+    auto it = m_shellV2Support.constFind(serial);
+    if (it == m_shellV2Support.constEnd()) {
+        return false;
+    }
+    supported = it.value();
+    return true;
+}
+
+void AdbClient::setShellV2Support(const QString &serial, bool supported)
+{
+    QMutexLocker locker(&m_featureMutex);
+    m_shellV2Support.insert(serial, supported);
+}
+
+bool AdbClient::isServerRunning(int timeout)
+{
+    QByteArray version;
+    return hostQuery("host:version", version, timeout);
+}
+
+bool AdbClient::hostQuery(const QString &service, QByteArray &payload, int timeout, QString *error)
+{
+    QDeadlineTimer deadline(timeout);
+    QTcpSocket socket;
+
+    if (!connectToServer(socket, deadline, error)) {
+        return false;
+    }
+    if (!sendRequest(socket, service, deadline, error) || !readStatus(socket, deadline, error)) {
+        return false;
+    }
+    if (!readLengthPrefixed(socket, payload, deadline)) {
+        setError(error, "Timeout reading reply of " + service);
+        return false;
+    }
+    return true;
+}
+
+bool AdbClient::listDevices(QByteArray &output, bool longFormat, int timeout, QString *error)
+{
+    return hostQuery(longFormat ? "host:devices-l" : "host:devices", output, timeout, error);
+}
+
+QStringList AdbClient::features(const QString &serial, int timeout, QString *error)
+{
+    QByteArray payload;
+    QString service = serial.isEmpty()
+        ? QStringLiteral("host:features")
+        : QString("host-serial:%1:features").arg(serial);
+
+    if (!hostQuery(service, payload, timeout, error)) {
+        return QStringList();
+    }
+    return QString::fromUtf8(payload).trimmed().split(',', Qt::SkipEmptyParts);
+}
+
+bool AdbClient::shell(const QString &serial, const QString &command, ShellResult &result,
+                      int timeout, QString *error)
+{
+    QDeadlineTimer deadline(timeout);
+    bool useV2 = supportsShellV2(serial, deadline);
+
+    QTcpSocket socket;
+    QString service = (useV2 ? QStringLiteral("shell,v2,raw:") : QStringLiteral("shell:")) + command;
+    if (!openService(socket, serial, service, deadline, error)) {
+        return false;
+    }
+
+    result = ShellResult();
+    if (useV2) {
+        if (!readShellV2(socket, result, deadline)) {
+            setError(error, "Timeout waiting for shell command: " + command);
+            return false;
+        }
+    } else if (!readUntilClosed(socket, result.stdOut, deadline)) {
+        setError(error, "Timeout waiting for shell command: " + command);
+        return false;
+    }
+    return true;
+}
+
+bool AdbClient::exec(const QString &serial, const QString &command, QByteArray &output,
+                     int timeout, QString *error)
+{
+    QDeadlineTimer deadline(timeout);
+    QTcpSocket socket;
+
+    if (!openService(socket, serial, "exec:" + command, deadline, error)) {
+        return false;
+    }
+    output.clear();
+    if (!readUntilClosed(socket, output, deadline)) {
+        setError(error, "Timeout waiting for exec command: " + command);
+        return false;
+    }
+    return true;
+}
+
+bool AdbClient::reboot(const QString &serial, const QString &target, int timeout, QString *error)
+{
+    QDeadlineTimer deadline(timeout);
+    QTcpSocket socket;
+
+    // adbd 回复 OKAY 后即开始重启，连接随之关闭
+    return openService(socket, serial, "reboot:" + target, deadline, error);
+}
+
+bool AdbClient::connectToServer(QTcpSocket &socket, const QDeadlineTimer &deadline, QString *error)
+{
+    socket.connectToHost(QHostAddress(QHostAddress::LocalHost), m_port);
+    if (!socket.waitForConnected(remainingMs(deadline))) {
+        setError(error, connectionError());
+        return false;
+    }
+    return true;
+}
+
+bool AdbClient::openService(QTcpSocket &socket, const QString &serial, const QString &service,
+                            const QDeadlineTimer &deadline, QString *error)
+{
+    if (!connectToServer(socket, deadline, error)) {
+        return false;
+    }
+
+    // 先切换到目标设备的传输通道，再在同一连接上请求设备端服务
+    QString transport = serial.isEmpty()
+        ? QStringLiteral("host:transport-any")
+        : QString("host:transport:%1").arg(serial);
+
+    if (!sendRequest(socket, transport, deadline, error) || !readStatus(socket, deadline, error)) {
+        return false;
+    }
+    return sendRequest(socket, service, deadline, error) && readStatus(socket, deadline, error);
+}
+
+bool AdbClient::sendRequest(QTcpSocket &socket, const QString &request,
+                            const QDeadlineTimer &deadline, QString *error)
+{
+    socket.write(frameRequest(request));
+    while (socket.bytesToWrite() > 0) {
+        if (!socket.waitForBytesWritten(remainingMs(deadline))) {
+            setError(error, "Failed to send request: " + request);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool AdbClient::readStatus(QTcpSocket &socket, const QDeadlineTimer &deadline, QString *error)
+{
+    QByteArray status;
+    if (!readExactly(socket, 4, status, deadline)) {
+        setError(error, "Timeout waiting for adb server reply");
+        return false;
+    }
+
+    if (status == "OKAY") {
+        return true;
+    }
+
+    if (status == "FAIL") {
+        QByteArray message;
+        readLengthPrefixed(socket, message, deadline);
+        setError(error, QString::fromUtf8(message));
+    } else {
+        setError(error, "Unexpected adb server reply: " + QString::fromLatin1(status));
+    }
+    return false;
+}
+
+bool AdbClient::readExactly(QTcpSocket &socket, qint64 size, QByteArray &data, const QDeadlineTimer &deadline)
+{
+    while (socket.bytesAvailable() < size) {
+        if (socket.state() != QAbstractSocket::ConnectedState) {
+            return false;
+        }
+        if (deadline.hasExpired() || !socket.waitForReadyRead(remainingMs(deadline))) {
+            if (socket.bytesAvailable() >= size) {
+                break;
+            }
+            return false;
+        }
+    }
+    data = socket.read(size);
+    return data.size() == size;
+}
+
+bool AdbClient::readLengthPrefixed(QTcpSocket &socket, QByteArray &data, const QDeadlineTimer &deadline)
+{
+    QByteArray header;
+    if (!readExactly(socket, 4, header, deadline)) {
+        return false;
+    }
+
+    bool ok = false;
+    int length = header.toInt(&ok, 16);
+    if (!ok) {
+        return false;
+    }
+    if (length == 0) {
+        data.clear();
+        return true;
+    }
+    return readExactly(socket, length, data, deadline);
+}
+
+bool AdbClient::readUntilClosed(QTcpSocket &socket, QByteArray &data, const QDeadlineTimer &deadline)
+{
+    for (;;) {
+        data += socket.readAll();
+        if (socket.state() != QAbstractSocket::ConnectedState) {
+            data += socket.readAll();
+            return true;
+        }
+        if (!socket.waitForReadyRead(remainingMs(deadline))) {
+            // 对端关闭连接同样会使 waitForReadyRead 返回 false
+            if (socket.state() != QAbstractSocket::ConnectedState) {
+                data += socket.readAll();
+                return true;
+            }
+            return false;
+        }
+    }
+}
+
+bool AdbClient::readShellV2(QTcpSocket &socket, ShellResult &result, const QDeadlineTimer &deadline)
+{
+    // 数据包格式: [id:1字节][length:4字节小端][data]
+    for (;;) {
+        QByteArray header;
+        if (!readExactly(socket, 5, header, deadline)) {
+            // 未收到退出包便断开，按已收到的数据返回
+            return socket.state() != QAbstractSocket::ConnectedState;
+        }
+
+        quint8 id = static_cast<quint8>(header.at(0));
+        quint32 length = qFromLittleEndian<quint32>(header.constData() + 1);
+
+        QByteArray data;
+        if (length > 0 && !readExactly(socket, length, data, deadline)) {
+            return false;
+        }
+
+        switch (id) {
+        case SHELL_STDOUT:
+            result.stdOut += data;
+            break;
+        case SHELL_STDERR:
+            result.stdErr += data;
+            break;
+        case SHELL_EXIT:
+            result.exitCode = data.isEmpty() ? 0 : static_cast<quint8>(data.at(0));
+            return true;
+        default:
+            break;
+        }
+    }
+}
+
+bool AdbClient::supportsShellV2(const QString &serial, const QDeadlineTimer &deadline)
+{
+    bool supported = false;
+    if (cachedShellV2Support(serial, supported)) {
+        return supported;
+    }
+
+    QString error;
+    QStringList deviceFeatures = features(serial, remainingMs(deadline), &error);
+    if (!error.isEmpty()) {
+        // 查询失败时不缓存，使用兼容性最好的 v1 协议
+        return false;
+    }
+
+    supported = deviceFeatures.contains("shell_v2");
+    setShellV2Support(serial, supported);
+    return supported;
+}
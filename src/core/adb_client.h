@@ -0,0 +1,66 @@
+#ifndef ADB_CLIENT_H
+#define ADB_CLIENT_H
+
+#include <QByteArray>
+#include <QDeadlineTimer>
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+
+class QTcpSocket;
+
+// adb server 智能套接字协议客户端 (默认 localhost:5037)
+// 每次调用使用独立的TCP连接，因此可以在任意线程中并发使用
+class AdbClient
+{
+public:
+    struct ShellResult {
+        int exitCode = -1;      // shell v1 协议无法获取退出码，此时为 -1
+        QByteArray stdOut;
+        QByteArray stdErr;      // shell v1 协议下 stderr 合并在 stdOut 中
+    };
+
+    explicit AdbClient(quint16 port = 5037);
+
+    quint16 port() const;
+    bool isServerRunning(int timeout = 1000);
+
+    // 返回值为 false 时, error 为 "connection" 表示无法连接到 adb server
+    // 其余为 adb server / adbd 返回的 FAIL 消息
+    bool hostQuery(const QString &service, QByteArray &payload, int timeout, QString *error = nullptr);
+    bool listDevices(QByteArray &output, bool longFormat, int timeout, QString *error = nullptr);
+    QStringList features(const QString &serial, int timeout, QString *error = nullptr);
+
+    bool shell(const QString &serial, const QString &command, ShellResult &result,
+               int timeout, QString *error = nullptr);
+    bool exec(const QString &serial, const QString &command, QByteArray &output,
+              int timeout, QString *error = nullptr);
+    bool reboot(const QString &serial, const QString &target, int timeout, QString *error = nullptr);
+
+    static QString connectionError();
+    // 按 "4位十六进制长度 + 内容" 格式封装请求
+    static QByteArray frameRequest(const QString &request);
+
+    // shell v2 支持情况缓存，异步执行路径 (AdbCommandRunner) 与同步接口共用
+    bool cachedShellV2Support(const QString &serial, bool &supported);
+    void setShellV2Support(const QString &serial, bool supported);
+
+private:
+    bool connectToServer(QTcpSocket &socket, const QDeadlineTimer &deadline, QString *error);
+    bool openService(QTcpSocket &socket, const QString &serial, const QString &service,
+                     const QDeadlineTimer &deadline, QString *error);
+    bool sendRequest(QTcpSocket &socket, const QString &request, const QDeadlineTimer &deadline, QString *error);
+    bool readStatus(QTcpSocket &socket, const QDeadlineTimer &deadline, QString *error);
+    bool readExactly(QTcpSocket &socket, qint64 size, QByteArray &data, const QDeadlineTimer &deadline);
+    bool readLengthPrefixed(QTcpSocket &socket, QByteArray &data, const QDeadlineTimer &deadline);
+    bool readUntilClosed(QTcpSocket &socket, QByteArray &data, const QDeadlineTimer &deadline);
+    bool readShellV2(QTcpSocket &socket, ShellResult &result, const QDeadlineTimer &deadline);
+    bool supportsShellV2(const QString &serial, const QDeadlineTimer &deadline);
+
+    quint16 m_port;
+    QMutex m_featureMutex;
+    QHash<QString, bool> m_shellV2Support;
+};
+
+#endif // ADB_CLIENT_H
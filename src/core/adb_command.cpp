@@ -0,0 +1,620 @@
+#include "adb_command.h"
+#include "adb_client.h"
+#include "spawned_process.h"
+#include <QFutureWatcher>
+#include <QHostAddress>
+#include <QRegularExpression>
+#include <QPromise>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QtEndian>
+#include <QDebug>
+#include <climits>
+#include <memory>
+
+namespace {
+
+// shell v2 协议数据包类型
+enum ShellPacketId {
+    SHELL_STDIN = 0,
+    SHELL_STDOUT = 1,
+    SHELL_STDERR = 2,
+    SHELL_EXIT = 3,
+    SHELL_CLOSE_STDIN = 4
+};
+
+QByteArray shellPacket(ShellPacketId id, const QByteArray &data)
+{
+    QByteArray packet(5, Qt::Uninitialized);
+    packet[0] = static_cast<char>(id);
+    qToLittleEndian<quint32>(static_cast<quint32>(data.size()), packet.data() + 1);
+    return packet + data;
+}
+
+using ResultPromise = std::shared_ptr<QPromise<AdbCommandResult>>;
+
+// 单条命令的执行过程，创建于I/O线程，完成、超时或被取消后自行销毁
+class AdbOperation : public QObject
+{
+public:
+    AdbOperation(AdbClient &client, const ResultPromise &promise,
+                 const AdbCommandOptions &options, QObject *parent);
+
+    void startProcess(const AdbCommandRunner::ProcessRequest &request);
+    void startService(const AdbCommandRunner::ServiceRequest &request);
+    void startShell(const QString &serial, const QString &command, const QByteArray &stdIn,
+                    const AdbCommandRunner::ProcessRequest &fallback);
+
+private:
+    enum SocketState {
+        STATE_CONNECTING,
+        STATE_STATUS,
+        STATE_FAIL_MESSAGE,
+        STATE_REPLY
+    };
+
+    void startShellService(const QString &serial, const QString &command, const QByteArray &stdIn,
+                           const AdbCommandRunner::ProcessRequest &fallback, bool useV2);
+    void finishFeatureQuery(const QByteArray *features);
+    void connectSocket();
+    void sendNextRequest();
+    void processSocketData();
+    void processReply();
+    bool takeLengthPrefixed(QByteArray &payload);
+    void onSocketDisconnected();
+    void onSocketError();
+    void serviceFailed(const QString &error);
+
+    void appendOutput(AdbOutputChannel channel, const QByteArray &data);
+    void complete();
+    void fail(const QString &error);
+    void cancel();
+    void abortTransport();
+
+    AdbClient &m_client;
+    ResultPromise m_promise;
+    AdbCommandOptions m_options;
+    AdbCommandResult m_result;
+    QFutureWatcher<AdbCommandResult> m_watcher;
+    QTimer m_deadlineTimer;
+    SpawnedProcess *m_process = nullptr;
+    QTcpSocket *m_socket = nullptr;
+    AdbCommandRunner::ServiceRequest m_request;
+    QStringList m_pendingRequests;
+    QByteArray m_buffer;
+    SocketState m_state = STATE_CONNECTING;
+    QString m_shellCommand;     // 非空表示正在查询设备是否支持 shell v2
+    QByteArray m_shellStdIn;
+    bool m_finished = false;
+};
+
+AdbOperation::AdbOperation(AdbClient &client, const ResultPromise &promise,
+                           const AdbCommandOptions &options, QObject *parent)
+    : QObject(parent)
+    , m_client(client)
+    , m_promise(promise)
+    , m_options(options)
+{
+    connect(&m_watcher, &QFutureWatcherBase::canceled, this, &AdbOperation::cancel);
+    m_watcher.setFuture(m_promise->future());
+
+    if (!m_options.deadline.isForever()) {
+        m_deadlineTimer.setSingleShot(true);
+        connect(&m_deadlineTimer, &QTimer::timeout, this, [this]() {
+            abortTransport();
+            m_result.timedOut = true;
+            fail("Command timeout");
+        });
+        qint64 remaining = qBound<qint64>(0, m_options.deadline.remainingTime(), INT_MAX);
+        m_deadlineTimer.start(static_cast<int>(remaining));
+    }
+}
+
+void AdbOperation::startProcess(const AdbCommandRunner::ProcessRequest &request)
+{
+    if (m_finished) {
+        return;
+    }
+
+    m_process = new SpawnedProcess(this);
+    connect(m_process, &SpawnedProcess::standardOutput, this, [this](const QByteArray &data) {
+        appendOutput(AdbOutputChannel::StdOut, data);
+    });
+    connect(m_process, &SpawnedProcess::standardError, this, [this](const QByteArray &data) {
+        appendOutput(AdbOutputChannel::StdErr, data);
+    });
+    connect(m_process, &SpawnedProcess::finished, this, [this](int exitCode, bool crashed) {
+        m_result.exitCode = exitCode;
+        if (crashed) {
+            m_result.error = "Process crashed";
+        }
+        complete();
+    });
+
+    qDebug() << "Executing command:" << request.program << request.arguments;
+    QString error;
+    if (!m_process->start(request.program, request.arguments, request.stdIn, &error)) {
+        fail("Failed to start " + request.program + ": " + error);
+    }
+}
+
+void AdbOperation::startService(const AdbCommandRunner::ServiceRequest &request)
+{
+    if (m_finished) {
+        return;
+    }
+
+    m_request = request;
+    m_pendingRequests.clear();
+    if (!request.hostService) {
+        // 先切换到目标设备的传输通道，再在同一连接上请求设备端服务
+        m_pendingRequests << (request.serial.isEmpty()
+            ? QStringLiteral("host:transport-any")
+            : QString("host:transport:%1").arg(request.serial));
+    }
+    m_pendingRequests << request.service;
+    connectSocket();
+}
+
+void AdbOperation::startShell(const QString &serial, const QString &command, const QByteArray &stdIn,
+                              const AdbCommandRunner::ProcessRequest &fallback)
+{
+    bool useV2 = false;
+    if (m_client.cachedShellV2Support(serial, useV2)) {
+        startShellService(serial, command, stdIn, fallback, useV2);
+        return;
+    }
+
+    // 首次访问该设备时先查询 features，结果与同步接口共用缓存
+    m_shellCommand = command;
+    m_shellStdIn = stdIn;
+    AdbCommandRunner::ServiceRequest query;
+    query.serial = serial;
+    query.hostService = true;
+    query.service = serial.isEmpty()
+        ? QStringLiteral("host:features")
+        : QString("host-serial:%1:features").arg(serial);
+    query.reply = AdbCommandRunner::REPLY_LENGTH_PREFIXED;
+    query.fallback = fallback;
+    startService(query);
+}
+
+void AdbOperation::startShellService(const QString &serial, const QString &command, const QByteArray &stdIn,
+                                     const AdbCommandRunner::ProcessRequest &fallback, bool useV2)
+{
+    AdbCommandRunner::ServiceRequest request;
+    request.serial = serial;
+    request.stdIn = stdIn;
+    request.service = (useV2 ? QStringLiteral("shell,v2,raw:") : QStringLiteral("shell:")) + command;
+    request.reply = useV2 ? AdbCommandRunner::REPLY_SHELL_V2 : AdbCommandRunner::REPLY_UNTIL_CLOSED;
+    request.fallback = fallback;
+    startService(request);
+}
+
+void AdbOperation::finishFeatureQuery(const QByteArray *features)
+{
+    QString command = m_shellCommand;
+    m_shellCommand.clear();
+
+    // 查询失败时不缓存，使用兼容性最好的 v1 协议
+    bool useV2 = false;
+    if (features) {
+        useV2 = QString::fromUtf8(*features).trimmed().split(',', Qt::SkipEmptyParts).contains("shell_v2");
+        m_client.setShellV2Support(m_request.serial, useV2);
+    }
+    startShellService(m_request.serial, command, m_shellStdIn, m_request.fallback, useV2);
+}
+
+void AdbOperation::connectSocket()
+{
+    if (m_socket) {
+        m_socket->disconnect(this);
+        m_socket->abort();
+        m_socket->deleteLater();
+    }
+    m_buffer.clear();
+    m_state = STATE_CONNECTING;
+
+    m_socket = new QTcpSocket(this);
+    connect(m_socket, &QTcpSocket::connected, this, &AdbOperation::sendNextRequest);
+    connect(m_socket, &QTcpSocket::readyRead, this, &AdbOperation::processSocketData);
+    connect(m_socket, &QTcpSocket::disconnected, this, &AdbOperation::onSocketDisconnected);
+    connect(m_socket, &QTcpSocket::errorOccurred, this, &AdbOperation::onSocketError);
+    m_socket->connectToHost(QHostAddress(QHostAddress::LocalHost), m_client.port());
+}
+
+void AdbOperation::sendNextRequest()
+{
+    if (m_pendingRequests.isEmpty()) {
+        m_state = STATE_REPLY;
+        if (m_request.reply == AdbCommandRunner::REPLY_NONE) {
+            // 如 reboot: adbd 回复 OKAY 后即开始执行，连接随之关闭
+            m_result.exitCode = 0;
+            complete();
+        } else if (m_request.reply == AdbCommandRunner::REPLY_SHELL_V2) {
+            // v2 协议下写完标准输入后通知设备端 EOF
+            if (!m_request.stdIn.isEmpty()) {
+                m_socket->write(shellPacket(SHELL_STDIN, m_request.stdIn));
+            }
+            m_socket->write(shellPacket(SHELL_CLOSE_STDIN, QByteArray()));
+        } else if (!m_request.stdIn.isEmpty()) {
+            // v1 协议无法单独关闭标准输入，命令需自行判断输入结束
+            m_socket->write(m_request.stdIn);
+        }
+        return;
+    }
+
+    m_state = STATE_STATUS;
+    m_socket->write(AdbClient::frameRequest(m_pendingRequests.takeFirst()));
+}
+
+void AdbOperation::processSocketData()
+{
+    m_buffer += m_socket->readAll();
+
+    while (!m_finished) {
+        switch (m_state) {
+        case STATE_STATUS: {
+            if (m_buffer.size() < 4) {
+                return;
+            }
+            QByteArray status = m_buffer.left(4);
+            m_buffer.remove(0, 4);
+            if (status == "OKAY") {
+                sendNextRequest();
+            } else if (status == "FAIL") {
+                m_state = STATE_FAIL_MESSAGE;
+            } else {
+                serviceFailed("Unexpected adb server reply: " + QString::fromLatin1(status));
+                return;
+            }
+            break;
+        }
+        case STATE_FAIL_MESSAGE: {
+            QByteArray message;
+            if (takeLengthPrefixed(message)) {
+                serviceFailed(QString::fromUtf8(message));
+            }
+            return;
+        }
+        case STATE_REPLY:
+            processReply();
+            return;
+        default:
+            return;
+        }
+    }
+}
+
+void AdbOperation::processReply()
+{
+    switch (m_request.reply) {
+    case AdbCommandRunner::REPLY_LENGTH_PREFIXED: {
+        QByteArray payload;
+        if (!takeLengthPrefixed(payload)) {
+            return;
+        }
+        if (!m_shellCommand.isEmpty()) {
+            finishFeatureQuery(&payload);
+            return;
+        }
+        appendOutput(AdbOutputChannel::StdOut, m_request.stdOutPrefix + payload);
+        m_result.exitCode = 0;
+        complete();
+        return;
+    }
+    case AdbCommandRunner::REPLY_UNTIL_CLOSED:
+        appendOutput(AdbOutputChannel::StdOut, m_buffer);
+        m_buffer.clear();
+        return;
+    case AdbCommandRunner::REPLY_SHELL_V2:
+        // 数据包格式: [id:1字节][length:4字节小端][data]
+        while (m_buffer.size() >= 5) {
+            quint8 id = static_cast<quint8>(m_buffer.at(0));
+            quint32 length = qFromLittleEndian<quint32>(m_buffer.constData() + 1);
+            if (static_cast<quint64>(m_buffer.size()) < 5 + static_cast<quint64>(length)) {
+                return;
+            }
+            QByteArray data = m_buffer.mid(5, length);
+            m_buffer.remove(0, 5 + length);
+
+            switch (id) {
+            case SHELL_STDOUT:
+                appendOutput(AdbOutputChannel::StdOut, data);
+                break;
+            case SHELL_STDERR:
+                appendOutput(AdbOutputChannel::StdErr, data);
+                break;
+            case SHELL_EXIT:
+                m_result.exitCode = data.isEmpty() ? 0 : static_cast<quint8>(data.at(0));
+                complete();
+                return;
+            default:
+                break;
+            }
+        }
+        return;
+    default:
+        return;
+    }
+}
+
+bool AdbOperation::takeLengthPrefixed(QByteArray &payload)
+{
+    if (m_buffer.size() < 4) {
+        return false;
+    }
+
+    bool ok = false;
+    int length = m_buffer.left(4).toInt(&ok, 16);
+    if (!ok) {
+        fail("Malformed adb server reply");
+        return false;
+    }
+    if (m_buffer.size() < 4 + length) {
+        return false;
+    }
+
+    payload = m_buffer.mid(4, length);
+    m_buffer.remove(0, 4 + length);
+    return true;
+}
+
+void AdbOperation::onSocketDisconnected()
+{
+    if (m_finished) {
+        return;
+    }
+    processSocketData();
+    if (m_finished) {
+        return;
+    }
+
+    // shell v1 和 exec 以连接关闭表示结束；v2 未收到退出包便断开时按已收到的数据返回
+    if (m_state == STATE_REPLY
+        && (m_request.reply == AdbCommandRunner::REPLY_UNTIL_CLOSED
+            || m_request.reply == AdbCommandRunner::REPLY_SHELL_V2)) {
+        complete();
+        return;
+    }
+    serviceFailed("Connection closed by adb server");
+}
+
+void AdbOperation::onSocketError()
+{
+    // 连接建立后的错误由 disconnected 处理
+    if (m_finished || m_state != STATE_CONNECTING) {
+        return;
+    }
+
+    // 无法连接adb server时回退到adb进程（adb会自动拉起server）
+    m_socket->disconnect(this);
+    if (m_request.fallback.program.isEmpty()) {
+        fail(AdbClient::connectionError());
+        return;
+    }
+    qDebug() << "adb server unavailable, falling back to adb process";
+    startProcess(m_request.fallback);
+}
+
+void AdbOperation::serviceFailed(const QString &error)
+{
+    if (!m_shellCommand.isEmpty()) {
+        finishFeatureQuery(nullptr);
+        return;
+    }
+    fail(error);
+}
+
+void AdbOperation::appendOutput(AdbOutputChannel channel, const QByteArray &data)
+{
+    if (data.isEmpty()) {
+        return;
+    }
+    if (channel == AdbOutputChannel::StdOut) {
+        m_result.stdOut += data;
+    } else {
+        m_result.stdErr += data;
+    }
+    if (m_options.onOutput) {
+        m_options.onOutput(channel, data);
+    }
+}
+
+void AdbOperation::complete()
+{
+    if (m_finished) {
+        return;
+    }
+    m_finished = true;
+    m_deadlineTimer.stop();
+    abortTransport();
+
+    m_promise->addResult(m_result);
+    m_promise->finish();
+    deleteLater();
+}
+
+void AdbOperation::fail(const QString &error)
+{
+    m_result.error = error;
+    complete();
+}
+
+void AdbOperation::cancel()
+{
+    if (m_finished) {
+        return;
+    }
+    m_finished = true;
+    m_deadlineTimer.stop();
+    abortTransport();
+
+    // 已取消的 QFuture 不再接受结果
+    m_promise->finish();
+    deleteLater();
+}
+
+void AdbOperation::abortTransport()
+{
+    if (m_process) {
+        m_process->disconnect(this);
+        m_process->kill();
+    }
+    if (m_socket) {
+        m_socket->disconnect(this);
+        m_socket->abort();
+    }
+}
+
+template <typename Start>
+QFuture<AdbCommandResult> launch(AdbCommandRunner *runner, AdbClient &client,
+                                 const AdbCommandOptions &options, Start start)
+{
+    ResultPromise promise = std::make_shared<QPromise<AdbCommandResult>>();
+    QFuture<AdbCommandResult> future = promise->future();
+    promise->start();
+
+    AdbClient *clientPtr = &client;
+    QMetaObject::invokeMethod(runner, [runner, clientPtr, promise, options, start]() {
+        if (promise->isCanceled()) {
+            promise->finish();
+            return;
+        }
+        start(new AdbOperation(*clientPtr, promise, options, runner));
+    }, Qt::QueuedConnection);
+    return future;
+}
+
+} // namespace
+
+AdbCommand AdbCommand::shell(const QString &serial, const QString &script)
+{
+    AdbCommand command;
+    command.serial = serial;
+    command.arguments << "shell" << script;
+    return command;
+}
+
+AdbCommand AdbCommand::reboot(const QString &serial, const QString &target)
+{
+    AdbCommand command;
+    command.serial = serial;
+    command.arguments << "reboot";
+    if (!target.isEmpty()) {
+        command.arguments << target;
+    }
+    return command;
+}
+
+AdbCommand AdbCommand::fromArguments(const QStringList &arguments)
+{
+    AdbCommand command;
+    command.arguments = arguments;
+    if (command.arguments.size() >= 2 && command.arguments.first() == "-s") {
+        command.serial = command.arguments.at(1);
+        command.arguments = command.arguments.mid(2);
+    }
+    return command;
+}
+
+QString AdbCommand::verb() const
+{
+    return arguments.value(0);
+}
+
+QString AdbCommand::deviceCommand() const
+{
+    if (arguments.size() == 2) {
+        return arguments.at(1);
+    }
+
+    QStringList quoted;
+    for (qsizetype i = 1; i < arguments.size(); ++i) {
+        quoted << quoteShellArgument(arguments.at(i));
+    }
+    return quoted.join(' ');
+}
+
+QStringList AdbCommand::processArguments() const
+{
+    QStringList result;
+    if (!serial.isEmpty()) {
+        result << "-s" << serial;
+    }
+
+    // adb 进程会把多个参数直接用空格拼接，带空格的参数需要提前合并为一个
+    const QString subcommand = verb();
+    if ((subcommand == "shell" || subcommand == "exec-out") && arguments.size() > 1) {
+        result << subcommand << deviceCommand();
+    } else {
+        result << arguments;
+    }
+    return result;
+}
+
+QString AdbCommand::toString() const
+{
+    QStringList quoted;
+    for (const QString &argument : processArguments()) {
+        quoted << quoteShellArgument(argument);
+    }
+    return quoted.join(' ');
+}
+
+QString AdbCommand::quoteShellArgument(const QString &argument)
+{
+    static const QRegularExpression safe("^[A-Za-z0-9_@%+=:,./-]+$");
+    if (safe.match(argument).hasMatch()) {
+        return argument;
+    }
+
+    // 单引号内不做任何解释，内部的单引号以 '\'' 表示
+    QString escaped = argument;
+    escaped.replace('\'', "'\\''");
+    return QLatin1Char('\'') + escaped + QLatin1Char('\'');
+}
+
+AdbCommandRunner::AdbCommandRunner(AdbClient &client, QObject *parent)
+    : QObject(parent)
+    , m_client(client)
+{
+}
+
+QFuture<AdbCommandResult> AdbCommandRunner::runProcess(const ProcessRequest &request,
+                                                       const AdbCommandOptions &options)
+{
+    return launch(this, m_client, options, [request](AdbOperation *operation) {
+        operation->startProcess(request);
+    });
+}
+
+QFuture<AdbCommandResult> AdbCommandRunner::runService(const ServiceRequest &request,
+                                                       const AdbCommandOptions &options)
+{
+    return launch(this, m_client, options, [request](AdbOperation *operation) {
+        operation->startService(request);
+    });
+}
+
+QFuture<AdbCommandResult> AdbCommandRunner::runShell(const QString &serial, const QString &command,
+                                                     const QByteArray &stdIn, const ProcessRequest &fallback,
+                                                     const AdbCommandOptions &options)
+{
+    return launch(this, m_client, options, [serial, command, stdIn, fallback](AdbOperation *operation) {
+        operation->startShell(serial, command, stdIn, fallback);
+    });
+}
+
+QFuture<AdbCommandResult> AdbCommandRunner::failedResult(const QString &error)
+{
+    AdbCommandResult result;
+    result.error = error;
+
+    QPromise<AdbCommandResult> promise;
+    QFuture<AdbCommandResult> future = promise.future();
+    promise.start();
+    promise.addResult(result);
+    promise.finish();
+    return future;
+}
@@ -0,0 +1,103 @@
+#ifndef ADB_COMMAND_H
+#define ADB_COMMAND_H
+
+#include <QByteArray>
+#include <QDeadlineTimer>
+#include <QFuture>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <functional>
+
+class AdbClient;
+
+enum class AdbOutputChannel {
+    StdOut,
+    StdErr
+};
+
+struct AdbCommandResult {
+    int exitCode = -1;      // 无法获取退出码时 (shell v1、exec) 为 -1
+    QByteArray stdOut;
+    QByteArray stdErr;
+    QString error;          // 非空表示命令未能完成：超时、无法启动、连接或协议错误
+    bool timedOut = false;
+
+    bool succeeded() const { return error.isEmpty() && exitCode <= 0; }
+};
+
+// 结构化的 adb 命令：参数逐个保存并原样传给 adb，不再按空格拆分命令行
+struct AdbCommand {
+    QString serial;
+    QStringList arguments;      // adb 子命令及其参数，不含 -s <serial>
+    QByteArray stdIn;           // 非空时写入命令的标准输入，写完后关闭
+
+    // 脚本作为单个整体交给设备端 sh -c 执行，管道、重定向和引号都在设备上处理
+    static AdbCommand shell(const QString &serial, const QString &script);
+    static AdbCommand reboot(const QString &serial, const QString &target = QString());
+    // 解析 "-s <serial> <子命令> ..." 形式的参数列表
+    static AdbCommand fromArguments(const QStringList &arguments);
+
+    QString verb() const;
+    // shell/exec-out 的设备端命令：单个参数原样使用，多个参数逐个转义后拼接
+    QString deviceCommand() const;
+    // 传给 adb 进程的完整参数，设备端命令始终作为一个参数传递
+    QStringList processArguments() const;
+    QString toString() const;
+
+    static QString quoteShellArgument(const QString &argument);
+};
+
+struct AdbCommandOptions {
+    QDeadlineTimer deadline = QDeadlineTimer(30000);
+    // 收到输出时立即回调，在I/O线程中执行，回调中不能同步等待其他命令
+    std::function<void(AdbOutputChannel channel, const QByteArray &data)> onOutput;
+};
+
+// 在专用I/O线程中以事件驱动方式执行命令，调用线程不阻塞
+// 原生请求直接走 adb server 协议，无法连接 server 时回退到 adb 进程 (SpawnedProcess)
+// 对返回的 QFuture 调用 cancel() 会终止进程或关闭连接，被取消的 QFuture 不含结果
+class AdbCommandRunner : public QObject
+{
+    Q_OBJECT
+
+public:
+    // adb server 应答的读取方式
+    enum ReplyMode {
+        REPLY_NONE,             // OKAY 即完成 (如 reboot)
+        REPLY_LENGTH_PREFIXED,  // host 查询
+        REPLY_UNTIL_CLOSED,     // shell v1 / exec
+        REPLY_SHELL_V2
+    };
+
+    struct ProcessRequest {
+        QString program;
+        QStringList arguments;
+        QByteArray stdIn;
+    };
+
+    struct ServiceRequest {
+        QString serial;
+        QString service;
+        bool hostService = false;   // true 时直接发给 adb server, 否则先切换到 serial 的传输通道
+        QByteArray stdIn;           // 服务建立后写入, shell v2 下随后发送关闭标准输入的数据包
+        ReplyMode reply = REPLY_UNTIL_CLOSED;
+        QByteArray stdOutPrefix;    // 成功时加在输出前, 使结果与 adb 进程的输出一致
+        ProcessRequest fallback;    // 无法连接 adb server 时执行, program 为空则直接失败
+    };
+
+    explicit AdbCommandRunner(AdbClient &client, QObject *parent = nullptr);
+
+    // 以下方法可在任意线程调用
+    QFuture<AdbCommandResult> runProcess(const ProcessRequest &request, const AdbCommandOptions &options);
+    QFuture<AdbCommandResult> runService(const ServiceRequest &request, const AdbCommandOptions &options);
+    QFuture<AdbCommandResult> runShell(const QString &serial, const QString &command, const QByteArray &stdIn,
+                                       const ProcessRequest &fallback, const AdbCommandOptions &options);
+
+    static QFuture<AdbCommandResult> failedResult(const QString &error);
+
+private:
+    AdbClient &m_client;
+};
+
+#endif // ADB_COMMAND_H
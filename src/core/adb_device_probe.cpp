@@ -0,0 +1,204 @@
+#include "adb_device_probe.h"
+
+namespace {
+
+const QByteArrayView SECTION_MARKER("@@PTB:");
+
+} // namespace
+
+QString AdbDeviceProbe::script()
+{
+    // 所有信息在同一次shell调用中输出，每段前输出分隔标记
+    return QStringLiteral(
+        "echo @@PTB:props; getprop; "
+        "echo @@PTB:su; which su 2>/dev/null; "
+        "echo @@PTB:imei; service call iphonesubinfo 1 2>/dev/null; "
+        "echo @@PTB:cpu; grep -ci processor /proc/cpuinfo; "
+        "echo @@PTB:mem; grep MemTotal /proc/meminfo; "
+        "echo @@PTB:battery; dumpsys battery 2>/dev/null; "
+        "echo @@PTB:bootid; cat /proc/sys/kernel/random/boot_id 2>/dev/null; "
+        "echo @@PTB:end");
+}
+
+QString AdbDeviceProbe::volatileScript()
+{
+    return QStringLiteral(
+        "echo @@PTB:bootid; cat /proc/sys/kernel/random/boot_id 2>/dev/null; "
+        "echo @@PTB:sim; getprop gsm.sim.state; "
+        "echo @@PTB:battery; dumpsys battery 2>/dev/null; "
+        "echo @@PTB:end");
+}
+
+AdbDeviceProbe::Sections AdbDeviceProbe::parse(QByteArrayView output)
+{
+    Sections sections;
+    QByteArrayView name;
+    qsizetype bodyStart = 0;
+
+    auto finishSection = [&](qsizetype bodyEnd) {
+        QByteArrayView body = output.sliced(bodyStart, bodyEnd - bodyStart).trimmed();
+        if (name == "props") {
+            parseProperties(body, sections.properties);
+        } else if (name == "su") {
+            sections.su = body;
+        } else if (name == "imei") {
+            sections.imei = body;
+        } else if (name == "cpu") {
+            sections.cpuCount = body;
+        } else if (name == "mem") {
+            sections.memTotal = body;
+        } else if (name == "battery") {
+            sections.battery = body;
+        } else if (name == "bootid") {
+            sections.bootId = body;
+        } else if (name == "sim") {
+            sections.sim = body;
+        }
+    };
+
+    qsizetype pos = 0;
+    while (pos < output.size()) {
+        qsizetype end = output.indexOf('\n', pos);
+        if (end < 0) {
+            end = output.size();
+        }
+
+        QByteArrayView line = output.sliced(pos, end - pos).trimmed();
+        if (line.startsWith(SECTION_MARKER)) {
+            if (!name.isEmpty()) {
+                finishSection(pos);
+            }
+            name = line.sliced(SECTION_MARKER.size());
+            bodyStart = qMin(end + 1, output.size());
+
+            if (name == "end") {
+                sections.complete = true;
+                name = QByteArrayView();
+                break;
+            }
+        }
+        pos = end + 1;
+    }
+
+    if (!name.isEmpty()) {
+        finishSection(output.size());
+    }
+    return sections;
+}
+
+void AdbDeviceProbe::fillDeviceInfo(const Sections &sections, DeviceInfo &info)
+{
+    info.manufacturer = property(sections, "ro.product.manufacturer");
+    info.model = property(sections, "ro.product.model");
+    info.deviceName = property(sections, "ro.product.device");
+    info.androidVersion = property(sections, "ro.build.version.release");
+    info.buildNumber = property(sections, "ro.build.display.id");
+    info.wifiMac = property(sections, "ro.boot.wifimacaddr");
+    info.simState = property(sections, "gsm.sim.state");
+    info.bootId = QString::fromUtf8(sections.bootId);
+
+    // which su 找不到时没有输出
+    info.isRooted = !sections.su.isEmpty();
+    info.imei = parseImei(sections.imei);
+
+    info.cpuInfo = QString::fromUtf8(sections.cpuCount) + " 核心";
+
+    // MemTotal:        5678900 kB
+    qsizetype colon = sections.memTotal.indexOf(':');
+    if (colon >= 0) {
+        info.ramSize = QString::fromUtf8(sections.memTotal.sliced(colon + 1).trimmed());
+    }
+
+    QByteArrayView level = fieldValue(sections.battery, "level");
+    if (!level.isEmpty()) {
+        info.batteryHealth = QString::fromUtf8(level) + "%";
+    }
+}
+
+void AdbDeviceProbe::fillVolatileInfo(const Sections &sections, DeviceInfo &info)
+{
+    info.bootId = QString::fromUtf8(sections.bootId);
+    info.simState = QString::fromUtf8(sections.sim);
+
+    QByteArrayView level = fieldValue(sections.battery, "level");
+    if (!level.isEmpty()) {
+        info.batteryHealth = QString::fromUtf8(level) + "%";
+    }
+}
+
+QString AdbDeviceProbe::property(const Sections &sections, const char *name)
+{
+    return QString::fromUtf8(sections.properties.value(QByteArrayView(name)));
+}
+
+void AdbDeviceProbe::parseProperties(QByteArrayView section, QHash<QByteArrayView, QByteArrayView> &properties)
+{
+    // 每行格式: [key]: [value]
+    qsizetype pos = 0;
+    while (pos < section.size()) {
+        qsizetype end = section.indexOf('\n', pos);
+        if (end < 0) {
+            end = section.size();
+        }
+
+        QByteArrayView line = section.sliced(pos, end - pos).trimmed();
+        pos = end + 1;
+
+        if (!line.startsWith('[') || !line.endsWith(']')) {
+            continue;
+        }
+        qsizetype separator = line.indexOf(QByteArrayView("]: ["));
+        if (separator < 1) {
+            continue;
+        }
+        properties.insert(line.sliced(1, separator - 1),
+                          line.sliced(separator + 4, line.size() - separator - 5));
+    }
+}
+
+QString AdbDeviceProbe::parseImei(QByteArrayView section)
+{
+    // service call 输出形如:
+    //   Result: Parcel(
+    //     0x00000000: 00000000 0000000f 00350033 00320035 '........3.5.2.5.'
+    // 取每行引号中的字符并去掉分隔用的 '.'
+    QString imei;
+    qsizetype pos = section.indexOf('\n');
+    while (pos >= 0 && pos < section.size()) {
+        qsizetype end = section.indexOf('\n', pos + 1);
+        if (end < 0) {
+            end = section.size();
+        }
+
+        QByteArrayView line = section.sliced(pos + 1, end - pos - 1);
+        qsizetype open = line.indexOf('\'');
+        qsizetype close = line.lastIndexOf('\'');
+        if (open >= 0 && close > open) {
+            for (char c : line.sliced(open + 1, close - open - 1)) {
+                if (c != '.' && c != ' ') {
+                    imei += QLatin1Char(c);
+                }
+            }
+        }
+        pos = end;
+    }
+    return imei;
+}
+
+QByteArrayView AdbDeviceProbe::fieldValue(QByteArrayView section, QByteArrayView key)
+{
+    qsizetype pos = 0;
+    while (pos < section.size()) {
+        qsizetype end = section.indexOf('\n', pos);
+        if (end < 0) {
+            end = section.size();
+        }
+
+        QByteArrayView line = section.sliced(pos, end - pos).trimmed();
+        if (line.startsWith(key) && line.size() > key.size() && line.at(key.size()) == ':') {
+            return line.sliced(key.size() + 1).trimmed();
+        }
+        pos = end + 1;
+    }
+    return QByteArrayView();
+}
@@ -0,0 +1,43 @@
+#ifndef ADB_DEVICE_PROBE_H
+#define ADB_DEVICE_PROBE_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QHash>
+#include <QString>
+#include "device_info.h"
+
+// 通过一次shell调用采集ADB设备信息
+// 探测脚本的输出以 "@@PTB:<段名>" 行分段，依次为 getprop 全量输出、su、IMEI、CPU、内存、电池和启动标识
+// 易变字段脚本只输出启动标识、SIM 状态和电池，用于在缓存有效期内刷新
+class AdbDeviceProbe
+{
+public:
+    // 解析结果直接引用原始输出的内存，输出缓冲区必须在使用期间保持有效
+    struct Sections {
+        QHash<QByteArrayView, QByteArrayView> properties;
+        QByteArrayView su;
+        QByteArrayView imei;
+        QByteArrayView cpuCount;
+        QByteArrayView memTotal;
+        QByteArrayView battery;
+        QByteArrayView bootId;
+        QByteArrayView sim;
+        bool complete = false;      // 是否读到结束标记
+    };
+
+    static QString script();
+    static QString volatileScript();
+    static Sections parse(QByteArrayView output);
+    static void fillDeviceInfo(const Sections &sections, DeviceInfo &info);
+    static void fillVolatileInfo(const Sections &sections, DeviceInfo &info);
+
+    static QString property(const Sections &sections, const char *name);
+
+private:
+    static void parseProperties(QByteArrayView section, QHash<QByteArrayView, QByteArrayView> &properties);
+    static QString parseImei(QByteArrayView section);
+    static QByteArrayView fieldValue(QByteArrayView section, QByteArrayView key);
+};
+
+#endif // ADB_DEVICE_PROBE_H
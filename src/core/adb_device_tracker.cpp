@@ -0,0 +1,154 @@
+#include "adb_device_tracker.h"
+#include <QTcpSocket>
+#include <QHostAddress>
+#include <QTimer>
+#include <QRegularExpression>
+#include <QDebug>
+
+AdbDeviceTracker::AdbDeviceTracker(quint16 port, QObject *parent)
+    : QObject(parent)
+    , m_socket(new QTcpSocket(this))
+    , m_reconnectTimer(new QTimer(this))
+    , m_port(port)
+    , m_state(STATE_IDLE)
+    , m_running(false)
+{
+    m_reconnectTimer->setSingleShot(true);
+    m_reconnectTimer->setInterval(3000);
+
+    connect(m_socket, &QTcpSocket::connected, this, &AdbDeviceTracker::onConnected);
+    connect(m_socket, &QTcpSocket::readyRead, this, &AdbDeviceTracker::onReadyRead);
+    connect(m_socket, &QTcpSocket::disconnected, this, &AdbDeviceTracker::onDisconnected);
+    connect(m_socket, &QTcpSocket::errorOccurred, this, [this](QAbstractSocket::SocketError) {
+        // 连接失败（如adb server未启动）不会触发disconnected
+        if (m_socket->state() == QAbstractSocket::UnconnectedState) {
+            onDisconnected();
+        }
+    });
+    connect(m_reconnectTimer, &QTimer::timeout, this, &AdbDeviceTracker::reconnect);
+}
+
+AdbDeviceTracker::~AdbDeviceTracker()
+{
+    m_running = false;
+    m_socket->disconnect(this);
+    m_socket->abort();
+}
+
+void AdbDeviceTracker::start()
+{
+    if (m_running) {
+        return;
+    }
+    m_running = true;
+    reconnect();
+}
+
+void AdbDeviceTracker::stop()
+{
+    m_running = false;
+    m_reconnectTimer->stop();
+    m_socket->abort();
+    setState(STATE_IDLE);
+}
+
+bool AdbDeviceTracker::isTracking() const
+{
+    return m_state == STATE_TRACKING;
+}
+
+void AdbDeviceTracker::reconnect()
+{
+    if (!m_running || m_socket->state() != QAbstractSocket::UnconnectedState) {
+        return;
+    }
+    m_buffer.clear();
+    m_socket->connectToHost(QHostAddress(QHostAddress::LocalHost), m_port);
+}
+
+void AdbDeviceTracker::onConnected()
+{
+    QByteArray request = "host:track-devices-l";
+    m_socket->write(QByteArray::number(request.size(), 16).rightJustified(4, '0') + request);
+    setState(STATE_WAITING_STATUS);
+}
+
+void AdbDeviceTracker::onReadyRead()
+{
+    m_buffer += m_socket->readAll();
+
+    if (m_state == STATE_WAITING_STATUS) {
+        if (m_buffer.size() < 4) {
+            return;
+        }
+        QByteArray status = m_buffer.left(4);
+        m_buffer.remove(0, 4);
+
+        if (status != "OKAY") {
+            qWarning() << "adb server rejected track-devices:" << m_buffer;
+            m_socket->abort();
+            onDisconnected();
+            return;
+        }
+        setState(STATE_TRACKING);
+        qDebug() << "ADB device tracking started";
+    }
+
+    // 每条推送消息为: 4位十六进制长度 + 设备列表
+    while (m_state == STATE_TRACKING && m_buffer.size() >= 4) {
+        bool ok = false;
+        int length = m_buffer.left(4).toInt(&ok, 16);
+        if (!ok) {
+            qWarning() << "Malformed track-devices message, reconnecting";
+            m_socket->abort();
+            onDisconnected();
+            return;
+        }
+        if (m_buffer.size() < 4 + length) {
+            break;
+        }
+
+        QByteArray payload = m_buffer.mid(4, length);
+        m_buffer.remove(0, 4 + length);
+        emit devicesUpdated(parseDeviceList(payload));
+    }
+}
+
+void AdbDeviceTracker::onDisconnected()
+{
+    setState(STATE_IDLE);
+    scheduleReconnect();
+}
+
+void AdbDeviceTracker::setState(State state)
+{
+    bool wasTracking = (m_state == STATE_TRACKING);
+    m_state = state;
+
+    if (wasTracking != (state == STATE_TRACKING)) {
+        emit trackingStateChanged(state == STATE_TRACKING);
+    }
+}
+
+void AdbDeviceTracker::scheduleReconnect()
+{
+    if (m_running && !m_reconnectTimer->isActive()) {
+        m_reconnectTimer->start();
+    }
+}
+
+QMap<QString, QString> AdbDeviceTracker::parseDeviceList(const QByteArray &payload)
+{
+    QMap<QString, QString> devices;
+    static const QRegularExpression whitespace("\\s+");
+
+    const QStringList lines = QString::fromUtf8(payload).split('\n', Qt::SkipEmptyParts);
+    for (const QString &line : lines) {
+        // 格式: <序列号> <状态> [product:x model:y device:z transport_id:n]
+        QStringList parts = line.split(whitespace, Qt::SkipEmptyParts);
+        if (parts.size() >= 2) {
+            devices.insert(parts.at(0), parts.at(1));
+        }
+    }
+    return devices;
+}
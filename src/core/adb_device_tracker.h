@@ -0,0 +1,57 @@
+#ifndef ADB_DEVICE_TRACKER_H
+#define ADB_DEVICE_TRACKER_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QMap>
+#include <QString>
+
+class QTcpSocket;
+class QTimer;
+
+// 通过 host:track-devices-l 长连接订阅adb设备变化
+// adb server 在每次设备增减或状态变化时推送完整的设备列表
+class AdbDeviceTracker : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit AdbDeviceTracker(quint16 port, QObject *parent = nullptr);
+    ~AdbDeviceTracker();
+
+    void start();
+    void stop();
+    bool isTracking() const;
+
+    // 解析设备列表，返回 序列号 -> 状态 (device / offline / unauthorized / recovery ...)
+    static QMap<QString, QString> parseDeviceList(const QByteArray &payload);
+
+signals:
+    void devicesUpdated(const QMap<QString, QString> &devices);
+    void trackingStateChanged(bool tracking);
+
+private slots:
+    void onConnected();
+    void onReadyRead();
+    void onDisconnected();
+    void reconnect();
+
+private:
+    enum State {
+        STATE_IDLE,
+        STATE_WAITING_STATUS,
+        STATE_TRACKING
+    };
+
+    void setState(State state);
+    void scheduleReconnect();
+
+    QTcpSocket *m_socket;
+    QTimer *m_reconnectTimer;
+    QByteArray m_buffer;
+    quint16 m_port;
+    State m_state;
+    bool m_running;
+};
+
+#endif // ADB_DEVICE_TRACKER_H
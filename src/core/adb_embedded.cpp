@@ -1,4 +1,6 @@
 #include "adb_embedded.h"
+#include "tool_cache.h"
+#include "startup_timing.h"
 #include <QCoreApplication>
 #include <QFile>
 #include <QDir>
@@ -6,26 +8,52 @@
 #include <QStandardPaths>
 #include <QDebug>
 #include <QThread>
+#include <QMutexLocker>
+#include <QProcessEnvironment>
+#include <QPromise>
+#include <memory>
 
-#ifdef Q_OS_WIN
-#include <windows.h>
-#else
-#include <sys/stat.h>
-#include <unistd.h>
-#endif
+namespace {
+
+const int SERVER_QUERY_TIMEOUT = 1000;      // 查询已运行的 adb server
+const int SERVER_START_TIMEOUT = 5000;      // adb start-server
+const int FASTBOOT_TEST_TIMEOUT = 3000;     // fastboot --version
+
+quint16 adbServerPort()
+{
+    // 与adb保持一致，支持通过环境变量指定server端口
+    bool ok = false;
+    int port = QProcessEnvironment::systemEnvironment()
+        .value("ANDROID_ADB_SERVER_PORT").toInt(&ok);
+    return (ok && port > 0 && port < 65536) ? static_cast<quint16>(port) : 5037;
+}
+
+} // namespace
 
 AdbEmbedded::AdbEmbedded(QObject *parent) 
     : QObject(parent)
+    , m_client(adbServerPort())
+    , m_runner(new AdbCommandRunner(m_client))
     , m_initialized(false)
+    , m_extractionStarted(false)
+    , m_extractionDone(false)
+    , m_startupRequested(false)
+    , m_extractionFinished(false)
+    , m_serverChecked(false)
+    , m_adbState(TOOL_PENDING)
+    , m_fastbootState(TOOL_PENDING)
 {
+    // 所有异步命令共用一个事件驱动的I/O线程
+    m_ioThread.setObjectName("AdbIoThread");
+    m_runner->moveToThread(&m_ioThread);
+    connect(&m_ioThread, &QThread::finished, m_runner, &QObject::deleteLater);
+    m_ioThread.start();
 }
 
 AdbEmbedded::~AdbEmbedded()
 {
-    // 清理临时文件
-    if (m_tempDir.isValid()) {
-        m_tempDir.remove();
-    }
+    m_ioThread.quit();
+    m_ioThread.wait();
 }
 
 AdbEmbedded& AdbEmbedded::instance()
@@ -40,6 +68,12 @@ bool AdbEmbedded::initialize()
         return true;
     }
 
+    // 后台启动与同步调用可能同时到达，只解压一次
+    QMutexLocker locker(&m_initMutex);
+    if (m_initialized) {
+        return true;
+    }
+
     qDebug() << "Initializing embedded ADB...";
 
     if (!extractEmbeddedTools()) {
@@ -54,12 +88,6 @@ bool AdbEmbedded::initialize()
 
 bool AdbEmbedded::extractEmbeddedTools()
 {
-    // 确保临时目录有效
-    if (!m_tempDir.isValid()) {
-        qCritical() << "Cannot create temporary directory";
-        return false;
-    }
-
     QString platformSubdir;
     QString binaryExtension;
     
@@ -76,56 +104,41 @@ bool AdbEmbedded::extractEmbeddedTools()
 #endif
 
     // 要提取的文件列表
-    QVector<QPair<QString, QString>> filesToExtract = {
-        {QString("adb/%1/adb%2").arg(platformSubdir).arg(binaryExtension), "adb"},
-        {QString("adb/%1/fastboot%2").arg(platformSubdir).arg(binaryExtension), "fastboot"}
+    QList<ToolCache::Entry> filesToExtract = {
+        {QString(":/binaries/adb/%1/adb%2").arg(platformSubdir, binaryExtension), "adb" + binaryExtension},
+        {QString(":/binaries/adb/%1/fastboot%2").arg(platformSubdir, binaryExtension), "fastboot" + binaryExtension}
     };
 
 #ifdef Q_OS_WIN
     // Windows需要额外的DLL文件
     filesToExtract.append({
-        {QString("adb/%1/AdbWinApi.dll").arg(platformSubdir), "AdbWinApi.dll"},
-        {QString("adb/%1/AdbWinUsbApi.dll").arg(platformSubdir), "AdbWinUsbApi.dll"}
+        {QString(":/binaries/adb/%1/AdbWinApi.dll").arg(platformSubdir), "AdbWinApi.dll"},
+        {QString(":/binaries/adb/%1/AdbWinUsbApi.dll").arg(platformSubdir), "AdbWinUsbApi.dll"}
     });
 #endif
 
-    // 提取所有文件
-    for (const auto &filePair : filesToExtract) {
-        QString resourcePath = ":/binaries/" + filePair.first;
-        QString outputPath = m_tempDir.path() + "/" + filePair.second;
-
-        QFile resourceFile(resourcePath);
-        if (!resourceFile.exists()) {
-            qWarning() << "Resource file not found:" << resourcePath;
-            return false;
-        }
+    // 优先使用按内容哈希命名的持久缓存，热启动时无需重新解压
+    QString toolsDir;
+    QString error;
+    ToolCache cache(filesToExtract);
+    if (!cache.prepare(toolsDir, &error)) {
+        qWarning() << "Tool cache unavailable, extracting to temporary directory:" << error;
 
-        // 复制文件到临时目录
-        if (!resourceFile.copy(outputPath)) {
-            qWarning() << "Failed to copy resource file to:" << outputPath 
-                      << "Error:" << resourceFile.errorString();
+        m_tempDir.reset(new QTemporaryDir());
+        if (!m_tempDir->isValid()) {
+            qCritical() << "Cannot create temporary directory";
             return false;
         }
-
-        // 设置文件权限（非Windows系统）
-#ifndef Q_OS_WIN
-        if (chmod(outputPath.toUtf8().constData(), 0755) != 0) {
-            qWarning() << "Failed to set executable permissions for:" << outputPath;
+        if (!ToolCache::extractTo(filesToExtract, m_tempDir->path(), &error)) {
+            qWarning() << error;
             return false;
         }
-#endif
-
-        qDebug() << "Extracted:" << outputPath;
+        toolsDir = m_tempDir->path();
     }
 
     // 设置ADB和Fastboot路径
-    m_adbPath = m_tempDir.path() + "/adb";
-    m_fastbootPath = m_tempDir.path() + "/fastboot";
-
-#ifdef Q_OS_WIN
-    m_adbPath += ".exe";
-    m_fastbootPath += ".exe";
-#endif
+    m_adbPath = toolsDir + "/adb" + binaryExtension;
+    m_fastbootPath = toolsDir + "/fastboot" + binaryExtension;
 
     // 验证文件是否存在且可执行
     if (!QFile::exists(m_adbPath) || !QFile::exists(m_fastbootPath)) {
@@ -133,81 +146,342 @@ bool AdbEmbedded::extractEmbeddedTools()
         return false;
     }
 
-    // 启动ADB服务器
-    QProcess adbProcess;
-    adbProcess.start(m_adbPath, QStringList() << "start-server");
-    if (!adbProcess.waitForFinished(5000)) {
-        qWarning() << "Failed to start ADB server";
-        // 继续执行，因为ADB可能已经在运行
+    return true;
+}
+
+void AdbEmbedded::startInitialization()
+{
+    if (m_startupRequested) {
+        return;
     }
+    m_startupRequested = true;
+    setAdbState(TOOL_STARTING);
+    setFastbootState(TOOL_STARTING);
+
+    // adb server 可能已在运行，直接查询，无需等待解压
+    AdbCommandRunner::ServiceRequest query;
+    query.hostService = true;
+    query.service = "host:version";
+    query.reply = AdbCommandRunner::REPLY_LENGTH_PREFIXED;
+    AdbCommandOptions options;
+    options.deadline = QDeadlineTimer(SERVER_QUERY_TIMEOUT);
+    m_runner->runService(query, options).then(this, [this](const AdbCommandResult &result) {
+        m_serverChecked = true;
+        if (result.succeeded()) {
+            qDebug() << "ADB server already running";
+            setAdbState(TOOL_READY);
+            return;
+        }
+        continueAdbStartup();
+    });
 
-    QProcess fastbootTest;
-    fastbootTest.setProgram(m_fastbootPath);
-    fastbootTest.setArguments(QStringList() << "--version");
-    fastbootTest.start();
-    
-    if (fastbootTest.waitForFinished(3000)) {
-        qDebug() << "Fastboot test passed:" << fastbootTest.readAllStandardOutput();
+    // 命令可能已提前触发解压
+    if (m_extractionFinished) {
+        onToolsExtracted(m_initialized);
     } else {
-        qWarning() << "Fastboot test failed";
-        return false;
+        startExtraction();
     }
-    
-    return true;
 }
 
-QString AdbEmbedded::executeCommand(const QString &command, int timeout)
+void AdbEmbedded::startExtraction()
 {
-    if (!m_initialized && !initialize()) {
-        return "Error: ADB not initialized";
+    if (m_extractionStarted.exchange(true)) {
+        return;
     }
+    
+    // 解压涉及磁盘读写，放到后台线程；不用全局线程池，
+    // 避免池中等待命令结果的任务占满线程导致解压无法开始
+    QThread *thread = QThread::create([this]() {
+        bool ok = initialize();
+        QList<std::function<void()>> pending;
+        {
+            QMutexLocker locker(&m_pendingMutex);
+            m_extractionDone = true;
+            pending.swap(m_pendingCommands);
+        }
+        for (const std::function<void()> &command : std::as_const(pending)) {
+            command();
+        }
+        QMetaObject::invokeMethod(this, [this, ok]() {
+            onToolsExtracted(ok);
+        }, Qt::QueuedConnection);
+    });
+    thread->setObjectName("AdbExtractThread");
+    connect(thread, &QThread::finished, thread, &QObject::deleteLater);
+    thread->start();
+}
 
-    QProcess process;
-    process.setProgram(m_adbPath);
+QFuture<AdbCommandResult> AdbEmbedded::afterExtraction(const std::function<QFuture<AdbCommandResult>()> &run)
+{
+    QMutexLocker locker(&m_pendingMutex);
+    if (m_extractionDone) {
+        locker.unlock();
+        return run();
+    }
     
-    // 解析命令参数
-    QStringList arguments = command.split(' ', Qt::SkipEmptyParts);
-    process.setArguments(arguments);
+    std::shared_ptr<QPromise<AdbCommandResult>> promise = std::make_shared<QPromise<AdbCommandResult>>();
+    QFuture<AdbCommandResult> future = promise->future();
+    promise->start();
+    m_pendingCommands.append([promise, run]() {
+        if (promise->isCanceled()) {
+            promise->finish();
+            return;
+        }
+        run().then([promise](const AdbCommandResult &result) {
+                promise->addResult(result);
+                promise->finish();
+            })
+            .onCanceled([promise]() {
+                promise->finish();
+            });
+    });
+    locker.unlock();
+    startExtraction();
+    return future;
+}
 
-    qDebug() << "Executing ADB command:" << m_adbPath << arguments;
+void AdbEmbedded::onToolsExtracted(bool ok)
+{
+    m_extractionFinished = true;
+    if (!m_startupRequested) {
+        return;
+    }
+    if (ok) {
+        StartupTiming::mark("tools-extracted");
+        testFastboot();
+    } else {
+        setFastbootState(TOOL_FAILED);
+    }
+    continueAdbStartup();
+}
 
-    process.start();
-    
-    if (!process.waitForFinished(timeout)) {
-        process.kill();
-        return "Error: Command timeout";
+void AdbEmbedded::continueAdbStartup()
+{
+    // 需要等 server 查询和解压都有结果
+    if (m_adbState != TOOL_STARTING || !m_serverChecked || !m_extractionFinished) {
+        return;
+    }
+    if (!m_initialized) {
+        setAdbState(TOOL_FAILED);
+        return;
+    }
+    startAdbServer();
+}
+
+void AdbEmbedded::startAdbServer()
+{
+    AdbCommandRunner::ProcessRequest request;
+    request.program = m_adbPath;
+    request.arguments = QStringList() << "start-server";
+    AdbCommandOptions options;
+    options.deadline = QDeadlineTimer(SERVER_START_TIMEOUT);
+    m_runner->runProcess(request, options).then(this, [this](const AdbCommandResult &result) {
+        if (result.succeeded()) {
+            setAdbState(TOOL_READY);
+        } else {
+            qWarning() << "Failed to start ADB server:"
+                       << (result.error.isEmpty() ? QString::fromUtf8(result.stdErr) : result.error);
+            setAdbState(TOOL_FAILED);
+        }
+    });
+}
+
+void AdbEmbedded::testFastboot()
+{
+    AdbCommandOptions options;
+    options.deadline = QDeadlineTimer(FASTBOOT_TEST_TIMEOUT);
+    fastbootAsync(QStringList() << "--version", options).then(this, [this](const AdbCommandResult &result) {
+        if (result.succeeded()) {
+            qDebug() << "Fastboot test passed:" << result.stdOut;
+            setFastbootState(TOOL_READY);
+        } else {
+            qWarning() << "Fastboot test failed:" << result.error;
+            setFastbootState(TOOL_FAILED);
+        }
+    });
+}
+
+AdbEmbedded::ToolState AdbEmbedded::adbState() const
+{
+    return m_adbState;
+}
+
+AdbEmbedded::ToolState AdbEmbedded::fastbootState() const
+{
+    return m_fastbootState;
+}
+
+void AdbEmbedded::setAdbState(ToolState state)
+{
+    if (m_adbState == state) {
+        return;
+    }
+    m_adbState = state;
+    if (state == TOOL_READY) {
+        StartupTiming::mark("adb-ready");
+    }
+    emit adbStateChanged(state);
+}
+
+void AdbEmbedded::setFastbootState(ToolState state)
+{
+    if (m_fastbootState == state) {
+        return;
+    }
+    m_fastbootState = state;
+    if (state == TOOL_READY) {
+        StartupTiming::mark("fastboot-ready");
+    }
+    emit fastbootStateChanged(state);
+}
+
+QFuture<AdbCommandResult> AdbEmbedded::executeAsync(const QStringList &arguments,
+                                                     const AdbCommandOptions &options)
+{
+    return executeAsync(AdbCommand::fromArguments(arguments), options);
+}
+
+QFuture<AdbCommandResult> AdbEmbedded::executeAsync(const AdbCommand &command,
+                                                     const AdbCommandOptions &options)
+{
+    // 原生协议不需要adb进程；解压完成前不设置回退进程，server 不可用时直接失败
+    AdbCommandRunner::ProcessRequest process;
+    if (m_initialized) {
+        process.program = m_adbPath;
+        process.arguments = command.processArguments();
+        process.stdIn = command.stdIn;
+    }
+
+    const QString verb = command.verb();
+    const QStringList args = command.arguments.mid(1);
+
+    // 优先通过adb server协议直接执行，无法连接server时回退到adb进程
+    AdbCommandRunner::ServiceRequest request;
+    request.serial = command.serial;
+    request.stdIn = command.stdIn;
+    request.fallback = process;
+
+    if (verb == "devices" && command.serial.isEmpty() && command.stdIn.isEmpty()) {
+        request.hostService = true;
+        request.service = args.contains("-l") ? QStringLiteral("host:devices-l") : QStringLiteral("host:devices");
+        request.reply = AdbCommandRunner::REPLY_LENGTH_PREFIXED;
+        request.stdOutPrefix = "List of devices attached\n";
+    } else if (verb == "shell" && !args.isEmpty()) {
+        return m_runner->runShell(command.serial, command.deviceCommand(), command.stdIn, process, options);
+    } else if (verb == "exec-out" && !args.isEmpty()) {
+        request.service = "exec:" + command.deviceCommand();
+    } else if (verb == "reboot" && args.size() <= 1 && command.stdIn.isEmpty()) {
+        request.service = "reboot:" + args.value(0);
+        request.reply = AdbCommandRunner::REPLY_NONE;
+    } else {
+        // 其余命令仍由adb进程处理，等待后台解压完成
+        return afterExtraction([this, command, options]() {
+            if (!m_initialized) {
+                return AdbCommandRunner::failedResult("ADB not initialized");
+            }
+            AdbCommandRunner::ProcessRequest process;
+            process.program = m_adbPath;
+            process.arguments = command.processArguments();
+            process.stdIn = command.stdIn;
+            return m_runner->runProcess(process, options);
+        });
+    }
+
+    return m_runner->runService(request, options);
+}
+
+QFuture<AdbCommandResult> AdbEmbedded::shellAsync(const QString &serial, const QString &command,
+                                                   const AdbCommandOptions &options)
+{
+    // 仅在adb server不可用时才需要adb进程，解压完成前或解压失败时只使用原生协议
+    AdbCommandRunner::ProcessRequest fallback;
+    if (m_initialized) {
+        fallback.program = m_adbPath;
+        fallback.arguments = AdbCommand::shell(serial, command).processArguments();
     }
+    return m_runner->runShell(serial, command, QByteArray(), fallback, options);
+}
 
-    QString output = process.readAllStandardOutput();
-    QString error = process.readAllStandardError();
+QFuture<AdbCommandResult> AdbEmbedded::fastbootAsync(const QStringList &arguments,
+                                                      const AdbCommandOptions &options)
+{
+    return afterExtraction([this, arguments, options]() {
+        if (!m_initialized) {
+            return AdbCommandRunner::failedResult("ADB not initialized");
+        }
+        AdbCommandRunner::ProcessRequest process;
+        process.program = m_fastbootPath;
+        process.arguments = arguments;
+        return m_runner->runProcess(process, options);
+    });
+}
+
+AdbCommandResult AdbEmbedded::waitForResult(QFuture<AdbCommandResult> future)
+{
+    future.waitForFinished();
+    if (future.resultCount() == 0) {
+        AdbCommandResult result;
+        result.error = "Command canceled";
+        return result;
+    }
+    return future.result();
+}
 
-    if (process.exitCode() != 0) {
-        return "Error: " + error;
+QString AdbEmbedded::formatResult(const AdbCommandResult &result)
+{
+    if (!result.error.isEmpty()) {
+        return "Error: " + result.error;
     }
+    if (result.exitCode > 0) {
+        return "Error: " + QString::fromUtf8(result.stdErr);
+    }
+
+    QString output = QString::fromUtf8(result.stdOut).trimmed();
+    return output.isEmpty() ? "Success" : output;
+}
 
-    return output.isEmpty() ? "Success" : output.trimmed();
+QString AdbEmbedded::executeCommand(const QString &command, int timeout)
+{
+    AdbCommandOptions options;
+    options.deadline = QDeadlineTimer(timeout);
+    return formatResult(waitForResult(executeAsync(QProcess::splitCommand(command), options)));
 }
 
 QString AdbEmbedded::getDeviceInfo(const QString &serial, const QString &prop)
 {
-    QString command;
-    if (serial.isEmpty()) {
-        command = QString("shell getprop %1").arg(prop);
-    } else {
-        command = QString("-s %1 shell getprop %2").arg(serial, prop);
+    AdbCommandResult result = waitForResult(shellAsync(serial, "getprop " + prop));
+    if (!result.succeeded()) {
+        return QString();
     }
-    
-    return executeCommand(command).trimmed();
+    return QString::fromUtf8(result.stdOut).trimmed();
+}
+
+AdbClient &AdbEmbedded::client()
+{
+    return m_client;
+}
+
+bool AdbEmbedded::shell(const QString &serial, const QString &command, AdbClient::ShellResult &result, int timeout)
+{
+    AdbCommandOptions options;
+    options.deadline = QDeadlineTimer(timeout);
+    AdbCommandResult commandResult = waitForResult(shellAsync(serial, command, options));
+
+    result.exitCode = commandResult.exitCode;
+    result.stdOut = commandResult.stdOut;
+    result.stdErr = commandResult.error.isEmpty() ? commandResult.stdErr : commandResult.error.toUtf8();
+    return commandResult.error.isEmpty();
 }
 
 QString AdbEmbedded::getAdbPath() const
 {
-    return m_adbPath;
+    // 解压完成前路径可能正在被后台线程写入
+    return m_initialized ? m_adbPath : QString();
 }
 
 QString AdbEmbedded::getFastbootPath() const
 {
-    return m_fastbootPath;
+    return m_initialized ? m_fastbootPath : QString();
 }
 
 QString AdbEmbedded::getPlatformBinaryName(const QString &baseName) const
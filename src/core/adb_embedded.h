@@ -2,35 +2,112 @@
 #define ADB_EMBEDDED_H
 
 #include <QObject>
+#include <QScopedPointer>
 #include <QProcess>
 #include <QString>
 #include <QTemporaryDir>
+#include <QThread>
+#include <QFuture>
+#include <QList>
+#include <QMutex>
+#include <atomic>
+#include <functional>
+#include "adb_client.h"
+#include "adb_command.h"
 
 class AdbEmbedded : public QObject
 {
     Q_OBJECT
 
 public:
+    // 工具的启动状态
+    enum ToolState {
+        TOOL_PENDING,       // 尚未开始
+        TOOL_STARTING,      // 解压/启动/自检中
+        TOOL_READY,
+        TOOL_FAILED
+    };
+    Q_ENUM(ToolState)
+
     static AdbEmbedded& instance();
     
+    // 同步解压内嵌工具，可在任意线程调用；不启动adb server
+    // 异步接口不调用此函数：需要工具进程的命令排队到后台解压完成后再执行
     bool initialize();
+    
+    // 非阻塞启动：后台解压工具，随后启动adb server、自检fastboot
+    // adb server 已在运行时无需等待解压即可就绪；各工具就绪后分别发出状态信号
+    void startInitialization();
+    ToolState adbState() const;
+    ToolState fastbootState() const;
+    
+    // 异步接口：命令在I/O线程中执行，可通过 then() 接续、cancel() 取消
+    // devices/shell/exec-out/reboot 直接走 adb server 协议
+    QFuture<AdbCommandResult> executeAsync(const AdbCommand &command,
+                                           const AdbCommandOptions &options = AdbCommandOptions());
+    // 参数与 adb 命令行一致
+    QFuture<AdbCommandResult> executeAsync(const QStringList &arguments,
+                                           const AdbCommandOptions &options = AdbCommandOptions());
+    QFuture<AdbCommandResult> shellAsync(const QString &serial, const QString &command,
+                                         const AdbCommandOptions &options = AdbCommandOptions());
+    QFuture<AdbCommandResult> fastbootAsync(const QStringList &arguments,
+                                            const AdbCommandOptions &options = AdbCommandOptions());
+    
+    // 在工作线程中同步等待结果，不能在I/O线程(输出回调)中调用
+    static AdbCommandResult waitForResult(QFuture<AdbCommandResult> future);
+    // 旧版文本格式：失败时以 "Error: " 开头，无输出时为 "Success"
+    static QString formatResult(const AdbCommandResult &result);
+    
+    // 同步兼容接口，基于异步接口实现；命令行按 shell 规则拆分，支持引号
     QString executeCommand(const QString &command, int timeout = 30000);
     QString getDeviceInfo(const QString &serial, const QString &prop);
     
+    // 原生 adb server 协议接口，不创建 adb 进程
+    AdbClient &client();
+    bool shell(const QString &serial, const QString &command, AdbClient::ShellResult &result, int timeout = 30000);
+    
     QString getAdbPath() const;
     QString getFastbootPath() const;
 
+signals:
+    void adbStateChanged(AdbEmbedded::ToolState state);
+    void fastbootStateChanged(AdbEmbedded::ToolState state);
+
 private:
     AdbEmbedded(QObject *parent = nullptr);
     ~AdbEmbedded();
     
     bool extractEmbeddedTools();
+    // 在独立线程中解压一次，完成后执行排队的命令；可在任意线程调用
+    void startExtraction();
+    // 解压完成后再调用 run，调用线程从不等待解压
+    QFuture<AdbCommandResult> afterExtraction(const std::function<QFuture<AdbCommandResult>()> &run);
+    void onToolsExtracted(bool ok);
+    void continueAdbStartup();
+    void startAdbServer();
+    void testFastboot();
+    void setAdbState(ToolState state);
+    void setFastbootState(ToolState state);
     QString getPlatformBinaryName(const QString &baseName) const;
-    
-    QTemporaryDir m_tempDir;
+    AdbClient m_client;
+    QThread m_ioThread;
+    AdbCommandRunner *m_runner;
+    QScopedPointer<QTemporaryDir> m_tempDir;   // 持久缓存不可用时的回退目录
+    QMutex m_initMutex;                         // 串行化解压，路径在 m_initialized 置位后只读
     QString m_adbPath;
     QString m_fastbootPath;
-    bool m_initialized;
+    std::atomic<bool> m_initialized;
+    std::atomic<bool> m_extractionStarted;
+    QMutex m_pendingMutex;
+    bool m_extractionDone;                      // 解压已有结果 (成功或失败)，受 m_pendingMutex 保护
+    QList<std::function<void()>> m_pendingCommands;
+    
+    // 以下状态只在主线程中访问
+    bool m_startupRequested;
+    bool m_extractionFinished;
+    bool m_serverChecked;
+    ToolState m_adbState;
+    ToolState m_fastbootState;
 };
 
 #endif // ADB_EMBEDDED_H
@@ -0,0 +1,99 @@
+#include "block_scan.h"
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PTB_BLOCK_SCAN_SSE2
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define PTB_BLOCK_SCAN_NEON
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+// 每次比较 64 字节，数据块大小通常为 4096
+const qint64 VECTOR_STRIDE = 64;
+
+quint32 loadWord(const uchar *data)
+{
+    quint32 word;
+    std::memcpy(&word, data, sizeof(word));
+    return word;
+}
+
+bool scalarTail(const uchar *block, qint64 offset, qint64 size, quint32 word)
+{
+    for (; offset + 4 <= size; offset += 4) {
+        if (loadWord(block + offset) != word) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+bool BlockScan::fillValueScalar(const uchar *block, qint64 size, quint32 &value)
+{
+    if (size < 4) {
+        return false;
+    }
+    const quint32 word = loadWord(block);
+    if (!scalarTail(block, 4, size, word)) {
+        return false;
+    }
+    value = word;
+    return true;
+}
+
+bool BlockScan::fillValue(const uchar *block, qint64 size, quint32 &value)
+{
+    if (size < 4) {
+        return false;
+    }
+    const quint32 word = loadWord(block);
+    qint64 offset = 0;
+
+#if defined(PTB_BLOCK_SCAN_SSE2)
+    const __m128i pattern = _mm_set1_epi32(static_cast<int>(word));
+    for (; offset + VECTOR_STRIDE <= size; offset += VECTOR_STRIDE) {
+        const __m128i *p = reinterpret_cast<const __m128i*>(block + offset);
+        __m128i equal = _mm_and_si128(
+            _mm_and_si128(_mm_cmpeq_epi32(_mm_loadu_si128(p), pattern),
+                          _mm_cmpeq_epi32(_mm_loadu_si128(p + 1), pattern)),
+            _mm_and_si128(_mm_cmpeq_epi32(_mm_loadu_si128(p + 2), pattern),
+                          _mm_cmpeq_epi32(_mm_loadu_si128(p + 3), pattern)));
+        if (_mm_movemask_epi8(equal) != 0xffff) {
+            return false;
+        }
+    }
+#elif defined(PTB_BLOCK_SCAN_NEON)
+    const uint32x4_t pattern = vdupq_n_u32(word);
+    for (; offset + VECTOR_STRIDE <= size; offset += VECTOR_STRIDE) {
+        const uint32_t *p = reinterpret_cast<const uint32_t*>(block + offset);
+        uint32x4_t equal = vandq_u32(
+            vandq_u32(vceqq_u32(vld1q_u32(p), pattern), vceqq_u32(vld1q_u32(p + 4), pattern)),
+            vandq_u32(vceqq_u32(vld1q_u32(p + 8), pattern), vceqq_u32(vld1q_u32(p + 12), pattern)));
+        if (vminvq_u32(equal) == 0) {
+            return false;
+        }
+    }
+#endif
+
+    if (!scalarTail(block, offset, size, word)) {
+        return false;
+    }
+    value = word;
+    return true;
+}
+
+const char *BlockScan::instructionSet()
+{
+#if defined(PTB_BLOCK_SCAN_SSE2)
+    return "SSE2";
+#elif defined(PTB_BLOCK_SCAN_NEON)
+    return "NEON";
+#else
+    return "scalar";
+#endif
+}
@@ -0,0 +1,19 @@
+#ifndef BLOCK_SCAN_H
+#define BLOCK_SCAN_H
+
+#include <QtGlobal>
+
+// 判断数据块是否由同一个 32 位字重复组成 (全零块是其特例)，用于 sparse 编码
+// x86-64 使用 SSE2，ARM64 使用 NEON，其他平台逐字比较
+class BlockScan
+{
+public:
+    // size 须为 4 的倍数；是时返回 true 并通过 value 给出重复的字 (本机字节序)
+    static bool fillValue(const uchar *block, qint64 size, quint32 &value);
+    // 逐字比较的实现，供基准测试对照
+    static bool fillValueScalar(const uchar *block, qint64 size, quint32 &value);
+
+    static const char *instructionSet();
+};
+
+#endif // BLOCK_SCAN_H
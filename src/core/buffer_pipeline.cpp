@@ -0,0 +1,90 @@
+#include "buffer_pipeline.h"
+
+BufferPipeline::BufferPipeline(int count, qint64 bufferSize)
+    : m_slots(static_cast<size_t>(count))
+    , m_finished(false)
+    , m_aborted(false)
+{
+    for (int i = 0; i < count; ++i) {
+        m_slots[i].data.resize(static_cast<int>(bufferSize));
+        m_free.push_back(i);
+    }
+}
+
+int BufferPipeline::acquire()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_condition.wait(lock, [this]() { return m_aborted || !m_free.empty(); });
+    if (m_aborted) {
+        return -1;
+    }
+    int slot = m_free.front();
+    m_free.pop_front();
+    return slot;
+}
+
+char *BufferPipeline::reserve(int slot, qint64 size)
+{
+    QByteArray &data = m_slots[slot].data;
+    if (data.size() < size) {
+        data.resize(static_cast<int>(size));
+    }
+    return data.data();
+}
+
+void BufferPipeline::submit(int slot, qint64 size, quint32 tag)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_slots[slot].size = size;
+    m_slots[slot].tag = tag;
+    m_filled.push_back(slot);
+    m_condition.notify_all();
+}
+
+void BufferPipeline::finish()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_finished = true;
+    m_condition.notify_all();
+}
+
+void BufferPipeline::abort()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_aborted = true;
+    m_condition.notify_all();
+}
+
+bool BufferPipeline::take(int &slot)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_condition.wait(lock, [this]() { return m_aborted || m_finished || !m_filled.empty(); });
+    if (m_aborted || m_filled.empty()) {
+        return false;
+    }
+    slot = m_filled.front();
+    m_filled.pop_front();
+    return true;
+}
+
+void BufferPipeline::release(int slot)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_free.push_back(slot);
+    m_condition.notify_all();
+}
+
+const char *BufferPipeline::data(int slot) const
+{
+    return m_slots[slot].data.constData();
+}
+
+qint64 BufferPipeline::size(int slot) const
+{
+    return m_slots[slot].size;
+}
+
+quint32 BufferPipeline::tag(int slot) const
+{
+    return m_slots[slot].tag;
+}
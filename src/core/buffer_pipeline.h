@@ -0,0 +1,53 @@
+#ifndef BUFFER_PIPELINE_H
+#define BUFFER_PIPELINE_H
+
+#include <QByteArray>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+// 有界缓冲池：生产者取空闲缓冲区填充后提交，消费者按提交顺序取出，用完归还
+// 缓冲区个数固定，一端快于另一端时在 acquire/take 中等待，内存占用与数据量无关
+// 用于让磁盘读写、校验计算与USB传输在不同线程中重叠进行
+class BufferPipeline
+{
+public:
+    BufferPipeline(int count, qint64 bufferSize);
+
+    // 生产者：等待空闲缓冲区，中止时返回 -1
+    int acquire();
+    // 缓冲区由取得它的一端独占，数据大于预设大小时就地扩大
+    char *reserve(int slot, qint64 size);
+    void submit(int slot, qint64 size, quint32 tag = 0);
+    // 生产者：不再提交，消费者取完已提交的缓冲区后结束
+    void finish();
+
+    // 任意一端出错时调用，两端的等待都立即返回
+    void abort();
+
+    // 消费者：取出下一个已填充的缓冲区，结束或中止时返回 false
+    bool take(int &slot);
+    void release(int slot);
+
+    const char *data(int slot) const;
+    qint64 size(int slot) const;
+    quint32 tag(int slot) const;
+
+private:
+    struct Slot {
+        QByteArray data;
+        qint64 size = 0;
+        quint32 tag = 0;
+    };
+
+    std::vector<Slot> m_slots;
+    std::deque<int> m_free;
+    std::deque<int> m_filled;
+    bool m_finished;
+    bool m_aborted;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+};
+
+#endif // BUFFER_PIPELINE_H
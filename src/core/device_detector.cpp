@@ -1,117 +1,864 @@
 #include "device_detector.h"
 #include "adb_embedded.h"
-#include <QProcess>
+#include "adb_device_tracker.h"
+#include "usb_hotplug_monitor.h"
+#include "fastboot_usb.h"
+#include "adb_device_probe.h"
+#include "modes/edl_9008.h"
+#include "modes/mtk_da.h"
+#include "startup_timing.h"
 #include <QStringList>
 #include <QDebug>
 #include <QTimer>
 #include <QThread> 
+#include <QThreadPool>
+#include <QMutexLocker>
 #include <QRegularExpression>
 
+namespace {
+
+// 重启后新模式探测不到的身份字段 (如 fastboot 下的型号、系统版本) 沿用重启前的信息
+void carryOverIdentity(const DeviceInfo &previous, DeviceInfo &info)
+{
+    auto keep = [](const QString &old, QString &field) {
+        if (field.isEmpty()) {
+            field = old;
+        }
+    };
+    keep(previous.manufacturer, info.manufacturer);
+    keep(previous.model, info.model);
+    keep(previous.deviceName, info.deviceName);
+    keep(previous.productName, info.productName);
+    keep(previous.androidVersion, info.androidVersion);
+    keep(previous.buildNumber, info.buildNumber);
+    keep(previous.imei, info.imei);
+}
+
+} // namespace
+
 DeviceDetector::DeviceDetector(QObject *parent)
     : QObject(parent)
     , m_monitorTimer(new QTimer(this))
+    , m_fastbootTimer(new QTimer(this))
+    , m_adbTracker(new AdbDeviceTracker(AdbEmbedded::instance().client().port(), this))
+    , m_usbMonitor(new UsbHotplugMonitor(this))
+    , m_hotplugProbeTimer(new QTimer(this))
+    , m_transitionTimer(new QTimer(this))
+    , m_refreshTimer(new QTimer(this))
+    , m_detectionPool(new QThreadPool(this))
+    , m_probePool(new QThreadPool(this))
+    , m_monitoring(false)
+    , m_enumerating(false)
+    , m_pendingEnumeration(false)
+    , m_pendingAdbEnumeration(false)
+    , m_probeSequence(0)
 {
-    m_monitorTimer->setInterval(2000);
+    // 枚举在单独的检测线程中串行执行，设备探测在有界线程池中并发执行
+    m_detectionPool->setMaxThreadCount(1);
+    m_probePool->setMaxThreadCount(MAX_PROBE_THREADS);
+    
+    // 未订阅到adb设备推送前按原2秒周期全量轮询，订阅成功后降为兜底轮询
+    m_monitorTimer->setInterval(POLL_INTERVAL);
     connect(m_monitorTimer, SIGNAL(timeout()), this, SLOT(checkDevices()));
+    
+    // fastboot设备不经过adb server，仍需单独轮询
+    m_fastbootTimer->setInterval(POLL_INTERVAL);
+    connect(m_fastbootTimer, &QTimer::timeout, this, &DeviceDetector::checkFastbootDevices);
+    
+    connect(m_adbTracker, &AdbDeviceTracker::devicesUpdated,
+            this, &DeviceDetector::onAdbDevicesUpdated);
+    connect(m_adbTracker, &AdbDeviceTracker::trackingStateChanged,
+            this, &DeviceDetector::onAdbTrackingStateChanged);
+    
+    // USB插入后短暂合并事件再探测，避免同一设备多个接口重复触发；只探测插入的端口
+    m_hotplugProbeTimer->setSingleShot(true);
+    m_hotplugProbeTimer->setInterval(HOTPLUG_SETTLE_DELAY);
+    connect(m_hotplugProbeTimer, &QTimer::timeout, this, &DeviceDetector::probeHotplugPorts);
+    
+    // 重启后设备重新枚举的时间不确定，预期转换窗口内短周期轮询
+    m_transitionTimer->setInterval(TRANSITION_POLL_INTERVAL);
+    connect(m_transitionTimer, &QTimer::timeout, this, &DeviceDetector::onTransitionPoll);
+    
+    // 已知设备不再重新探测，电池、SIM 等易变字段按各自周期单独刷新
+    m_refreshTimer->setInterval(VOLATILE_REFRESH_INTERVAL);
+    connect(m_refreshTimer, &QTimer::timeout, this, &DeviceDetector::refreshVolatileState);
+    
+    connect(m_usbMonitor, &UsbHotplugMonitor::deviceArrived,
+            this, &DeviceDetector::onUsbDeviceArrived);
+    connect(m_usbMonitor, &UsbHotplugMonitor::deviceLeft,
+            this, &DeviceDetector::onUsbDeviceLeft);
+    
+    AdbEmbedded &adb = AdbEmbedded::instance();
+    connect(&adb, &AdbEmbedded::adbStateChanged, this, &DeviceDetector::onAdbStateChanged);
+    connect(&adb, &AdbEmbedded::fastbootStateChanged, this, &DeviceDetector::onFastbootStateChanged);
 }
 
 DeviceDetector::~DeviceDetector()
 {
     stopMonitoring();
+    
+    // 工作线程中的任务会访问本对象，析构前必须全部结束
+    m_detectionPool->clear();
+    m_probePool->clear();
+    m_detectionPool->waitForDone();
+    m_probePool->waitForDone();
 }
 
 void DeviceDetector::startMonitoring()
 {
-    // 确保ADB已初始化
-    if (!AdbEmbedded::instance().initialize()) {
-        qWarning() << "Failed to initialize ADB for device monitoring";
+    if (m_monitoring) {
         return;
     }
+    m_monitoring = true;
     
-    m_monitorTimer->start();
+    // fastboot 通过 libusb 枚举，不依赖内嵌工具，立即开始
+    m_usbMonitor->start();
+    m_refreshTimer->start();
+    updateFastbootPolling();
+    checkFastbootDevices();
+    
+    // adb 相关检测在 adb server 就绪后开始
+    AdbEmbedded &adb = AdbEmbedded::instance();
+    adb.startInitialization();
+    if (adb.adbState() == AdbEmbedded::TOOL_READY) {
+        startAdbMonitoring();
+    }
     qDebug() << "Device monitoring started";
 }
 
+void DeviceDetector::startAdbMonitoring()
+{
+    if (!m_monitoring || m_monitorTimer->isActive()) {
+        return;
+    }
+    m_monitorTimer->start();
+    m_adbTracker->start();
+    updateFastbootPolling();
+    qDebug() << "ADB device monitoring started";
+}
+
+void DeviceDetector::onAdbStateChanged(AdbEmbedded::ToolState state)
+{
+    if (state == AdbEmbedded::TOOL_READY) {
+        startAdbMonitoring();
+    } else if (state == AdbEmbedded::TOOL_FAILED) {
+        qWarning() << "ADB server unavailable, only fastboot devices will be detected";
+    }
+}
+
+void DeviceDetector::onFastbootStateChanged(AdbEmbedded::ToolState state)
+{
+    // libusb 不可用时 fastboot 检测依赖内嵌的 fastboot，就绪后立即补一次
+    if (state == AdbEmbedded::TOOL_READY && m_monitoring) {
+        checkFastbootDevices();
+    }
+}
+
 void DeviceDetector::stopMonitoring()
 {
+    m_monitoring = false;
     m_monitorTimer->stop();
+    m_fastbootTimer->stop();
+    m_hotplugProbeTimer->stop();
+    m_hotplugPorts.clear();
+    m_transitionTimer->stop();
+    m_refreshTimer->stop();
+    m_adbTracker->stop();
+    m_usbMonitor->stop();
     qDebug() << "Device monitoring stopped";
 }
 
 void DeviceDetector::checkDevices()
 {
-    detectConnectedDevices();
+    // adb server 就绪前只枚举 fastboot 设备
+    startEnumeration(AdbEmbedded::instance().adbState() == AdbEmbedded::TOOL_READY);
+}
+
+void DeviceDetector::checkFastbootDevices()
+{
+    startEnumeration(false);
 }
 
-void DeviceDetector::detectConnectedDevices()
+void DeviceDetector::startEnumeration(bool includeAdb)
 {
-    QMap<QString, DeviceInfo> newDevices;
+    // 同一时间只进行一次枚举，期间的请求合并到下一轮
+    if (m_enumerating) {
+        m_pendingEnumeration = true;
+        m_pendingAdbEnumeration = m_pendingAdbEnumeration || includeAdb;
+        return;
+    }
+    m_enumerating = true;
+    
+    m_detectionPool->start([this, includeAdb]() {
+        EnumerationResult result = enumerateDevices(includeAdb);
+        QMetaObject::invokeMethod(this, [this, result]() {
+            applyEnumeration(result);
+        }, Qt::QueuedConnection);
+    });
+}
 
-    // 检测Fastboot设备 - 添加异常处理
+DeviceDetector::EnumerationResult DeviceDetector::enumerateDevices(bool includeAdb)
+{
+    // 运行在检测线程中
+    EnumerationResult result;
+    result.adbScanned = includeAdb;
+    
+    // EDL/MTK 端口只凭描述符识别，一次扫描缓存的设备列表即可；
+    // 这些端口存在时间很短，先于需要打开设备的fastboot枚举进行
+    QList<UsbDeviceDescription> usbDevices;
+    result.usbScanned = UsbContext::instance().devices(usbDevices);
+    for (const UsbDeviceDescription &device : std::as_const(usbDevices)) {
+        DeviceMode mode = usbDeviceMode(device);
+        if (mode != MODE_UNKNOWN) {
+            result.devices[device.portPath] = mode;
+        }
+    }
+    
     QStringList fastbootDevices;
     if (detectFastbootDevices(fastbootDevices)) {
+        QMutexLocker locker(&m_fastbootModeMutex);
         for (const QString &deviceId : fastbootDevices) {
-            try {
-                DeviceMode mode = m_fastbootDeviceModes[deviceId] ? MODE_FASTBOOTD : MODE_FASTBOOT;
-                DeviceInfo info = getFastbootDeviceInfo(deviceId);
-                info.mode = mode;
-                info.isFastbootdMode = (mode == MODE_FASTBOOTD);
-                newDevices[deviceId] = info;
-                if (!m_currentDevices.contains(deviceId)) {
-                    qDebug() << "Fastboot device connected:" << deviceId;
-                    QString formattedInfo = formatDeviceInfoForDisplay(info);
-                    qDebug().noquote() << formattedInfo;
-                    emit deviceConnected(info);
-                } else if (m_currentDevices[deviceId].mode != mode) {
-                    emit deviceModeChanged(deviceId, mode);
-                    qDebug() << "Fastboot device mode changed:" << deviceId << "to" << mode;
-                }
-            } catch (const std::exception& e) {
-                qWarning() << "Exception while processing Fastboot device" << deviceId << ":" << e.what();
-            } catch (...) {
-                qWarning() << "Unknown exception while processing Fastboot device" << deviceId;
+            result.devices[deviceId] = m_fastbootDeviceModes.value(deviceId) ? MODE_FASTBOOTD : MODE_FASTBOOT;
+        }
+    }
+    
+    if (includeAdb) {
+        QStringList adbDevices;
+        if (detectADBDevices(adbDevices)) {
+            for (const QString &deviceId : adbDevices) {
+                result.devices[deviceId] = MODE_ADB;
             }
         }
     }
     
-    // 检测ADB设备
-    QStringList adbDevices;
-    if (detectADBDevices(adbDevices)) {
-        for (const QString &deviceId : adbDevices) {
-            DeviceMode mode = MODE_ADB;
-            DeviceInfo info = getDeviceInfo(deviceId, mode);
-            info.mode = mode;
+    return result;
+}
+
+void DeviceDetector::applyEnumeration(const EnumerationResult &result)
+{
+    m_enumerating = false;
+    
+    // 本轮枚举覆盖的模式中已不存在的设备视为断开
+    auto inScope = [&result](int mode) {
+        return isFastbootFamily(mode)
+            || (result.adbScanned && mode == MODE_ADB)
+            || (result.usbScanned && (mode == MODE_EDL_9008 || mode == MODE_MTK_DA));
+    };
+    
+    for (auto it = m_currentDevices.begin(); it != m_currentDevices.end();) {
+        if (inScope(it.value().mode) && !result.devices.contains(it.key()) && !holdForTransition(it.key())) {
+            m_propertyCache.invalidate(it.key());
+            emit deviceDisconnected(it.key());
+            qDebug() << "Device disconnected:" << it.key();
+            it = m_currentDevices.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    cancelStaleProbes([&](const QString &serial, int mode) {
+        return inScope(mode) && !result.devices.contains(serial);
+    });
+    
+    // 已知且模式未变的设备保留现有信息，只探测新出现或模式变化的设备
+    int probed = 0;
+    for (auto it = result.devices.constBegin(); it != result.devices.constEnd(); ++it) {
+        auto known = m_currentDevices.constFind(it.key());
+        if (known != m_currentDevices.constEnd() && known.value().mode == it.value()
+            && !m_expectedTransitions.value(it.key()).departed) {
+            continue;
+        }
+        requestProbe(it.key(), static_cast<DeviceMode>(it.value()));
+        ++probed;
+    }
+    if (probed > 0) {
+        qDebug() << "Enumeration found" << result.devices.size() << "devices," << probed << "need probing";
+    }
+    
+    if (m_pendingEnumeration) {
+        bool includeAdb = m_pendingAdbEnumeration;
+        m_pendingEnumeration = false;
+        m_pendingAdbEnumeration = false;
+        startEnumeration(includeAdb);
+    }
+}
+
+void DeviceDetector::requestProbe(const QString &serial, DeviceMode mode)
+{
+    // 同一设备同一模式的探测不并发执行；已作废或模式已变化的探测不阻止重新探测
+    if (m_probeTokens.contains(serial) && m_probesInFlight.value(serial, MODE_UNKNOWN) == mode) {
+        return;
+    }
+    
+    quint64 token = ++m_probeSequence;
+    m_probesInFlight.insert(serial, mode);
+    m_probeTokens.insert(serial, token);
+    
+    if (mode == MODE_ADB) {
+        // ADB 设备通过异步shell探测，不占用探测线程
+        startAdbProbe(serial, token);
+        return;
+    }
+    
+    m_probePool->start([this, serial, mode, token]() {
+        DeviceInfo info = probeDevice(serial, mode);
+        QMetaObject::invokeMethod(this, [this, serial, info, token]() {
+            applyProbeResult(serial, info, token);
+        }, Qt::QueuedConnection);
+    });
+}
+
+DeviceInfo DeviceDetector::probeDevice(const QString &deviceId, DeviceMode mode)
+{
+    // 运行在探测线程池中，每个设备一个任务
+    // 同一次启动内静态字段直接取缓存，只刷新已过期的易变字段
+    DeviceInfo cached;
+    QList<DevicePropertyCache::VolatileField> staleFields;
+    if (m_propertyCache.lookup(deviceId, mode, cached, staleFields)) {
+        if (staleFields.isEmpty() || refreshVolatileFields(deviceId, cached, staleFields)) {
+            return cached;
+        }
+        qDebug() << "Property cache invalidated for" << deviceId << ", probing again";
+    }
+    
+    DeviceInfo info = probeDeviceUncached(deviceId, mode);
+    // 没取到 boot_id 的 ADB 结果不缓存，否则下次刷新易变字段时会因启动标识不同而反复失效
+    bool cacheable = mode != MODE_ADB || !info.bootId.isEmpty();
+    if (cacheable && (!info.model.isEmpty() || !info.productName.isEmpty())) {
+        m_propertyCache.store(deviceId, info);
+    }
+    return info;
+}
+
+void DeviceDetector::startAdbProbe(const QString &serial, quint64 token)
+{
+    // 同一次启动内静态字段直接取缓存，只刷新已过期的易变字段
+    DeviceInfo cached;
+    QList<DevicePropertyCache::VolatileField> staleFields;
+    bool hit = m_propertyCache.lookup(serial, MODE_ADB, cached, staleFields);
+    if (hit && staleFields.isEmpty()) {
+        applyProbeResult(serial, cached, token);
+        return;
+    }
+    
+    QString script = hit ? AdbDeviceProbe::volatileScript() : AdbDeviceProbe::script();
+    AdbEmbedded::instance().shellAsync(serial, script)
+        .then(this, [this, serial, token, hit, cached, staleFields](const AdbCommandResult &result) {
+            // 探测期间设备已断开或已发起新的探测
+            if (m_probeTokens.value(serial) != token) {
+                return;
+            }
             
-            newDevices[deviceId] = info;
+            if (hit) {
+                DeviceInfo info = cached;
+                if (applyAdbVolatileOutput(serial, result, staleFields, info)) {
+                    applyProbeResult(serial, info, token);
+                } else {
+                    qDebug() << "Property cache invalidated for" << serial << ", probing again";
+                    startAdbProbe(serial, token);
+                }
+                return;
+            }
             
-            if (!m_currentDevices.contains(deviceId)) {
-                qDebug() << "ADB device connected:" << deviceId;
-                // 输出格式化设备信息
-                QString formattedInfo = formatDeviceInfoForDisplay(info);
-                qDebug().noquote() << formattedInfo;
-                emit deviceConnected(info);
-            } else if (m_currentDevices[deviceId].mode != mode) {
-                emit deviceModeChanged(deviceId, mode);
-                qDebug() << "Device mode changed:" << deviceId << "to" << mode;
+            DeviceInfo info;
+            info.serialNumber = serial;
+            info.mode = MODE_ADB;
+            if (parseAdbProbeOutput(result, info)) {
+                m_propertyCache.store(serial, info);
+                applyProbeResult(serial, info, token);
+                return;
             }
+            
+            qWarning() << "ADB probe failed for" << serial << ":"
+                       << (result.error.isEmpty() ? QString::fromUtf8(result.stdErr) : result.error);
+            
+            // 探测脚本失败时在线程池中逐项获取
+            m_probePool->start([this, serial, token]() {
+                DeviceInfo info = probeDevice(serial, MODE_ADB);
+                QMetaObject::invokeMethod(this, [this, serial, info, token]() {
+                    applyProbeResult(serial, info, token);
+                }, Qt::QueuedConnection);
+            });
+        });
+}
+
+bool DeviceDetector::applyAdbVolatileOutput(const QString &serial, const AdbCommandResult &result,
+                                            const QList<DevicePropertyCache::VolatileField> &fields,
+                                            DeviceInfo &info)
+{
+    AdbDeviceProbe::Sections sections = AdbDeviceProbe::parse(result.stdOut);
+    if (!result.error.isEmpty() || !sections.complete) {
+        m_propertyCache.invalidate(serial);
+        return false;
+    }
+    
+    DeviceInfo fresh;
+    AdbDeviceProbe::fillVolatileInfo(sections, fresh);
+    if (!m_propertyCache.updateVolatile(serial, fresh.bootId, fresh, fields)) {
+        return false;
+    }
+    DevicePropertyCache::copyFields(fresh, info, fields);
+    return true;
+}
+
+bool DeviceDetector::parseAdbProbeOutput(const AdbCommandResult &result, DeviceInfo &info)
+{
+    if (!result.error.isEmpty()) {
+        return false;
+    }
+    
+    // 解析结果引用 result.stdOut 的内存，在其作用域内完成填充
+    AdbDeviceProbe::Sections sections = AdbDeviceProbe::parse(result.stdOut);
+    if (!sections.complete || sections.properties.isEmpty()) {
+        return false;
+    }
+    
+    AdbDeviceProbe::fillDeviceInfo(sections, info);
+    return true;
+}
+
+bool DeviceDetector::refreshVolatileFields(const QString &deviceId, DeviceInfo &info,
+                                           const QList<DevicePropertyCache::VolatileField> &fields)
+{
+    // ADB 设备由 startAdbProbe 异步刷新，这里只处理 fastbootd
+    // fastbootd 没有启动标识，断开或切换模式时缓存已失效
+    DeviceInfo fresh;
+    fresh.bootId = info.bootId;
+    fresh.batteryHealth = formatFastbootBattery(getFastbootVar("battery-status", deviceId));
+    
+    if (!m_propertyCache.updateVolatile(deviceId, fresh.bootId, fresh, fields)) {
+        return false;
+    }
+    DevicePropertyCache::copyFields(fresh, info, fields);
+    return true;
+}
+
+DeviceInfo DeviceDetector::probeDeviceUncached(const QString &deviceId, DeviceMode mode)
+{
+    if (!isFastbootFamily(mode)) {
+        DeviceInfo info = getDeviceInfo(deviceId, mode);
+        info.mode = mode;
+        return info;
+    }
+    
+    DeviceInfo info;
+    info.serialNumber = deviceId;
+    try {
+        info = getFastbootDeviceInfo(deviceId);
+    } catch (const std::exception& e) {
+        qWarning() << "Exception while processing Fastboot device" << deviceId << ":" << e.what();
+    } catch (...) {
+        qWarning() << "Unknown exception while processing Fastboot device" << deviceId;
+    }
+    info.mode = mode;
+    info.isFastbootdMode = (mode == MODE_FASTBOOTD);
+    return info;
+}
+
+void DeviceDetector::applyProbeResult(const QString &serial, const DeviceInfo &info, quint64 token)
+{
+    // 探测期间设备已断开或已发起新的探测，丢弃结果
+    if (m_probeTokens.value(serial) != token) {
+        return;
+    }
+    m_probeTokens.remove(serial);
+    m_probesInFlight.remove(serial);
+    
+    DeviceMode mode = static_cast<DeviceMode>(info.mode);
+    auto expected = m_expectedTransitions.constFind(serial);
+    // 重启到同一模式时必须先观察到设备离开，否则仍在运行的设备的探测结果会被误认为重启完成
+    if (expected != m_expectedTransitions.constEnd() && m_currentDevices.contains(serial)
+        && (expected.value().departed
+            || (expected.value().toMode == mode && m_currentDevices[serial].mode != mode))) {
+        // 预期的重启完成：沿用已知身份信息，以一次模式变化代替断开和连接
+        DeviceInfo merged = info;
+        carryOverIdentity(m_currentDevices[serial], merged);
+        m_expectedTransitions.erase(expected);
+        if (m_expectedTransitions.isEmpty()) {
+            m_transitionTimer->stop();
+        }
+        m_currentDevices[serial] = merged;
+        emit deviceModeChanged(serial, mode);
+        qDebug() << "Device completed expected transition:" << serial << "to" << mode;
+        return;
+    }
+    
+    if (!m_currentDevices.contains(serial)) {
+        qDebug() << "Device connected:" << serial;
+        qDebug().noquote() << formatDeviceInfoForDisplay(info);
+        StartupTiming::mark("first-device");
+        m_currentDevices[serial] = info;
+        emit deviceConnected(info);
+    } else if (m_currentDevices[serial].mode != mode) {
+        m_currentDevices[serial] = info;
+        emit deviceModeChanged(serial, mode);
+        qDebug() << "Device mode changed:" << serial << "to" << mode;
+    } else {
+        DeviceInfo &current = m_currentDevices[serial];
+        const bool volatileChanged = current.batteryHealth != info.batteryHealth || current.simState != info.simState;
+        current = info;
+        if (volatileChanged) {
+            emit deviceInfoUpdated(info);
         }
     }
+}
+
+void DeviceDetector::refreshVolatileState()
+{
+    // 只刷新易变字段：ADB 设备执行精简脚本，fastbootd 只查询电池；静态字段和模式不变
+    for (auto it = m_currentDevices.constBegin(); it != m_currentDevices.constEnd(); ++it) {
+        const QString &serial = it.key();
+        const DeviceMode mode = static_cast<DeviceMode>(it.value().mode);
+        if (m_probeTokens.contains(serial) || m_expectedTransitions.contains(serial)) {
+            continue;
+        }
+        if (m_propertyCache.hasStaleFields(serial, mode)) {
+            requestProbe(serial, mode);
+        }
+    }
+}
+
+bool DeviceDetector::expectTransition(const QString &serial, DeviceMode toMode, int windowMs)
+{
+    // EDL/MTK 端口以USB路径标识，与重启前的序列号无法对应
+    if (toMode != MODE_ADB && !isFastbootFamily(toMode)) {
+        return false;
+    }
     
-    // 检查断开的设备
-    for (auto it = m_currentDevices.begin(); it != m_currentDevices.end(); ++it) {
-        if (!newDevices.contains(it.key())) {
+    ExpectedTransition transition;
+    transition.toMode = toMode;
+    transition.deadline = QDeadlineTimer(windowMs);
+    m_expectedTransitions.insert(serial, transition);
+    if (m_monitoring && !m_transitionTimer->isActive()) {
+        m_transitionTimer->start();
+    }
+    return true;
+}
+
+void DeviceDetector::cancelTransition(const QString &serial)
+{
+    auto it = m_expectedTransitions.find(serial);
+    if (it == m_expectedTransitions.end()) {
+        return;
+    }
+    // 已离开的设备按普通断开处理，由下一轮枚举报告
+    const bool departed = it.value().departed;
+    m_expectedTransitions.erase(it);
+    if (m_expectedTransitions.isEmpty()) {
+        m_transitionTimer->stop();
+    }
+    if (departed) {
+        checkDevices();
+    }
+}
+
+bool DeviceDetector::holdForTransition(const QString &serial)
+{
+    auto it = m_expectedTransitions.find(serial);
+    if (it == m_expectedTransitions.end() || it.value().deadline.hasExpired()) {
+        return false;
+    }
+    if (!it.value().departed) {
+        it.value().departed = true;
+        qDebug() << "Device left for expected transition:" << serial;
+    }
+    return true;
+}
+
+void DeviceDetector::onTransitionPoll()
+{
+    expireTransitions();
+    if (m_expectedTransitions.isEmpty()) {
+        return;
+    }
+    // adb 设备已有推送时只需轮询 fastboot 和 USB 端口
+    startEnumeration(AdbEmbedded::instance().adbState() == AdbEmbedded::TOOL_READY
+                     && !m_adbTracker->isTracking());
+}
+
+void DeviceDetector::expireTransitions()
+{
+    bool departedExpired = false;
+    for (auto it = m_expectedTransitions.begin(); it != m_expectedTransitions.end();) {
+        if (it.value().deadline.hasExpired()) {
+            qDebug() << "Expected transition timed out:" << it.key();
+            departedExpired = departedExpired || it.value().departed;
+            it = m_expectedTransitions.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    if (m_expectedTransitions.isEmpty()) {
+        m_transitionTimer->stop();
+    }
+    // 超时仍未出现的设备由完整枚举报告断开
+    if (departedExpired) {
+        checkDevices();
+    }
+}
+
+void DeviceDetector::cancelStaleProbes(const std::function<bool(const QString &, int)> &isStale)
+{
+    for (auto it = m_probesInFlight.constBegin(); it != m_probesInFlight.constEnd(); ++it) {
+        if (isStale(it.key(), it.value())) {
+            m_probeTokens.remove(it.key());
+        }
+    }
+}
+
+void DeviceDetector::onAdbDevicesUpdated(const QMap<QString, QString> &devices)
+{
+    // adb server 每次推送完整列表，仅对新增、状态变化和消失的设备做处理
+    for (auto it = m_currentDevices.begin(); it != m_currentDevices.end();) {
+        if (it.value().mode == MODE_ADB && devices.value(it.key()) != "device" && !holdForTransition(it.key())) {
+            m_propertyCache.invalidate(it.key());
             emit deviceDisconnected(it.key());
-            qDebug() << "Device disconnected:" << it.key();
+            qDebug() << "ADB device disconnected:" << it.key();
+            it = m_currentDevices.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    cancelStaleProbes([&devices](const QString &serial, int mode) {
+        return mode == MODE_ADB && devices.value(serial) != "device";
+    });
+    
+    for (auto it = devices.constBegin(); it != devices.constEnd(); ++it) {
+        const QString &serial = it.key();
+        if (it.value() != "device") {
+            continue;
+        }
+        if (!m_currentDevices.contains(serial) || m_currentDevices[serial].mode != MODE_ADB
+            || m_expectedTransitions.value(serial).departed) {
+            requestProbe(serial, MODE_ADB);
+        }
+    }
+}
+
+void DeviceDetector::onAdbTrackingStateChanged(bool tracking)
+{
+    if (tracking) {
+        m_monitorTimer->setInterval(SAFETY_POLL_INTERVAL);
+        qDebug() << "ADB device tracking active, polling reduced to safety net";
+    } else {
+        m_monitorTimer->setInterval(POLL_INTERVAL);
+        qDebug() << "ADB device tracking lost, falling back to polling";
+    }
+    updateFastbootPolling();
+}
+
+void DeviceDetector::updateFastbootPolling()
+{
+    // 未订阅adb推送时全量轮询已覆盖fastboot；有USB热插拔事件时也无需单独轮询
+    bool fullPolling = m_monitorTimer->isActive() && !m_adbTracker->isTracking();
+    bool needPolling = m_monitoring && !fullPolling && !m_usbMonitor->isRunning();
+    
+    if (needPolling && !m_fastbootTimer->isActive()) {
+        m_fastbootTimer->start();
+    } else if (!needPolling) {
+        m_fastbootTimer->stop();
+    }
+}
+
+void DeviceDetector::onUsbDeviceArrived(const UsbDeviceDescription &device)
+{
+    qDebug() << "USB device arrived:" << device.portPath
+             << QString("%1:%2").arg(device.vendorId, 4, 16, QChar('0')).arg(device.productId, 4, 16, QChar('0'));
+    
+    // MTK BROM/Preloader 端口只存在几百毫秒，不等待合并延迟直接上报
+    DeviceMode mode = usbDeviceMode(device);
+    if (mode != MODE_UNKNOWN) {
+        reportUsbDevice(device, mode);
+    }
+    scheduleHotplugProbe(device);
+}
+
+void DeviceDetector::reportUsbDevice(const UsbDeviceDescription &device, DeviceMode mode)
+{
+    if (!m_monitoring) {
+        return;
+    }
+    auto known = m_currentDevices.constFind(device.portPath);
+    if (known != m_currentDevices.constEnd() && known.value().mode == mode) {
+        return;
+    }
+    
+    // 描述符已包含全部信息，按探测结果处理，同时作废该端口上进行中的探测
+    quint64 token = ++m_probeSequence;
+    m_probesInFlight.insert(device.portPath, mode);
+    m_probeTokens.insert(device.portPath, token);
+    applyProbeResult(device.portPath, usbDeviceInfo(device, mode), token);
+}
+
+DeviceDetector::DeviceMode DeviceDetector::usbDeviceMode(const UsbDeviceDescription &device)
+{
+    if (EDL9008::isEdlDevice(device)) {
+        return MODE_EDL_9008;
+    }
+    if (MTKDA::isMtkDevice(device)) {
+        return MODE_MTK_DA;
+    }
+    return MODE_UNKNOWN;
+}
+
+DeviceInfo DeviceDetector::usbDeviceInfo(const UsbDeviceDescription &device, DeviceMode mode)
+{
+    DeviceInfo info;
+    info.serialNumber = device.portPath;
+    info.mode = mode;
+    info.hwVersion = QString("%1:%2")
+        .arg(device.vendorId, 4, 16, QChar('0'))
+        .arg(device.productId, 4, 16, QChar('0'));
+    
+    if (mode == MODE_EDL_9008) {
+        if (const EDL9008::UsbId *id = EDL9008::matchDevice(device)) {
+            info.manufacturer = id->vendorName;
+            info.model = id->productName;
+        }
+    } else if (mode == MODE_MTK_DA) {
+        if (const MTKDA::UsbId *id = MTKDA::matchDevice(device)) {
+            info.manufacturer = id->vendorName;
+            info.model = MTKDA::stageName(id->stage);
+        }
+    }
+    return info;
+}
+
+void DeviceDetector::onUsbDeviceLeft(const UsbDeviceDescription &device)
+{
+    qDebug() << "USB device left:" << device.portPath;
+    if (!m_monitoring) {
+        return;
+    }
+    
+    // EDL/MTK 端口以USB路径为标识，直接按描述符报告断开
+    DeviceMode mode = usbDeviceMode(device);
+    if (mode != MODE_UNKNOWN) {
+        auto known = m_currentDevices.constFind(device.portPath);
+        if (known != m_currentDevices.constEnd() && known.value().mode == mode) {
+            reportDisconnected(device.portPath);
         }
+        return;
+    }
+    
+    if (device.isFastbootInterface()) {
+        m_hotplugPorts.remove(device.portPath);
+        forgetHotplugPort(device);
+    } else if (device.isAdbInterface() && m_monitorTimer->isActive() && !m_adbTracker->isTracking()) {
+        QTimer::singleShot(HOTPLUG_SETTLE_DELAY, this, &DeviceDetector::checkDevices);
+    }
+}
+
+void DeviceDetector::scheduleHotplugProbe(const UsbDeviceDescription &device)
+{
+    if (!m_monitoring) {
+        return;
     }
     
-    m_currentDevices = newDevices;
+    // EDL/MTK 端口已由 reportUsbDevice 上报，ADB 设备由adb推送处理
+    if (device.isFastbootInterface()) {
+        m_hotplugPorts.insert(device.portPath);
+        m_hotplugProbeTimer->start();
+    } else if (device.isAdbInterface() && m_monitorTimer->isActive() && !m_adbTracker->isTracking()) {
+        QTimer::singleShot(HOTPLUG_SETTLE_DELAY, this, &DeviceDetector::checkDevices);
+    }
+}
+
+void DeviceDetector::probeHotplugPorts()
+{
+    const QSet<QString> ports = m_hotplugPorts;
+    m_hotplugPorts.clear();
+    
+    // 只为插入的端口建立fastboot会话，与枚举在同一检测线程中串行执行
+    m_detectionPool->start([this, ports]() {
+        bool allOpened = true;
+        for (const QString &port : ports) {
+            FastbootUsbManager::DeviceEntry entry;
+            if (!FastbootUsbManager::instance().openPort(port, entry)) {
+                allOpened = false;
+                continue;
+            }
+            {
+                QMutexLocker locker(&m_fastbootModeMutex);
+                m_fastbootDeviceModes[entry.serial] = entry.isFastbootd;
+            }
+            QMetaObject::invokeMethod(this, [this, entry]() {
+                applyHotplugFastboot(entry.serial, entry.isFastbootd);
+            }, Qt::QueuedConnection);
+        }
+        // 无法直接打开 (libusb 不可用或缺少权限) 时由完整枚举回退到fastboot进程
+        if (!allOpened) {
+            QMetaObject::invokeMethod(this, &DeviceDetector::checkFastbootDevices, Qt::QueuedConnection);
+        }
+    });
+}
+
+void DeviceDetector::applyHotplugFastboot(const QString &serial, bool isFastbootd)
+{
+    if (!m_monitoring) {
+        return;
+    }
+    DeviceMode mode = isFastbootd ? MODE_FASTBOOTD : MODE_FASTBOOT;
+    auto known = m_currentDevices.constFind(serial);
+    if (known != m_currentDevices.constEnd() && known.value().mode == mode
+        && !m_expectedTransitions.value(serial).departed) {
+        return;
+    }
+    requestProbe(serial, mode);
+}
+
+void DeviceDetector::forgetHotplugPort(const UsbDeviceDescription &device)
+{
+    const QString port = device.portPath;
+    m_detectionPool->start([this, port]() {
+        QString serial;
+        bool known = FastbootUsbManager::instance().forgetPort(port, serial);
+        QMetaObject::invokeMethod(this, [this, known, serial]() {
+            if (!m_monitoring) {
+                return;
+            }
+            // 端口上没有原生会话 (设备经fastboot进程访问) 时无法对应序列号，由完整枚举处理
+            if (!known) {
+                checkFastbootDevices();
+                return;
+            }
+            auto current = m_currentDevices.constFind(serial);
+            if (current == m_currentDevices.constEnd() || !isFastbootFamily(current.value().mode)) {
+                return;
+            }
+            {
+                QMutexLocker locker(&m_fastbootModeMutex);
+                m_fastbootDeviceModes.remove(serial);
+            }
+            if (!holdForTransition(serial)) {
+                reportDisconnected(serial);
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+
+void DeviceDetector::reportDisconnected(const QString &serial)
+{
+    m_propertyCache.invalidate(serial);
+    m_probeTokens.remove(serial);
+    m_probesInFlight.remove(serial);
+    m_currentDevices.remove(serial);
+    emit deviceDisconnected(serial);
+    qDebug() << "Device disconnected:" << serial;
+}
+
+bool DeviceDetector::isFastbootFamily(int mode)
+{
+    return mode == MODE_FASTBOOT || mode == MODE_FASTBOOTD;
 }
 
 bool DeviceDetector::detectADBDevices(QStringList &devices)
 {
-    QString output = AdbEmbedded::instance().executeCommand("devices -l");
-    QStringList lines = output.split('\n', Qt::SkipEmptyParts);
+    AdbCommandResult result = AdbEmbedded::waitForResult(
+        AdbEmbedded::instance().executeAsync({"devices", "-l"}));
+    if (!result.succeeded()) {
+        return false;
+    }
+    QStringList lines = QString::fromUtf8(result.stdOut).split('\n', Qt::SkipEmptyParts);
     
     for (const QString &line : lines) {
         if (line.contains("device") && !line.startsWith("List")) {
@@ -131,10 +878,10 @@ bool DeviceDetector::detectADBDevices(QStringList &devices)
 DeviceDetector::DeviceMode DeviceDetector::detectDeviceMode(const QString &deviceId)
 {
     // 尝试ADB命令
-    QString adbResult = AdbEmbedded::instance().executeCommand(
-        QString("-s %1 shell getprop ro.build.version.sdk").arg(deviceId));
+    AdbCommandResult adbResult = AdbEmbedded::waitForResult(
+        AdbEmbedded::instance().shellAsync(deviceId, "getprop ro.build.version.sdk"));
     
-    if (!adbResult.contains("Error")) {
+    if (adbResult.succeeded()) {
         return MODE_ADB;
     }
     
@@ -149,13 +896,15 @@ DeviceDetector::DeviceMode DeviceDetector::detectDeviceMode(const QString &devic
         }
     }
     
-    // 检测EDL模式 (需要USB检测)
-    if (detectEDLMode()) {
+    // 检测EDL模式，EDL设备以USB端口路径为标识
+    QStringList edlDevices;
+    if (detectEDLDevices(edlDevices) && edlDevices.contains(deviceId)) {
         return MODE_EDL_9008;
     }
     
     // 检测MTK DA模式
-    if (detectMTKDAMode()) {
+    QStringList mtkDevices;
+    if (detectMTKDevices(mtkDevices) && mtkDevices.contains(deviceId)) {
         return MODE_MTK_DA;
     }
     
@@ -169,40 +918,43 @@ DeviceInfo DeviceDetector::getDeviceInfo(const QString &deviceId, DeviceMode mod
     info.mode = mode;
     
     if (mode == MODE_ADB) {
-        // 使用ADB获取详细信息
+        // 探测脚本失败时逐项使用ADB获取详细信息 (运行在探测线程中)
+        auto shellOutput = [&deviceId](const QString &command) {
+            AdbCommandResult result = AdbEmbedded::waitForResult(
+                AdbEmbedded::instance().shellAsync(deviceId, command));
+            return result.succeeded() ? QString::fromUtf8(result.stdOut).trimmed() : QString();
+        };
+        
         info.manufacturer = AdbEmbedded::instance().getDeviceInfo(deviceId, "ro.product.manufacturer");
         info.model = AdbEmbedded::instance().getDeviceInfo(deviceId, "ro.product.model");
         info.deviceName = AdbEmbedded::instance().getDeviceInfo(deviceId, "ro.product.device");
         info.androidVersion = AdbEmbedded::instance().getDeviceInfo(deviceId, "ro.build.version.release");
         info.buildNumber = AdbEmbedded::instance().getDeviceInfo(deviceId, "ro.build.display.id");
         
+        // 启动标识：缓存条目以它判断设备是否重启过
+        info.bootId = shellOutput("cat /proc/sys/kernel/random/boot_id");
+        
         // 获取Android SDK版本
         QString sdkVersion = AdbEmbedded::instance().getDeviceInfo(deviceId, "ro.build.version.sdk");
         
         // 检查Root状态
-        QString rootCheck = AdbEmbedded::instance().executeCommand(
-            QString("-s %1 shell \"which su\"").arg(deviceId));
-        info.isRooted = !rootCheck.trimmed().isEmpty();
+        info.isRooted = !shellOutput("which su").isEmpty();
         
         // 获取网络信息
-        info.imei = AdbEmbedded::instance().executeCommand(
-            QString("-s %1 shell service call iphonesubinfo 1 | awk -F \"'\" '{print $2}' | sed '1 d' | tr -d '.' | awk '{print $1}'").arg(deviceId)).trimmed();
+        info.imei = shellOutput("service call iphonesubinfo 1 | awk -F \"'\" '{print $2}' | sed '1 d' | tr -d '.' | awk '{print $1}'");
         
         info.wifiMac = AdbEmbedded::instance().getDeviceInfo(deviceId, "ro.boot.wifimacaddr");
         
         // 获取硬件信息
-        info.cpuInfo = AdbEmbedded::instance().executeCommand(
-            QString("-s %1 shell cat /proc/cpuinfo | grep -i processor | wc -l").arg(deviceId)).trimmed() + " 核心";
+        info.cpuInfo = shellOutput("cat /proc/cpuinfo | grep -i processor | wc -l") + " 核心";
         
-        QString ramInfo = AdbEmbedded::instance().executeCommand(
-            QString("-s %1 shell cat /proc/meminfo | grep MemTotal").arg(deviceId)).trimmed();
+        QString ramInfo = shellOutput("cat /proc/meminfo | grep MemTotal");
         if (!ramInfo.isEmpty()) {
             info.ramSize = ramInfo.split(":").value(1).trimmed();
         }
         
         // 获取电池信息
-        QString batteryLevel = AdbEmbedded::instance().executeCommand(
-            QString("-s %1 shell dumpsys battery | grep level").arg(deviceId)).trimmed();
+        QString batteryLevel = shellOutput("dumpsys battery | grep level");
         if (!batteryLevel.isEmpty()) {
             info.batteryHealth = batteryLevel.split(":").value(1).trimmed() + "%";
         }
@@ -211,11 +963,33 @@ DeviceInfo DeviceDetector::getDeviceInfo(const QString &deviceId, DeviceMode mod
         // 获取Fastboot设备信息
         info = getFastbootDeviceInfo(deviceId);
         info.mode = mode; // 确保模式正确设置
+    } else if (mode == MODE_EDL_9008 || mode == MODE_MTK_DA) {
+        // EDL/MTK 端口信息来自USB描述符，无需打开设备
+        QList<UsbDeviceDescription> usbDevices;
+        UsbContext::instance().devices(usbDevices);
+        for (const UsbDeviceDescription &device : std::as_const(usbDevices)) {
+            if (device.portPath == deviceId && usbDeviceMode(device) == mode) {
+                info = usbDeviceInfo(device, mode);
+                break;
+            }
+        }
     }
     
     return info;
 }
 
+QString DeviceDetector::formatFastbootBattery(const QString &batteryStatus)
+{
+    if (batteryStatus == "low") {
+        return "电量低";
+    } else if (batteryStatus == "ok") {
+        return "正常";
+    } else if (!batteryStatus.isEmpty() && !batteryStatus.contains("Not found")) {
+        return batteryStatus;
+    }
+    return "未知";
+}
+
 // 新增结构体存储设备ID和模式
 struct FastbootDevice {
     QString id;
@@ -224,29 +998,36 @@ struct FastbootDevice {
 
 bool DeviceDetector::detectFastbootDevices(QStringList &devices)
 {
-    QProcess fastbootProcess;
-    QString fastbootPath = AdbEmbedded::instance().getFastbootPath();
+    // 优先通过libusb直接枚举fastboot接口，并保持会话供后续命令复用
+    FastbootUsbManager &usbManager = FastbootUsbManager::instance();
+    QList<FastbootUsbManager::DeviceEntry> usbDevices;
+    if (usbManager.isAvailable() && usbManager.enumerate(usbDevices)) {
+        QMutexLocker locker(&m_fastbootModeMutex);
+        m_fastbootDeviceModes.clear();
+        for (const FastbootUsbManager::DeviceEntry &entry : usbDevices) {
+            devices.append(entry.serial);
+            m_fastbootDeviceModes[entry.serial] = entry.isFastbootd;
+        }
+        return !devices.isEmpty();
+    }
     
-    if (fastbootPath.isEmpty()) {
+    if (AdbEmbedded::instance().getFastbootPath().isEmpty()) {
         qDebug() << "Fastboot path is empty, skipping detection";
         return false;
     }
     
     // 执行 `fastboot devices -l` 获取详细信息（包含模式）
-    fastbootProcess.setProgram(fastbootPath);
-    fastbootProcess.setArguments(QStringList() << "devices" << "-l");
-    
-    fastbootProcess.start();
-    if (!fastbootProcess.waitForFinished(3000)) {
-        fastbootProcess.kill();
+    AdbCommandOptions options;
+    options.deadline = QDeadlineTimer(3000);
+    AdbCommandResult result = AdbEmbedded::waitForResult(
+        AdbEmbedded::instance().fastbootAsync({"devices", "-l"}, options));
+    if (!result.error.isEmpty()) {
         return false;
     }
     
-    QString output = fastbootProcess.readAllStandardOutput();
-    QString error = fastbootProcess.readAllStandardError();
-    
-    if (!error.isEmpty()) {
-        qDebug() << "Fastboot error:" << error;
+    QString output = QString::fromUtf8(result.stdOut);
+    if (!result.stdErr.isEmpty()) {
+        qDebug() << "Fastboot error:" << result.stdErr;
     }
     
     QStringList lines = output.split('\n', Qt::SkipEmptyParts);
@@ -271,6 +1052,7 @@ bool DeviceDetector::detectFastbootDevices(QStringList &devices)
     }
     
     // 缓存设备模式（用于后续快速查询）
+    QMutexLocker locker(&m_fastbootModeMutex);
     m_fastbootDeviceModes.clear();
     for (const auto &device : fbDevices) {
         m_fastbootDeviceModes[device.id] = device.isFastbootd;
@@ -294,33 +1076,45 @@ DeviceInfo DeviceDetector::getFastbootDeviceInfo(const QString &deviceId)
     qDebug() << "Getting Fastboot device info for:" << deviceId;
     
     try {
+        // 一次 getvar all 取回全部变量，不支持时 snapshot 为空，逐个查询
+        QMap<QString, QString> snapshot = getFastbootSnapshot(deviceId);
+        qDebug() << "getvar all snapshot:" << snapshot.size() << "variables";
+        
         // 获取基础设备信息
-        info.productName = getFastbootVar("product", deviceId);
+        info.productName = getFastbootVar("product", deviceId, snapshot);
         qDebug() << "Product name:" << info.productName;
         
-        info.variant = getFastbootVar("variant", deviceId);
+        info.variant = getFastbootVar("variant", deviceId, snapshot);
         qDebug() << "Variant:" << info.variant;
         
-        info.hwVersion = getFastbootVar("hw_version", deviceId);
-        if (info.hwVersion.isEmpty()) {
-            info.hwVersion = getFastbootVar("hw-version", deviceId);
+        if (!snapshot.isEmpty() && !snapshot.contains("hw_version")) {
+            info.hwVersion = getFastbootVar("hw-version", deviceId, snapshot);
+        } else {
+            info.hwVersion = getFastbootVar("hw_version", deviceId, snapshot);
+            if (info.hwVersion.isEmpty()) {
+                info.hwVersion = getFastbootVar("hw-version", deviceId, snapshot);
+            }
         }
         qDebug() << "HW version:" << info.hwVersion;
         
         // 获取 Bootloader 版本
-        info.bootloaderVersion = getFastbootVar("bootloader-version", deviceId);
+        info.bootloaderVersion = getFastbootVar("bootloader-version", deviceId, snapshot);
         if (info.bootloaderVersion.isEmpty() || info.bootloaderVersion.contains("FAILED")) {
         info.bootloaderVersion = "无法获取";
         }
         qDebug() << "Bootloader version:" << info.bootloaderVersion;
         
         // 检测Bootloader锁状态
-        QString bootloaderStatus = getBootloaderStatus(deviceId);
+        QString bootloaderStatus = getBootloaderStatus(deviceId, snapshot);
         info.isBootloaderUnlocked = (bootloaderStatus == "已解锁");
         qDebug() << "Bootloader status:" << bootloaderStatus;
         
         // 检测是否为Fastbootd模式
-        info.isFastbootdMode = isFastbootdMode(deviceId);
+        if (snapshot.contains("is-userspace")) {
+            info.isFastbootdMode = (snapshot.value("is-userspace") == "yes");
+        } else {
+            info.isFastbootdMode = isFastbootdMode(deviceId);
+        }
         if (info.isFastbootdMode) {
             info.mode = MODE_FASTBOOTD;
         }
@@ -328,16 +1122,7 @@ DeviceInfo DeviceDetector::getFastbootDeviceInfo(const QString &deviceId)
         
         // 仅在Fastbootd模式下获取电池状态
         if (info.isFastbootdMode) {
-            QString batteryStatus = getFastbootVar("battery-status", deviceId);
-            if (batteryStatus == "low") {
-                info.batteryHealth = "电量低";
-            } else if (batteryStatus == "ok") {
-                info.batteryHealth = "正常";
-            } else if (!batteryStatus.isEmpty() && !batteryStatus.contains("Not found")) {
-                info.batteryHealth = batteryStatus;
-            } else {
-                info.batteryHealth = "未知";
-            }
+            info.batteryHealth = formatFastbootBattery(getFastbootVar("battery-status", deviceId, snapshot));
         } else {
             info.batteryHealth = "传统Fastboot模式不支持电池检测";
         }
@@ -384,8 +1169,16 @@ DeviceInfo DeviceDetector::getFastbootDeviceInfo(const QString &deviceId)
     return info;
 }
 
-QString DeviceDetector::getBootloaderStatus(const QString &deviceId)
+QString DeviceDetector::getBootloaderStatus(const QString &deviceId, const QMap<QString, QString> &snapshot)
 {
+    // getvar all 已包含 unlocked 时无需再发送 oem 命令
+    QString snapshotUnlocked = snapshot.value("unlocked");
+    if (snapshotUnlocked == "yes") {
+        return "已解锁";
+    } else if (snapshotUnlocked == "no") {
+        return "已锁定";
+    }
+    
     // 方法1: 检查oem device-info (小米等品牌)
     QString oemInfo = executeFastbootCommand("oem device-info", deviceId);
     if (oemInfo.contains("Device unlocked: true") || oemInfo.contains("unlocked: true")) {
@@ -403,7 +1196,7 @@ QString DeviceDetector::getBootloaderStatus(const QString &deviceId)
     }
     
     // 方法3: 检查getvar unlocked状态
-    QString unlockedStatus = getFastbootVar("unlocked", deviceId);
+    QString unlockedStatus = getFastbootVar("unlocked", deviceId, snapshot);
     if (unlockedStatus == "yes") {
         return "已解锁";
     } else if (unlockedStatus == "no") {
@@ -423,8 +1216,11 @@ QString DeviceDetector::getBootloaderStatus(const QString &deviceId)
 bool DeviceDetector::isFastbootdMode(const QString &deviceId)
 {
     // 直接从缓存获取，避免重复执行命令
-    if (m_fastbootDeviceModes.contains(deviceId)) {
-        return m_fastbootDeviceModes[deviceId];
+    {
+        QMutexLocker locker(&m_fastbootModeMutex);
+        if (m_fastbootDeviceModes.contains(deviceId)) {
+            return m_fastbootDeviceModes.value(deviceId);
+        }
     }
     
     // 兼容处理：若缓存未命中，执行原逻辑作为 fallback
@@ -432,11 +1228,50 @@ bool DeviceDetector::isFastbootdMode(const QString &deviceId)
     return result.contains("is-userspace: yes") || result.contains("fastbootd");
 }
 
-QString DeviceDetector::getFastbootVar(const QString &varName, const QString &deviceId)
+QMap<QString, QString> DeviceDetector::getFastbootSnapshot(const QString &deviceId)
+{
+    QMap<QString, QString> snapshot;
+    if (deviceId.isEmpty()) {
+        return snapshot;
+    }
+    
+    if (std::shared_ptr<FastbootClient> client = FastbootUsbManager::instance().session(deviceId)) {
+        client->getvarAll(snapshot);
+        return snapshot;
+    }
+    
+    // fastboot 进程将变量以 "(bootloader) key: value" 形式输出
+    QStringList lines = executeFastbootCommand("getvar all", deviceId).split('\n', Qt::SkipEmptyParts);
+    QStringList variableLines;
+    for (const QString &line : lines) {
+        if (line.startsWith("(bootloader) ")) {
+            variableLines.append(line);
+        }
+    }
+    return FastbootClient::parseVariables(variableLines);
+}
+
+QString DeviceDetector::getFastbootVar(const QString &varName, const QString &deviceId,
+                                       const QMap<QString, QString> &snapshot)
 {
     if (varName.isEmpty() || deviceId.isEmpty()) {
         return "";
     }
+    
+    // 快照中已有的变量不再访问设备；部分引导程序的 getvar all 不列出全部变量，缺失时单独查询
+    auto cached = snapshot.constFind(varName);
+    if (cached != snapshot.constEnd()) {
+        return cached.value();
+    }
+
+    // 已建立原生会话时直接查询，不再启动fastboot进程
+    if (std::shared_ptr<FastbootClient> client = FastbootUsbManager::instance().session(deviceId)) {
+        QString value;
+        if (client->getvar(varName, value)) {
+            return value;
+        }
+        return "设备不支持此信息";
+    }
 
     // 执行 fastboot 命令获取变量
     QString command = QString("getvar %1").arg(varName);
@@ -462,52 +1297,73 @@ QString DeviceDetector::getFastbootVar(const QString &varName, const QString &de
 
 QString DeviceDetector::executeFastbootCommand(const QString &command, const QString &deviceId)
 {
+    // 拆分命令参数
+    QStringList commandArguments = command.split(' ', Qt::SkipEmptyParts);
+    
+    if (!deviceId.isEmpty()) {
+        FastbootUsbManager &usbManager = FastbootUsbManager::instance();
+        QString wireCommand = FastbootClient::commandFromArguments(commandArguments);
+        std::shared_ptr<FastbootClient> client = usbManager.session(deviceId);
+        
+        if (client && !wireCommand.isEmpty()) {
+            FastbootResponse response;
+            client->command(wireCommand, response);
+            return FastbootClient::formatResponse(wireCommand, response);
+        }
+        if (client) {
+            // 原生会话占用着USB接口，交给fastboot进程前先释放
+            usbManager.release(deviceId);
+        }
+    }
+    
     if (!AdbEmbedded::instance().initialize()) {
         return "Error: ADB/Fastboot not initialized";
     }
 
-    QProcess process;
-    QString fastbootPath = AdbEmbedded::instance().getFastbootPath();
-    
     QStringList arguments;
     if (!deviceId.isEmpty()) {
         arguments << "-s" << deviceId;
     }
+    arguments << commandArguments;
     
-    // 拆分命令参数
-    arguments << command.split(' ', Qt::SkipEmptyParts);
-    
-    process.setProgram(fastbootPath);
-    process.setArguments(arguments);
-    
-    process.start();
-    if (!process.waitForFinished(5000)) {
-        process.kill();
+    AdbCommandOptions options;
+    options.deadline = QDeadlineTimer(5000);
+    AdbCommandResult result = AdbEmbedded::waitForResult(
+        AdbEmbedded::instance().fastbootAsync(arguments, options));
+    if (result.timedOut) {
         return "Error: Fastboot command timed out";
     }
+    if (!result.error.isEmpty()) {
+        return "Error: " + result.error;
+    }
     
-    QString output = process.readAllStandardOutput();
-    QString error = process.readAllStandardError();
-    
-    return output + error;
+    return QString::fromUtf8(result.stdOut + result.stdErr);
 }
 
-bool DeviceDetector::detectEDLMode()
+bool DeviceDetector::detectEDLDevices(QStringList &devices)
 {
-    // EDL模式检测需要通过USB设备枚举
-    // 这里使用libusb或QSerialPort来检测9008端口设备
-    // 简化实现，返回false
-    qDebug() << "EDL mode detection not implemented yet";
-    return false;
+    // EDL 设备没有可读的序列号，以USB端口路径为标识
+    QList<UsbDeviceDescription> edlDevices;
+    if (!EDL9008::scanDevices(edlDevices)) {
+        return false;
+    }
+    for (const UsbDeviceDescription &device : std::as_const(edlDevices)) {
+        devices.append(device.portPath);
+    }
+    return !devices.isEmpty();
 }
 
-bool DeviceDetector::detectMTKDAMode()
+bool DeviceDetector::detectMTKDevices(QStringList &devices)
 {
-    // MTK DA模式检测
-    // 需要通过USB设备枚举和特定命令检测
-    // 简化实现，返回false
-    qDebug() << "MTK DA mode detection not implemented yet";
-    return false;
+    // MTK 下载端口同样以USB端口路径为标识
+    QList<UsbDeviceDescription> mtkDevices;
+    if (!MTKDA::scanDevices(mtkDevices)) {
+        return false;
+    }
+    for (const UsbDeviceDescription &device : std::as_const(mtkDevices)) {
+        devices.append(device.portPath);
+    }
+    return !devices.isEmpty();
 }
 
 // ==================== 设备信息显示改进 ====================
@@ -4,8 +4,21 @@
 #include <QObject>
 #include <QTimer>
 #include <QMap>
+#include <QHash>
+#include <QSet>
+#include <QMutex>
+#include <QDeadlineTimer>
 #include <QString>
+#include <functional>
 #include "device_info.h"
+#include "usb_context.h"
+#include "device_property_cache.h"
+#include "adb_command.h"
+#include "adb_embedded.h"
+
+class AdbDeviceTracker;
+class UsbHotplugMonitor;
+class QThreadPool;
 
 class DeviceDetector : public QObject
 {
@@ -36,32 +49,123 @@ public:
     QString getBootloaderStatusIcon(bool isUnlocked) const;
     QString getModeDisplayName(DeviceMode mode) const;
     void forceRefresh() { checkDevices(); }
-    QMap<QString, bool> m_fastbootDeviceModes; 
+    DeviceInfo currentDeviceInfo(const QString &serial) const { return m_currentDevices.value(serial); }
+    // 重启前登记预期的模式转换：窗口期内加快轮询，设备短暂消失不报告断开，
+    // 以新模式重新出现时沿用已知身份信息并只发出一次 deviceModeChanged
+    // 只支持能按序列号识别的模式 (ADB/Fastboot/Fastbootd)；只能在本对象所在线程调用
+    bool expectTransition(const QString &serial, DeviceMode toMode, int windowMs = TRANSITION_WINDOW);
+    void cancelTransition(const QString &serial);
+    DevicePropertyCache::Stats propertyCacheStats() const { return m_propertyCache.stats(); }
+    QMap<QString, bool> m_fastbootDeviceModes;     // 由检测线程写入，访问时需持有 m_fastbootModeMutex
 
 signals:
     void deviceConnected(const DeviceInfo &info);
     void deviceDisconnected(const QString &serial);
     void deviceModeChanged(const QString &serial, DeviceMode newMode);
+    // 已连接设备的电池、SIM 等易变信息刷新后发出
+    void deviceInfoUpdated(const DeviceInfo &info);
 
 private slots:
     void checkDevices();
+    void checkFastbootDevices();
+    void onAdbDevicesUpdated(const QMap<QString, QString> &devices);
+    void onAdbTrackingStateChanged(bool tracking);
+    void onUsbDeviceArrived(const UsbDeviceDescription &device);
+    void onUsbDeviceLeft(const UsbDeviceDescription &device);
+    void onAdbStateChanged(AdbEmbedded::ToolState state);
+    void onFastbootStateChanged(AdbEmbedded::ToolState state);
+    void onTransitionPoll();
+    void refreshVolatileState();
 
 private:
+    static const int POLL_INTERVAL = 2000;          // 无设备推送时的轮询周期
+    static const int SAFETY_POLL_INTERVAL = 10000;  // 有设备推送时的兜底轮询周期
+    static const int HOTPLUG_SETTLE_DELAY = 200;    // USB插入后等待接口就绪的时间
+    static const int MAX_PROBE_THREADS = 32;        // 并发探测设备的线程上限
+    static const int VOLATILE_REFRESH_INTERVAL = 10000;    // 检查已知设备易变字段是否到期的周期
+    static const int TRANSITION_POLL_INTERVAL = 250;    // 等待预期模式转换时的轮询周期
+    static const int TRANSITION_WINDOW = 60000;
+    
+    // 一次设备枚举的结果，序列号 -> DeviceMode
+    struct EnumerationResult {
+        bool adbScanned = false;
+        bool usbScanned = false;    // 本轮是否扫描了 EDL/MTK 等仅凭USB描述符识别的设备
+        QMap<QString, int> devices;
+    };
+    
+    // 一台设备预期的模式转换
+    struct ExpectedTransition {
+        DeviceMode toMode = MODE_UNKNOWN;
+        bool departed = false;      // 已从原模式消失，m_currentDevices 中保留的是转换前的信息
+        QDeadlineTimer deadline;
+    };
+    
     QTimer *m_monitorTimer;
+    QTimer *m_fastbootTimer;
+    AdbDeviceTracker *m_adbTracker;
+    UsbHotplugMonitor *m_usbMonitor;
+    QTimer *m_hotplugProbeTimer;
+    QTimer *m_transitionTimer;
+    QTimer *m_refreshTimer;
+    QThreadPool *m_detectionPool;
+    QThreadPool *m_probePool;
     QMap<QString, DeviceInfo> m_currentDevices;
+    QMutex m_fastbootModeMutex;
+    DevicePropertyCache m_propertyCache;
+    
+    // 以下状态只在本对象所在线程中访问
+    bool m_monitoring;
+    bool m_enumerating;
+    bool m_pendingEnumeration;
+    bool m_pendingAdbEnumeration;
+    quint64 m_probeSequence;
+    QHash<QString, int> m_probesInFlight;       // 序列号 -> 探测时的模式
+    QHash<QString, quint64> m_probeTokens;      // 序列号 -> 有效探测的编号
+    QHash<QString, ExpectedTransition> m_expectedTransitions;
+    QSet<QString> m_hotplugPorts;               // 等待合并延迟后探测的fastboot端口路径
     
-    void detectConnectedDevices();
+    void startAdbMonitoring();
+    void startEnumeration(bool includeAdb);
+    EnumerationResult enumerateDevices(bool includeAdb);
+    void applyEnumeration(const EnumerationResult &result);
+    void requestProbe(const QString &serial, DeviceMode mode);
+    DeviceInfo probeDevice(const QString &deviceId, DeviceMode mode);
+    DeviceInfo probeDeviceUncached(const QString &deviceId, DeviceMode mode);
+    void startAdbProbe(const QString &serial, quint64 token);
+    bool applyAdbVolatileOutput(const QString &serial, const AdbCommandResult &result,
+                                const QList<DevicePropertyCache::VolatileField> &fields, DeviceInfo &info);
+    static bool parseAdbProbeOutput(const AdbCommandResult &result, DeviceInfo &info);
+    bool refreshVolatileFields(const QString &deviceId, DeviceInfo &info,
+                               const QList<DevicePropertyCache::VolatileField> &fields);
+    void applyProbeResult(const QString &serial, const DeviceInfo &info, quint64 token);
+    void cancelStaleProbes(const std::function<bool(const QString &, int)> &isStale);
+    // 设备从枚举中消失时调用：处于预期转换窗口内则记录离开并返回 true，调用方保留设备不报告断开
+    bool holdForTransition(const QString &serial);
+    void expireTransitions();
+    void scheduleHotplugProbe(const UsbDeviceDescription &device);
+    void probeHotplugPorts();
+    void applyHotplugFastboot(const QString &serial, bool isFastbootd);
+    void forgetHotplugPort(const UsbDeviceDescription &device);
+    void reportDisconnected(const QString &serial);
+    void reportUsbDevice(const UsbDeviceDescription &device, DeviceMode mode);
+    static DeviceMode usbDeviceMode(const UsbDeviceDescription &device);
+    static DeviceInfo usbDeviceInfo(const UsbDeviceDescription &device, DeviceMode mode);
+    void updateFastbootPolling();
+    static bool isFastbootFamily(int mode);
     DeviceMode detectDeviceMode(const QString &deviceId);
     DeviceInfo getDeviceInfo(const QString &deviceId, DeviceMode mode);
+    static QString formatFastbootBattery(const QString &batteryStatus);
     
     // Fastboot特定检测
-    QString getBootloaderStatus(const QString &deviceId);
+    QString getBootloaderStatus(const QString &deviceId, const QMap<QString, QString> &snapshot = QMap<QString, QString>());
     bool isFastbootdMode(const QString &deviceId);
-    QString getFastbootVar(const QString &varName, const QString &deviceId);
+    QMap<QString, QString> getFastbootSnapshot(const QString &deviceId);
+    QString getFastbootVar(const QString &varName, const QString &deviceId,
+                           const QMap<QString, QString> &snapshot = QMap<QString, QString>());
     
     // 特定模式检测
-    bool detectEDLMode();
-    bool detectMTKDAMode();
+    bool detectEDLDevices(QStringList &devices);
+    bool detectMTKDevices(QStringList &devices);
     bool detectADBDevices(QStringList &devices);
     
     QString formatValue(const QString &value) const;
@@ -48,6 +48,7 @@ QMap<QString, QVariant> DeviceInfo::toMap() const
     // 系统信息
     map["isRooted"] = isRooted;
     map["selinuxStatus"] = selinuxStatus;
+    map["bootId"] = bootId;
     map["mode"] = mode;
     
     return map;
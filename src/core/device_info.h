@@ -48,6 +48,7 @@ public:
     // 系统信息
     bool isRooted;
     QString selinuxStatus;
+    QString bootId;     // 每次开机生成，用于判断缓存是否仍然有效
     
     int mode;  // 使用int而不是enum，避免包含问题
     
@@ -0,0 +1,145 @@
+#include "device_property_cache.h"
+#include "device_detector.h"
+#include <QMutexLocker>
+
+bool DevicePropertyCache::lookup(const QString &serial, int mode, DeviceInfo &info,
+                                 QList<VolatileField> &staleFields)
+{
+    QMutexLocker locker(&m_mutex);
+
+    auto it = m_entries.find(serial);
+    if (it == m_entries.end()) {
+        ++m_stats.misses;
+        return false;
+    }
+
+    // 模式变化后静态字段也可能不同 (如 fastboot 与 ADB 提供的信息不同)
+    if (it->info.mode != mode) {
+        m_entries.erase(it);
+        ++m_stats.invalidations;
+        ++m_stats.misses;
+        return false;
+    }
+
+    staleFields.clear();
+    for (VolatileField field : volatileFields(mode)) {
+        const QElapsedTimer &timer = it->refreshed[field];
+        if (!timer.isValid() || timer.hasExpired(refreshInterval(field))) {
+            staleFields.append(field);
+        }
+    }
+
+    if (staleFields.isEmpty()) {
+        ++m_stats.hits;
+    } else {
+        ++m_stats.refreshes;
+    }
+    info = it->info;
+    return true;
+}
+
+bool DevicePropertyCache::hasStaleFields(const QString &serial, int mode) const
+{
+    QMutexLocker locker(&m_mutex);
+
+    auto it = m_entries.constFind(serial);
+    if (it == m_entries.constEnd() || it->info.mode != mode) {
+        return false;
+    }
+    for (VolatileField field : volatileFields(mode)) {
+        const QElapsedTimer &timer = it->refreshed[field];
+        if (!timer.isValid() || timer.hasExpired(refreshInterval(field))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void DevicePropertyCache::store(const QString &serial, const DeviceInfo &info)
+{
+    QMutexLocker locker(&m_mutex);
+
+    Entry entry;
+    entry.info = info;
+    for (VolatileField field : volatileFields(info.mode)) {
+        entry.refreshed[field].start();
+    }
+    m_entries.insert(serial, entry);
+}
+
+bool DevicePropertyCache::updateVolatile(const QString &serial, const QString &bootId,
+                                         const DeviceInfo &fresh, const QList<VolatileField> &fields)
+{
+    QMutexLocker locker(&m_mutex);
+
+    auto it = m_entries.find(serial);
+    if (it == m_entries.end()) {
+        return false;
+    }
+
+    // 设备已重启，缓存的静态字段不再可信
+    if (it->info.bootId != bootId) {
+        m_entries.erase(it);
+        ++m_stats.invalidations;
+        return false;
+    }
+
+    copyFields(fresh, it->info, fields);
+    for (VolatileField field : fields) {
+        it->refreshed[field].start();
+    }
+    return true;
+}
+
+void DevicePropertyCache::invalidate(const QString &serial)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_entries.remove(serial) > 0) {
+        ++m_stats.invalidations;
+    }
+}
+
+DevicePropertyCache::Stats DevicePropertyCache::stats() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_stats;
+}
+
+QList<DevicePropertyCache::VolatileField> DevicePropertyCache::volatileFields(int mode)
+{
+    switch (mode) {
+    case DeviceDetector::MODE_ADB:
+        return {FIELD_BATTERY, FIELD_SIM_STATE};
+    case DeviceDetector::MODE_FASTBOOTD:
+        return {FIELD_BATTERY};
+    default:
+        // 传统 fastboot 下所有字段在会话期间不变
+        return {};
+    }
+}
+
+int DevicePropertyCache::refreshInterval(VolatileField field)
+{
+    switch (field) {
+    case FIELD_BATTERY: return 30000;
+    case FIELD_SIM_STATE: return 10000;
+    default: return 0;
+    }
+}
+
+void DevicePropertyCache::copyFields(const DeviceInfo &source, DeviceInfo &target,
+                                     const QList<VolatileField> &fields)
+{
+    for (VolatileField field : fields) {
+        switch (field) {
+        case FIELD_BATTERY:
+            target.batteryHealth = source.batteryHealth;
+            break;
+        case FIELD_SIM_STATE:
+            target.simState = source.simState;
+            break;
+        default:
+            break;
+        }
+    }
+}
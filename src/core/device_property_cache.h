@@ -0,0 +1,57 @@
+#ifndef DEVICE_PROPERTY_CACHE_H
+#define DEVICE_PROPERTY_CACHE_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include "device_info.h"
+
+// 按序列号缓存设备信息
+// ro.* 等静态字段在同一次启动(boot id)内只获取一次，电池、SIM 等易变字段按各自周期刷新
+// 设备断开、重连或模式变化时整条缓存失效；可在多个探测线程中并发使用
+class DevicePropertyCache
+{
+public:
+    enum VolatileField {
+        FIELD_BATTERY = 0,
+        FIELD_SIM_STATE,
+        FIELD_COUNT
+    };
+
+    struct Stats {
+        quint64 hits = 0;           // 完全命中，无需访问设备
+        quint64 misses = 0;         // 无缓存，需要完整探测
+        quint64 refreshes = 0;      // 仅刷新易变字段
+        quint64 invalidations = 0;
+    };
+
+    // 命中时填充 info，并在 staleFields 中返回已过期的易变字段
+    bool lookup(const QString &serial, int mode, DeviceInfo &info, QList<VolatileField> &staleFields);
+    void store(const QString &serial, const DeviceInfo &info);
+    // 只检查是否有易变字段到期，不计入统计也不使缓存失效
+    bool hasStaleFields(const QString &serial, int mode) const;
+    // 启动标识与缓存不一致时使整条缓存失效并返回 false
+    bool updateVolatile(const QString &serial, const QString &bootId,
+                        const DeviceInfo &fresh, const QList<VolatileField> &fields);
+    void invalidate(const QString &serial);
+
+    Stats stats() const;
+
+    static QList<VolatileField> volatileFields(int mode);
+    static int refreshInterval(VolatileField field);
+    static void copyFields(const DeviceInfo &source, DeviceInfo &target, const QList<VolatileField> &fields);
+
+private:
+    struct Entry {
+        DeviceInfo info;
+        QElapsedTimer refreshed[FIELD_COUNT];
+    };
+
+    mutable QMutex m_mutex;
+    QHash<QString, Entry> m_entries;
+    Stats m_stats;
+};
+
+#endif // DEVICE_PROPERTY_CACHE_H
@@ -0,0 +1,278 @@
+#include "fastboot_client.h"
+#include <QMutexLocker>
+#include <QDebug>
+
+namespace {
+
+const int MAX_COMMAND_LENGTH = 4096;     // 旧版引导程序限制为 64 字节
+const int MAX_RESPONSE_LENGTH = 256;
+const qint64 DOWNLOAD_CHUNK_SIZE = 1024 * 1024;
+
+} // namespace
+
+FastbootClient::FastbootClient(std::unique_ptr<FastbootTransport> transport)
+    : m_transport(std::move(transport))
+{
+}
+
+FastbootClient::~FastbootClient()
+{
+    if (m_transport) {
+        m_transport->close();
+    }
+}
+
+bool FastbootClient::command(const QString &cmd, FastbootResponse &response, int timeout)
+{
+    QMutexLocker locker(&m_mutex);
+    return commandLocked(cmd, response, timeout);
+}
+
+bool FastbootClient::getvar(const QString &name, QString &value, int timeout)
+{
+    FastbootResponse response;
+    if (!command("getvar:" + name, response, timeout)) {
+        return false;
+    }
+    value = response.message;
+    return true;
+}
+
+QMap<QString, QString> FastbootClient::getvars(const QStringList &names, int timeout)
+{
+    QMap<QString, QString> values;
+    QMutexLocker locker(&m_mutex);
+
+    for (const QString &name : names) {
+        FastbootResponse response;
+        if (commandLocked("getvar:" + name, response, timeout)) {
+            values.insert(name, response.message);
+        }
+    }
+    return values;
+}
+
+bool FastbootClient::getvarAll(QMap<QString, QString> &variables, int timeout)
+{
+    FastbootResponse response;
+    if (!command("getvar:all", response, timeout)) {
+        return false;
+    }
+    variables = parseVariables(response.info);
+    return !variables.isEmpty();
+}
+
+bool FastbootClient::download(const char *data, qint64 size, FastbootResponse &response, int timeout)
+{
+    bool sent = false;
+    return downloadStream(size, [data, size, &sent](const char *&chunk) -> qint64 {
+        if (sent) {
+            return -1;
+        }
+        sent = true;
+        chunk = data;
+        return size;
+    }, response, timeout);
+}
+
+bool FastbootClient::downloadStream(qint64 size, const ChunkSource &source, FastbootResponse &response,
+                                    int timeout)
+{
+    QMutexLocker locker(&m_mutex);
+
+    QString cmd = QString("download:%1").arg(size, 8, 16, QChar('0'));
+    if (!sendCommand(cmd, timeout, response)) {
+        return false;
+    }
+
+    qint64 accepted = 0;
+    if (!readResponse(response, &accepted, timeout)) {
+        return false;
+    }
+    if (accepted != size) {
+        response.ok = false;
+        response.message = QString("Device accepted %1 of %2 bytes").arg(accepted).arg(size);
+        return false;
+    }
+
+    for (qint64 sent = 0; sent < size;) {
+        const char *data = nullptr;
+        qint64 length = source(data);
+        if (length <= 0 || length > size - sent) {
+            response.ok = false;
+            response.message = "Download data not available";
+            return false;
+        }
+
+        for (qint64 offset = 0; offset < length;) {
+            qint64 chunk = qMin(DOWNLOAD_CHUNK_SIZE, length - offset);
+            qint64 written = m_transport->write(data + offset, chunk, timeout);
+            if (written <= 0) {
+                response.ok = false;
+                response.message = "USB write failed during download";
+                return false;
+            }
+            offset += written;
+        }
+        sent += length;
+    }
+
+    return readResponse(response, nullptr, timeout);
+}
+
+bool FastbootClient::flash(const QString &partition, FastbootResponse &response, int timeout)
+{
+    return command("flash:" + partition, response, timeout);
+}
+
+bool FastbootClient::erase(const QString &partition, FastbootResponse &response, int timeout)
+{
+    return command("erase:" + partition, response, timeout);
+}
+
+bool FastbootClient::reboot(const QString &target, FastbootResponse &response, int timeout)
+{
+    return command(target.isEmpty() ? QStringLiteral("reboot") : "reboot-" + target, response, timeout);
+}
+
+QString FastbootClient::commandFromArguments(const QStringList &arguments)
+{
+    if (arguments.isEmpty()) {
+        return QString();
+    }
+
+    const QString &verb = arguments.first();
+    if (verb == "getvar" && arguments.size() >= 2) {
+        return "getvar:" + arguments.mid(1).join(' ');
+    }
+    if (verb == "oem" && arguments.size() >= 2) {
+        return arguments.join(' ');
+    }
+    if (verb == "erase" && arguments.size() == 2) {
+        return "erase:" + arguments.at(1);
+    }
+    if (verb == "reboot" && arguments.size() <= 2) {
+        return arguments.size() == 2 ? "reboot-" + arguments.at(1) : verb;
+    }
+    if (arguments.size() == 1
+        && (verb == "reboot-bootloader" || verb == "reboot-recovery" || verb == "reboot-fastboot")) {
+        return verb;
+    }
+    return QString();
+}
+
+bool FastbootClient::isQualifiedKey(QStringView name)
+{
+    // slot-count、slot-suffixes 等是普通键，只有按槽位查询的几项带后缀
+    return name.startsWith(QLatin1String("partition-")) || name == QLatin1String("has-slot")
+        || name == QLatin1String("is-logical") || name == QLatin1String("slot-retry-count")
+        || name == QLatin1String("slot-successful") || name == QLatin1String("slot-unbootable");
+}
+
+QMap<QString, QString> FastbootClient::parseVariables(const QStringList &lines)
+{
+    static const QString prefix = QStringLiteral("(bootloader) ");
+    QMap<QString, QString> variables;
+
+    for (const QString &rawLine : lines) {
+        QStringView line(rawLine);
+        if (line.startsWith(prefix)) {
+            line = line.mid(prefix.size());
+        }
+
+        // getvar all 的 INFO 行多为 "key:value"，单个 getvar 的主机输出为 "key: value"；
+        // partition-size:boot_a 等按分区/槽位的键本身带一个冒号，取第二个冒号分隔
+        qsizetype separator = line.indexOf(QLatin1Char(':'));
+        if (separator > 0 && isQualifiedKey(line.left(separator))) {
+            separator = line.indexOf(QLatin1Char(':'), separator + 1);
+        }
+        if (separator <= 0) {
+            continue;
+        }
+        variables.insert(line.left(separator).trimmed().toString(),
+                         line.mid(separator + 1).trimmed().toString());
+    }
+    return variables;
+}
+
+QString FastbootClient::formatResponse(const QString &cmd, const FastbootResponse &response)
+{
+    QString output;
+    for (const QString &line : response.info) {
+        output += "(bootloader) " + line + "\n";
+    }
+
+    if (response.ok) {
+        if (cmd.startsWith("getvar:")) {
+            output += cmd.mid(7) + ": " + response.message + "\n";
+        }
+        output += "OKAY\n";
+    } else {
+        output += QString("FAILED (remote: '%1')\n").arg(response.message);
+    }
+    return output;
+}
+
+bool FastbootClient::commandLocked(const QString &cmd, FastbootResponse &response, int timeout)
+{
+    if (!sendCommand(cmd, timeout, response)) {
+        return false;
+    }
+    return readResponse(response, nullptr, timeout);
+}
+
+bool FastbootClient::sendCommand(const QString &cmd, int timeout, FastbootResponse &response)
+{
+    response = FastbootResponse();
+
+    QByteArray data = cmd.toUtf8();
+    if (data.size() > MAX_COMMAND_LENGTH) {
+        response.message = "Command too long";
+        return false;
+    }
+
+    if (!m_transport || m_transport->write(data.constData(), data.size(), timeout) != data.size()) {
+        response.message = "USB write failed";
+        return false;
+    }
+    return true;
+}
+
+bool FastbootClient::readResponse(FastbootResponse &response, qint64 *dataSize, int timeout)
+{
+    char buffer[MAX_RESPONSE_LENGTH + 1];
+
+    // INFO / TEXT 可能出现多次，直到收到 OKAY / FAIL / DATA
+    for (;;) {
+        qint64 length = m_transport->read(buffer, MAX_RESPONSE_LENGTH, timeout);
+        if (length < 4) {
+            response.ok = false;
+            response.message = length < 0 ? "USB read failed" : "Short response from device";
+            return false;
+        }
+
+        QByteArray status(buffer, 4);
+        QString payload = QString::fromUtf8(buffer + 4, static_cast<int>(length - 4));
+
+        if (status == "INFO" || status == "TEXT") {
+            response.info.append(payload);
+        } else if (status == "OKAY") {
+            response.ok = true;
+            response.message = payload;
+            return true;
+        } else if (status == "FAIL") {
+            response.ok = false;
+            response.message = payload;
+            return false;
+        } else if (status == "DATA" && dataSize) {
+            bool ok = false;
+            *dataSize = payload.toLongLong(&ok, 16);
+            response.ok = ok;
+            return ok;
+        } else {
+            response.ok = false;
+            response.message = "Unexpected response: " + QString::fromLatin1(status);
+            return false;
+        }
+    }
+}
@@ -0,0 +1,75 @@
+#ifndef FASTBOOT_CLIENT_H
+#define FASTBOOT_CLIENT_H
+
+#include <QMap>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <functional>
+#include <memory>
+
+// fastboot 传输层，USB 实现见 fastboot_usb.h，也可替换为内存中的模拟设备
+class FastbootTransport
+{
+public:
+    virtual ~FastbootTransport() = default;
+
+    // 返回实际传输的字节数，出错返回 -1
+    virtual qint64 write(const char *data, qint64 size, int timeout) = 0;
+    virtual qint64 read(char *data, qint64 maxSize, int timeout) = 0;
+    virtual void close() = 0;
+};
+
+struct FastbootResponse {
+    bool ok = false;
+    QString message;        // OKAY / FAIL 携带的内容
+    QStringList info;       // 执行过程中收到的 INFO 行
+};
+
+// fastboot 协议客户端 (getvar/download/flash/erase/reboot/oem)
+// 持有同一传输通道连续发送命令，无需为每个命令重新打开设备
+class FastbootClient
+{
+public:
+    static const int DEFAULT_TIMEOUT = 5000;
+
+    // 分块提供下载数据：通过 data 给出下一块并返回其长度，数据在下一次调用前保持有效；出错返回 -1
+    using ChunkSource = std::function<qint64(const char *&data)>;
+
+    explicit FastbootClient(std::unique_ptr<FastbootTransport> transport);
+    ~FastbootClient();
+
+    bool command(const QString &cmd, FastbootResponse &response, int timeout = DEFAULT_TIMEOUT);
+    bool getvar(const QString &name, QString &value, int timeout = DEFAULT_TIMEOUT);
+    // 在同一会话中依次查询多个变量，只返回设备支持的变量
+    QMap<QString, QString> getvars(const QStringList &names, int timeout = DEFAULT_TIMEOUT);
+    // 通过一次 getvar:all 获取全部变量，引导程序不支持时返回 false
+    bool getvarAll(QMap<QString, QString> &variables, int timeout = DEFAULT_TIMEOUT);
+
+    bool download(const char *data, qint64 size, FastbootResponse &response, int timeout = DEFAULT_TIMEOUT);
+    // 边准备边发送：size 字节由 source 分块给出，发送当前块时下一块可以在其他线程中准备
+    bool downloadStream(qint64 size, const ChunkSource &source, FastbootResponse &response,
+                        int timeout = DEFAULT_TIMEOUT);
+    bool flash(const QString &partition, FastbootResponse &response, int timeout = 60000);
+    bool erase(const QString &partition, FastbootResponse &response, int timeout = 60000);
+    bool reboot(const QString &target, FastbootResponse &response, int timeout = DEFAULT_TIMEOUT);
+
+    // 将 fastboot 命令行参数转换为协议命令，不支持的命令返回空字符串
+    static QString commandFromArguments(const QStringList &arguments);
+    // 解析 getvar all 的输出行，兼容 "(bootloader) " 前缀以及 "key:value"、"key: value" 两种分隔
+    static QMap<QString, QString> parseVariables(const QStringList &lines);
+    // 以 fastboot 命令行工具的格式输出响应，兼容原有的文本解析
+    static QString formatResponse(const QString &cmd, const FastbootResponse &response);
+
+private:
+    bool sendCommand(const QString &cmd, int timeout, FastbootResponse &response);
+    bool readResponse(FastbootResponse &response, qint64 *dataSize, int timeout);
+    bool commandLocked(const QString &cmd, FastbootResponse &response, int timeout);
+    // 键本身带分区或槽位名，如 partition-size:boot_a
+    static bool isQualifiedKey(QStringView name);
+
+    std::unique_ptr<FastbootTransport> m_transport;
+    QMutex m_mutex;
+};
+
+#endif // FASTBOOT_CLIENT_H
@@ -0,0 +1,251 @@
+#include "fastboot_flasher.h"
+#include "buffer_pipeline.h"
+#include "mapped_image.h"
+#include <QCryptographicHash>
+#include <QElapsedTimer>
+#include <QDebug>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+void setError(QString *error, const QString &message)
+{
+    if (error) {
+        *error = message;
+    }
+}
+
+} // namespace
+
+FastbootFlasher::FastbootFlasher(std::shared_ptr<FastbootClient> client, QObject *parent)
+    : QObject(parent)
+    , m_client(std::move(client))
+    , m_maxDownloadSize(0)
+{
+}
+
+double FastbootFlasher::JobStats::throughputMBps() const
+{
+    return elapsedMs > 0 ? (bytes / (1024.0 * 1024.0)) / (elapsedMs / 1000.0) : 0.0;
+}
+
+FastbootFlasher::JobStats FastbootFlasher::lastJob() const
+{
+    return m_lastJob;
+}
+
+qint64 FastbootFlasher::maxDownloadSize(QString *error)
+{
+    if (m_maxDownloadSize > 0) {
+        return m_maxDownloadSize;
+    }
+    if (!m_client) {
+        setError(error, "No fastboot session");
+        return 0;
+    }
+
+    // 引导程序可能返回十六进制 (0x10000000) 或十进制
+    QString value;
+    bool ok = false;
+    if (m_client->getvar("max-download-size", value)) {
+        m_maxDownloadSize = value.trimmed().toLongLong(&ok, 0);
+    }
+    if (!ok || m_maxDownloadSize <= 0) {
+        m_maxDownloadSize = 0;
+        setError(error, "Cannot read max-download-size: " + value);
+        return 0;
+    }
+    qDebug() << "fastboot max-download-size:" << m_maxDownloadSize;
+    return m_maxDownloadSize;
+}
+
+bool FastbootFlasher::flash(const QString &partition, const QString &imagePath, QString *error)
+{
+    std::shared_ptr<const MappedImage> image = MappedImage::open(imagePath, error);
+    return image && flash(partition, *image, error);
+}
+
+bool FastbootFlasher::flash(const QString &partition, const MappedImage &image, QString *error)
+{
+    const qint64 maxDownload = maxDownloadSize(error);
+    if (maxDownload <= 0) {
+        return false;
+    }
+    const uchar *mapped = image.data();
+
+    // 分片数和编码后的总量要扫描完才知道，进度以镜像大小为总量
+    const qint64 total = image.size();
+
+    JobStats stats;
+    stats.partition = partition;
+    QElapsedTimer timer;
+    timer.start();
+
+    // 生产者依次生成每个下载 (原始镜像此时才扫描对应的块) 并登记其大小，再按顺序把内容拷入缓冲区
+    // 缓冲区不跨越下载边界；分块扫描、缺页导致的磁盘读取和哈希计算都发生在生产者线程中，
+    // 与消费者发送上一个下载重叠
+    struct Pending {
+        qint64 size = 0;
+        QByteArray digest;
+    };
+    std::vector<Pending> pending;
+    bool produced = false;
+    QString splitError;
+    std::mutex mutex;
+    std::condition_variable condition;
+
+    const qint64 bufferSize = DEFAULT_BUFFER_SIZE;
+    BufferPipeline pipeline(DEFAULT_BUFFER_COUNT, bufferSize);
+    std::thread producer([&]() {
+        SparseImage::Splitter splitter(image.sparse(), mapped, maxDownload);
+        SparseImage::Download download;
+        bool ok = true;
+        while (ok && splitter.next(download, &splitError)) {
+            size_t index;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                index = pending.size();
+                Pending entry;
+                entry.size = download.size;
+                pending.push_back(entry);
+            }
+            condition.notify_all();
+
+            QCryptographicHash hash(QCryptographicHash::Sha256);
+            int slot = -1;
+            qint64 filled = 0;
+            for (const SparseImage::Segment &segment : std::as_const(download.segments)) {
+                const char *source = segment.bytes.isEmpty()
+                    ? reinterpret_cast<const char*>(mapped + segment.sourceOffset) : segment.bytes.constData();
+                qint64 remaining = segment.size();
+                while (ok && remaining > 0) {
+                    if (slot >= 0 && filled == bufferSize) {
+                        pipeline.submit(slot, filled);
+                        slot = -1;
+                    }
+                    if (slot < 0) {
+                        slot = pipeline.acquire();
+                        if (slot < 0) {
+                            ok = false;
+                            break;
+                        }
+                        filled = 0;
+                    }
+
+                    char *buffer = pipeline.reserve(slot, bufferSize) + filled;
+                    qint64 length = qMin(remaining, bufferSize - filled);
+                    std::memcpy(buffer, source, static_cast<size_t>(length));
+                    hash.addData(QByteArrayView(buffer, length));
+                    filled += length;
+                    source += length;
+                    remaining -= length;
+                }
+            }
+            if (!ok) {
+                break;
+            }
+            // 摘要在提交最后一个缓冲区之前写入，消费者取到该缓冲区时即可读取
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                pending[index].digest = hash.result();
+            }
+            if (slot >= 0) {
+                pipeline.submit(slot, filled);
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            produced = true;
+        }
+        condition.notify_all();
+        pipeline.finish();
+    });
+
+    bool ok = true;
+    qint64 done = 0;
+    for (size_t i = 0; ok; ++i) {
+        qint64 size = 0;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [&]() { return pending.size() > i || produced; });
+            if (pending.size() <= i) {
+                break;
+            }
+            size = pending[i].size;
+        }
+        qDebug().noquote() << QString("Sending '%1' part %2 (%3 KB)").arg(partition).arg(i + 1).arg(size / 1024);
+
+        int held = -1;
+        auto releaseHeld = [this, &pipeline, &held, &done, &partition, total]() {
+            if (held >= 0) {
+                done += pipeline.size(held);
+                pipeline.release(held);
+                held = -1;
+                emit progress(partition, qMin(done, total), total);
+            }
+        };
+
+        FastbootResponse response;
+        ok = m_client->downloadStream(size, [&pipeline, &held, &releaseHeld](const char *&data) -> qint64 {
+            // 上一块已发送完毕，归还后取下一块
+            releaseHeld();
+            int slot;
+            if (!pipeline.take(slot)) {
+                return -1;
+            }
+            held = slot;
+            data = pipeline.data(slot);
+            return pipeline.size(slot);
+        }, response);
+        releaseHeld();
+
+        if (ok) {
+            QByteArray digest;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                digest = pending[i].digest;
+            }
+            qDebug().noquote() << QString("Sent '%1' part %2, sha256 %3")
+                .arg(partition).arg(i + 1).arg(QString::fromLatin1(digest.toHex()));
+            ok = m_client->flash(partition, response, FLASH_TIMEOUT);
+        }
+        if (!ok) {
+            setError(error, QString("Flashing %1 failed: %2").arg(partition, response.message));
+        } else {
+            ++stats.downloads;
+        }
+    }
+
+    if (!ok) {
+        pipeline.abort();
+    }
+    producer.join();
+    if (ok && !splitError.isEmpty()) {
+        ok = false;
+        setError(error, splitError);
+    }
+    if (ok && done < total) {
+        emit progress(partition, total, total);
+    }
+
+    stats.bytes = done;
+    stats.elapsedMs = timer.elapsed();
+    finishJob(stats, ok);
+    return ok;
+}
+
+void FastbootFlasher::finishJob(const JobStats &stats, bool success)
+{
+    m_lastJob = stats;
+    qDebug().noquote() << QString("fastboot flash %1 %2: %3 bytes in %4 download(s), %5 ms (%6 MB/s)")
+        .arg(stats.partition, success ? "succeeded" : "failed")
+        .arg(stats.bytes)
+        .arg(stats.downloads)
+        .arg(stats.elapsedMs)
+        .arg(stats.throughputMBps(), 0, 'f', 1);
+    emit jobFinished(stats.partition, success, stats.bytes, stats.elapsedMs);
+}
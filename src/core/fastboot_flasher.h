@@ -0,0 +1,57 @@
+#ifndef FASTBOOT_FLASHER_H
+#define FASTBOOT_FLASHER_H
+
+#include <QObject>
+#include <QString>
+#include <memory>
+#include "fastboot_client.h"
+
+class MappedImage;
+
+// fastboot 刷写：内存映射镜像，超过 max-download-size 时即时切分为 sparse 分片
+// 后台线程生成下一个分片 (原始镜像此时才分块扫描)，把数据从映射内存复制到缓冲区并计算 SHA-256，与当前段的USB下载重叠
+// 缓冲区个数和大小固定，刷写多 GB 的镜像也只占用常量内存；所有操作同步执行，应在工作线程中调用
+class FastbootFlasher : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const int DEFAULT_BUFFER_COUNT = 4;
+    static const qint64 DEFAULT_BUFFER_SIZE = 4 * 1024 * 1024;
+    static const int FLASH_TIMEOUT = 120000;
+
+    // 一次刷写作业的统计
+    struct JobStats {
+        QString partition;
+        qint64 bytes = 0;           // 实际下载的字节数 (含 sparse 头部)
+        int downloads = 0;
+        qint64 elapsedMs = 0;
+
+        double throughputMBps() const;
+    };
+
+    // client 通常来自 FastbootUsbManager::session()，刷写需要原生USB会话
+    explicit FastbootFlasher(std::shared_ptr<FastbootClient> client, QObject *parent = nullptr);
+
+    // 首次调用时查询设备并缓存，之后不再访问设备
+    qint64 maxDownloadSize(QString *error = nullptr);
+
+    bool flash(const QString &partition, const QString &imagePath, QString *error = nullptr);
+    // 使用已映射的镜像，多台设备可并发刷写同一个 MappedImage
+    bool flash(const QString &partition, const MappedImage &image, QString *error = nullptr);
+
+    JobStats lastJob() const;
+
+signals:
+    void progress(const QString &partition, qint64 done, qint64 total);
+    void jobFinished(const QString &partition, bool success, qint64 bytes, qint64 elapsedMs);
+
+private:
+    void finishJob(const JobStats &stats, bool success);
+
+    std::shared_ptr<FastbootClient> m_client;
+    qint64 m_maxDownloadSize;
+    JobStats m_lastJob;
+};
+
+#endif // FASTBOOT_FLASHER_H
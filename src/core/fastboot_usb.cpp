@@ -0,0 +1,353 @@
+#include "fastboot_usb.h"
+#include <QMutexLocker>
+#include <QSet>
+#include <QDebug>
+#include <libusb.h>
+#include <utility>
+
+namespace {
+
+const quint8 FASTBOOT_INTERFACE_CLASS = 0xff;
+const quint8 FASTBOOT_INTERFACE_SUBCLASS = 0x42;
+const quint8 FASTBOOT_INTERFACE_PROTOCOL = 0x03;
+
+unsigned int libusbTimeout(int timeout)
+{
+    // libusb 以 0 表示不超时
+    return timeout < 0 ? 0u : static_cast<unsigned int>(timeout);
+}
+
+} // namespace
+
+UsbFastbootTransport::UsbFastbootTransport(libusb_device_handle *handle, int interfaceNumber,
+                                           quint8 inEndpoint, quint8 outEndpoint)
+    : m_handle(handle)
+    , m_interfaceNumber(interfaceNumber)
+    , m_inEndpoint(inEndpoint)
+    , m_outEndpoint(outEndpoint)
+{
+}
+
+UsbFastbootTransport::~UsbFastbootTransport()
+{
+    close();
+}
+
+std::unique_ptr<UsbFastbootTransport> UsbFastbootTransport::open(libusb_device *device, QString *serial)
+{
+    libusb_device_descriptor descriptor;
+    if (libusb_get_device_descriptor(device, &descriptor) != LIBUSB_SUCCESS) {
+        return nullptr;
+    }
+
+    libusb_config_descriptor *config = nullptr;
+    if (libusb_get_active_config_descriptor(device, &config) != LIBUSB_SUCCESS || !config) {
+        return nullptr;
+    }
+
+    // 查找 fastboot 接口及其批量端点
+    int interfaceNumber = -1;
+    quint8 inEndpoint = 0;
+    quint8 outEndpoint = 0;
+    for (int i = 0; i < config->bNumInterfaces && interfaceNumber < 0; ++i) {
+        const libusb_interface &iface = config->interface[i];
+        for (int alt = 0; alt < iface.num_altsetting; ++alt) {
+            const libusb_interface_descriptor &setting = iface.altsetting[alt];
+            if (setting.bInterfaceClass != FASTBOOT_INTERFACE_CLASS
+                || setting.bInterfaceSubClass != FASTBOOT_INTERFACE_SUBCLASS
+                || setting.bInterfaceProtocol != FASTBOOT_INTERFACE_PROTOCOL) {
+                continue;
+            }
+
+            inEndpoint = outEndpoint = 0;
+            for (int e = 0; e < setting.bNumEndpoints; ++e) {
+                const libusb_endpoint_descriptor &endpoint = setting.endpoint[e];
+                if ((endpoint.bmAttributes & LIBUSB_TRANSFER_TYPE_MASK) != LIBUSB_TRANSFER_TYPE_BULK) {
+                    continue;
+                }
+                if (endpoint.bEndpointAddress & LIBUSB_ENDPOINT_IN) {
+                    inEndpoint = endpoint.bEndpointAddress;
+                } else {
+                    outEndpoint = endpoint.bEndpointAddress;
+                }
+            }
+            if (inEndpoint && outEndpoint) {
+                interfaceNumber = setting.bInterfaceNumber;
+                break;
+            }
+        }
+    }
+    libusb_free_config_descriptor(config);
+
+    if (interfaceNumber < 0) {
+        return nullptr;
+    }
+
+    libusb_device_handle *handle = nullptr;
+    int result = libusb_open(device, &handle);
+    if (result != LIBUSB_SUCCESS) {
+        qWarning() << "Cannot open fastboot USB device:" << libusb_error_name(result);
+        return nullptr;
+    }
+
+    libusb_set_auto_detach_kernel_driver(handle, 1);
+    result = libusb_claim_interface(handle, interfaceNumber);
+    if (result != LIBUSB_SUCCESS) {
+        qWarning() << "Cannot claim fastboot interface:" << libusb_error_name(result);
+        libusb_close(handle);
+        return nullptr;
+    }
+
+    if (serial) {
+        unsigned char buffer[256] = {0};
+        int length = descriptor.iSerialNumber
+            ? libusb_get_string_descriptor_ascii(handle, descriptor.iSerialNumber, buffer, sizeof(buffer))
+            : 0;
+        *serial = length > 0
+            ? QString::fromLatin1(reinterpret_cast<const char*>(buffer), length)
+            : QString();
+    }
+
+    return std::unique_ptr<UsbFastbootTransport>(
+        new UsbFastbootTransport(handle, interfaceNumber, inEndpoint, outEndpoint));
+}
+
+qint64 UsbFastbootTransport::write(const char *data, qint64 size, int timeout)
+{
+    if (!m_handle) {
+        return -1;
+    }
+
+    int transferred = 0;
+    int result = libusb_bulk_transfer(m_handle, m_outEndpoint,
+                                      reinterpret_cast<unsigned char*>(const_cast<char*>(data)),
+                                      static_cast<int>(size), &transferred, libusbTimeout(timeout));
+    if (result != LIBUSB_SUCCESS) {
+        qWarning() << "fastboot USB write failed:" << libusb_error_name(result);
+        return -1;
+    }
+    return transferred;
+}
+
+qint64 UsbFastbootTransport::read(char *data, qint64 maxSize, int timeout)
+{
+    if (!m_handle) {
+        return -1;
+    }
+
+    int transferred = 0;
+    int result = libusb_bulk_transfer(m_handle, m_inEndpoint,
+                                      reinterpret_cast<unsigned char*>(data),
+                                      static_cast<int>(maxSize), &transferred, libusbTimeout(timeout));
+    if (result != LIBUSB_SUCCESS) {
+        return -1;
+    }
+    return transferred;
+}
+
+void UsbFastbootTransport::close()
+{
+    if (m_handle) {
+        libusb_release_interface(m_handle, m_interfaceNumber);
+        libusb_close(m_handle);
+        m_handle = nullptr;
+    }
+}
+
+FastbootUsbManager::FastbootUsbManager()
+{
+    // 先构造 libusb 上下文，保证其在所有会话关闭之后才析构
+    UsbContext::instance();
+}
+
+FastbootUsbManager::~FastbootUsbManager()
+{
+    for (Session &session : m_sessions) {
+        session.client.reset();
+        libusb_unref_device(session.device);
+    }
+    for (auto it = m_released.begin(); it != m_released.end(); ++it) {
+        libusb_unref_device(it.key());
+    }
+}
+
+FastbootUsbManager& FastbootUsbManager::instance()
+{
+    static FastbootUsbManager instance;
+    return instance;
+}
+
+bool FastbootUsbManager::isAvailable() const
+{
+    return UsbContext::instance().isValid();
+}
+
+bool FastbootUsbManager::enumerate(QList<DeviceEntry> &devices)
+{
+    libusb_context *ctx = UsbContext::instance().context();
+    if (!ctx) {
+        return false;
+    }
+
+    QMutexLocker locker(&m_mutex);
+
+    libusb_device **list = nullptr;
+    ssize_t count = libusb_get_device_list(ctx, &list);
+    if (count < 0) {
+        return false;
+    }
+
+    bool complete = true;
+    QSet<libusb_device*> present;
+
+    for (ssize_t i = 0; i < count; ++i) {
+        libusb_device *device = list[i];
+        UsbDeviceDescription description;
+        if (!UsbContext::describeDevice(device, description) || !description.isFastbootInterface()) {
+            continue;
+        }
+        present.insert(device);
+
+        DeviceEntry entry;
+        if (openSession(device, description, entry)) {
+            devices.append(entry);
+        } else {
+            complete = false;
+        }
+    }
+
+    // 清理已拔出设备的会话
+    for (auto it = m_sessions.begin(); it != m_sessions.end();) {
+        if (!present.contains(it->device)) {
+            libusb_unref_device(it->device);
+            it = m_sessions.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    for (auto it = m_released.begin(); it != m_released.end();) {
+        if (!present.contains(it.key())) {
+            libusb_unref_device(it.key());
+            it = m_released.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    libusb_free_device_list(list, 1);
+    return complete;
+}
+
+bool FastbootUsbManager::openPort(const QString &portPath, DeviceEntry &entry)
+{
+    libusb_context *ctx = UsbContext::instance().context();
+    if (!ctx) {
+        return false;
+    }
+
+    QMutexLocker locker(&m_mutex);
+
+    libusb_device **list = nullptr;
+    ssize_t count = libusb_get_device_list(ctx, &list);
+    if (count < 0) {
+        return false;
+    }
+
+    bool opened = false;
+    for (ssize_t i = 0; i < count; ++i) {
+        UsbDeviceDescription description;
+        if (UsbContext::describeDevice(list[i], description) && description.portPath == portPath
+            && description.isFastbootInterface()) {
+            opened = openSession(list[i], description, entry);
+            break;
+        }
+    }
+
+    libusb_free_device_list(list, 1);
+    return opened;
+}
+
+bool FastbootUsbManager::forgetPort(const QString &portPath, QString &serial)
+{
+    QMutexLocker locker(&m_mutex);
+    for (auto it = m_sessions.begin(); it != m_sessions.end(); ++it) {
+        if (it->entry.portPath == portPath) {
+            serial = it->entry.serial;
+            libusb_unref_device(it->device);
+            m_sessions.erase(it);
+            return true;
+        }
+    }
+    for (auto it = m_released.begin(); it != m_released.end(); ++it) {
+        if (it->portPath == portPath) {
+            serial = it->serial;
+            libusb_unref_device(it.key());
+            m_released.erase(it);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool FastbootUsbManager::openSession(libusb_device *device, const UsbDeviceDescription &description,
+                                     DeviceEntry &entry)
+{
+    // 已有会话的设备直接复用
+    for (const Session &session : std::as_const(m_sessions)) {
+        if (session.device == device) {
+            entry = session.entry;
+            return true;
+        }
+    }
+    if (m_released.contains(device)) {
+        entry = m_released.value(device);
+        return true;
+    }
+
+    QString serial;
+    std::unique_ptr<UsbFastbootTransport> transport = UsbFastbootTransport::open(device, &serial);
+    if (!transport || serial.isEmpty()) {
+        return false;
+    }
+
+    Session session;
+    session.client = std::make_shared<FastbootClient>(std::move(transport));
+    session.entry.serial = serial;
+    session.entry.portPath = description.portPath;
+
+    QString userspace;
+    session.entry.isFastbootd = session.client->getvar("is-userspace", userspace) && userspace == "yes";
+    session.device = libusb_ref_device(device);
+
+    // 设备重新枚举后以新会话替换旧会话
+    auto old = m_sessions.find(serial);
+    if (old != m_sessions.end()) {
+        libusb_unref_device(old->device);
+        m_sessions.erase(old);
+    }
+    m_sessions.insert(serial, session);
+    entry = session.entry;
+    qDebug() << "Opened native fastboot session:" << serial << description.portPath;
+    return true;
+}
+
+std::shared_ptr<FastbootClient> FastbootUsbManager::session(const QString &serial)
+{
+    QMutexLocker locker(&m_mutex);
+    auto it = m_sessions.constFind(serial);
+    return it != m_sessions.constEnd() ? it->client : nullptr;
+}
+
+void FastbootUsbManager::release(const QString &serial)
+{
+    QMutexLocker locker(&m_mutex);
+    auto it = m_sessions.find(serial);
+    if (it == m_sessions.end()) {
+        return;
+    }
+
+    // 会话对象可能仍被其他线程持有，接口在最后一个引用释放时关闭
+    // 设备引用转移给释放列表，设备拔出后再释放
+    m_released.insert(it->device, it->entry);
+    m_sessions.erase(it);
+}
@@ -0,0 +1,80 @@
+#ifndef FASTBOOT_USB_H
+#define FASTBOOT_USB_H
+
+#include <QHash>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <memory>
+#include "fastboot_client.h"
+#include "usb_context.h"
+
+struct libusb_device_handle;
+
+// 通过 libusb 批量端点与 fastboot 接口通信，会话期间保持接口被占用
+class UsbFastbootTransport : public FastbootTransport
+{
+public:
+    ~UsbFastbootTransport() override;
+
+    static std::unique_ptr<UsbFastbootTransport> open(libusb_device *device, QString *serial);
+
+    qint64 write(const char *data, qint64 size, int timeout) override;
+    qint64 read(char *data, qint64 maxSize, int timeout) override;
+    void close() override;
+
+private:
+    UsbFastbootTransport(libusb_device_handle *handle, int interfaceNumber,
+                         quint8 inEndpoint, quint8 outEndpoint);
+
+    libusb_device_handle *m_handle;
+    int m_interfaceNumber;
+    quint8 m_inEndpoint;
+    quint8 m_outEndpoint;
+};
+
+// 管理所有 fastboot USB 设备的常驻会话，按序列号索引
+class FastbootUsbManager
+{
+public:
+    struct DeviceEntry {
+        QString serial;
+        QString portPath;
+        bool isFastbootd = false;
+    };
+
+    static FastbootUsbManager& instance();
+
+    bool isAvailable() const;
+
+    // 扫描USB设备，为新出现的fastboot接口建立会话并清理已拔出的设备
+    // 返回 false 表示存在无法打开的fastboot接口（如缺少权限），调用方应回退到fastboot进程
+    bool enumerate(QList<DeviceEntry> &devices);
+
+    // 热插拔时只处理指定端口：为新出现的fastboot接口建立会话，或丢弃已拔出端口的会话并返回其序列号
+    bool openPort(const QString &portPath, DeviceEntry &entry);
+    bool forgetPort(const QString &portPath, QString &serial);
+
+    std::shared_ptr<FastbootClient> session(const QString &serial);
+    // 释放会话，使fastboot进程可以访问该设备
+    void release(const QString &serial);
+
+private:
+    FastbootUsbManager();
+    ~FastbootUsbManager();
+
+    struct Session {
+        DeviceEntry entry;
+        std::shared_ptr<FastbootClient> client;
+        libusb_device *device = nullptr;
+    };
+
+    // 调用方需持有 m_mutex
+    bool openSession(libusb_device *device, const UsbDeviceDescription &description, DeviceEntry &entry);
+
+    QMutex m_mutex;
+    QHash<QString, Session> m_sessions;     // 序列号 -> 会话
+    QHash<libusb_device*, DeviceEntry> m_released;  // 已释放给fastboot进程的设备
+};
+
+#endif // FASTBOOT_USB_H
@@ -0,0 +1,130 @@
+#include "flash_recipe.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+namespace {
+
+void setError(QString *error, const QString &message)
+{
+    if (error) {
+        *error = message;
+    }
+}
+
+bool parseTarget(const QString &name, RestartTool::RestartMode &target)
+{
+    // fastboot 协议可达的重启目标；"fastboot" 指用户空间 fastbootd
+    if (name == "system" || name.isEmpty()) {
+        target = RestartTool::MODE_SYSTEM;
+    } else if (name == "recovery") {
+        target = RestartTool::MODE_RECOVERY;
+    } else if (name == "bootloader") {
+        target = RestartTool::MODE_BOOTLOADER;
+    } else if (name == "fastboot") {
+        target = RestartTool::MODE_FASTBOOT;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+QString FlashRecipe::Step::describe() const
+{
+    switch (action) {
+    case ACTION_FLASH:
+        return QString("flash %1 %2").arg(partition, QFileInfo(imagePath).fileName());
+    case ACTION_ERASE:
+        return "erase " + partition;
+    case ACTION_REBOOT:
+        switch (target) {
+        case RestartTool::MODE_RECOVERY: return "reboot recovery";
+        case RestartTool::MODE_BOOTLOADER: return "reboot bootloader";
+        case RestartTool::MODE_FASTBOOT: return "reboot fastboot";
+        default: return "reboot";
+        }
+    }
+    return QString();
+}
+
+bool FlashRecipe::load(const QString &path, FlashRecipe &recipe, QString *error)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        setError(error, "Cannot open " + path + ": " + file.errorString());
+        return false;
+    }
+
+    QJsonParseError parseError;
+    QJsonDocument document = QJsonDocument::fromJson(file.readAll(), &parseError);
+    if (!document.isObject()) {
+        setError(error, QString("Invalid recipe %1: %2").arg(path, parseError.errorString()));
+        return false;
+    }
+
+    const QJsonObject root = document.object();
+    const QDir baseDir = QFileInfo(path).absoluteDir();
+    recipe = FlashRecipe();
+    recipe.name = root.value("name").toString(QFileInfo(path).completeBaseName());
+
+    const QJsonArray steps = root.value("steps").toArray();
+    for (int i = 0; i < steps.size(); ++i) {
+        const QJsonObject object = steps.at(i).toObject();
+        const QString action = object.value("action").toString();
+        Step step;
+
+        if (action == "flash" || action == "erase") {
+            step.action = action == "flash" ? ACTION_FLASH : ACTION_ERASE;
+            step.partition = object.value("partition").toString();
+            if (step.partition.isEmpty()) {
+                setError(error, QString("Recipe step %1: missing partition").arg(i + 1));
+                return false;
+            }
+            if (step.action == ACTION_FLASH) {
+                const QString image = object.value("image").toString();
+                if (image.isEmpty()) {
+                    setError(error, QString("Recipe step %1: missing image").arg(i + 1));
+                    return false;
+                }
+                step.imagePath = QDir::cleanPath(baseDir.absoluteFilePath(image));
+                if (!QFileInfo::exists(step.imagePath)) {
+                    setError(error, QString("Recipe step %1: %2 not found").arg(i + 1).arg(step.imagePath));
+                    return false;
+                }
+            }
+        } else if (action == "reboot") {
+            step.action = ACTION_REBOOT;
+            const QString target = object.value("target").toString();
+            if (!parseTarget(target, step.target)) {
+                setError(error, QString("Recipe step %1: unsupported reboot target '%2'").arg(i + 1).arg(target));
+                return false;
+            }
+        } else {
+            setError(error, QString("Recipe step %1: unknown action '%2'").arg(i + 1).arg(action));
+            return false;
+        }
+        recipe.steps.append(step);
+    }
+
+    if (recipe.steps.isEmpty()) {
+        setError(error, "Recipe has no steps: " + path);
+        return false;
+    }
+    return true;
+}
+
+QStringList FlashRecipe::imagePaths() const
+{
+    QStringList paths;
+    for (const Step &step : steps) {
+        if (step.action == ACTION_FLASH && !paths.contains(step.imagePath)) {
+            paths.append(step.imagePath);
+        }
+    }
+    return paths;
+}
@@ -0,0 +1,48 @@
+#ifndef FLASH_RECIPE_H
+#define FLASH_RECIPE_H
+
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include "restart_tool.h"
+
+// 批量刷机配方：按顺序执行的 fastboot 刷写、擦除和重启步骤
+// JSON 格式：
+// {
+//   "name": "factory",
+//   "steps": [
+//     { "action": "reboot", "target": "bootloader" },
+//     { "action": "flash", "partition": "boot", "image": "boot.img" },
+//     { "action": "erase", "partition": "userdata" },
+//     { "action": "reboot", "target": "fastboot" },
+//     { "action": "flash", "partition": "system", "image": "system.img" },
+//     { "action": "reboot", "target": "system" }
+//   ]
+// }
+// 相对镜像路径以配方文件所在目录为基准
+struct FlashRecipe {
+    enum Action {
+        ACTION_FLASH,
+        ACTION_ERASE,
+        ACTION_REBOOT
+    };
+
+    struct Step {
+        Action action = ACTION_FLASH;
+        QString partition;
+        QString imagePath;          // 绝对路径
+        RestartTool::RestartMode target = RestartTool::MODE_SYSTEM;
+
+        QString describe() const;
+    };
+
+    QString name;
+    QList<Step> steps;
+
+    static bool load(const QString &path, FlashRecipe &recipe, QString *error = nullptr);
+
+    // 配方引用的全部镜像，去重后保持首次出现的顺序
+    QStringList imagePaths() const;
+};
+
+#endif // FLASH_RECIPE_H
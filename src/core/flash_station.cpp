@@ -0,0 +1,393 @@
+#include "flash_station.h"
+#include "adb_embedded.h"
+#include "fastboot_flasher.h"
+#include "fastboot_usb.h"
+#include "mapped_image.h"
+#include <QHash>
+#include <QThread>
+#include <QThreadPool>
+#include <QDebug>
+
+namespace {
+
+void setError(QString *error, const QString &message)
+{
+    if (error) {
+        *error = message;
+    }
+}
+
+// fastboot reboot-<target> 与 adb reboot <target> 使用相同的目标名
+QString rebootTarget(RestartTool::RestartMode mode)
+{
+    switch (mode) {
+    case RestartTool::MODE_RECOVERY: return "recovery";
+    case RestartTool::MODE_BOOTLOADER: return "bootloader";
+    case RestartTool::MODE_FASTBOOT: return "fastboot";
+    default: return QString();
+    }
+}
+
+} // namespace
+
+// 一次批量任务的共享数据，镜像在最后一台设备结束后随之释放
+struct FlashStation::Run {
+    FlashRecipe recipe;
+    QStringList serials;
+    QHash<QString, std::shared_ptr<const MappedImage>> images;
+    qint64 totalWeight = 0;         // 所有刷写步骤的镜像大小之和，用于进度加权
+    std::atomic<int> remaining{0};
+    std::atomic<int> succeeded{0};
+    std::atomic<int> failed{0};
+    QElapsedTimer timer;
+};
+
+// 单台设备的状态机，整个生命周期都在同一个工作线程中
+class FlashStation::DeviceJob
+{
+public:
+    DeviceJob(FlashStation *station, const std::shared_ptr<Run> &run, const QString &serial);
+
+    bool run();
+
+private:
+    bool flashStep(const FlashRecipe::Step &step, QString *error);
+    bool eraseStep(const FlashRecipe::Step &step, QString *error);
+    bool rebootStep(const FlashRecipe::Step &step, QString *error);
+    void setState(DeviceState state, const QString &detail = QString());
+    void reportProgress(qint64 stepDone, qint64 stepTotal, qint64 stepMs, bool force);
+
+    FlashStation *m_station;
+    std::shared_ptr<Run> m_run;
+    QString m_serial;
+    std::shared_ptr<FastbootClient> m_client;
+    std::unique_ptr<FastbootFlasher> m_flasher;     // 随会话重建，max-download-size 每个会话只查询一次
+    qint64 m_doneWeight;
+    qint64 m_stepWeight;
+    qint64 m_bytesSent;
+    qint64 m_transferMs;
+    QElapsedTimer m_lastReport;
+};
+
+FlashStation::DeviceJob::DeviceJob(FlashStation *station, const std::shared_ptr<Run> &run, const QString &serial)
+    : m_station(station)
+    , m_run(run)
+    , m_serial(serial)
+    , m_doneWeight(0)
+    , m_stepWeight(0)
+    , m_bytesSent(0)
+    , m_transferMs(0)
+{
+}
+
+bool FlashStation::DeviceJob::run()
+{
+    QElapsedTimer timer;
+    timer.start();
+    m_client = FastbootUsbManager::instance().session(m_serial);
+
+    const QList<FlashRecipe::Step> &steps = m_run->recipe.steps;
+    for (int i = 0; i < steps.size(); ++i) {
+        if (m_station->m_cancelled) {
+            setState(STATE_CANCELLED, QString("停止于第 %1/%2 步").arg(i + 1).arg(steps.size()));
+            return false;
+        }
+
+        const FlashRecipe::Step &step = steps.at(i);
+        const QString detail = QString("%1 (%2/%3)").arg(step.describe()).arg(i + 1).arg(steps.size());
+        QString error;
+        bool ok = false;
+        switch (step.action) {
+        case FlashRecipe::ACTION_FLASH:
+            setState(STATE_FLASHING, detail);
+            ok = flashStep(step, &error);
+            break;
+        case FlashRecipe::ACTION_ERASE:
+            setState(STATE_ERASING, detail);
+            ok = eraseStep(step, &error);
+            break;
+        case FlashRecipe::ACTION_REBOOT:
+            setState(STATE_REBOOTING, detail);
+            ok = rebootStep(step, &error);
+            break;
+        }
+
+        if (!ok) {
+            setState(STATE_FAILED, QString("%1: %2").arg(step.describe(), error));
+            return false;
+        }
+    }
+
+    reportProgress(0, 0, 0, true);
+    setState(STATE_DONE, QString("耗时 %1 秒").arg(timer.elapsed() / 1000.0, 0, 'f', 1));
+    return true;
+}
+
+bool FlashStation::DeviceJob::flashStep(const FlashRecipe::Step &step, QString *error)
+{
+    if (!m_client) {
+        setError(error, "设备不在 fastboot 模式");
+        return false;
+    }
+    std::shared_ptr<const MappedImage> image = m_run->images.value(step.imagePath);
+    if (!image) {
+        setError(error, "Image not loaded: " + step.imagePath);
+        return false;
+    }
+    if (!m_flasher) {
+        m_flasher.reset(new FastbootFlasher(m_client));
+    }
+
+    // 刷写器在本线程中发出进度信号，直接连接
+    QElapsedTimer stepTimer;
+    stepTimer.start();
+    m_stepWeight = image->size();
+    QMetaObject::Connection connection = QObject::connect(m_flasher.get(), &FastbootFlasher::progress,
+        [this, &stepTimer](const QString &, qint64 done, qint64 total) {
+            reportProgress(done, total, stepTimer.elapsed(), done == total);
+        });
+    const bool ok = m_flasher->flash(step.partition, *image, error);
+    QObject::disconnect(connection);
+
+    m_transferMs += stepTimer.elapsed();
+    m_bytesSent += m_flasher->lastJob().bytes;
+    m_doneWeight += m_stepWeight;
+    m_stepWeight = 0;
+    return ok;
+}
+
+bool FlashStation::DeviceJob::eraseStep(const FlashRecipe::Step &step, QString *error)
+{
+    if (!m_client) {
+        setError(error, "设备不在 fastboot 模式");
+        return false;
+    }
+    FastbootResponse response;
+    if (!m_client->erase(step.partition, response, FastbootFlasher::FLASH_TIMEOUT)) {
+        setError(error, response.message);
+        return false;
+    }
+    return true;
+}
+
+bool FlashStation::DeviceJob::rebootStep(const FlashRecipe::Step &step, QString *error)
+{
+    const QString target = rebootTarget(step.target);
+    std::shared_ptr<FastbootClient> previous = m_client;
+
+    if (m_client) {
+        FastbootResponse response;
+        if (!m_client->reboot(target, response)) {
+            setError(error, response.message);
+            return false;
+        }
+    } else {
+        // 首个重启步骤可以把仍处于 ADB 模式的设备送入 fastboot
+        AdbCommandResult result = AdbEmbedded::waitForResult(
+            AdbEmbedded::instance().executeAsync(AdbCommand::reboot(m_serial, target)));
+        if (!result.succeeded()) {
+            setError(error, AdbEmbedded::formatResult(result));
+            return false;
+        }
+    }
+    m_flasher.reset();
+    m_client.reset();
+
+    // 重启到系统或恢复模式后配方不再操作设备
+    if (step.target != RestartTool::MODE_BOOTLOADER && step.target != RestartTool::MODE_FASTBOOT) {
+        return true;
+    }
+
+    setState(STATE_WAITING, step.describe());
+    m_client = m_station->waitForSession(m_serial, previous, REBOOT_TIMEOUT);
+    if (!m_client) {
+        setError(error, m_station->m_cancelled ? "已取消" : "等待设备重新进入 fastboot 超时");
+        return false;
+    }
+    return true;
+}
+
+void FlashStation::DeviceJob::setState(DeviceState state, const QString &detail)
+{
+    emit m_station->deviceStateChanged(m_serial, state, detail);
+}
+
+void FlashStation::DeviceJob::reportProgress(qint64 stepDone, qint64 stepTotal, qint64 stepMs, bool force)
+{
+    if (!force && m_lastReport.isValid() && m_lastReport.elapsed() < PROGRESS_INTERVAL) {
+        return;
+    }
+    m_lastReport.start();
+
+    // 进度按镜像大小加权，速率只统计USB传输的时间
+    const double stepFraction = stepTotal > 0 ? static_cast<double>(stepDone) / stepTotal : 0.0;
+    const double doneWeight = m_doneWeight + m_stepWeight * stepFraction;
+    const qint64 transferMs = m_transferMs + stepMs;
+    const qint64 bytes = m_bytesSent + stepDone;
+    const qint64 totalWeight = m_run->totalWeight;
+
+    const int percent = totalWeight > 0 ? static_cast<int>(doneWeight * 100 / totalWeight) : 100;
+    const double mbps = transferMs > 0 ? (bytes / (1024.0 * 1024.0)) / (transferMs / 1000.0) : 0.0;
+    const int eta = doneWeight > 0 && transferMs > 0
+        ? static_cast<int>((totalWeight - doneWeight) * transferMs / doneWeight / 1000) : -1;
+    emit m_station->deviceProgress(m_serial, percent, mbps, eta);
+}
+
+FlashStation::FlashStation(QObject *parent)
+    : QObject(parent)
+    , m_pool(new QThreadPool(this))
+    , m_running(false)
+    , m_cancelled(false)
+    , m_lastRescan(-RESCAN_INTERVAL)
+{
+    // 设备操作大部分时间阻塞在USB传输上，线程数按设备数而不是CPU核数设置
+    m_pool->setMaxThreadCount(MAX_PARALLEL_DEVICES);
+    m_clock.start();
+}
+
+FlashStation::~FlashStation()
+{
+    cancel();
+    m_pool->waitForDone();
+}
+
+bool FlashStation::isRunning() const
+{
+    return m_running;
+}
+
+bool FlashStation::start(const FlashRecipe &recipe, const QStringList &serials, QString *error)
+{
+    if (m_running) {
+        setError(error, "已有批量刷机任务在运行");
+        return false;
+    }
+    if (serials.isEmpty() || recipe.steps.isEmpty()) {
+        setError(error, "没有可执行的设备或步骤");
+        return false;
+    }
+
+    m_running = true;
+    m_cancelled = false;
+
+    std::shared_ptr<Run> run = std::make_shared<Run>();
+    run->recipe = recipe;
+    run->serials = serials;
+    run->timer.start();
+    for (const QString &serial : serials) {
+        emit deviceStateChanged(serial, STATE_PENDING, QString());
+    }
+
+    m_pool->start([this, run]() {
+        prepareRun(run);
+    });
+    return true;
+}
+
+void FlashStation::cancel()
+{
+    m_cancelled = true;
+}
+
+QString FlashStation::stateName(DeviceState state)
+{
+    switch (state) {
+    case STATE_PENDING: return "等待中";
+    case STATE_FLASHING: return "刷写中";
+    case STATE_ERASING: return "擦除中";
+    case STATE_REBOOTING: return "重启中";
+    case STATE_WAITING: return "等待设备";
+    case STATE_DONE: return "完成";
+    case STATE_FAILED: return "失败";
+    case STATE_CANCELLED: return "已取消";
+    default: return "未知";
+    }
+}
+
+void FlashStation::prepareRun(const std::shared_ptr<Run> &run)
+{
+    // 每个镜像只映射和扫描一次，之后所有设备只读共享
+    const QStringList paths = run->recipe.imagePaths();
+    emit outputMessage(QString("📦 批量刷机 '%1': 准备 %2 个镜像，%3 台设备")
+                       .arg(run->recipe.name).arg(paths.size()).arg(run->serials.size()));
+
+    for (const QString &path : paths) {
+        QString error;
+        std::shared_ptr<const MappedImage> image = MappedImage::open(path, &error);
+        if (!image) {
+            emit outputMessage("❌ 镜像加载失败: " + error, true);
+            for (const QString &serial : std::as_const(run->serials)) {
+                emit deviceStateChanged(serial, STATE_FAILED, error);
+            }
+            m_running = false;
+            emit finished(0, static_cast<int>(run->serials.size()));
+            return;
+        }
+        run->images.insert(path, image);
+    }
+
+    for (const FlashRecipe::Step &step : std::as_const(run->recipe.steps)) {
+        if (step.action == FlashRecipe::ACTION_FLASH) {
+            run->totalWeight += run->images.value(step.imagePath)->size();
+        }
+    }
+
+    run->remaining = static_cast<int>(run->serials.size());
+    for (const QString &serial : std::as_const(run->serials)) {
+        m_pool->start([this, run, serial]() {
+            DeviceJob job(this, run, serial);
+            finishDevice(run, job.run());
+        });
+    }
+}
+
+void FlashStation::finishDevice(const std::shared_ptr<Run> &run, bool success)
+{
+    if (success) {
+        ++run->succeeded;
+    } else {
+        ++run->failed;
+    }
+    if (run->remaining.fetch_sub(1) != 1) {
+        return;
+    }
+
+    const int succeeded = run->succeeded;
+    const int failed = run->failed;
+    qDebug().noquote() << QString("Flash station '%1': %2 succeeded, %3 failed, %4 ms")
+        .arg(run->recipe.name).arg(succeeded).arg(failed).arg(run->timer.elapsed());
+    emit outputMessage(QString("%1 批量刷机结束: 成功 %2 台，失败 %3 台")
+                       .arg(failed == 0 ? "✅" : "⚠️").arg(succeeded).arg(failed), failed > 0);
+    m_running = false;
+    emit finished(succeeded, failed);
+}
+
+std::shared_ptr<FastbootClient> FlashStation::waitForSession(const QString &serial,
+                                                             const std::shared_ptr<FastbootClient> &previous,
+                                                             int timeout)
+{
+    // 重启前的会话在设备断开后才会被清理，只接受重新枚举后建立的新会话
+    QElapsedTimer timer;
+    timer.start();
+    while (!m_cancelled && timer.elapsed() < timeout) {
+        std::shared_ptr<FastbootClient> client = FastbootUsbManager::instance().session(serial);
+        if (client && client != previous) {
+            return client;
+        }
+        rescanUsb();
+        QThread::msleep(SESSION_POLL_INTERVAL);
+    }
+    return nullptr;
+}
+
+void FlashStation::rescanUsb()
+{
+    // 多台设备同时等待时只由其中一个线程枚举，新会话对所有设备可见
+    const qint64 now = m_clock.elapsed();
+    qint64 last = m_lastRescan;
+    if (now - last < RESCAN_INTERVAL || !m_lastRescan.compare_exchange_strong(last, now)) {
+        return;
+    }
+    QList<FastbootUsbManager::DeviceEntry> devices;
+    FastbootUsbManager::instance().enumerate(devices);
+}
@@ -0,0 +1,76 @@
+#ifndef FLASH_STATION_H
+#define FLASH_STATION_H
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <atomic>
+#include <memory>
+#include "flash_recipe.h"
+
+class FastbootClient;
+class QThreadPool;
+
+// 多设备并行刷机：同一配方在所选设备上并发执行，每台设备在独立的工作线程中按步骤推进自己的状态
+// 配方引用的镜像只映射和扫描一次，所有设备共享同一份只读数据
+// 所有USB/adb I/O 都在工作线程中进行，信号以排队方式送达界面线程
+class FlashStation : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const int MAX_PARALLEL_DEVICES = 64;     // 同时刷写的设备上限，超出的设备排队
+    static const int PROGRESS_INTERVAL = 250;       // 每台设备进度信号的最小间隔 (ms)
+    static const int REBOOT_TIMEOUT = 120000;       // 等待设备重启回到 fastboot 的时间
+    static const int RESCAN_INTERVAL = 1000;        // 等待重启时重新枚举USB的最小间隔，由所有设备共用
+    static const int SESSION_POLL_INTERVAL = 250;
+
+    enum DeviceState {
+        STATE_PENDING,
+        STATE_FLASHING,
+        STATE_ERASING,
+        STATE_REBOOTING,
+        STATE_WAITING,          // 等待设备重新枚举
+        STATE_DONE,
+        STATE_FAILED,
+        STATE_CANCELLED
+    };
+    Q_ENUM(DeviceState)
+
+    explicit FlashStation(QObject *parent = nullptr);
+    ~FlashStation();
+
+    bool isRunning() const;
+    // 立即返回；镜像映射、扫描和设备操作都在工作线程中进行
+    bool start(const FlashRecipe &recipe, const QStringList &serials, QString *error = nullptr);
+    // 正在传输的分区不会被打断，各设备在当前步骤完成后停止
+    void cancel();
+
+    static QString stateName(DeviceState state);
+
+signals:
+    void outputMessage(const QString &message, bool isError = false);
+    void deviceStateChanged(const QString &serial, FlashStation::DeviceState state, const QString &detail);
+    // percent 按镜像大小加权；mbps 为实际USB传输速率；etaSeconds 不含等待重启的时间，未知时为 -1
+    void deviceProgress(const QString &serial, int percent, double mbps, int etaSeconds);
+    void finished(int succeeded, int failed);
+
+private:
+    struct Run;
+    class DeviceJob;
+
+    void prepareRun(const std::shared_ptr<Run> &run);
+    void finishDevice(const std::shared_ptr<Run> &run, bool success);
+    std::shared_ptr<FastbootClient> waitForSession(const QString &serial,
+                                                   const std::shared_ptr<FastbootClient> &previous, int timeout);
+    void rescanUsb();
+
+    QThreadPool *m_pool;
+    QElapsedTimer m_clock;
+    std::atomic<bool> m_running;
+    std::atomic<bool> m_cancelled;
+    std::atomic<qint64> m_lastRescan;
+};
+
+#endif // FLASH_STATION_H
@@ -0,0 +1,66 @@
+#include "gpt_parser.h"
+#include <QtEndian>
+
+namespace {
+
+const char GPT_SIGNATURE[] = "EFI PART";
+const int GPT_HEADER_MIN_SIZE = 92;
+const int GPT_ENTRIES_LBA_OFFSET = 72;
+const int GPT_ENTRY_COUNT_OFFSET = 80;
+const int GPT_ENTRY_SIZE_OFFSET = 84;
+const int GPT_ENTRY_FIRST_LBA_OFFSET = 32;
+const int GPT_ENTRY_LAST_LBA_OFFSET = 40;
+const int GPT_ENTRY_NAME_OFFSET = 56;
+const int GPT_ENTRY_NAME_CHARS = 36;
+const quint32 GPT_MIN_ENTRY_SIZE = 128;
+const quint32 GPT_MAX_ENTRIES = 1024;
+
+} // namespace
+
+quint64 GptParser::Header::entriesBytes() const
+{
+    return static_cast<quint64>(entryCount) * entrySize;
+}
+
+bool GptParser::parseHeader(const QByteArray &header, Header &result)
+{
+    if (header.size() < GPT_HEADER_MIN_SIZE || !header.startsWith(GPT_SIGNATURE)) {
+        return false;
+    }
+
+    result.entriesLba = qFromLittleEndian<quint64>(header.constData() + GPT_ENTRIES_LBA_OFFSET);
+    result.entryCount = qFromLittleEndian<quint32>(header.constData() + GPT_ENTRY_COUNT_OFFSET);
+    result.entrySize = qFromLittleEndian<quint32>(header.constData() + GPT_ENTRY_SIZE_OFFSET);
+    return result.entryCount > 0 && result.entryCount <= GPT_MAX_ENTRIES
+        && result.entrySize >= GPT_MIN_ENTRY_SIZE;
+}
+
+QList<GptPartition> GptParser::parseEntries(const QByteArray &entries, const Header &header)
+{
+    QList<GptPartition> partitions;
+    for (quint32 i = 0; i < header.entryCount; ++i) {
+        quint64 offset = static_cast<quint64>(i) * header.entrySize;
+        if (offset + header.entrySize > static_cast<quint64>(entries.size())) {
+            break;
+        }
+        const char *entry = entries.constData() + static_cast<qsizetype>(offset);
+
+        GptPartition partition;
+        partition.firstLba = qFromLittleEndian<quint64>(entry + GPT_ENTRY_FIRST_LBA_OFFSET);
+        partition.lastLba = qFromLittleEndian<quint64>(entry + GPT_ENTRY_LAST_LBA_OFFSET);
+        if (partition.firstLba == 0 && partition.lastLba == 0) {
+            continue;
+        }
+
+        // 分区名为 UTF-16LE，以 0 结尾
+        for (int c = 0; c < GPT_ENTRY_NAME_CHARS; ++c) {
+            char16_t ch = qFromLittleEndian<quint16>(entry + GPT_ENTRY_NAME_OFFSET + c * 2);
+            if (ch == 0) {
+                break;
+            }
+            partition.label.append(QChar(ch));
+        }
+        partitions.append(partition);
+    }
+    return partitions;
+}
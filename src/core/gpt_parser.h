@@ -0,0 +1,34 @@
+#ifndef GPT_PARSER_H
+#define GPT_PARSER_H
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+
+// GPT 分区项，位置以 LBA 计
+struct GptPartition {
+    QString label;
+    quint64 firstLba = 0;
+    quint64 lastLba = 0;
+};
+
+// GPT 头和分区项解析，EDL/MTK 读取分区表时共用
+class GptParser
+{
+public:
+    struct Header {
+        quint64 entriesLba = 0;
+        quint32 entryCount = 0;
+        quint32 entrySize = 0;
+
+        // 分区项数组占用的字节数
+        quint64 entriesBytes() const;
+    };
+
+    // header 为 LBA 1 的内容
+    static bool parseHeader(const QByteArray &header, Header &result);
+    // 跳过未使用的分区项
+    static QList<GptPartition> parseEntries(const QByteArray &entries, const Header &header);
+};
+
+#endif // GPT_PARSER_H
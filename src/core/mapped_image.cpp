@@ -0,0 +1,72 @@
+#include "mapped_image.h"
+#include <QDebug>
+
+namespace {
+
+void setError(QString *error, const QString &message)
+{
+    if (error) {
+        *error = message;
+    }
+}
+
+} // namespace
+
+MappedImage::MappedImage()
+    : m_data(nullptr)
+    , m_size(0)
+{
+}
+
+MappedImage::~MappedImage()
+{
+    if (m_data) {
+        m_file.unmap(m_data);
+    }
+}
+
+std::shared_ptr<const MappedImage> MappedImage::open(const QString &path, QString *error)
+{
+    std::shared_ptr<MappedImage> image(new MappedImage());
+    image->m_file.setFileName(path);
+    if (!image->m_file.open(QIODevice::ReadOnly)) {
+        setError(error, "Cannot open " + path + ": " + image->m_file.errorString());
+        return nullptr;
+    }
+
+    image->m_size = image->m_file.size();
+    image->m_data = image->m_size > 0 ? image->m_file.map(0, image->m_size) : nullptr;
+    if (!image->m_data) {
+        setError(error, "Cannot map " + path);
+        return nullptr;
+    }
+
+    if (!image->m_sparse.load(image->m_data, image->m_size, error)) {
+        return nullptr;
+    }
+    qDebug().noquote() << QString("Mapped %1: %2 bytes, %3")
+        .arg(path)
+        .arg(image->m_size)
+        .arg(image->m_sparse.isSparse() ? "sparse" : "raw");
+    return image;
+}
+
+QString MappedImage::path() const
+{
+    return m_file.fileName();
+}
+
+const uchar *MappedImage::data() const
+{
+    return m_data;
+}
+
+qint64 MappedImage::size() const
+{
+    return m_size;
+}
+
+const SparseImage &MappedImage::sparse() const
+{
+    return m_sparse;
+}
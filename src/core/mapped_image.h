@@ -0,0 +1,35 @@
+#ifndef MAPPED_IMAGE_H
+#define MAPPED_IMAGE_H
+
+#include <QFile>
+#include <QString>
+#include <memory>
+#include "sparse_image.h"
+
+// 只读内存映射的刷写镜像及其 sparse 头部解析结果
+// 加载完成后不再修改，多个刷写线程可同时使用；N 台设备刷同一镜像时共享同一份映射
+// 打开时不读取原始镜像的内容，分块扫描在刷写需要切分时才与传输重叠进行 (见 SparseImage::Splitter)
+class MappedImage
+{
+public:
+    static std::shared_ptr<const MappedImage> open(const QString &path, QString *error = nullptr);
+    ~MappedImage();
+
+    MappedImage(const MappedImage &) = delete;
+    MappedImage &operator=(const MappedImage &) = delete;
+
+    QString path() const;
+    const uchar *data() const;
+    qint64 size() const;
+    const SparseImage &sparse() const;
+
+private:
+    MappedImage();
+
+    QFile m_file;
+    uchar *m_data;
+    qint64 m_size;
+    SparseImage m_sparse;
+};
+
+#endif // MAPPED_IMAGE_H
@@ -1,5 +1,316 @@
 #include "edl_9008.h"
+#include "sahara_client.h"
+#include <QElapsedTimer>
+#include <QFile>
+#include <QDebug>
 
-EDL9008::EDL9008(QObject *parent) : QObject(parent)
+namespace {
+
+const quint8 VENDOR_SPECIFIC_CLASS = 0xff;
+const int MAX_LUNS = 8;
+
+void setError(QString *error, const QString &message)
+{
+    if (error) {
+        *error = message;
+    }
+}
+
+// 高通原厂 9008 及部分 OEM 改过 VID/PID 的 Sahara 设备
+const EDL9008::UsbId KNOWN_EDL_IDS[] = {
+    {0x05c6, 0x9008, "Qualcomm", "QDLoader 9008", false},
+    {0x05c6, 0x900e, "Qualcomm", "QDLoader 900E", true},
+    {0x05c6, 0x9025, "Qualcomm", "QDLoader 9025", true},
+    {0x0fce, 0x9dde, "Sony", "EDL", true},
+    {0x0fce, 0xade5, "Sony", "EDL", true},
+    {0x19d2, 0x0076, "ZTE", "EDL", true},
+    {0x1199, 0x9062, "Sierra Wireless", "EDL", true},
+    {0x1199, 0x9070, "Sierra Wireless", "EDL", true},
+    {0x1199, 0x9090, "Sierra Wireless", "EDL", true},
+    {0x0846, 0x68e0, "Netgear", "EDL", true},
+};
+
+bool hasVendorInterface(const UsbDeviceDescription &device)
+{
+    for (const UsbInterfaceClass &iface : device.interfaces) {
+        if (iface.interfaceClass == VENDOR_SPECIFIC_CLASS && iface.interfaceSubClass == VENDOR_SPECIFIC_CLASS) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+EDL9008::EDL9008(QObject *parent)
+    : PartitionDevice("EDL", parent)
+    , m_partitionsLoaded(false)
+{
+}
+
+EDL9008::~EDL9008()
+{
+    close();
+}
+
+bool EDL9008::open(const QString &portPath, QString *error)
+{
+    std::unique_ptr<UsbEdlTransport> transport = UsbEdlTransport::open(portPath, error);
+    if (!transport) {
+        return false;
+    }
+    open(std::move(transport));
+    return true;
+}
+
+void EDL9008::open(std::unique_ptr<EdlTransport> transport)
+{
+    close();
+    m_transport = std::move(transport);
+}
+
+void EDL9008::close()
+{
+    m_firehose.reset();
+    m_partitions.clear();
+    m_partitionsLoaded = false;
+    if (m_transport) {
+        m_transport->close();
+        m_transport.reset();
+    }
+}
+
+bool EDL9008::isOpen() const
+{
+    return m_transport != nullptr;
+}
+
+void EDL9008::setOptions(const Options &options)
+{
+    m_options = options;
+}
+
+EDL9008::Options EDL9008::options() const
+{
+    return m_options;
+}
+
+bool EDL9008::loadProgrammer(const QString &programmerPath, QString *error)
+{
+    if (!m_transport) {
+        setError(error, "EDL device not open");
+        return false;
+    }
+
+    QFile programmer(programmerPath);
+    if (!programmer.open(QIODevice::ReadOnly)) {
+        setError(error, "Cannot open programmer " + programmerPath + ": " + programmer.errorString());
+        return false;
+    }
+    uchar *image = programmer.map(0, programmer.size());
+    if (!image) {
+        setError(error, "Cannot map programmer " + programmerPath);
+        return false;
+    }
+
+    SaharaClient sahara(*m_transport);
+    bool uploaded = sahara.uploadImage(image, programmer.size(), error);
+    programmer.unmap(image);
+    if (!uploaded) {
+        return false;
+    }
+
+    // programmer 启动后在同一端点上切换为 Firehose
+    m_firehose.reset(new FirehoseClient(*m_transport));
+    m_partitions.clear();
+    m_partitionsLoaded = false;
+    if (!m_firehose->configure(m_options.memoryName, m_options.maxPayloadSize, error)) {
+        m_firehose.reset();
+        return false;
+    }
+    return true;
+}
+
+bool EDL9008::findPartition(const QString &label, FirehosePartition &partition, QString *error)
+{
+    return loadPartitions(error) && findByLabel(m_partitions, label, partition, error);
+}
+
+bool EDL9008::readPartition(const QString &label, const QString &outputPath, QString *error)
 {
+    FirehosePartition partition;
+    if (!findPartition(label, partition, error)) {
+        return false;
+    }
+
+    QFile output(outputPath);
+    if (!output.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        setError(error, "Cannot create " + outputPath + ": " + output.errorString());
+        return false;
+    }
+
+    JobStats stats;
+    stats.operation = "read";
+    stats.partition = label;
+    QElapsedTimer timer;
+    timer.start();
+
+    bool ok = m_firehose->readSectors(partition.lun, partition.firstSector, partition.sectorCount,
+        [&output, &stats](const char *data, qint64 size) {
+            stats.bytes += size;
+            return output.write(data, size) == size;
+        }, error,
+        [this](qint64 done, qint64 total) {
+            emit progress("read", done, total);
+        });
+
+    stats.elapsedMs = timer.elapsed();
+    finishJob(stats, ok);
+    return ok;
+}
+
+bool EDL9008::programPartition(const QString &label, const QString &imagePath, QString *error)
+{
+    FirehosePartition partition;
+    if (!findPartition(label, partition, error)) {
+        return false;
+    }
+
+    QFile image(imagePath);
+    if (!image.open(QIODevice::ReadOnly)) {
+        setError(error, "Cannot open " + imagePath + ": " + image.errorString());
+        return false;
+    }
+    const qint64 size = image.size();
+    const qint64 capacity = static_cast<qint64>(partition.sectorCount) * m_firehose->sectorSize();
+    if (size == 0 || size > capacity) {
+        setError(error, QString("Image size %1 does not fit partition %2 (%3 bytes)")
+                 .arg(size).arg(label).arg(capacity));
+        return false;
+    }
+
+    // 映射整个镜像，由 Firehose 客户端在后台线程中预取下一块
+    uchar *data = image.map(0, size);
+    if (!data) {
+        setError(error, "Cannot map " + imagePath);
+        return false;
+    }
+
+    JobStats stats;
+    stats.operation = "program";
+    stats.partition = label;
+    QElapsedTimer timer;
+    timer.start();
+
+    bool ok = m_firehose->programSectors(partition.lun, partition.firstSector, data, size,
+        m_options.chunkSize, error,
+        [this, &stats](qint64 done, qint64 total) {
+            stats.bytes = done;
+            emit progress("program", done, total);
+        });
+
+    stats.elapsedMs = timer.elapsed();
+    image.unmap(data);
+    finishJob(stats, ok);
+    return ok;
+}
+
+bool EDL9008::erasePartition(const QString &label, QString *error)
+{
+    FirehosePartition partition;
+    if (!findPartition(label, partition, error)) {
+        return false;
+    }
+
+    JobStats stats;
+    stats.operation = "erase";
+    stats.partition = label;
+    QElapsedTimer timer;
+    timer.start();
+
+    bool ok = m_firehose->eraseSectors(partition.lun, partition.firstSector, partition.sectorCount, error);
+    if (ok) {
+        stats.bytes = static_cast<qint64>(partition.sectorCount) * m_firehose->sectorSize();
+    }
+
+    stats.elapsedMs = timer.elapsed();
+    finishJob(stats, ok);
+    return ok;
+}
+
+bool EDL9008::reset(QString *error)
+{
+    return ensureFirehose(error) && m_firehose->reset(error);
+}
+
+bool EDL9008::ensureFirehose(QString *error)
+{
+    if (!m_firehose) {
+        setError(error, "Firehose programmer not loaded");
+        return false;
+    }
+    return true;
+}
+
+bool EDL9008::loadPartitions(QString *error)
+{
+    if (!ensureFirehose(error)) {
+        return false;
+    }
+    if (m_partitionsLoaded) {
+        return true;
+    }
+
+    // eMMC 只有 LUN 0；UFS 依次读取，遇到不存在的 LUN 为止
+    int luns = m_options.memoryName.compare("emmc", Qt::CaseInsensitive) == 0 ? 1 : MAX_LUNS;
+    QList<FirehosePartition> partitions;
+    for (int lun = 0; lun < luns; ++lun) {
+        QString lunError;
+        if (!m_firehose->readPartitionTable(lun, partitions, &lunError)) {
+            if (lun == 0) {
+                setError(error, lunError);
+                return false;
+            }
+            break;
+        }
+    }
+
+    m_partitions = partitions;
+    m_partitionsLoaded = true;
+    qDebug() << "EDL partition table loaded:" << m_partitions.size() << "partitions";
+    return true;
+}
+
+const EDL9008::UsbId *EDL9008::matchDevice(const UsbDeviceDescription &device)
+{
+    for (const UsbId &id : KNOWN_EDL_IDS) {
+        if (id.vendorId != device.vendorId || id.productId != device.productId) {
+            continue;
+        }
+        if (id.requireVendorInterface && !hasVendorInterface(device)) {
+            return nullptr;
+        }
+        return &id;
+    }
+    return nullptr;
+}
+
+bool EDL9008::isEdlDevice(const UsbDeviceDescription &device)
+{
+    return matchDevice(device) != nullptr;
+}
+
+bool EDL9008::scanDevices(QList<UsbDeviceDescription> &devices)
+{
+    QList<UsbDeviceDescription> all;
+    if (!UsbContext::instance().devices(all)) {
+        return false;
+    }
+
+    for (const UsbDeviceDescription &device : std::as_const(all)) {
+        if (isEdlDevice(device)) {
+            devices.append(device);
+        }
+    }
+    return true;
 }
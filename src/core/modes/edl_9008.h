@@ -1,14 +1,73 @@
 #ifndef EDL_9008_H
 #define EDL_9008_H
 
-#include <QObject>
+#include <QList>
+#include <QString>
+#include <memory>
+#include "usb_context.h"
+#include "edl_transport.h"
+#include "firehose_client.h"
+#include "partition_device.h"
 
-class EDL9008 : public QObject
+// 高通紧急下载模式 (EDL, QDLoader 9008)
+// 通过 Sahara 上传 programmer 后以 Firehose 读写/擦除分区；所有操作同步执行，应在工作线程中调用
+class EDL9008 : public PartitionDevice
 {
     Q_OBJECT
 
 public:
+    // 已知的 EDL USB 标识
+    struct UsbId {
+        quint16 vendorId;
+        quint16 productId;
+        const char *vendorName;
+        const char *productName;
+        bool requireVendorInterface;    // PID 同时用于其他模式时，还需存在 0xff/0xff 厂商接口
+    };
+
+    struct Options {
+        QString memoryName = "ufs";
+        qint64 chunkSize = 1024 * 1024;     // 单次USB传输的大小，向下对齐到扇区
+        qint64 maxPayloadSize = FirehoseClient::DEFAULT_MAX_PAYLOAD;
+    };
+
     explicit EDL9008(QObject *parent = nullptr);
+    ~EDL9008();
+
+    // 按 USB 端口路径打开设备，或使用给定的传输层 (如本地回环模拟器)
+    bool open(const QString &portPath, QString *error = nullptr);
+    void open(std::unique_ptr<EdlTransport> transport);
+    void close();
+    bool isOpen() const;
+
+    void setOptions(const Options &options);
+    Options options() const;
+
+    // Sahara 上传 programmer 并完成 Firehose 配置
+    bool loadProgrammer(const QString &programmerPath, QString *error = nullptr);
+
+    bool findPartition(const QString &label, FirehosePartition &partition, QString *error = nullptr);
+    bool readPartition(const QString &label, const QString &outputPath, QString *error = nullptr);
+    bool programPartition(const QString &label, const QString &imagePath, QString *error = nullptr);
+    bool erasePartition(const QString &label, QString *error = nullptr);
+    bool reset(QString *error = nullptr);
+
+    // 只根据描述符判断，不打开设备
+    static const UsbId *matchDevice(const UsbDeviceDescription &device);
+    static bool isEdlDevice(const UsbDeviceDescription &device);
+
+    // 扫描当前连接的 EDL 设备，使用共享的 libusb 上下文和设备描述缓存
+    static bool scanDevices(QList<UsbDeviceDescription> &devices);
+
+private:
+    bool ensureFirehose(QString *error);
+    bool loadPartitions(QString *error);
+
+    std::unique_ptr<EdlTransport> m_transport;
+    std::unique_ptr<FirehoseClient> m_firehose;
+    Options m_options;
+    QList<FirehosePartition> m_partitions;
+    bool m_partitionsLoaded;
 };
 
 #endif // EDL_9008_H
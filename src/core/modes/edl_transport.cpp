@@ -0,0 +1,188 @@
+#include "edl_transport.h"
+#include "edl_9008.h"
+#include "usb_context.h"
+#include <QDebug>
+#include <libusb.h>
+
+namespace {
+
+unsigned int libusbTimeout(int timeout)
+{
+    // libusb 以 0 表示不超时
+    return timeout < 0 ? 0u : static_cast<unsigned int>(timeout);
+}
+
+void setError(QString *error, const QString &message)
+{
+    if (error) {
+        *error = message;
+    }
+}
+
+// 9008 端口只有一个厂商自定义接口，取其中的一对批量端点
+bool findBulkInterface(libusb_device *device, int &interfaceNumber, quint8 &inEndpoint, quint8 &outEndpoint,
+                       int &outPacketSize)
+{
+    libusb_config_descriptor *config = nullptr;
+    if (libusb_get_active_config_descriptor(device, &config) != LIBUSB_SUCCESS || !config) {
+        return false;
+    }
+
+    interfaceNumber = -1;
+    for (int i = 0; i < config->bNumInterfaces && interfaceNumber < 0; ++i) {
+        const libusb_interface &iface = config->interface[i];
+        for (int alt = 0; alt < iface.num_altsetting; ++alt) {
+            const libusb_interface_descriptor &setting = iface.altsetting[alt];
+            if (setting.bInterfaceClass != LIBUSB_CLASS_VENDOR_SPEC) {
+                continue;
+            }
+
+            inEndpoint = outEndpoint = 0;
+            for (int e = 0; e < setting.bNumEndpoints; ++e) {
+                const libusb_endpoint_descriptor &endpoint = setting.endpoint[e];
+                if ((endpoint.bmAttributes & LIBUSB_TRANSFER_TYPE_MASK) != LIBUSB_TRANSFER_TYPE_BULK) {
+                    continue;
+                }
+                if (endpoint.bEndpointAddress & LIBUSB_ENDPOINT_IN) {
+                    inEndpoint = endpoint.bEndpointAddress;
+                } else {
+                    outEndpoint = endpoint.bEndpointAddress;
+                    outPacketSize = endpoint.wMaxPacketSize;
+                }
+            }
+            if (inEndpoint && outEndpoint) {
+                interfaceNumber = setting.bInterfaceNumber;
+                break;
+            }
+        }
+    }
+    libusb_free_config_descriptor(config);
+    return interfaceNumber >= 0;
+}
+
+} // namespace
+
+UsbEdlTransport::UsbEdlTransport(libusb_device_handle *handle, int interfaceNumber,
+                                 quint8 inEndpoint, quint8 outEndpoint, int outPacketSize)
+    : m_handle(handle)
+    , m_interfaceNumber(interfaceNumber)
+    , m_inEndpoint(inEndpoint)
+    , m_outEndpoint(outEndpoint)
+    , m_outPacketSize(outPacketSize)
+{
+}
+
+UsbEdlTransport::~UsbEdlTransport()
+{
+    close();
+}
+
+std::unique_ptr<UsbEdlTransport> UsbEdlTransport::open(const QString &portPath, QString *error)
+{
+    libusb_context *ctx = UsbContext::instance().context();
+    if (!ctx) {
+        setError(error, "libusb not available");
+        return nullptr;
+    }
+
+    libusb_device **list = nullptr;
+    ssize_t count = libusb_get_device_list(ctx, &list);
+    if (count < 0) {
+        setError(error, QString("Cannot list USB devices: %1").arg(libusb_error_name(static_cast<int>(count))));
+        return nullptr;
+    }
+
+    libusb_device *target = nullptr;
+    for (ssize_t i = 0; i < count; ++i) {
+        UsbDeviceDescription description;
+        if (UsbContext::describeDevice(list[i], description)
+            && description.portPath == portPath && EDL9008::isEdlDevice(description)) {
+            target = list[i];
+            break;
+        }
+    }
+
+    std::unique_ptr<UsbEdlTransport> transport;
+    int interfaceNumber = -1;
+    quint8 inEndpoint = 0;
+    quint8 outEndpoint = 0;
+    int outPacketSize = 0;
+    if (!target) {
+        setError(error, "No EDL device on port " + portPath);
+    } else if (!findBulkInterface(target, interfaceNumber, inEndpoint, outEndpoint, outPacketSize)) {
+        setError(error, "EDL device has no bulk interface");
+    } else {
+        libusb_device_handle *handle = nullptr;
+        int result = libusb_open(target, &handle);
+        if (result != LIBUSB_SUCCESS) {
+            setError(error, QString("Cannot open EDL device: %1").arg(libusb_error_name(result)));
+        } else {
+            libusb_set_auto_detach_kernel_driver(handle, 1);
+            result = libusb_claim_interface(handle, interfaceNumber);
+            if (result != LIBUSB_SUCCESS) {
+                setError(error, QString("Cannot claim EDL interface: %1").arg(libusb_error_name(result)));
+                libusb_close(handle);
+            } else {
+                transport.reset(new UsbEdlTransport(handle, interfaceNumber, inEndpoint, outEndpoint, outPacketSize));
+            }
+        }
+    }
+
+    libusb_free_device_list(list, 1);
+    return transport;
+}
+
+qint64 UsbEdlTransport::write(const char *data, qint64 size, int timeout)
+{
+    if (!m_handle) {
+        return -1;
+    }
+
+    int transferred = 0;
+    int result = libusb_bulk_transfer(m_handle, m_outEndpoint,
+                                      reinterpret_cast<unsigned char*>(const_cast<char*>(data)),
+                                      static_cast<int>(size), &transferred, libusbTimeout(timeout));
+    if (result != LIBUSB_SUCCESS) {
+        qWarning() << "EDL USB write failed:" << libusb_error_name(result);
+        return -1;
+    }
+    
+    // configure 时声明了 ZLPAwareHost，长度为包长整数倍的传输以零长度包结束，
+    // 否则设备会把下一次写入当作同一次传输的后续数据
+    if (transferred == size && size > 0 && m_outPacketSize > 0 && size % m_outPacketSize == 0) {
+        int zlpTransferred = 0;
+        unsigned char empty = 0;
+        result = libusb_bulk_transfer(m_handle, m_outEndpoint, &empty, 0, &zlpTransferred,
+                                      libusbTimeout(timeout));
+        if (result != LIBUSB_SUCCESS) {
+            qWarning() << "EDL USB zero-length packet failed:" << libusb_error_name(result);
+            return -1;
+        }
+    }
+    return transferred;
+}
+
+qint64 UsbEdlTransport::read(char *data, qint64 maxSize, int timeout)
+{
+    if (!m_handle) {
+        return -1;
+    }
+
+    int transferred = 0;
+    int result = libusb_bulk_transfer(m_handle, m_inEndpoint,
+                                      reinterpret_cast<unsigned char*>(data),
+                                      static_cast<int>(maxSize), &transferred, libusbTimeout(timeout));
+    if (result != LIBUSB_SUCCESS) {
+        return -1;
+    }
+    return transferred;
+}
+
+void UsbEdlTransport::close()
+{
+    if (m_handle) {
+        libusb_release_interface(m_handle, m_interfaceNumber);
+        libusb_close(m_handle);
+        m_handle = nullptr;
+    }
+}
@@ -0,0 +1,46 @@
+#ifndef EDL_TRANSPORT_H
+#define EDL_TRANSPORT_H
+
+#include <QString>
+#include <memory>
+
+struct libusb_device_handle;
+
+// EDL 传输层 (Sahara 与 Firehose 共用同一对批量端点)
+// USB 实现见 UsbEdlTransport，也可替换为在本地回环中模拟协议的设备
+class EdlTransport
+{
+public:
+    virtual ~EdlTransport() = default;
+
+    // 返回实际传输的字节数，出错返回 -1
+    virtual qint64 write(const char *data, qint64 size, int timeout) = 0;
+    virtual qint64 read(char *data, qint64 maxSize, int timeout) = 0;
+    virtual void close() = 0;
+};
+
+// 通过 libusb 批量端点与 9008 端口通信
+class UsbEdlTransport : public EdlTransport
+{
+public:
+    ~UsbEdlTransport() override;
+
+    // 按 USB 端口路径 (与 DeviceDetector 中 EDL 设备的标识一致) 打开设备
+    static std::unique_ptr<UsbEdlTransport> open(const QString &portPath, QString *error = nullptr);
+
+    qint64 write(const char *data, qint64 size, int timeout) override;
+    qint64 read(char *data, qint64 maxSize, int timeout) override;
+    void close() override;
+
+private:
+    UsbEdlTransport(libusb_device_handle *handle, int interfaceNumber,
+                    quint8 inEndpoint, quint8 outEndpoint, int outPacketSize);
+
+    libusb_device_handle *m_handle;
+    int m_interfaceNumber;
+    quint8 m_inEndpoint;
+    quint8 m_outEndpoint;
+    int m_outPacketSize;        // 写入长度为其整数倍时追加零长度包
+};
+
+#endif // EDL_TRANSPORT_H
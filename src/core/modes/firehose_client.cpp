@@ -0,0 +1,392 @@
+#include "firehose_client.h"
+#include "edl_transport.h"
+#include "gpt_parser.h"
+#include "buffer_pipeline.h"
+#include <QXmlStreamReader>
+#include <QXmlStreamWriter>
+#include <QDebug>
+#include <cstring>
+#include <thread>
+
+namespace {
+
+const int READ_BUFFER_SIZE = 16 * 1024;
+const int PROGRAM_BUFFER_COUNT = 2;     // 双缓冲：当前块发送时后台线程准备下一块
+const char DATA_END_TAG[] = "</data>";
+
+void setError(QString *error, const QString &message)
+{
+    if (error) {
+        *error = message;
+    }
+}
+
+} // namespace
+
+FirehoseClient::FirehoseClient(EdlTransport &transport)
+    : m_transport(transport)
+    , m_sectorSize(4096)
+    , m_maxPayloadSize(DEFAULT_MAX_PAYLOAD)
+{
+}
+
+int FirehoseClient::sectorSize() const
+{
+    return m_sectorSize;
+}
+
+void FirehoseClient::setSectorSize(int sectorSize)
+{
+    m_sectorSize = sectorSize;
+}
+
+qint64 FirehoseClient::maxPayloadSize() const
+{
+    return m_maxPayloadSize;
+}
+
+bool FirehoseClient::configure(const QString &memoryName, qint64 maxPayloadSize, QString *error)
+{
+    // eMMC 为 512 字节扇区，UFS/NAND 为 4096
+    m_sectorSize = memoryName.compare("emmc", Qt::CaseInsensitive) == 0 ? 512 : 4096;
+
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        QMap<QString, QString> attributes;
+        attributes["MemoryName"] = memoryName;
+        attributes["MaxPayloadSizeToTargetInBytes"] = QString::number(maxPayloadSize);
+        attributes["Verbose"] = "0";
+        attributes["ZLPAwareHost"] = "1";
+        attributes["SkipStorageInit"] = "0";
+        attributes["SkipWrite"] = "0";
+        if (!sendCommand("configure", attributes, error)) {
+            return false;
+        }
+
+        Response response;
+        if (!readResponse(response, error)) {
+            return false;
+        }
+
+        // 设备不接受请求的上限时会在应答中给出支持的值，按该值重试一次
+        qint64 supported = response.attributes.value("MaxPayloadSizeToTargetInBytesSupported").toLongLong();
+        if (!response.ack) {
+            if (attempt == 0 && supported > 0 && supported < maxPayloadSize) {
+                maxPayloadSize = supported;
+                continue;
+            }
+            setError(error, "Firehose configure rejected: " + response.log);
+            return false;
+        }
+
+        qint64 accepted = response.attributes.value("MaxPayloadSizeToTargetInBytes").toLongLong();
+        m_maxPayloadSize = accepted > 0 ? qMin(accepted, maxPayloadSize) : maxPayloadSize;
+        qDebug() << "Firehose configured:" << memoryName << "max payload" << m_maxPayloadSize;
+        return true;
+    }
+    return false;
+}
+
+bool FirehoseClient::readSectors(int lun, quint64 startSector, quint64 sectorCount, const DataSink &sink,
+                                 QString *error, const ProgressCallback &progress)
+{
+    if (!sendCommand("read", sectorAttributes(lun, startSector, sectorCount), error)) {
+        return false;
+    }
+
+    Response response;
+    if (!readResponse(response, error)) {
+        return false;
+    }
+    if (!response.ack || response.attributes.value("rawmode") != "true") {
+        setError(error, QString("Firehose read rejected at sector %1: %2").arg(startSector).arg(response.log));
+        return false;
+    }
+
+    const qint64 total = static_cast<qint64>(sectorCount) * m_sectorSize;
+    const qint64 chunkSize = qMax<qint64>(m_sectorSize, m_maxPayloadSize / m_sectorSize * m_sectorSize);
+    QByteArray buffer(static_cast<int>(qMin(chunkSize, total)), Qt::Uninitialized);
+    qint64 done = 0;
+    while (done < total) {
+        qint64 length = qMin<qint64>(buffer.size(), total - done);
+        if (!readRaw(buffer.data(), length, error)) {
+            return false;
+        }
+        if (!sink(buffer.constData(), length)) {
+            setError(error, "Read aborted");
+            return false;
+        }
+        done += length;
+        if (progress) {
+            progress(done, total);
+        }
+    }
+
+    if (!readResponse(response, error)) {
+        return false;
+    }
+    if (!response.ack) {
+        setError(error, "Firehose read failed: " + response.log);
+        return false;
+    }
+    return true;
+}
+
+bool FirehoseClient::programSectors(int lun, quint64 startSector, const uchar *data, qint64 size,
+                                    qint64 chunkSize, QString *error, const ProgressCallback &progress)
+{
+    const quint64 sectorCount = static_cast<quint64>((size + m_sectorSize - 1) / m_sectorSize);
+    QMap<QString, QString> attributes = sectorAttributes(lun, startSector, sectorCount);
+    attributes["filename"] = "";
+    if (!sendCommand("program", attributes, error)) {
+        return false;
+    }
+
+    Response response;
+    if (!readResponse(response, error)) {
+        return false;
+    }
+    if (!response.ack || response.attributes.value("rawmode") != "true") {
+        setError(error, QString("Firehose program rejected at sector %1: %2").arg(startSector).arg(response.log));
+        return false;
+    }
+
+    // 块大小对齐到扇区且不超过协商的单次传输上限
+    chunkSize = qMin(chunkSize, m_maxPayloadSize) / m_sectorSize * m_sectorSize;
+    chunkSize = qMax<qint64>(chunkSize, m_sectorSize);
+
+    const qint64 total = static_cast<qint64>(sectorCount) * m_sectorSize;
+    qint64 done = 0;
+    
+    // 生产者线程把下一块从映射内存复制到空闲缓冲区并按扇区补零，
+    // 缺页导致的磁盘读取发生在生产者线程中，与当前块的USB传输重叠
+    BufferPipeline pipeline(PROGRAM_BUFFER_COUNT, chunkSize);
+    const int sectorSize = m_sectorSize;
+    std::thread producer([&pipeline, data, size, chunkSize, sectorSize]() {
+        for (qint64 offset = 0; offset < size;) {
+            int slot = pipeline.acquire();
+            if (slot < 0) {
+                return;
+            }
+            qint64 length = qMin(chunkSize, size - offset);
+            qint64 padded = (length + sectorSize - 1) / sectorSize * sectorSize;
+            char *buffer = pipeline.reserve(slot, padded);
+            std::memcpy(buffer, data + offset, static_cast<size_t>(length));
+            std::memset(buffer + length, 0, static_cast<size_t>(padded - length));
+            pipeline.submit(slot, padded);
+            offset += length;
+        }
+        pipeline.finish();
+    });
+    
+    bool sent = true;
+    int slot;
+    while (sent && pipeline.take(slot)) {
+        const qint64 length = pipeline.size(slot);
+        sent = writeAll(pipeline.data(slot), length, error);
+        pipeline.release(slot);
+        if (sent) {
+            done += length;
+            if (progress) {
+                progress(done, total);
+            }
+        }
+    }
+    if (!sent) {
+        pipeline.abort();
+    }
+    producer.join();
+    if (!sent) {
+        return false;
+    }
+
+    if (!readResponse(response, error)) {
+        return false;
+    }
+    if (!response.ack) {
+        setError(error, QString("Firehose program failed at sector %1: %2").arg(startSector).arg(response.log));
+        return false;
+    }
+    return true;
+}
+
+bool FirehoseClient::eraseSectors(int lun, quint64 startSector, quint64 sectorCount, QString *error)
+{
+    if (!sendCommand("erase", sectorAttributes(lun, startSector, sectorCount), error)) {
+        return false;
+    }
+
+    // 擦除大分区可能需要较长时间
+    Response response;
+    if (!readResponse(response, error, DEFAULT_TIMEOUT * 6)) {
+        return false;
+    }
+    if (!response.ack) {
+        setError(error, QString("Firehose erase failed at sector %1: %2").arg(startSector).arg(response.log));
+        return false;
+    }
+    return true;
+}
+
+bool FirehoseClient::readPartitionTable(int lun, QList<FirehosePartition> &partitions, QString *error)
+{
+    QByteArray header;
+    auto collect = [](QByteArray &target) {
+        return [&target](const char *data, qint64 size) {
+            target.append(data, static_cast<int>(size));
+            return true;
+        };
+    };
+
+    // GPT 头位于 LBA 1
+    if (!readSectors(lun, 1, 1, collect(header), error)) {
+        return false;
+    }
+    GptParser::Header gpt;
+    if (!GptParser::parseHeader(header, gpt)) {
+        setError(error, QString("No valid GPT on LUN %1").arg(lun));
+        return false;
+    }
+
+    QByteArray entries;
+    quint64 sectors = (gpt.entriesBytes() + m_sectorSize - 1) / m_sectorSize;
+    if (!readSectors(lun, gpt.entriesLba, sectors, collect(entries), error)) {
+        return false;
+    }
+
+    for (const GptPartition &entry : GptParser::parseEntries(entries, gpt)) {
+        FirehosePartition partition;
+        partition.label = entry.label;
+        partition.lun = lun;
+        partition.firstSector = entry.firstLba;
+        partition.sectorCount = entry.lastLba - entry.firstLba + 1;
+        partitions.append(partition);
+    }
+    return true;
+}
+
+bool FirehoseClient::reset(QString *error)
+{
+    QMap<QString, QString> attributes;
+    attributes["value"] = "reset";
+    if (!sendCommand("power", attributes, error)) {
+        return false;
+    }
+    Response response;
+    if (!readResponse(response, error)) {
+        return false;
+    }
+    if (!response.ack) {
+        setError(error, "Firehose reset failed: " + response.log);
+        return false;
+    }
+    return true;
+}
+
+bool FirehoseClient::sendCommand(const QString &element, const QMap<QString, QString> &attributes, QString *error)
+{
+    QByteArray xml;
+    QXmlStreamWriter writer(&xml);
+    writer.writeStartDocument();
+    writer.writeStartElement("data");
+    writer.writeStartElement(element);
+    for (auto it = attributes.constBegin(); it != attributes.constEnd(); ++it) {
+        writer.writeAttribute(it.key(), it.value());
+    }
+    writer.writeEndElement();
+    writer.writeEndElement();
+    writer.writeEndDocument();
+    return writeAll(xml.constData(), xml.size(), error);
+}
+
+bool FirehoseClient::readResponse(Response &response, QString *error, int timeout)
+{
+    // 应答前通常有若干 <log> 文档，一次读取可能包含多个文档或半个文档
+    QString lastLog;
+    response.log.clear();
+    for (;;) {
+        int end = m_buffer.indexOf(DATA_END_TAG);
+        if (end < 0) {
+            char buffer[READ_BUFFER_SIZE];
+            qint64 received = m_transport.read(buffer, sizeof(buffer), timeout);
+            if (received <= 0) {
+                setError(error, lastLog.isEmpty() ? QString("No response from firehose programmer")
+                                                  : "Firehose: " + lastLog);
+                return false;
+            }
+            m_buffer.append(buffer, static_cast<int>(received));
+            continue;
+        }
+
+        int length = end + static_cast<int>(sizeof(DATA_END_TAG) - 1);
+        QByteArray document = m_buffer.left(length);
+        m_buffer.remove(0, length);
+
+        bool found = false;
+        QXmlStreamReader xml(document);
+        while (!xml.atEnd()) {
+            if (xml.readNext() != QXmlStreamReader::StartElement) {
+                continue;
+            }
+            if (xml.name() == QLatin1String("log")) {
+                lastLog = xml.attributes().value("value").toString();
+                qDebug() << "Firehose:" << lastLog;
+            } else if (xml.name() == QLatin1String("response")) {
+                response.attributes.clear();
+                for (const QXmlStreamAttribute &attribute : xml.attributes()) {
+                    response.attributes[attribute.name().toString()] = attribute.value().toString();
+                }
+                response.ack = response.attributes.value("value") == "ACK";
+                found = true;
+            }
+        }
+        if (found) {
+            response.log = lastLog;
+            return true;
+        }
+    }
+}
+
+bool FirehoseClient::readRaw(char *data, qint64 size, QString *error)
+{
+    // 先取出解析应答时多读到的原始数据
+    qint64 buffered = qMin<qint64>(size, m_buffer.size());
+    if (buffered > 0) {
+        std::memcpy(data, m_buffer.constData(), static_cast<size_t>(buffered));
+        m_buffer.remove(0, static_cast<int>(buffered));
+    }
+
+    qint64 done = buffered;
+    while (done < size) {
+        qint64 received = m_transport.read(data + done, size - done, DEFAULT_TIMEOUT);
+        if (received <= 0) {
+            setError(error, "Firehose raw data transfer timed out");
+            return false;
+        }
+        done += received;
+    }
+    return true;
+}
+
+bool FirehoseClient::writeAll(const char *data, qint64 size, QString *error)
+{
+    while (size > 0) {
+        qint64 written = m_transport.write(data, size, DEFAULT_TIMEOUT);
+        if (written <= 0) {
+            setError(error, "Firehose USB write failed");
+            return false;
+        }
+        data += written;
+        size -= written;
+    }
+    return true;
+}
+
+QMap<QString, QString> FirehoseClient::sectorAttributes(int lun, quint64 startSector, quint64 sectorCount) const
+{
+    QMap<QString, QString> attributes;
+    attributes["SECTOR_SIZE_IN_BYTES"] = QString::number(m_sectorSize);
+    attributes["num_partition_sectors"] = QString::number(sectorCount);
+    attributes["physical_partition_number"] = QString::number(lun);
+    attributes["start_sector"] = QString::number(startSector);
+    return attributes;
+}
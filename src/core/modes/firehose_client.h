@@ -0,0 +1,72 @@
+#ifndef FIREHOSE_CLIENT_H
+#define FIREHOSE_CLIENT_H
+
+#include <QByteArray>
+#include <QList>
+#include <QMap>
+#include <QString>
+#include <functional>
+
+class EdlTransport;
+
+// GPT 中的一个分区，位置以扇区计
+struct FirehosePartition {
+    QString label;
+    int lun = 0;
+    quint64 firstSector = 0;
+    quint64 sectorCount = 0;
+};
+
+// Firehose 协议客户端：programmer 运行后通过 XML 命令读写存储
+// 命令与应答为 <data> 文档，read/program 在 ACK(rawmode) 之后传输原始扇区数据
+class FirehoseClient
+{
+public:
+    static const int DEFAULT_TIMEOUT = 10000;
+    static const qint64 DEFAULT_MAX_PAYLOAD = 1024 * 1024;
+
+    using ProgressCallback = std::function<void(qint64 done, qint64 total)>;
+    // 返回 false 时中止读取
+    using DataSink = std::function<bool(const char *data, qint64 size)>;
+
+    explicit FirehoseClient(EdlTransport &transport);
+
+    // 协商存储类型和单次传输上限，设备给出更小的上限时以设备为准
+    bool configure(const QString &memoryName, qint64 maxPayloadSize = DEFAULT_MAX_PAYLOAD,
+                   QString *error = nullptr);
+    int sectorSize() const;
+    void setSectorSize(int sectorSize);
+    qint64 maxPayloadSize() const;
+
+    bool readSectors(int lun, quint64 startSector, quint64 sectorCount, const DataSink &sink,
+                     QString *error = nullptr, const ProgressCallback &progress = ProgressCallback());
+    // data 通常为内存映射的镜像文件；按 chunkSize (向下对齐到扇区) 分块发送，末尾不足一个扇区时补零
+    // 下一块由后台线程经 BufferPipeline 预先从映射内存复制到另一个缓冲区，USB 传输不会因缺页而等待磁盘
+    bool programSectors(int lun, quint64 startSector, const uchar *data, qint64 size, qint64 chunkSize,
+                        QString *error = nullptr, const ProgressCallback &progress = ProgressCallback());
+    bool eraseSectors(int lun, quint64 startSector, quint64 sectorCount, QString *error = nullptr);
+
+    // 读取 LUN 上的 GPT 分区表
+    bool readPartitionTable(int lun, QList<FirehosePartition> &partitions, QString *error = nullptr);
+    bool reset(QString *error = nullptr);
+
+private:
+    struct Response {
+        bool ack = false;
+        QMap<QString, QString> attributes;
+        QString log;            // 应答前最后一条日志，NAK 时通常为失败原因
+    };
+
+    bool sendCommand(const QString &element, const QMap<QString, QString> &attributes, QString *error);
+    bool readResponse(Response &response, QString *error, int timeout = DEFAULT_TIMEOUT);
+    bool readRaw(char *data, qint64 size, QString *error);
+    bool writeAll(const char *data, qint64 size, QString *error);
+    QMap<QString, QString> sectorAttributes(int lun, quint64 startSector, quint64 sectorCount) const;
+
+    EdlTransport &m_transport;
+    QByteArray m_buffer;        // 已收到但尚未解析的数据
+    int m_sectorSize;
+    qint64 m_maxPayloadSize;
+};
+
+#endif // FIREHOSE_CLIENT_H
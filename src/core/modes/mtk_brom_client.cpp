@@ -0,0 +1,215 @@
+#include "mtk_brom_client.h"
+#include "mtk_transport.h"
+#include <QElapsedTimer>
+#include <QtEndian>
+#include <QDebug>
+#include <cstring>
+
+namespace {
+
+enum BromCommand : quint8 {
+    BROM_JUMP_DA = 0xd5,
+    BROM_SEND_DA = 0xd7,
+    BROM_GET_HW_CODE = 0xfd
+};
+
+const quint8 START_SEQUENCE[] = {0xa0, 0x0a, 0x50, 0x05};
+const int HANDSHAKE_READ_TIMEOUT = 100;
+const int READ_BUFFER_SIZE = 512;
+const qint64 UPLOAD_CHUNK_SIZE = 0x400;
+// 上传完成后的状态 0~3 均表示成功 (3 为未校验签名)
+const quint16 MAX_SUCCESS_STATUS = 3;
+
+void setError(QString *error, const QString &message)
+{
+    if (error) {
+        *error = message;
+    }
+}
+
+// 按小端 16 位字异或，奇数长度时最后一个字节单独异或
+quint16 dataChecksum(const char *data, qint64 size)
+{
+    quint16 checksum = 0;
+    qint64 i = 0;
+    for (; i + 1 < size; i += 2) {
+        checksum ^= qFromLittleEndian<quint16>(data + i);
+    }
+    if (i < size) {
+        checksum ^= static_cast<quint8>(data[i]);
+    }
+    return checksum;
+}
+
+} // namespace
+
+MtkBromClient::MtkBromClient(MtkTransport &transport)
+    : m_transport(transport)
+{
+}
+
+bool MtkBromClient::handshake(QString *error, int timeout)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    size_t index = 0;
+    while (index < sizeof(START_SEQUENCE)) {
+        if (timer.elapsed() > timeout) {
+            setError(error, "MTK handshake timed out");
+            return false;
+        }
+
+        const char out = static_cast<char>(START_SEQUENCE[index]);
+        char in = 0;
+        if (m_transport.write(&out, 1, HANDSHAKE_READ_TIMEOUT) != 1
+            || !readBytes(&in, 1, HANDSHAKE_READ_TIMEOUT)) {
+            index = 0;
+            m_pending.clear();
+            continue;
+        }
+
+        // 回复不符时从头开始，丢弃 Preloader 可能输出的其他内容
+        if (static_cast<quint8>(in) == static_cast<quint8>(~START_SEQUENCE[index])) {
+            ++index;
+        } else {
+            index = 0;
+            m_pending.clear();
+        }
+    }
+
+    qDebug() << "MTK handshake completed in" << timer.elapsed() << "ms";
+    return true;
+}
+
+bool MtkBromClient::getHwCode(quint16 &hwCode, QString *error)
+{
+    quint16 status = 0;
+    if (!echo(QByteArray(1, static_cast<char>(BROM_GET_HW_CODE)), error)
+        || !readWord(hwCode, error) || !readWord(status, error)) {
+        return false;
+    }
+    if (status != 0) {
+        setError(error, QString("MTK GET_HW_CODE failed, status 0x%1").arg(status, 4, 16, QChar('0')));
+        return false;
+    }
+    return true;
+}
+
+bool MtkBromClient::sendDa(quint32 address, const char *data, qint64 size, quint32 signatureLength,
+                           QString *error)
+{
+    quint16 status = 0;
+    if (!echo(QByteArray(1, static_cast<char>(BROM_SEND_DA)), error)
+        || !echo32(address, error)
+        || !echo32(static_cast<quint32>(size), error)
+        || !echo32(signatureLength, error)
+        || !readWord(status, error)) {
+        return false;
+    }
+    if (status > MAX_SUCCESS_STATUS) {
+        setError(error, QString("MTK SEND_DA rejected, status 0x%1").arg(status, 4, 16, QChar('0')));
+        return false;
+    }
+
+    for (qint64 offset = 0; offset < size; offset += UPLOAD_CHUNK_SIZE) {
+        if (!writeAll(data + offset, qMin(UPLOAD_CHUNK_SIZE, size - offset), error)) {
+            return false;
+        }
+    }
+
+    quint16 checksum = 0;
+    if (!readWord(checksum, error) || !readWord(status, error)) {
+        return false;
+    }
+    quint16 expected = dataChecksum(data, size);
+    if (checksum != expected) {
+        setError(error, QString("MTK DA checksum mismatch: device 0x%1, expected 0x%2")
+                 .arg(checksum, 4, 16, QChar('0')).arg(expected, 4, 16, QChar('0')));
+        return false;
+    }
+    if (status > MAX_SUCCESS_STATUS) {
+        setError(error, QString("MTK DA upload failed, status 0x%1").arg(status, 4, 16, QChar('0')));
+        return false;
+    }
+    return true;
+}
+
+bool MtkBromClient::jumpDa(quint32 address, QString *error)
+{
+    quint16 status = 0;
+    if (!echo(QByteArray(1, static_cast<char>(BROM_JUMP_DA)), error)
+        || !echo32(address, error) || !readWord(status, error)) {
+        return false;
+    }
+    if (status != 0) {
+        setError(error, QString("MTK JUMP_DA failed, status 0x%1").arg(status, 4, 16, QChar('0')));
+        return false;
+    }
+    return true;
+}
+
+bool MtkBromClient::readBytes(char *data, qint64 size, int timeout)
+{
+    while (m_pending.size() < size) {
+        char buffer[READ_BUFFER_SIZE];
+        qint64 received = m_transport.read(buffer, sizeof(buffer), timeout);
+        if (received <= 0) {
+            return false;
+        }
+        m_pending.append(buffer, static_cast<int>(received));
+    }
+    std::memcpy(data, m_pending.constData(), static_cast<size_t>(size));
+    m_pending.remove(0, static_cast<int>(size));
+    return true;
+}
+
+bool MtkBromClient::writeAll(const char *data, qint64 size, QString *error)
+{
+    while (size > 0) {
+        qint64 written = m_transport.write(data, size, DEFAULT_TIMEOUT);
+        if (written <= 0) {
+            setError(error, "MTK USB write failed");
+            return false;
+        }
+        data += written;
+        size -= written;
+    }
+    return true;
+}
+
+bool MtkBromClient::echo(const QByteArray &data, QString *error)
+{
+    if (!writeAll(data.constData(), data.size(), error)) {
+        return false;
+    }
+    QByteArray reply(data.size(), Qt::Uninitialized);
+    if (!readBytes(reply.data(), reply.size(), DEFAULT_TIMEOUT)) {
+        setError(error, "No echo from MTK device");
+        return false;
+    }
+    if (reply != data) {
+        setError(error, QString("MTK echo mismatch: sent %1, got %2")
+                 .arg(QString::fromLatin1(data.toHex()), QString::fromLatin1(reply.toHex())));
+        return false;
+    }
+    return true;
+}
+
+bool MtkBromClient::echo32(quint32 value, QString *error)
+{
+    char buffer[4];
+    qToBigEndian(value, buffer);
+    return echo(QByteArray(buffer, sizeof(buffer)), error);
+}
+
+bool MtkBromClient::readWord(quint16 &value, QString *error, int timeout)
+{
+    char buffer[2];
+    if (!readBytes(buffer, sizeof(buffer), timeout)) {
+        setError(error, "No response from MTK device");
+        return false;
+    }
+    value = qFromBigEndian<quint16>(buffer);
+    return true;
+}
@@ -0,0 +1,37 @@
+#ifndef MTK_BROM_CLIENT_H
+#define MTK_BROM_CLIENT_H
+
+#include <QByteArray>
+#include <QString>
+
+class MtkTransport;
+
+// BROM/Preloader 下载协议：握手后以单字节命令加大端参数通信，参数由设备原样回显
+// 用于读取芯片 HW code、上传 DA 第一阶段并跳转执行
+class MtkBromClient
+{
+public:
+    static const int DEFAULT_TIMEOUT = 5000;
+
+    explicit MtkBromClient(MtkTransport &transport);
+
+    // 发送 A0 0A 50 05，设备逐字节回复取反值；端口刚出现时可能尚未就绪，在 timeout 内反复尝试
+    bool handshake(QString *error = nullptr, int timeout = DEFAULT_TIMEOUT);
+    bool getHwCode(quint16 &hwCode, QString *error = nullptr);
+    // data 包含末尾 signatureLength 字节的签名
+    bool sendDa(quint32 address, const char *data, qint64 size, quint32 signatureLength,
+                QString *error = nullptr);
+    bool jumpDa(quint32 address, QString *error = nullptr);
+
+private:
+    bool readBytes(char *data, qint64 size, int timeout);
+    bool writeAll(const char *data, qint64 size, QString *error);
+    bool echo(const QByteArray &data, QString *error);
+    bool echo32(quint32 value, QString *error);
+    bool readWord(quint16 &value, QString *error, int timeout = DEFAULT_TIMEOUT);
+
+    MtkTransport &m_transport;
+    QByteArray m_pending;       // 一次读取中多收到的字节
+};
+
+#endif // MTK_BROM_CLIENT_H
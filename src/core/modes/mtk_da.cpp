@@ -1,5 +1,406 @@
 #include "mtk_da.h"
+#include "mtk_brom_client.h"
+#include <QElapsedTimer>
+#include <QFile>
+#include <QStringList>
+#include <QtEndian>
+#include <QDebug>
 
-MTKDA::MTKDA(QObject *parent) : QObject(parent)
+namespace {
+
+// DA 文件布局：头部标识，0x68 处为条目数，条目从 0x6c 开始，每个 0xdc 字节
+const char DA_FILE_MAGIC[] = "MTK_DOWNLOAD_AGENT";
+const qint64 DA_ENTRY_COUNT_OFFSET = 0x68;
+const qint64 DA_ENTRIES_OFFSET = 0x6c;
+const qint64 DA_ENTRY_SIZE = 0xdc;
+const quint16 DA_ENTRY_MAGIC = 0xdada;
+// 条目内：+0x02 芯片代码，+0x12 区段数，区段表从 +0x14 开始，每个区段 5 个 u32
+const int DA_ENTRY_HW_CODE = 0x02;
+const int DA_ENTRY_REGION_COUNT = 0x12;
+const int DA_ENTRY_REGIONS = 0x14;
+const int DA_REGION_SIZE = 20;
+// 区段 1 为 DA 第一阶段 (由 BROM 加载)，区段 2 为第二阶段
+const int DA1_REGION = 1;
+const int DA2_REGION = 2;
+
+void setError(QString *error, const QString &message)
+{
+    if (error) {
+        *error = message;
+    }
+}
+
+// 联发科原厂及部分 OEM 修改过 VID/PID 的下载端口
+const MTKDA::UsbId KNOWN_MTK_IDS[] = {
+    {0x0e8d, 0x0003, "MediaTek", MTKDA::STAGE_BROM},
+    {0x0fce, 0xf200, "Sony", MTKDA::STAGE_BROM},
+    {0x0e8d, 0x2000, "MediaTek", MTKDA::STAGE_PRELOADER},
+    {0x0e8d, 0x20ff, "MediaTek", MTKDA::STAGE_PRELOADER},
+    {0x0e8d, 0x6000, "MediaTek", MTKDA::STAGE_PRELOADER},
+    {0x1004, 0x6000, "LG", MTKDA::STAGE_PRELOADER},
+    {0x22d9, 0x0006, "OPPO", MTKDA::STAGE_PRELOADER},
+    {0x0e8d, 0x2001, "MediaTek", MTKDA::STAGE_DA},
+};
+
+struct DaRegion {
+    quint32 offset = 0;             // 在 DA 文件中的位置
+    quint32 length = 0;             // 含签名
+    quint32 startAddress = 0;       // 加载地址
+    quint32 signatureLength = 0;
+};
+
+bool readRegion(const uchar *entry, int index, qint64 fileSize, DaRegion &region)
 {
+    const uchar *data = entry + DA_ENTRY_REGIONS + index * DA_REGION_SIZE;
+    region.offset = qFromLittleEndian<quint32>(data);
+    region.length = qFromLittleEndian<quint32>(data + 4);
+    region.startAddress = qFromLittleEndian<quint32>(data + 8);
+    region.signatureLength = qFromLittleEndian<quint32>(data + 16);
+    return region.length > region.signatureLength
+        && static_cast<qint64>(region.offset) + region.length <= fileSize;
+}
+
+// 按芯片代码在 DA 文件中查找两个阶段的区段
+bool findDaRegions(const uchar *image, qint64 size, quint16 daCode, DaRegion &da1, DaRegion &da2,
+                   QString *error)
+{
+    if (size < DA_ENTRIES_OFFSET
+        || qstrncmp(reinterpret_cast<const char*>(image), DA_FILE_MAGIC, sizeof(DA_FILE_MAGIC) - 1) != 0) {
+        setError(error, "Not an MTK download agent file");
+        return false;
+    }
+
+    const quint32 count = qFromLittleEndian<quint32>(image + DA_ENTRY_COUNT_OFFSET);
+    QStringList available;
+    for (quint32 i = 0; i < count; ++i) {
+        const qint64 offset = DA_ENTRIES_OFFSET + i * DA_ENTRY_SIZE;
+        if (offset + DA_ENTRY_SIZE > size) {
+            break;
+        }
+        const uchar *entry = image + offset;
+        if (qFromLittleEndian<quint16>(entry) != DA_ENTRY_MAGIC) {
+            continue;
+        }
+
+        const quint16 hwCode = qFromLittleEndian<quint16>(entry + DA_ENTRY_HW_CODE);
+        if (hwCode != daCode) {
+            available.append(QString("0x%1").arg(hwCode, 4, 16, QChar('0')));
+            continue;
+        }
+        if (qFromLittleEndian<quint16>(entry + DA_ENTRY_REGION_COUNT) <= DA2_REGION
+            || !readRegion(entry, DA1_REGION, size, da1) || !readRegion(entry, DA2_REGION, size, da2)) {
+            setError(error, QString("Corrupt DA entry for chip 0x%1").arg(daCode, 4, 16, QChar('0')));
+            return false;
+        }
+        return true;
+    }
+
+    setError(error, QString("DA file has no entry for chip 0x%1 (available: %2)")
+             .arg(daCode, 4, 16, QChar('0')).arg(available.join(", ")));
+    return false;
+}
+
+} // namespace
+
+MTKDA::MTKDA(QObject *parent)
+    : PartitionDevice("MTK", parent)
+    , m_partitionsLoaded(false)
+{
+}
+
+MTKDA::~MTKDA()
+{
+    close();
+}
+
+bool MTKDA::open(const QString &portPath, QString *error)
+{
+    std::unique_ptr<UsbMtkTransport> transport = UsbMtkTransport::open(portPath, error);
+    if (!transport) {
+        return false;
+    }
+    open(std::move(transport));
+    return true;
+}
+
+void MTKDA::open(std::unique_ptr<MtkTransport> transport)
+{
+    close();
+    m_transport = std::move(transport);
+}
+
+void MTKDA::close()
+{
+    m_da.reset();
+    m_partitions.clear();
+    m_partitionsLoaded = false;
+    if (m_transport) {
+        m_transport->close();
+        m_transport.reset();
+    }
+}
+
+bool MTKDA::isOpen() const
+{
+    return m_transport != nullptr;
+}
+
+void MTKDA::setOptions(const Options &options)
+{
+    m_options = options;
+    if (m_da) {
+        m_da->setBufferCount(m_options.bufferCount);
+        m_da->setTransferSize(m_options.transferSize);
+    }
+}
+
+MTKDA::Options MTKDA::options() const
+{
+    return m_options;
+}
+
+qint64 MTKDA::transferSize() const
+{
+    return m_da ? m_da->transferSize() : 0;
+}
+
+bool MTKDA::loadDownloadAgent(const QString &daPath, QString *error)
+{
+    if (!m_transport) {
+        setError(error, "MTK device not open");
+        return false;
+    }
+
+    QFile file(daPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        setError(error, "Cannot open DA " + daPath + ": " + file.errorString());
+        return false;
+    }
+    uchar *image = file.map(0, file.size());
+    if (!image) {
+        setError(error, "Cannot map DA " + daPath);
+        return false;
+    }
+
+    m_da.reset();
+    m_partitions.clear();
+    m_partitionsLoaded = false;
+
+    MtkBromClient brom(*m_transport);
+    quint16 hwCode = 0;
+    DaRegion da1;
+    DaRegion da2;
+    bool ok = brom.handshake(error) && brom.getHwCode(hwCode, error);
+    if (ok) {
+        qDebug() << "MTK chip hw code" << QString("0x%1").arg(hwCode, 4, 16, QChar('0'));
+        ok = findDaRegions(image, file.size(), m_options.daCode ? m_options.daCode : hwCode, da1, da2, error)
+            && brom.sendDa(da1.startAddress, reinterpret_cast<const char*>(image + da1.offset),
+                           da1.length, da1.signatureLength, error)
+            && brom.jumpDa(da1.startAddress, error);
+    }
+
+    // DA 第一阶段在同一端点上切换为 XFlash 协议
+    std::unique_ptr<MtkDaClient> da;
+    if (ok) {
+        da.reset(new MtkDaClient(*m_transport));
+        da->setStorage(m_options.storageName.compare("ufs", Qt::CaseInsensitive) == 0
+                       ? MtkDaClient::STORAGE_UFS : MtkDaClient::STORAGE_EMMC);
+        da->setBufferCount(m_options.bufferCount);
+        da->setTransferSize(m_options.transferSize);
+        ok = da->initialize(error)
+            && da->bootTo(da2.startAddress, reinterpret_cast<const char*>(image + da2.offset),
+                          da2.length - da2.signatureLength, error)
+            && da->queryPacketLength(error);
+    }
+
+    file.unmap(image);
+    if (!ok) {
+        return false;
+    }
+    m_da = std::move(da);
+    return true;
+}
+
+bool MTKDA::findPartition(const QString &label, MtkPartition &partition, QString *error)
+{
+    return loadPartitions(error) && findByLabel(m_partitions, label, partition, error);
+}
+
+bool MTKDA::readPartition(const QString &label, const QString &outputPath, QString *error)
+{
+    MtkPartition partition;
+    if (!findPartition(label, partition, error)) {
+        return false;
+    }
+
+    QFile output(outputPath);
+    if (!output.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        setError(error, "Cannot create " + outputPath + ": " + output.errorString());
+        return false;
+    }
+
+    JobStats stats;
+    stats.operation = "read";
+    stats.partition = label;
+    QElapsedTimer timer;
+    timer.start();
+
+    // 写文件在 DA 客户端的写盘线程中进行，期间本线程不访问 output
+    bool ok = m_da->readData(partition.offset, partition.size,
+        [&output](const char *data, qint64 size) {
+            return output.write(data, size) == size;
+        }, error,
+        [this, &stats](qint64 done, qint64 total) {
+            stats.bytes = done;
+            emit progress("read", done, total);
+        });
+
+    if (ok && !output.flush()) {
+        setError(error, "Cannot write " + outputPath + ": " + output.errorString());
+        ok = false;
+    }
+    stats.elapsedMs = timer.elapsed();
+    finishJob(stats, ok);
+    return ok;
+}
+
+bool MTKDA::writePartition(const QString &label, const QString &imagePath, QString *error)
+{
+    MtkPartition partition;
+    if (!findPartition(label, partition, error)) {
+        return false;
+    }
+
+    QFile image(imagePath);
+    if (!image.open(QIODevice::ReadOnly)) {
+        setError(error, "Cannot open " + imagePath + ": " + image.errorString());
+        return false;
+    }
+    const qint64 size = image.size();
+    if (size == 0 || static_cast<quint64>(size) > partition.size) {
+        setError(error, QString("Image size %1 does not fit partition %2 (%3 bytes)")
+                 .arg(size).arg(label).arg(partition.size));
+        return false;
+    }
+
+    // 按扇区对齐写入长度，末尾由 DA 客户端补零
+    const qint64 sector = m_da->sectorSize();
+    const quint64 length = static_cast<quint64>((size + sector - 1) / sector * sector);
+
+    JobStats stats;
+    stats.operation = "write";
+    stats.partition = label;
+    QElapsedTimer timer;
+    timer.start();
+
+    // 镜像在 DA 客户端的预取线程中读取，期间本线程不访问 image
+    bool ok = m_da->writeData(partition.offset, length,
+        [&image](char *data, qint64 maxSize) {
+            return image.read(data, maxSize);
+        }, error,
+        [this, &stats](qint64 done, qint64 total) {
+            stats.bytes = done;
+            emit progress("write", done, total);
+        });
+
+    stats.elapsedMs = timer.elapsed();
+    finishJob(stats, ok);
+    return ok;
+}
+
+bool MTKDA::erasePartition(const QString &label, QString *error)
+{
+    MtkPartition partition;
+    if (!findPartition(label, partition, error)) {
+        return false;
+    }
+
+    JobStats stats;
+    stats.operation = "erase";
+    stats.partition = label;
+    QElapsedTimer timer;
+    timer.start();
+
+    bool ok = m_da->format(partition.offset, partition.size, error);
+    if (ok) {
+        stats.bytes = static_cast<qint64>(partition.size);
+    }
+
+    stats.elapsedMs = timer.elapsed();
+    finishJob(stats, ok);
+    return ok;
+}
+
+bool MTKDA::ensureDa(QString *error)
+{
+    if (!m_da) {
+        setError(error, "MTK download agent not loaded");
+        return false;
+    }
+    return true;
+}
+
+bool MTKDA::loadPartitions(QString *error)
+{
+    if (!ensureDa(error)) {
+        return false;
+    }
+    if (m_partitionsLoaded) {
+        return true;
+    }
+
+    QList<MtkPartition> partitions;
+    if (!m_da->readPartitionTable(partitions, error)) {
+        return false;
+    }
+
+    m_partitions = partitions;
+    m_partitionsLoaded = true;
+    qDebug() << "MTK partition table loaded:" << m_partitions.size() << "partitions";
+    return true;
+}
+
+QString MTKDA::jobDetail() const
+{
+    return m_da ? QString("transfer size %1").arg(transferSize()) : QString();
+}
+
+const MTKDA::UsbId *MTKDA::matchDevice(const UsbDeviceDescription &device)
+{
+    for (const UsbId &id : KNOWN_MTK_IDS) {
+        if (id.vendorId == device.vendorId && id.productId == device.productId) {
+            return &id;
+        }
+    }
+    return nullptr;
+}
+
+bool MTKDA::isMtkDevice(const UsbDeviceDescription &device)
+{
+    return matchDevice(device) != nullptr;
+}
+
+QString MTKDA::stageName(Stage stage)
+{
+    switch (stage) {
+    case STAGE_BROM: return "BROM";
+    case STAGE_PRELOADER: return "Preloader";
+    case STAGE_DA: return "DA";
+    }
+    return QString();
+}
+
+bool MTKDA::scanDevices(QList<UsbDeviceDescription> &devices)
+{
+    QList<UsbDeviceDescription> all;
+    if (!UsbContext::instance().devices(all)) {
+        return false;
+    }
+
+    for (const UsbDeviceDescription &device : std::as_const(all)) {
+        if (isMtkDevice(device)) {
+            devices.append(device);
+        }
+    }
+    return true;
 }
@@ -1,14 +1,85 @@
 #ifndef MTK_DA_H
 #define MTK_DA_H
 
-#include <QObject>
+#include <QList>
+#include <QString>
+#include <memory>
+#include "usb_context.h"
+#include "mtk_transport.h"
+#include "mtk_da_client.h"
+#include "partition_device.h"
 
-class MTKDA : public QObject
+// 联发科 BROM / Preloader / DA 下载端口
+// 握手后经 BROM 上传 DA，再以 XFlash DA 协议读写/格式化分区；所有操作同步执行，应在工作线程中调用
+class MTKDA : public PartitionDevice
 {
     Q_OBJECT
 
 public:
+    enum Stage {
+        STAGE_BROM,         // 芯片内置 BootROM
+        STAGE_PRELOADER,
+        STAGE_DA            // 已加载 Download Agent
+    };
+
+    // 已知的 MTK 下载端口 USB 标识
+    struct UsbId {
+        quint16 vendorId;
+        quint16 productId;
+        const char *vendorName;
+        Stage stage;
+    };
+
+    struct Options {
+        QString storageName = "emmc";
+        int bufferCount = MtkDaClient::DEFAULT_BUFFER_COUNT;
+        qint64 transferSize = MtkDaClient::DEFAULT_TRANSFER_SIZE;  // 初始值，传输中自动调整
+        // DA 文件中按芯片代码选择条目；与 BROM 报告的 HW code 不同时 (如 0x0766 对应 0x6765) 在此指定
+        quint16 daCode = 0;
+    };
+
     explicit MTKDA(QObject *parent = nullptr);
+    ~MTKDA();
+
+    // 按 USB 端口路径打开设备，或使用给定的传输层 (如本地回环模拟器)
+    bool open(const QString &portPath, QString *error = nullptr);
+    void open(std::unique_ptr<MtkTransport> transport);
+    void close();
+    bool isOpen() const;
+
+    void setOptions(const Options &options);
+    Options options() const;
+    // DA 客户端当前的传输大小 (随传输自动调整)，DA 未加载时为 0
+    qint64 transferSize() const;
+
+    // 握手、上传并启动 DA 两个阶段，之后即可读写分区
+    bool loadDownloadAgent(const QString &daPath, QString *error = nullptr);
+
+    bool findPartition(const QString &label, MtkPartition &partition, QString *error = nullptr);
+    // 分区数据经有界缓冲池直接写入文件，不在内存中累积
+    bool readPartition(const QString &label, const QString &outputPath, QString *error = nullptr);
+    bool writePartition(const QString &label, const QString &imagePath, QString *error = nullptr);
+    bool erasePartition(const QString &label, QString *error = nullptr);
+
+    // 只根据描述符判断，不打开设备
+    static const UsbId *matchDevice(const UsbDeviceDescription &device);
+    static bool isMtkDevice(const UsbDeviceDescription &device);
+    static QString stageName(Stage stage);
+
+    // 扫描当前连接的 MTK 下载端口，使用共享的 libusb 上下文和设备描述缓存
+    // BROM/Preloader 端口只存在几百毫秒，检测器还会直接处理热插拔事件，见 DeviceDetector
+    static bool scanDevices(QList<UsbDeviceDescription> &devices);
+
+private:
+    bool ensureDa(QString *error);
+    bool loadPartitions(QString *error);
+    QString jobDetail() const override;
+
+    std::unique_ptr<MtkTransport> m_transport;
+    std::unique_ptr<MtkDaClient> m_da;
+    Options m_options;
+    QList<MtkPartition> m_partitions;
+    bool m_partitionsLoaded;
 };
 
 #endif // MTK_DA_H
@@ -0,0 +1,603 @@
+#include "mtk_da_client.h"
+#include "mtk_transport.h"
+#include "gpt_parser.h"
+#include "buffer_pipeline.h"
+#include <QElapsedTimer>
+#include <QtEndian>
+#include <QDebug>
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+namespace {
+
+enum DaCommand : quint32 {
+    DA_FORMAT = 0x010003,
+    DA_WRITE_DATA = 0x010004,
+    DA_READ_DATA = 0x010005,
+    DA_BOOT_TO = 0x010008,
+    DA_DEVICE_CTRL = 0x010009,
+    DA_SETUP_ENVIRONMENT = 0x010100,
+    DA_SETUP_HW_INIT_PARAMS = 0x010101,
+    DA_GET_PACKET_LENGTH = 0x040007
+};
+
+const quint32 PACKET_MAGIC = 0xfeeeeeef;
+const quint32 DT_PROTOCOL_FLOW = 1;
+const quint32 SYNC_SIGNAL = 0x434e5953;
+const char DA_SYNC_CHAR = static_cast<char>(0xc0);
+const int HEADER_SIZE = 12;
+const quint32 MAX_PACKET_LENGTH = 16 * 1024 * 1024;
+
+// 不足一个 USB 包的读取先收进暂存区，避免设备一次发出的数据超过请求长度
+const qint64 USB_PACKET_SIZE = 512;
+const qint64 ADAPT_WINDOW = 8 * 1024 * 1024;
+const int FORMAT_TIMEOUT = 120000;
+
+// 环境参数：日志级别、日志通道 (UART)、主机系统、UFS provision
+const quint32 DA_LOG_LEVEL = 2;
+const quint32 DA_LOG_CHANNEL_UART = 1;
+const quint32 DA_SYSTEM_OS_LINUX = 1;
+
+// 用户区分区类型
+const quint32 EMMC_PART_USER = 8;
+const quint32 UFS_LU2 = 2;
+
+void setError(QString *error, const QString &message)
+{
+    if (error) {
+        *error = message;
+    }
+}
+
+void append32(QByteArray &data, quint32 value)
+{
+    char buffer[4];
+    qToLittleEndian(value, buffer);
+    data.append(buffer, sizeof(buffer));
+}
+
+void append64(QByteArray &data, quint64 value)
+{
+    char buffer[8];
+    qToLittleEndian(value, buffer);
+    data.append(buffer, sizeof(buffer));
+}
+
+// 写入数据包的校验和：字节累加取低 16 位
+quint32 packetChecksum(const char *data, qint64 size)
+{
+    quint32 sum = 0;
+    const uchar *bytes = reinterpret_cast<const uchar*>(data);
+    for (qint64 i = 0; i < size; ++i) {
+        sum += bytes[i];
+    }
+    return sum & 0xffff;
+}
+
+} // namespace
+
+MtkDaClient::MtkDaClient(MtkTransport &transport)
+    : m_transport(transport)
+    , m_storage(STORAGE_EMMC)
+    , m_readPacketLength(0x100000)
+    , m_writePacketLength(0x100000)
+    , m_bufferCount(DEFAULT_BUFFER_COUNT)
+    , m_transferSize(DEFAULT_TRANSFER_SIZE)
+    , m_bestTransferSize(DEFAULT_TRANSFER_SIZE)
+    , m_bestThroughput(0.0)
+    , m_windowBytes(0)
+    , m_windowNs(0)
+{
+}
+
+qint64 MtkDaClient::readPacketLength() const
+{
+    return m_readPacketLength;
+}
+
+qint64 MtkDaClient::writePacketLength() const
+{
+    return m_writePacketLength;
+}
+
+void MtkDaClient::setStorage(Storage storage)
+{
+    m_storage = storage;
+}
+
+MtkDaClient::Storage MtkDaClient::storage() const
+{
+    return m_storage;
+}
+
+int MtkDaClient::sectorSize() const
+{
+    return m_storage == STORAGE_UFS ? 4096 : 512;
+}
+
+void MtkDaClient::setBufferCount(int count)
+{
+    // 至少两个缓冲区才能让USB和磁盘重叠
+    m_bufferCount = qMax(2, count);
+}
+
+int MtkDaClient::bufferCount() const
+{
+    return m_bufferCount;
+}
+
+void MtkDaClient::setTransferSize(qint64 size)
+{
+    if (size < MIN_TRANSFER_SIZE) {
+        size = MIN_TRANSFER_SIZE;
+    } else if (size > MAX_TRANSFER_SIZE) {
+        size = MAX_TRANSFER_SIZE;
+    }
+    size = size / USB_PACKET_SIZE * USB_PACKET_SIZE;
+    m_transferSize = m_bestTransferSize = size;
+    m_bestThroughput = 0.0;
+    m_windowBytes = m_windowNs = 0;
+}
+
+qint64 MtkDaClient::transferSize() const
+{
+    return m_transferSize;
+}
+
+bool MtkDaClient::initialize(QString *error)
+{
+    char sync = 0;
+    if (!readExact(&sync, 1, error, DEFAULT_TIMEOUT)) {
+        return false;
+    }
+    if (sync != DA_SYNC_CHAR) {
+        setError(error, QString("Unexpected DA sync byte 0x%1").arg(static_cast<quint8>(sync), 2, 16, QChar('0')));
+        return false;
+    }
+
+    QByteArray environment;
+    append32(environment, DA_LOG_LEVEL);
+    append32(environment, DA_LOG_CHANNEL_UART);
+    append32(environment, DA_SYSTEM_OS_LINUX);
+    append32(environment, 0);
+    append32(environment, 0);
+    if (!sendCommand(DA_SETUP_ENVIRONMENT, error) || !sendParameter(environment, error)) {
+        return false;
+    }
+
+    QByteArray hwInit;
+    append32(hwInit, 0);
+    if (!sendCommand(DA_SETUP_HW_INIT_PARAMS, error) || !sendParameter(hwInit, error)) {
+        return false;
+    }
+
+    // 初始化完成后 DA 发出同步信号
+    QByteArray payload;
+    if (!xread(payload, error)) {
+        return false;
+    }
+    if (payload.size() < 4 || qFromLittleEndian<quint32>(payload.constData()) != SYNC_SIGNAL) {
+        setError(error, "DA did not send sync signal");
+        return false;
+    }
+    qDebug() << "MTK DA stage 1 ready";
+    return true;
+}
+
+bool MtkDaClient::bootTo(quint64 address, const char *data, qint64 size, QString *error)
+{
+    if (!sendCommand(DA_BOOT_TO, error)) {
+        return false;
+    }
+
+    // 地址和长度参数之后不回复状态，紧接着发送 DA 数据
+    QByteArray parameter;
+    append64(parameter, address);
+    append64(parameter, static_cast<quint64>(size));
+    if (!xsend(parameter.constData(), parameter.size(), error)
+        || !xsend(data, size, error)
+        || !expectStatus("BOOT_TO", error)) {
+        return false;
+    }
+    qDebug() << "MTK DA stage 2 started at" << QString("0x%1").arg(address, 0, 16);
+    return true;
+}
+
+bool MtkDaClient::queryPacketLength(QString *error)
+{
+    if (!sendCommand(DA_DEVICE_CTRL, error) || !sendCommand(DA_GET_PACKET_LENGTH, error)) {
+        return false;
+    }
+
+    QByteArray payload;
+    if (!xread(payload, error) || !expectStatus("GET_PACKET_LENGTH", error)) {
+        return false;
+    }
+    if (payload.size() < 8) {
+        setError(error, "Invalid DA packet length response");
+        return false;
+    }
+
+    m_writePacketLength = qFromLittleEndian<quint32>(payload.constData());
+    m_readPacketLength = qFromLittleEndian<quint32>(payload.constData() + 4);
+    qDebug() << "MTK DA packet length: write" << m_writePacketLength << "read" << m_readPacketLength;
+    return true;
+}
+
+bool MtkDaClient::readData(quint64 offset, quint64 length, const DataSink &sink,
+                           QString *error, const ProgressCallback &progress)
+{
+    if (!sendCommand(DA_READ_DATA, error) || !sendParameter(storageParameter(offset, length), error)) {
+        return false;
+    }
+
+    const qint64 total = static_cast<qint64>(length);
+    BufferPipeline pipeline(m_bufferCount, m_readPacketLength);
+    std::atomic<bool> sinkFailed(false);
+    std::thread writer([&pipeline, &sink, &sinkFailed]() {
+        int slot;
+        while (pipeline.take(slot)) {
+            if (!sink(pipeline.data(slot), pipeline.size(slot))) {
+                sinkFailed = true;
+                pipeline.abort();
+            }
+            pipeline.release(slot);
+        }
+    });
+
+    bool ok = true;
+    qint64 done = 0;
+    while (ok && done < total) {
+        quint32 packetLength = 0;
+        if (!readPacketHeader(packetLength, error, DEFAULT_TIMEOUT)) {
+            ok = false;
+            break;
+        }
+        if (packetLength == 0 || packetLength > static_cast<quint64>(total - done)) {
+            setError(error, QString("Invalid DA data packet length %1").arg(packetLength));
+            ok = false;
+            break;
+        }
+
+        int slot = pipeline.acquire();
+        if (slot < 0) {
+            ok = false;
+            break;
+        }
+
+        QElapsedTimer timer;
+        timer.start();
+        if (!readExact(pipeline.reserve(slot, packetLength), packetLength, error, DEFAULT_TIMEOUT)) {
+            reduceTransferSize();
+            ok = false;
+            break;
+        }
+        adaptTransferSize(packetLength, timer.nsecsElapsed());
+        pipeline.submit(slot, packetLength);
+        done += packetLength;
+
+        // 每个数据包都需确认后设备才发送下一个
+        if (!xsend32(0, error)) {
+            ok = false;
+            break;
+        }
+        if (progress) {
+            progress(done, total);
+        }
+    }
+
+    if (ok) {
+        pipeline.finish();
+    } else {
+        pipeline.abort();
+    }
+    writer.join();
+
+    if (sinkFailed) {
+        setError(error, "Read aborted");
+        return false;
+    }
+    return ok && expectStatus("READ_DATA", error);
+}
+
+bool MtkDaClient::writeData(quint64 offset, quint64 length, const DataSource &source,
+                            QString *error, const ProgressCallback &progress)
+{
+    if (!sendCommand(DA_WRITE_DATA, error) || !sendParameter(storageParameter(offset, length), error)) {
+        return false;
+    }
+
+    const qint64 total = static_cast<qint64>(length);
+    const qint64 packetSize = m_writePacketLength;
+    BufferPipeline pipeline(m_bufferCount, packetSize);
+    std::atomic<bool> sourceFailed(false);
+    std::thread reader([&pipeline, &source, &sourceFailed, total, packetSize]() {
+        for (qint64 filled = 0; filled < total;) {
+            int slot = pipeline.acquire();
+            if (slot < 0) {
+                return;
+            }
+
+            const qint64 size = qMin(packetSize, total - filled);
+            char *buffer = pipeline.reserve(slot, size);
+            qint64 received = 0;
+            while (received < size) {
+                qint64 count = source(buffer + received, size - received);
+                if (count < 0) {
+                    sourceFailed = true;
+                    pipeline.abort();
+                    return;
+                }
+                if (count == 0) {
+                    break;
+                }
+                received += count;
+            }
+            // 镜像末尾不足一个扇区的部分补零
+            std::memset(buffer + received, 0, static_cast<size_t>(size - received));
+
+            // 校验和也在预取线程中算好
+            pipeline.submit(slot, size, packetChecksum(buffer, size));
+            filled += size;
+        }
+        pipeline.finish();
+    });
+
+    bool ok = true;
+    qint64 done = 0;
+    int slot;
+    while (ok && pipeline.take(slot)) {
+        const qint64 size = pipeline.size(slot);
+        QElapsedTimer timer;
+        timer.start();
+        ok = xsend32(0, error)
+            && xsend32(pipeline.tag(slot), error)
+            && xsend(pipeline.data(slot), size, error);
+        if (ok) {
+            adaptTransferSize(size, timer.nsecsElapsed());
+            ok = expectStatus(QString("WRITE_DATA at offset %1").arg(offset + done), error);
+        } else {
+            reduceTransferSize();
+        }
+        pipeline.release(slot);
+
+        if (ok) {
+            done += size;
+            if (progress) {
+                progress(done, total);
+            }
+        }
+    }
+
+    if (!ok) {
+        pipeline.abort();
+    }
+    reader.join();
+
+    if (sourceFailed) {
+        setError(error, "Cannot read image data");
+        return false;
+    }
+    if (!ok) {
+        return false;
+    }
+    if (done < total) {
+        setError(error, "Write aborted");
+        return false;
+    }
+    return expectStatus("WRITE_DATA", error);
+}
+
+bool MtkDaClient::format(quint64 offset, quint64 length, QString *error)
+{
+    // 格式化大分区可能需要较长时间
+    return sendCommand(DA_FORMAT, error)
+        && sendParameter(storageParameter(offset, length), error)
+        && expectStatus("FORMAT", error, FORMAT_TIMEOUT);
+}
+
+bool MtkDaClient::readPartitionTable(QList<MtkPartition> &partitions, QString *error)
+{
+    auto collect = [](QByteArray &target) {
+        return [&target](const char *data, qint64 size) {
+            target.append(data, static_cast<int>(size));
+            return true;
+        };
+    };
+
+    // GPT 头位于 LBA 1
+    const quint64 sector = static_cast<quint64>(sectorSize());
+    QByteArray header;
+    if (!readData(sector, sector, collect(header), error)) {
+        return false;
+    }
+    GptParser::Header gpt;
+    if (!GptParser::parseHeader(header, gpt)) {
+        setError(error, "No valid GPT on user area");
+        return false;
+    }
+
+    QByteArray entries;
+    quint64 entriesLength = (gpt.entriesBytes() + sector - 1) / sector * sector;
+    if (!readData(gpt.entriesLba * sector, entriesLength, collect(entries), error)) {
+        return false;
+    }
+
+    for (const GptPartition &entry : GptParser::parseEntries(entries, gpt)) {
+        MtkPartition partition;
+        partition.label = entry.label;
+        partition.offset = entry.firstLba * sector;
+        partition.size = (entry.lastLba - entry.firstLba + 1) * sector;
+        partitions.append(partition);
+    }
+    return true;
+}
+
+bool MtkDaClient::sendCommand(quint32 command, QString *error)
+{
+    return xsend32(command, error)
+        && expectStatus(QString("command 0x%1").arg(command, 6, 16, QChar('0')), error);
+}
+
+bool MtkDaClient::sendParameter(const QByteArray &parameter, QString *error)
+{
+    return xsend(parameter.constData(), parameter.size(), error) && expectStatus("parameter", error);
+}
+
+bool MtkDaClient::xsend(const char *data, qint64 size, QString *error)
+{
+    QByteArray header;
+    append32(header, PACKET_MAGIC);
+    append32(header, DT_PROTOCOL_FLOW);
+    append32(header, static_cast<quint32>(size));
+    return writeAll(header.constData(), header.size(), error) && writeAll(data, size, error);
+}
+
+bool MtkDaClient::xsend32(quint32 value, QString *error)
+{
+    char buffer[4];
+    qToLittleEndian(value, buffer);
+    return xsend(buffer, sizeof(buffer), error);
+}
+
+bool MtkDaClient::xread(QByteArray &payload, QString *error, int timeout)
+{
+    quint32 length = 0;
+    if (!readPacketHeader(length, error, timeout)) {
+        return false;
+    }
+    payload.resize(static_cast<int>(length));
+    return readExact(payload.data(), length, error, timeout);
+}
+
+bool MtkDaClient::readPacketHeader(quint32 &length, QString *error, int timeout)
+{
+    char header[HEADER_SIZE];
+    if (!readExact(header, HEADER_SIZE, error, timeout)) {
+        return false;
+    }
+    if (qFromLittleEndian<quint32>(header) != PACKET_MAGIC) {
+        setError(error, "Invalid DA packet magic");
+        return false;
+    }
+    length = qFromLittleEndian<quint32>(header + 8);
+    if (length > MAX_PACKET_LENGTH) {
+        setError(error, QString("DA packet too large: %1 bytes").arg(length));
+        return false;
+    }
+    return true;
+}
+
+bool MtkDaClient::expectStatus(const QString &operation, QString *error, int timeout)
+{
+    QByteArray payload;
+    if (!xread(payload, error, timeout)) {
+        return false;
+    }
+
+    // 状态为 2 或 4 字节；同步信号也表示成功
+    quint32 status = 0xffffffff;
+    if (payload.size() == 2) {
+        status = qFromLittleEndian<quint16>(payload.constData());
+    } else if (payload.size() >= 4) {
+        status = qFromLittleEndian<quint32>(payload.constData());
+    }
+    if (status != 0 && status != SYNC_SIGNAL) {
+        setError(error, QString("DA %1 failed, status 0x%2").arg(operation).arg(status, 8, 16, QChar('0')));
+        return false;
+    }
+    return true;
+}
+
+bool MtkDaClient::readExact(char *data, qint64 size, QString *error, int timeout)
+{
+    qint64 done = qMin<qint64>(size, m_pending.size());
+    if (done > 0) {
+        std::memcpy(data, m_pending.constData(), static_cast<size_t>(done));
+        m_pending.remove(0, static_cast<int>(done));
+    }
+
+    while (done < size) {
+        const qint64 remaining = size - done;
+        qint64 received;
+        if (remaining < USB_PACKET_SIZE) {
+            char buffer[USB_PACKET_SIZE];
+            received = m_transport.read(buffer, sizeof(buffer), timeout);
+            if (received > 0) {
+                qint64 used = qMin(received, remaining);
+                std::memcpy(data + done, buffer, static_cast<size_t>(used));
+                m_pending.append(buffer + used, static_cast<int>(received - used));
+                received = used;
+            }
+        } else {
+            // 直接收进目标缓冲区，长度取 USB 包的整数倍
+            qint64 chunk = qMin(remaining, m_transferSize) / USB_PACKET_SIZE * USB_PACKET_SIZE;
+            received = m_transport.read(data + done, chunk, timeout);
+        }
+        if (received <= 0) {
+            setError(error, "DA data transfer timed out");
+            return false;
+        }
+        done += received;
+    }
+    return true;
+}
+
+bool MtkDaClient::writeAll(const char *data, qint64 size, QString *error)
+{
+    while (size > 0) {
+        qint64 written = m_transport.write(data, qMin(size, m_transferSize), DEFAULT_TIMEOUT);
+        if (written <= 0) {
+            setError(error, "MTK USB write failed");
+            return false;
+        }
+        data += written;
+        size -= written;
+    }
+    return true;
+}
+
+QByteArray MtkDaClient::storageParameter(quint64 offset, quint64 length) const
+{
+    QByteArray parameter;
+    append32(parameter, m_storage);
+    append32(parameter, m_storage == STORAGE_UFS ? UFS_LU2 : EMMC_PART_USER);
+    append64(parameter, offset);
+    append64(parameter, length);
+    return parameter;
+}
+
+void MtkDaClient::adaptTransferSize(qint64 bytes, qint64 elapsedNs)
+{
+    m_windowBytes += bytes;
+    m_windowNs += elapsedNs;
+    if (m_windowBytes < ADAPT_WINDOW) {
+        return;
+    }
+
+    const double throughput = static_cast<double>(m_windowBytes) / qMax<qint64>(m_windowNs, 1);
+    m_windowBytes = m_windowNs = 0;
+
+    // 提升超过 5% 才算更好，避免在噪声中来回切换
+    if (throughput > m_bestThroughput * 1.05) {
+        m_bestThroughput = throughput;
+        m_bestTransferSize = m_transferSize;
+        if (m_transferSize < MAX_TRANSFER_SIZE) {
+            m_transferSize *= 2;
+            qDebug() << "MTK transfer size increased to" << m_transferSize;
+        }
+    } else if (m_transferSize != m_bestTransferSize) {
+        m_transferSize = m_bestTransferSize;
+        qDebug() << "MTK transfer size settled at" << m_transferSize;
+    }
+}
+
+void MtkDaClient::reduceTransferSize()
+{
+    m_transferSize = m_transferSize / 2 > MIN_TRANSFER_SIZE ? m_transferSize / 2 : MIN_TRANSFER_SIZE;
+    m_bestTransferSize = m_transferSize;
+    m_bestThroughput = 0.0;
+    m_windowBytes = m_windowNs = 0;
+    qWarning() << "MTK transfer failed, transfer size reduced to" << m_transferSize;
+}
@@ -0,0 +1,104 @@
+#ifndef MTK_DA_CLIENT_H
+#define MTK_DA_CLIENT_H
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <functional>
+
+class MtkTransport;
+
+// GPT 中的一个分区，位置以字节计 (DA 读写命令使用字节地址)
+struct MtkPartition {
+    QString label;
+    quint64 offset = 0;
+    quint64 size = 0;
+};
+
+// XFlash DA 协议客户端：DA 第一阶段运行后，命令与数据均封装为
+// magic + 类型 + 长度的数据包，每条命令和参数后设备回复一个状态包
+class MtkDaClient
+{
+public:
+    enum Storage : quint32 {
+        STORAGE_EMMC = 0x01,
+        STORAGE_UFS = 0x30
+    };
+
+    static const int DEFAULT_TIMEOUT = 10000;
+    static const int DEFAULT_BUFFER_COUNT = 4;
+    static const qint64 DEFAULT_TRANSFER_SIZE = 256 * 1024;
+    static const qint64 MIN_TRANSFER_SIZE = 16 * 1024;
+    static const qint64 MAX_TRANSFER_SIZE = 4 * 1024 * 1024;
+
+    using ProgressCallback = std::function<void(qint64 done, qint64 total)>;
+    // 在写盘线程中调用，返回 false 时中止读取
+    using DataSink = std::function<bool(const char *data, qint64 size)>;
+    // 在预取线程中调用，返回读取的字节数，0 表示数据结束 (其余部分补零)，-1 表示出错
+    using DataSource = std::function<qint64(char *data, qint64 maxSize)>;
+
+    explicit MtkDaClient(MtkTransport &transport);
+
+    // BROM 跳转到 DA 第一阶段后调用：等待同步字节并完成环境和硬件初始化
+    bool initialize(QString *error = nullptr);
+    // 上传并启动 DA 第二阶段 (data 不含签名)
+    bool bootTo(quint64 address, const char *data, qint64 size, QString *error = nullptr);
+    // 查询设备每个数据包的读写长度，读写分区前调用
+    bool queryPacketLength(QString *error = nullptr);
+    qint64 readPacketLength() const;
+    qint64 writePacketLength() const;
+
+    // 选择目标存储的用户区；eMMC 为 512 字节扇区，UFS 为 4096
+    void setStorage(Storage storage);
+    Storage storage() const;
+    int sectorSize() const;
+
+    // 读写时在USB和磁盘之间轮转的缓冲区个数，决定流水线深度和内存上限
+    void setBufferCount(int count);
+    int bufferCount() const;
+    // 单次USB批量传输的大小；读写过程中按实测吞吐量自动调整，传输失败时减半
+    void setTransferSize(qint64 size);
+    qint64 transferSize() const;
+
+    // 数据包由调用线程从USB收取，写盘在另一线程中进行，两者通过有界缓冲池衔接
+    bool readData(quint64 offset, quint64 length, const DataSink &sink,
+                  QString *error = nullptr, const ProgressCallback &progress = ProgressCallback());
+    // 下一个数据包由预取线程从 source 读入空闲缓冲区，与当前包的USB传输重叠
+    bool writeData(quint64 offset, quint64 length, const DataSource &source,
+                   QString *error = nullptr, const ProgressCallback &progress = ProgressCallback());
+    bool format(quint64 offset, quint64 length, QString *error = nullptr);
+
+    // 读取用户区的 GPT 分区表
+    bool readPartitionTable(QList<MtkPartition> &partitions, QString *error = nullptr);
+
+private:
+    bool sendCommand(quint32 command, QString *error);
+    bool sendParameter(const QByteArray &parameter, QString *error);
+    bool xsend(const char *data, qint64 size, QString *error);
+    bool xsend32(quint32 value, QString *error);
+    bool xread(QByteArray &payload, QString *error, int timeout = DEFAULT_TIMEOUT);
+    bool readPacketHeader(quint32 &length, QString *error, int timeout);
+    bool expectStatus(const QString &operation, QString *error, int timeout = DEFAULT_TIMEOUT);
+    bool readExact(char *data, qint64 size, QString *error, int timeout);
+    bool writeAll(const char *data, qint64 size, QString *error);
+    QByteArray storageParameter(quint64 offset, quint64 length) const;
+
+    void adaptTransferSize(qint64 bytes, qint64 elapsedNs);
+    void reduceTransferSize();
+
+    MtkTransport &m_transport;
+    QByteArray m_pending;       // 一次读取中多收到的字节
+    Storage m_storage;
+    qint64 m_readPacketLength;
+    qint64 m_writePacketLength;
+    int m_bufferCount;
+
+    // 传输大小的爬山调整：吞吐量提升则继续加倍，否则退回到最好的大小
+    qint64 m_transferSize;
+    qint64 m_bestTransferSize;
+    double m_bestThroughput;
+    qint64 m_windowBytes;
+    qint64 m_windowNs;
+};
+
+#endif // MTK_DA_CLIENT_H
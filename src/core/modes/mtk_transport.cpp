@@ -0,0 +1,207 @@
+#include "mtk_transport.h"
+#include "mtk_da.h"
+#include "usb_context.h"
+#include <QDebug>
+#include <libusb.h>
+
+namespace {
+
+const quint8 CDC_COMM_CLASS = 0x02;
+const quint8 CDC_DATA_CLASS = 0x0a;
+const quint8 CDC_SET_LINE_CODING = 0x20;
+const quint8 CDC_SET_CONTROL_LINE_STATE = 0x22;
+const int CONTROL_TIMEOUT = 1000;
+
+unsigned int libusbTimeout(int timeout)
+{
+    // libusb 以 0 表示不超时
+    return timeout < 0 ? 0u : static_cast<unsigned int>(timeout);
+}
+
+void setError(QString *error, const QString &message)
+{
+    if (error) {
+        *error = message;
+    }
+}
+
+// 查找 CDC 通信接口和带一对批量端点的数据接口；部分 DA 端口只有一个厂商接口
+bool findInterfaces(libusb_device *device, int &controlInterface, int &dataInterface,
+                    quint8 &inEndpoint, quint8 &outEndpoint)
+{
+    libusb_config_descriptor *config = nullptr;
+    if (libusb_get_active_config_descriptor(device, &config) != LIBUSB_SUCCESS || !config) {
+        return false;
+    }
+
+    controlInterface = -1;
+    dataInterface = -1;
+    for (int i = 0; i < config->bNumInterfaces; ++i) {
+        const libusb_interface &iface = config->interface[i];
+        for (int alt = 0; alt < iface.num_altsetting; ++alt) {
+            const libusb_interface_descriptor &setting = iface.altsetting[alt];
+            if (setting.bInterfaceClass == CDC_COMM_CLASS && controlInterface < 0) {
+                controlInterface = setting.bInterfaceNumber;
+                continue;
+            }
+            if (dataInterface >= 0
+                || (setting.bInterfaceClass != CDC_DATA_CLASS
+                    && setting.bInterfaceClass != LIBUSB_CLASS_VENDOR_SPEC)) {
+                continue;
+            }
+
+            inEndpoint = outEndpoint = 0;
+            for (int e = 0; e < setting.bNumEndpoints; ++e) {
+                const libusb_endpoint_descriptor &endpoint = setting.endpoint[e];
+                if ((endpoint.bmAttributes & LIBUSB_TRANSFER_TYPE_MASK) != LIBUSB_TRANSFER_TYPE_BULK) {
+                    continue;
+                }
+                if (endpoint.bEndpointAddress & LIBUSB_ENDPOINT_IN) {
+                    inEndpoint = endpoint.bEndpointAddress;
+                } else {
+                    outEndpoint = endpoint.bEndpointAddress;
+                }
+            }
+            if (inEndpoint && outEndpoint) {
+                dataInterface = setting.bInterfaceNumber;
+            }
+        }
+    }
+    libusb_free_config_descriptor(config);
+    return dataInterface >= 0;
+}
+
+} // namespace
+
+UsbMtkTransport::UsbMtkTransport(libusb_device_handle *handle, int controlInterface, int dataInterface,
+                                 quint8 inEndpoint, quint8 outEndpoint)
+    : m_handle(handle)
+    , m_controlInterface(controlInterface)
+    , m_dataInterface(dataInterface)
+    , m_inEndpoint(inEndpoint)
+    , m_outEndpoint(outEndpoint)
+{
+}
+
+UsbMtkTransport::~UsbMtkTransport()
+{
+    close();
+}
+
+std::unique_ptr<UsbMtkTransport> UsbMtkTransport::open(const QString &portPath, QString *error)
+{
+    libusb_context *ctx = UsbContext::instance().context();
+    if (!ctx) {
+        setError(error, "libusb not available");
+        return nullptr;
+    }
+
+    libusb_device **list = nullptr;
+    ssize_t count = libusb_get_device_list(ctx, &list);
+    if (count < 0) {
+        setError(error, QString("Cannot list USB devices: %1").arg(libusb_error_name(static_cast<int>(count))));
+        return nullptr;
+    }
+
+    libusb_device *target = nullptr;
+    for (ssize_t i = 0; i < count; ++i) {
+        UsbDeviceDescription description;
+        if (UsbContext::describeDevice(list[i], description)
+            && description.portPath == portPath && MTKDA::isMtkDevice(description)) {
+            target = list[i];
+            break;
+        }
+    }
+
+    std::unique_ptr<UsbMtkTransport> transport;
+    int controlInterface = -1;
+    int dataInterface = -1;
+    quint8 inEndpoint = 0;
+    quint8 outEndpoint = 0;
+    if (!target) {
+        setError(error, "No MTK download port on " + portPath);
+    } else if (!findInterfaces(target, controlInterface, dataInterface, inEndpoint, outEndpoint)) {
+        setError(error, "MTK port has no bulk data interface");
+    } else {
+        libusb_device_handle *handle = nullptr;
+        int result = libusb_open(target, &handle);
+        if (result != LIBUSB_SUCCESS) {
+            setError(error, QString("Cannot open MTK port: %1").arg(libusb_error_name(result)));
+        } else {
+            // 从 cdc_acm 驱动接管接口
+            libusb_set_auto_detach_kernel_driver(handle, 1);
+            if (controlInterface >= 0 && libusb_claim_interface(handle, controlInterface) != LIBUSB_SUCCESS) {
+                controlInterface = -1;
+            }
+            result = libusb_claim_interface(handle, dataInterface);
+            if (result != LIBUSB_SUCCESS) {
+                setError(error, QString("Cannot claim MTK data interface: %1").arg(libusb_error_name(result)));
+                if (controlInterface >= 0) {
+                    libusb_release_interface(handle, controlInterface);
+                }
+                libusb_close(handle);
+            } else {
+                if (controlInterface >= 0) {
+                    // 115200 8N1 并置位 DTR/RTS，部分 BROM 在此之前不响应握手
+                    unsigned char lineCoding[7] = {0x00, 0xc2, 0x01, 0x00, 0x00, 0x00, 0x08};
+                    libusb_control_transfer(handle, LIBUSB_REQUEST_TYPE_CLASS | LIBUSB_RECIPIENT_INTERFACE,
+                                            CDC_SET_LINE_CODING, 0, static_cast<uint16_t>(controlInterface),
+                                            lineCoding, sizeof(lineCoding), CONTROL_TIMEOUT);
+                    libusb_control_transfer(handle, LIBUSB_REQUEST_TYPE_CLASS | LIBUSB_RECIPIENT_INTERFACE,
+                                            CDC_SET_CONTROL_LINE_STATE, 0x03, static_cast<uint16_t>(controlInterface),
+                                            nullptr, 0, CONTROL_TIMEOUT);
+                }
+                transport.reset(new UsbMtkTransport(handle, controlInterface, dataInterface,
+                                                    inEndpoint, outEndpoint));
+            }
+        }
+    }
+
+    libusb_free_device_list(list, 1);
+    return transport;
+}
+
+qint64 UsbMtkTransport::write(const char *data, qint64 size, int timeout)
+{
+    if (!m_handle) {
+        return -1;
+    }
+
+    int transferred = 0;
+    int result = libusb_bulk_transfer(m_handle, m_outEndpoint,
+                                      reinterpret_cast<unsigned char*>(const_cast<char*>(data)),
+                                      static_cast<int>(size), &transferred, libusbTimeout(timeout));
+    if (result != LIBUSB_SUCCESS) {
+        qWarning() << "MTK USB write failed:" << libusb_error_name(result);
+        return -1;
+    }
+    return transferred;
+}
+
+qint64 UsbMtkTransport::read(char *data, qint64 maxSize, int timeout)
+{
+    if (!m_handle) {
+        return -1;
+    }
+
+    int transferred = 0;
+    int result = libusb_bulk_transfer(m_handle, m_inEndpoint,
+                                      reinterpret_cast<unsigned char*>(data),
+                                      static_cast<int>(maxSize), &transferred, libusbTimeout(timeout));
+    if (result != LIBUSB_SUCCESS) {
+        return -1;
+    }
+    return transferred;
+}
+
+void UsbMtkTransport::close()
+{
+    if (m_handle) {
+        libusb_release_interface(m_handle, m_dataInterface);
+        if (m_controlInterface >= 0) {
+            libusb_release_interface(m_handle, m_controlInterface);
+        }
+        libusb_close(m_handle);
+        m_handle = nullptr;
+    }
+}
@@ -0,0 +1,46 @@
+#ifndef MTK_TRANSPORT_H
+#define MTK_TRANSPORT_H
+
+#include <QString>
+#include <memory>
+
+struct libusb_device_handle;
+
+// MTK 下载端口传输层 (BROM/Preloader/DA 共用)
+// USB 实现见 UsbMtkTransport，也可替换为在本地回环中模拟协议的设备
+class MtkTransport
+{
+public:
+    virtual ~MtkTransport() = default;
+
+    // 返回实际传输的字节数，出错返回 -1
+    virtual qint64 write(const char *data, qint64 size, int timeout) = 0;
+    virtual qint64 read(char *data, qint64 maxSize, int timeout) = 0;
+    virtual void close() = 0;
+};
+
+// BROM/Preloader 以 CDC ACM 串口枚举，通过数据接口的批量端点通信
+class UsbMtkTransport : public MtkTransport
+{
+public:
+    ~UsbMtkTransport() override;
+
+    // 按 USB 端口路径 (与 DeviceDetector 中 MTK 设备的标识一致) 打开设备
+    static std::unique_ptr<UsbMtkTransport> open(const QString &portPath, QString *error = nullptr);
+
+    qint64 write(const char *data, qint64 size, int timeout) override;
+    qint64 read(char *data, qint64 maxSize, int timeout) override;
+    void close() override;
+
+private:
+    UsbMtkTransport(libusb_device_handle *handle, int controlInterface, int dataInterface,
+                    quint8 inEndpoint, quint8 outEndpoint);
+
+    libusb_device_handle *m_handle;
+    int m_controlInterface;
+    int m_dataInterface;
+    quint8 m_inEndpoint;
+    quint8 m_outEndpoint;
+};
+
+#endif // MTK_TRANSPORT_H
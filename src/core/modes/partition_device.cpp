@@ -0,0 +1,36 @@
+#include "partition_device.h"
+#include <QDebug>
+
+PartitionDevice::PartitionDevice(const QString &logName, QObject *parent)
+    : QObject(parent)
+    , m_logName(logName)
+{
+}
+
+double PartitionDevice::JobStats::throughputMBps() const
+{
+    return elapsedMs > 0 ? (bytes / (1024.0 * 1024.0)) / (elapsedMs / 1000.0) : 0.0;
+}
+
+PartitionDevice::JobStats PartitionDevice::lastJob() const
+{
+    return m_lastJob;
+}
+
+QString PartitionDevice::jobDetail() const
+{
+    return QString();
+}
+
+void PartitionDevice::finishJob(const JobStats &stats, bool success)
+{
+    m_lastJob = stats;
+    const QString detail = jobDetail();
+    qDebug().noquote() << QString("%1 %2 %3 %4: %5 bytes in %6 ms (%7 MB/s%8)")
+        .arg(m_logName, stats.operation, stats.partition, success ? "succeeded" : "failed")
+        .arg(stats.bytes)
+        .arg(stats.elapsedMs)
+        .arg(stats.throughputMBps(), 0, 'f', 1)
+        .arg(detail.isEmpty() ? QString() : ", " + detail);
+    emit jobFinished(stats.operation, stats.partition, success, stats.bytes, stats.elapsedMs);
+}
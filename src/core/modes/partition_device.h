@@ -0,0 +1,62 @@
+#ifndef PARTITION_DEVICE_H
+#define PARTITION_DEVICE_H
+
+#include <QList>
+#include <QObject>
+#include <QString>
+
+// 按分区读写的下载模式 (EDL、MTK DA) 的公共部分：作业统计、完成通知和按名称查找分区
+class PartitionDevice : public QObject
+{
+    Q_OBJECT
+
+public:
+    // 一次分区读写作业的统计
+    struct JobStats {
+        QString operation;
+        QString partition;
+        qint64 bytes = 0;
+        qint64 elapsedMs = 0;
+
+        double throughputMBps() const;
+    };
+
+    JobStats lastJob() const;
+
+signals:
+    void progress(const QString &operation, qint64 done, qint64 total);
+    void jobFinished(const QString &operation, const QString &partition, bool success,
+                     qint64 bytes, qint64 elapsedMs);
+
+protected:
+    // logName 为日志中的模式名，如 "EDL"
+    PartitionDevice(const QString &logName, QObject *parent);
+
+    // 保存统计、输出日志并发出 jobFinished
+    void finishJob(const JobStats &stats, bool success);
+    // 附加在作业日志末尾的模式相关信息
+    virtual QString jobDetail() const;
+
+    // Partition 须有 label 成员
+    template <typename Partition>
+    static bool findByLabel(const QList<Partition> &partitions, const QString &label,
+                            Partition &partition, QString *error)
+    {
+        for (const Partition &candidate : partitions) {
+            if (candidate.label == label) {
+                partition = candidate;
+                return true;
+            }
+        }
+        if (error) {
+            *error = "Partition not found: " + label;
+        }
+        return false;
+    }
+
+private:
+    QString m_logName;
+    JobStats m_lastJob;
+};
+
+#endif // PARTITION_DEVICE_H
@@ -0,0 +1,201 @@
+#include "sahara_client.h"
+#include "edl_transport.h"
+#include <QtEndian>
+#include <QDebug>
+
+namespace {
+
+// 命令码 (小端 u32 cmd + u32 length 包头)
+enum SaharaCommand : quint32 {
+    SAHARA_HELLO = 0x01,
+    SAHARA_HELLO_RESP = 0x02,
+    SAHARA_READ_DATA = 0x03,
+    SAHARA_END_IMAGE_TX = 0x04,
+    SAHARA_DONE = 0x05,
+    SAHARA_DONE_RESP = 0x06,
+    SAHARA_RESET = 0x07,
+    SAHARA_READ_DATA_64 = 0x12
+};
+
+const quint32 SAHARA_VERSION = 2;
+const quint32 SAHARA_VERSION_COMPATIBLE = 1;
+const quint32 SAHARA_MODE_IMAGE_TX_PENDING = 0;
+const quint32 SAHARA_STATUS_SUCCESS = 0;
+const quint32 SAHARA_IMAGE_TX_COMPLETE = 1;
+const int HEADER_SIZE = 8;
+const int HELLO_RESP_SIZE = 0x30;
+const int MAX_PACKET_SIZE = 4096;
+
+void setError(QString *error, const QString &message)
+{
+    if (error) {
+        *error = message;
+    }
+}
+
+quint32 field32(const QByteArray &packet, int offset)
+{
+    return offset + 4 <= packet.size()
+        ? qFromLittleEndian<quint32>(packet.constData() + offset) : 0;
+}
+
+quint64 field64(const QByteArray &packet, int offset)
+{
+    return offset + 8 <= packet.size()
+        ? qFromLittleEndian<quint64>(packet.constData() + offset) : 0;
+}
+
+void append32(QByteArray &packet, quint32 value)
+{
+    char buffer[4];
+    qToLittleEndian(value, buffer);
+    packet.append(buffer, sizeof(buffer));
+}
+
+} // namespace
+
+SaharaClient::SaharaClient(EdlTransport &transport)
+    : m_transport(transport)
+    , m_deviceVersion(0)
+{
+}
+
+quint32 SaharaClient::deviceVersion() const
+{
+    return m_deviceVersion;
+}
+
+bool SaharaClient::uploadImage(const uchar *image, qint64 size, QString *error, int timeout)
+{
+    QByteArray packet;
+    for (;;) {
+        if (!readPacket(packet, timeout, error)) {
+            return false;
+        }
+
+        switch (field32(packet, 0)) {
+        case SAHARA_HELLO:
+            // 包头之后依次为 version, version_compatible, max_cmd_len, mode
+            m_deviceVersion = field32(packet, 8);
+            qDebug() << "Sahara HELLO, version" << m_deviceVersion << "mode" << field32(packet, 20);
+            if (!sendHelloResponse(SAHARA_MODE_IMAGE_TX_PENDING, timeout, error)) {
+                return false;
+            }
+            break;
+
+        case SAHARA_READ_DATA:
+            // image_id, offset, length 均为 u32
+            if (!sendImageData(image, size, field32(packet, 12), field32(packet, 16), timeout, error)) {
+                return false;
+            }
+            break;
+
+        case SAHARA_READ_DATA_64:
+            // image_id, offset, length 均为 u64
+            if (!sendImageData(image, size, field64(packet, 16), field64(packet, 24), timeout, error)) {
+                return false;
+            }
+            break;
+
+        case SAHARA_END_IMAGE_TX: {
+            quint32 status = field32(packet, 12);
+            if (status != SAHARA_STATUS_SUCCESS) {
+                setError(error, QString("Sahara image transfer failed, status 0x%1").arg(status, 0, 16));
+                return false;
+            }
+            QByteArray done;
+            append32(done, SAHARA_DONE);
+            append32(done, HEADER_SIZE);
+            if (!writePacket(done, timeout, error)) {
+                return false;
+            }
+            break;
+        }
+
+        case SAHARA_DONE_RESP:
+            if (field32(packet, 8) != SAHARA_IMAGE_TX_COMPLETE) {
+                setError(error, "Sahara reported image transfer still pending");
+                return false;
+            }
+            qDebug() << "Sahara programmer upload complete";
+            return true;
+
+        default:
+            setError(error, QString("Unexpected Sahara command 0x%1").arg(field32(packet, 0), 0, 16));
+            return false;
+        }
+    }
+}
+
+bool SaharaClient::readPacket(QByteArray &packet, int timeout, QString *error)
+{
+    // 设备每个命令包一次发出，包长超过单次读取时继续读完
+    packet.resize(MAX_PACKET_SIZE);
+    qint64 received = m_transport.read(packet.data(), packet.size(), timeout);
+    if (received < HEADER_SIZE) {
+        setError(error, "No Sahara packet from device");
+        return false;
+    }
+    packet.resize(static_cast<int>(received));
+
+    quint32 length = field32(packet, 4);
+    if (length < static_cast<quint32>(HEADER_SIZE) || length > static_cast<quint32>(MAX_PACKET_SIZE)) {
+        setError(error, QString("Invalid Sahara packet length %1").arg(length));
+        return false;
+    }
+    while (static_cast<quint32>(packet.size()) < length) {
+        char buffer[MAX_PACKET_SIZE];
+        qint64 more = m_transport.read(buffer, length - packet.size(), timeout);
+        if (more <= 0) {
+            setError(error, "Truncated Sahara packet");
+            return false;
+        }
+        packet.append(buffer, static_cast<int>(more));
+    }
+    return true;
+}
+
+bool SaharaClient::writePacket(const QByteArray &packet, int timeout, QString *error)
+{
+    if (m_transport.write(packet.constData(), packet.size(), timeout) != packet.size()) {
+        setError(error, "Failed to send Sahara packet");
+        return false;
+    }
+    return true;
+}
+
+bool SaharaClient::sendHelloResponse(quint32 mode, int timeout, QString *error)
+{
+    QByteArray response;
+    append32(response, SAHARA_HELLO_RESP);
+    append32(response, HELLO_RESP_SIZE);
+    append32(response, SAHARA_VERSION);
+    append32(response, SAHARA_VERSION_COMPATIBLE);
+    append32(response, SAHARA_STATUS_SUCCESS);
+    append32(response, mode);
+    response.append(HELLO_RESP_SIZE - response.size(), '\0');
+    return writePacket(response, timeout, error);
+}
+
+bool SaharaClient::sendImageData(const uchar *image, qint64 size, quint64 offset, quint64 length,
+                                 int timeout, QString *error)
+{
+    if (offset > static_cast<quint64>(size) || length > static_cast<quint64>(size) - offset) {
+        setError(error, QString("Sahara requested %1 bytes at offset %2 beyond programmer size %3")
+                 .arg(length).arg(offset).arg(size));
+        return false;
+    }
+
+    const char *data = reinterpret_cast<const char*>(image + offset);
+    qint64 remaining = static_cast<qint64>(length);
+    while (remaining > 0) {
+        qint64 written = m_transport.write(data, remaining, timeout);
+        if (written <= 0) {
+            setError(error, "Failed to send programmer data");
+            return false;
+        }
+        data += written;
+        remaining -= written;
+    }
+    return true;
+}
@@ -0,0 +1,35 @@
+#ifndef SAHARA_CLIENT_H
+#define SAHARA_CLIENT_H
+
+#include <QByteArray>
+#include <QString>
+
+class EdlTransport;
+
+// Sahara 协议：9008 设备上电后由 PBL 发出 HELLO，主机按设备请求的偏移和长度
+// 逐段发送 programmer (firehose 引导程序)，完成后设备跳转执行并切换到 Firehose 协议
+class SaharaClient
+{
+public:
+    static const int DEFAULT_TIMEOUT = 5000;
+
+    explicit SaharaClient(EdlTransport &transport);
+
+    // image 在上传期间必须保持有效，通常为内存映射的 programmer 文件
+    bool uploadImage(const uchar *image, qint64 size, QString *error = nullptr, int timeout = DEFAULT_TIMEOUT);
+
+    // 最近一次 HELLO 中设备报告的协议版本
+    quint32 deviceVersion() const;
+
+private:
+    bool readPacket(QByteArray &packet, int timeout, QString *error);
+    bool writePacket(const QByteArray &packet, int timeout, QString *error);
+    bool sendHelloResponse(quint32 mode, int timeout, QString *error);
+    bool sendImageData(const uchar *image, qint64 size, quint64 offset, quint64 length,
+                       int timeout, QString *error);
+
+    EdlTransport &m_transport;
+    quint32 m_deviceVersion;
+};
+
+#endif // SAHARA_CLIENT_H
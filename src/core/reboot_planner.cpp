@@ -0,0 +1,157 @@
+#include "reboot_planner.h"
+
+namespace {
+
+// 节点按重启目标编号：设备所处的模式以能到达它的 RestartMode 表示
+const int NODE_COUNT = RestartTool::MODE_SHUTDOWN + 1;
+const int UNREACHABLE = 0x3fffffff;
+
+struct Transition {
+    int costMs;                     // 估计的重启耗时，0 表示不支持
+    const char *fastbootCommand;    // 源模式为 fastboot/fastbootd 时发送的命令；ADB 的命令由 RestartTool 按Root状态生成
+};
+
+// 行：当前模式；列：重启目标。恢复模式检测不到、EDL 需要 programmer、关机后无法操作，均无出边
+constexpr Transition TRANSITIONS[NODE_COUNT][NODE_COUNT] = {
+    // 系统 (ADB)
+    { {45000, nullptr}, {25000, nullptr}, {12000, nullptr}, {25000, nullptr}, {8000, nullptr}, {5000, nullptr} },
+    // 恢复模式
+    { {0, nullptr}, {0, nullptr}, {0, nullptr}, {0, nullptr}, {0, nullptr}, {0, nullptr} },
+    // 引导程序 (Fastboot)
+    { {40000, "reboot"}, {20000, "reboot-recovery"}, {8000, "reboot-bootloader"}, {20000, "reboot-fastboot"},
+      {0, nullptr}, {5000, "shutdown"} },
+    // Fastbootd
+    { {40000, "reboot"}, {20000, "reboot-recovery"}, {10000, "reboot-bootloader"}, {20000, "reboot-fastboot"},
+      {0, nullptr}, {5000, "shutdown"} },
+    // EDL
+    { {0, nullptr}, {0, nullptr}, {0, nullptr}, {0, nullptr}, {0, nullptr}, {0, nullptr} },
+    // 关机
+    { {0, nullptr}, {0, nullptr}, {0, nullptr}, {0, nullptr}, {0, nullptr}, {0, nullptr} }
+};
+
+constexpr int sourceNode(DeviceDetector::DeviceMode mode)
+{
+    switch (mode) {
+    case DeviceDetector::MODE_ADB: return RestartTool::MODE_SYSTEM;
+    case DeviceDetector::MODE_RECOVERY: return RestartTool::MODE_RECOVERY;
+    case DeviceDetector::MODE_FASTBOOT: return RestartTool::MODE_BOOTLOADER;
+    case DeviceDetector::MODE_FASTBOOTD: return RestartTool::MODE_FASTBOOT;
+    case DeviceDetector::MODE_EDL_9008: return RestartTool::MODE_EDL;
+    default: return -1;
+    }
+}
+
+// 只有检测器能按序列号识别的模式才能作为中间点，执行器在这些模式上等待下一跳
+constexpr bool isWaypoint(int node)
+{
+    return node == RestartTool::MODE_SYSTEM || node == RestartTool::MODE_BOOTLOADER
+        || node == RestartTool::MODE_FASTBOOT;
+}
+
+struct PlanTable {
+    int cost[NODE_COUNT][NODE_COUNT];
+    int next[NODE_COUNT][NODE_COUNT];   // 第一跳的目标，-1 表示不可达
+    int hops[NODE_COUNT][NODE_COUNT];
+};
+
+// Floyd-Warshall，中间点限定为 waypoint；耗时相同时取重启次数少的路径
+constexpr PlanTable buildPlanTable()
+{
+    PlanTable table{};
+    for (int i = 0; i < NODE_COUNT; ++i) {
+        for (int j = 0; j < NODE_COUNT; ++j) {
+            const bool direct = TRANSITIONS[i][j].costMs > 0;
+            table.cost[i][j] = direct ? TRANSITIONS[i][j].costMs : UNREACHABLE;
+            table.next[i][j] = direct ? j : -1;
+            table.hops[i][j] = direct ? 1 : 0;
+        }
+    }
+
+    for (int k = 0; k < NODE_COUNT; ++k) {
+        if (!isWaypoint(k)) {
+            continue;
+        }
+        for (int i = 0; i < NODE_COUNT; ++i) {
+            if (i == k || table.next[i][k] < 0) {
+                continue;
+            }
+            for (int j = 0; j < NODE_COUNT; ++j) {
+                if (j == k || table.next[k][j] < 0) {
+                    continue;
+                }
+                const int cost = table.cost[i][k] + table.cost[k][j];
+                const int hops = table.hops[i][k] + table.hops[k][j];
+                if (cost < table.cost[i][j] || (cost == table.cost[i][j] && hops < table.hops[i][j])) {
+                    table.cost[i][j] = cost;
+                    table.next[i][j] = table.next[i][k];
+                    table.hops[i][j] = hops;
+                }
+            }
+        }
+    }
+    return table;
+}
+
+constexpr PlanTable PLAN_TABLE = buildPlanTable();
+
+static_assert(PLAN_TABLE.next[RestartTool::MODE_BOOTLOADER][RestartTool::MODE_EDL] == RestartTool::MODE_SYSTEM,
+              "Fastboot 应经系统重启到 EDL");
+static_assert(PLAN_TABLE.hops[RestartTool::MODE_FASTBOOT][RestartTool::MODE_EDL] == 2,
+              "Fastbootd 到 EDL 应为两跳");
+static_assert(PLAN_TABLE.next[RestartTool::MODE_SYSTEM][RestartTool::MODE_BOOTLOADER] == RestartTool::MODE_BOOTLOADER,
+              "ADB 应直接重启到引导程序");
+static_assert(PLAN_TABLE.next[RestartTool::MODE_EDL][RestartTool::MODE_SYSTEM] < 0,
+              "EDL 没有出边");
+
+} // namespace
+
+RebootPlanner::Plan RebootPlanner::plan(DeviceDetector::DeviceMode current, RestartTool::RestartMode target)
+{
+    Plan plan;
+    const int from = sourceNode(current);
+    const int to = static_cast<int>(target);
+    if (from < 0 || to < 0 || to >= NODE_COUNT || PLAN_TABLE.next[from][to] < 0) {
+        return plan;
+    }
+
+    plan.reachable = true;
+    plan.estimatedMs = PLAN_TABLE.cost[from][to];
+
+    DeviceDetector::DeviceMode mode = current;
+    int node = from;
+    for (int i = 0; i < PLAN_TABLE.hops[from][to]; ++i) {
+        const int next = PLAN_TABLE.next[node][to];
+        Hop hop;
+        hop.from = mode;
+        hop.target = static_cast<RestartTool::RestartMode>(next);
+        hop.lands = landingMode(hop.target);
+        hop.estimatedMs = TRANSITIONS[node][next].costMs;
+        plan.hops.append(hop);
+
+        mode = hop.lands;
+        node = next;
+    }
+    return plan;
+}
+
+QString RebootPlanner::fastbootCommand(DeviceDetector::DeviceMode current, RestartTool::RestartMode target)
+{
+    const int from = sourceNode(current);
+    const int to = static_cast<int>(target);
+    if (from < 0 || to < 0 || to >= NODE_COUNT || !TRANSITIONS[from][to].fastbootCommand) {
+        return QString();
+    }
+    return QString::fromLatin1(TRANSITIONS[from][to].fastbootCommand);
+}
+
+DeviceDetector::DeviceMode RebootPlanner::landingMode(RestartTool::RestartMode target)
+{
+    switch (target) {
+    case RestartTool::MODE_SYSTEM: return DeviceDetector::MODE_ADB;
+    case RestartTool::MODE_RECOVERY: return DeviceDetector::MODE_RECOVERY;
+    case RestartTool::MODE_BOOTLOADER: return DeviceDetector::MODE_FASTBOOT;
+    case RestartTool::MODE_FASTBOOT: return DeviceDetector::MODE_FASTBOOTD;
+    case RestartTool::MODE_EDL: return DeviceDetector::MODE_EDL_9008;
+    default: return DeviceDetector::MODE_UNKNOWN;
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef REBOOT_PLANNER_H
+#define REBOOT_PLANNER_H
+
+#include <QList>
+#include <QString>
+#include "device_detector.h"
+#include "restart_tool.h"
+
+// 重启路径规划：模式转换表和任意两种模式之间耗时最短的路径都在编译期算出
+// 例如 Fastboot 不能直接进入 EDL，规划为 Fastboot → 系统 → adb reboot edl
+// 中间模式必须能被检测器按序列号识别 (ADB/Fastboot/Fastbootd)，恢复模式、EDL 和关机只能作为终点
+class RebootPlanner
+{
+public:
+    // 路径中的一步：在 from 模式下发送重启到 target 的命令，设备随后进入 lands 模式
+    struct Hop {
+        DeviceDetector::DeviceMode from = DeviceDetector::MODE_UNKNOWN;
+        RestartTool::RestartMode target = RestartTool::MODE_SYSTEM;
+        DeviceDetector::DeviceMode lands = DeviceDetector::MODE_UNKNOWN;    // 关机时为 MODE_UNKNOWN
+        int estimatedMs = 0;
+    };
+
+    struct Plan {
+        bool reachable = false;
+        QList<Hop> hops;
+        int estimatedMs = 0;
+    };
+
+    static Plan plan(DeviceDetector::DeviceMode current, RestartTool::RestartMode target);
+    // fastboot/fastbootd 下直接转换的命令，不支持或当前为 ADB 模式时为空
+    static QString fastbootCommand(DeviceDetector::DeviceMode current, RestartTool::RestartMode target);
+    // 重启到 target 后检测器报告的模式
+    static DeviceDetector::DeviceMode landingMode(RestartTool::RestartMode target);
+};
+
+#endif // REBOOT_PLANNER_H
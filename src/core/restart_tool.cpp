@@ -1,68 +1,377 @@
 #include "restart_tool.h"
 #include "adb_embedded.h"
+#include "fastboot_usb.h"
+#include "reboot_planner.h"
+#include <QElapsedTimer>
+#include <QPromise>
+#include <QThreadPool>
+#include <QTimer>
 #include <QDebug>
+#include <algorithm>
+#include <memory>
 
-RestartTool::RestartTool(QObject *parent) : QObject(parent)
+namespace {
+
+template <typename T>
+QFuture<T> readyFuture(const T &value)
+{
+    QPromise<T> promise;
+    QFuture<T> future = promise.future();
+    promise.start();
+    promise.addResult(value);
+    promise.finish();
+    return future;
+}
+
+// 只有目标为正常重启时 adb reboot 不需要 su
+bool needsRoot(DeviceDetector::DeviceMode currentMode, RestartTool::RestartMode targetMode)
+{
+    return currentMode == DeviceDetector::MODE_ADB && targetMode != RestartTool::MODE_SYSTEM;
+}
+
+} // namespace
+
+struct RestartTool::RebootChain {
+    QString deviceId;
+    RebootPlanner::Plan plan;
+    int hop = 0;                    // 正在执行的跳
+    bool verbose = false;           // 单台重启时逐跳输出命令和等待信息
+    QStringList commands;
+    QElapsedTimer timer;
+    QPromise<RestartOutcome> promise;
+    DeviceDetector::DeviceMode waitingFor = DeviceDetector::MODE_UNKNOWN;
+    QTimer *timeout = nullptr;      // 非空时正在等待设备进入 waitingFor
+};
+
+RestartTool::RestartTool(QObject *parent)
+    : QObject(parent)
+    , m_commandPool(new QThreadPool(this))
+    , m_detector(nullptr)
 {
+    // 命令大部分时间在等待USB应答，线程数按设备数而不是CPU核数设置
+    m_commandPool->setMaxThreadCount(MAX_PARALLEL_COMMANDS);
 }
 
-QString RestartTool::restartDevice(const QString &deviceId, DeviceDetector::DeviceMode currentMode, RestartMode targetMode)
+void RestartTool::setDeviceDetector(DeviceDetector *detector)
+{
+    if (m_detector) {
+        disconnect(m_detector, nullptr, this, nullptr);
+    }
+    m_detector = detector;
+    if (m_detector) {
+        connect(m_detector, &DeviceDetector::deviceConnected, this, &RestartTool::onDeviceConnected);
+        connect(m_detector, &DeviceDetector::deviceModeChanged, this, &RestartTool::onDeviceModeChanged);
+    }
+}
+
+void RestartTool::restartDevice(const QString &deviceId, DeviceDetector::DeviceMode currentMode, RestartMode targetMode)
 {
     emit outputMessage(QString("🔄 尝试重启设备 %1 到 %2 模式...")
                       .arg(deviceId)
                       .arg(getModeName(targetMode)));
     
-    // 检查当前模式和目标模式的兼容性
-    if (currentMode == DeviceDetector::MODE_FASTBOOTD && targetMode == MODE_FASTBOOT) {
-        emit outputMessage("ℹ️ 设备已在Fastbootd模式", false);
-        return "Device already in Fastbootd mode";
+    runPlan(deviceId, currentMode, targetMode, true)
+        .then(this, [this, targetMode](const RestartOutcome &outcome) {
+            if (outcome.command.isEmpty()) {
+                emit outputMessage("❌ " + outcome.result, true);
+                emit restartFinished(outcome.deviceId, outcome.success);
+                return;
+            }
+            reportResult(outcome.deviceId, targetMode, outcome.success, outcome.result);
+        });
+}
+
+void RestartTool::restartDevices(const QMap<QString, DeviceDetector::DeviceMode> &devices, RestartMode targetMode)
+{
+    if (devices.isEmpty()) {
+        emit batchRestartFinished(QList<RestartOutcome>());
+        return;
     }
     
-    bool hasRoot = false;
-    if (currentMode == DeviceDetector::MODE_ADB) {
-        hasRoot = checkRootPermission(deviceId);
+    emit outputMessage(QString("🔄 批量重启 %1 台设备到 %2 模式...")
+                      .arg(devices.size())
+                      .arg(getModeName(targetMode)));
+    
+    // 每台设备独立完成 Root 检查、命令发送和中间模式等待，互不等待
+    struct Batch {
+        QList<RestartOutcome> outcomes;
+        qsizetype remaining = 0;
+        QElapsedTimer timer;
+    };
+    std::shared_ptr<Batch> batch = std::make_shared<Batch>();
+    batch->remaining = devices.size();
+    batch->timer.start();
+    
+    for (auto it = devices.constBegin(); it != devices.constEnd(); ++it) {
+        const QString deviceId = it.key();
+        const DeviceDetector::DeviceMode currentMode = it.value();
+        runPlan(deviceId, currentMode, targetMode, false)
+            .then(this, [this, batch, targetMode](const RestartOutcome &outcome) {
+                batch->outcomes.append(outcome);
+                emit restartFinished(outcome.deviceId, outcome.success);
+                if (--batch->remaining == 0) {
+                    reportBatch(batch->outcomes, targetMode, batch->timer.elapsed());
+                }
+            });
+    }
+}
+
+QFuture<RestartTool::RestartOutcome> RestartTool::runPlan(const QString &deviceId,
+                                                          DeviceDetector::DeviceMode currentMode,
+                                                          RestartMode targetMode, bool verbose)
+{
+    const RebootPlanner::Plan plan = RebootPlanner::plan(currentMode, targetMode);
+    if (!plan.reachable) {
+        RestartOutcome outcome;
+        outcome.deviceId = deviceId;
+        outcome.result = QString("%1 无法重启到%2")
+            .arg(m_detector ? m_detector->getModeDisplayName(currentMode) : QString("当前模式"))
+            .arg(getModeName(targetMode));
+        return readyFuture(outcome);
+    }
+    if (plan.hops.size() > 1 && !m_detector) {
+        RestartOutcome outcome;
+        outcome.deviceId = deviceId;
+        outcome.result = QString("需要经过中间模式才能重启到%1，但未连接设备检测器").arg(getModeName(targetMode));
+        return readyFuture(outcome);
+    }
+    if (m_chains.contains(deviceId)) {
+        RestartOutcome outcome;
+        outcome.deviceId = deviceId;
+        outcome.result = "设备正在执行上一次重启";
+        return readyFuture(outcome);
     }
     
-    QString command = getRestartCommand(deviceId, currentMode, targetMode, hasRoot);
+    std::shared_ptr<RebootChain> chain = std::make_shared<RebootChain>();
+    chain->deviceId = deviceId;
+    chain->plan = plan;
+    chain->verbose = verbose;
+    chain->timer.start();
+    chain->promise.start();
+    QFuture<RestartOutcome> future = chain->promise.future();
+    m_chains.insert(deviceId, chain);
     
-    if (command.isEmpty()) {
-        emit outputMessage("❌ 无法生成重启命令或模式不支持", true);
-        return "Error: No command generated or mode not supported";
+    if (verbose && plan.hops.size() > 1) {
+        QList<RestartMode> targets;
+        for (const RebootPlanner::Hop &hop : plan.hops) {
+            targets.append(hop.target);
+        }
+        emit outputMessage(describePlan(currentMode, targets, plan.estimatedMs));
+    }
+    runHop(chain);
+    return future;
+}
+
+void RestartTool::runHop(const std::shared_ptr<RebootChain> &chain)
+{
+    const RebootPlanner::Hop hop = chain->plan.hops.at(chain->hop);
+    // 单台重启首次需要 su 时输出Root检查结果
+    const bool reportRoot = chain->verbose && needsRoot(hop.from, hop.target)
+        && !m_rootCache.contains(chain->deviceId);
+    QFuture<bool> root = reportRoot ? checkRootPermission(chain->deviceId)
+                                    : rootCapability(chain->deviceId, hop.from, hop.target);
+    const int window = qMax(MIN_HOP_TIMEOUT, hop.estimatedMs * HOP_TIMEOUT_FACTOR);
+    root.then(this, [this, chain, hop, window](bool hasRoot) {
+            // 命令发出前登记，设备在命令返回前就断开时检测器也能识别为预期的重启
+            if (m_detector) {
+                m_detector->expectTransition(chain->deviceId, hop.lands, window);
+            }
+            sendRestart(chain->deviceId, hop.from, hop.target, hasRoot)
+                .then(this, [this, chain, hop, window](const RestartOutcome &outcome) {
+                    if (!outcome.success && m_detector) {
+                        m_detector->cancelTransition(chain->deviceId);
+                    }
+                    if (!outcome.command.isEmpty()) {
+                        chain->commands.append(outcome.command);
+                        if (chain->verbose) {
+                            emit outputMessage(QString("💻 执行命令: %1").arg(outcome.command));
+                        }
+                    }
+                    if (!outcome.success || chain->hop + 1 >= chain->plan.hops.size()) {
+                        finishChain(chain, outcome);
+                        return;
+                    }
+                    
+                    // 中间模式由检测器事件确认，不做固定等待；超时按估计耗时放宽
+                    chain->waitingFor = hop.lands;
+                    chain->timeout = new QTimer(this);
+                    chain->timeout->setSingleShot(true);
+                    connect(chain->timeout, &QTimer::timeout, this, [this, chain, outcome]() {
+                        chain->timeout->deleteLater();
+                        chain->timeout = nullptr;
+                        RestartOutcome failed = outcome;
+                        failed.success = false;
+                        failed.result = QString("等待设备进入%1超时")
+                            .arg(m_detector ? m_detector->getModeDisplayName(chain->waitingFor) : QString("中间模式"));
+                        finishChain(chain, failed);
+                    });
+                    chain->timeout->start(window);
+                    if (chain->verbose) {
+                        emit outputMessage(QString("⏳ 等待设备进入%1...").arg(m_detector->getModeDisplayName(hop.lands)));
+                    }
+                });
+        });
+}
+
+void RestartTool::onDeviceConnected(const DeviceInfo &info)
+{
+    onHopLanded(info.serialNumber, static_cast<DeviceDetector::DeviceMode>(info.mode));
+}
+
+void RestartTool::onDeviceModeChanged(const QString &serial, DeviceDetector::DeviceMode newMode)
+{
+    onHopLanded(serial, newMode);
+}
+
+void RestartTool::onHopLanded(const QString &serial, DeviceDetector::DeviceMode mode)
+{
+    auto it = m_chains.constFind(serial);
+    if (it == m_chains.constEnd()) {
+        return;
+    }
+    std::shared_ptr<RebootChain> chain = it.value();
+    if (!chain->timeout || chain->waitingFor != mode) {
+        return;
     }
     
-    emit outputMessage(QString("💻 执行命令: %1").arg(command));
+    chain->timeout->stop();
+    chain->timeout->deleteLater();
+    chain->timeout = nullptr;
+    chain->waitingFor = DeviceDetector::MODE_UNKNOWN;
+    ++chain->hop;
+    runHop(chain);
+}
+
+void RestartTool::finishChain(const std::shared_ptr<RebootChain> &chain, RestartOutcome outcome)
+{
+    m_chains.remove(chain->deviceId);
+    outcome.command = chain->commands.join(" → ");
+    outcome.elapsedMs = chain->timer.elapsed();
+    chain->promise.addResult(outcome);
+    chain->promise.finish();
+}
+
+QString RestartTool::describePlan(DeviceDetector::DeviceMode currentMode, const QList<RestartMode> &targets,
+                                  int estimatedMs) const
+{
+    QStringList steps;
+    steps << m_detector->getModeDisplayName(currentMode);
+    for (RestartMode target : targets) {
+        steps << getModeName(target);
+    }
+    return QString("📍 重启路径: %1 (%2 次重启，预计 %3 秒)")
+        .arg(steps.join(" → "))
+        .arg(targets.size())
+        .arg((estimatedMs + 999) / 1000);
+}
+
+QFuture<RestartTool::RestartOutcome> RestartTool::sendRestart(const QString &deviceId,
+                                                              DeviceDetector::DeviceMode currentMode,
+                                                              RestartMode targetMode, bool hasRoot)
+{
+    RestartOutcome outcome;
+    outcome.deviceId = deviceId;
+    QElapsedTimer timer;
+    timer.start();
     
-    QString result;
     if (currentMode == DeviceDetector::MODE_ADB) {
-        result = AdbEmbedded::instance().executeCommand(command);
-    } else {
-        // 对于Fastboot模式，我们需要直接执行fastboot命令
-        QProcess process;
-        QString fastbootPath = AdbEmbedded::instance().getFastbootPath();
-        
-        QStringList arguments;
-        if (!deviceId.isEmpty()) {
-            arguments << "-s" << deviceId;
+        AdbCommand command = getAdbRestartCommand(deviceId, targetMode, hasRoot);
+        if (command.arguments.isEmpty()) {
+            outcome.result = "无法生成重启命令或模式不支持";
+            return readyFuture(outcome);
         }
-        arguments << command.split(' ', Qt::SkipEmptyParts);
-        
-        process.setProgram(fastbootPath);
-        process.setArguments(arguments);
         
-        emit outputMessage(QString("执行Fastboot命令: %1 %2").arg(fastbootPath).arg(arguments.join(" ")));
-        
-        process.start();
-        if (!process.waitForFinished(10000)) {
-            process.kill();
-            result = "Error: Command timeout";
-        } else {
-            result = process.readAllStandardOutput() + process.readAllStandardError();
-        }
+        outcome.command = command.toString();
+        return AdbEmbedded::instance().executeAsync(command)
+            .then([outcome, timer](const AdbCommandResult &result) {
+                RestartOutcome finished = outcome;
+                finished.success = result.succeeded();
+                finished.result = AdbEmbedded::formatResult(result);
+                finished.elapsedMs = timer.elapsed();
+                return finished;
+            });
     }
     
+    QString command = RebootPlanner::fastbootCommand(currentMode, targetMode);
+    if (command.isEmpty()) {
+        outcome.result = "无法生成重启命令或模式不支持";
+        return readyFuture(outcome);
+    }
+    outcome.command = command;
+    
+    if (std::shared_ptr<FastbootClient> client = FastbootUsbManager::instance().session(deviceId)) {
+        // 设备已有原生fastboot会话，直接通过USB发送命令
+        // 命令在线程池中执行，多台设备的USB往返互不阻塞，也不占用界面线程
+        std::shared_ptr<QPromise<RestartOutcome>> promise = std::make_shared<QPromise<RestartOutcome>>();
+        QFuture<RestartOutcome> future = promise->future();
+        promise->start();
+        m_commandPool->start([promise, client, command, outcome, timer]() {
+            FastbootResponse response;
+            client->command(command, response);
+            QString result = FastbootClient::formatResponse(command, response);
+            RestartOutcome finished = outcome;
+            finished.success = response.ok;
+            finished.result = response.ok ? result : "Error: " + result;
+            finished.elapsedMs = timer.elapsed();
+            promise->addResult(finished);
+            promise->finish();
+        });
+        return future;
+    }
+    
+    // 对于Fastboot模式，我们需要直接执行fastboot命令
+    QStringList arguments;
+    if (!deviceId.isEmpty()) {
+        arguments << "-s" << deviceId;
+    }
+    arguments << command.split(' ', Qt::SkipEmptyParts);
+    
+    AdbCommandOptions options;
+    options.deadline = QDeadlineTimer(10000);
+    return AdbEmbedded::instance().fastbootAsync(arguments, options)
+        .then([outcome, timer](const AdbCommandResult &result) {
+            // fastboot 的提示信息输出在 stderr
+            RestartOutcome finished = outcome;
+            finished.success = result.succeeded();
+            finished.result = result.error.isEmpty()
+                ? QString::fromUtf8(result.stdOut + result.stdErr).trimmed()
+                : "Error: " + result.error;
+            finished.elapsedMs = timer.elapsed();
+            return finished;
+        });
+}
+
+QFuture<bool> RestartTool::rootCapability(const QString &deviceId, DeviceDetector::DeviceMode currentMode,
+                                          RestartMode targetMode)
+{
+    if (!needsRoot(currentMode, targetMode)) {
+        return readyFuture(false);
+    }
+    auto cached = m_rootCache.constFind(deviceId);
+    if (cached != m_rootCache.constEnd()) {
+        return readyFuture(cached.value());
+    }
+    return queryRoot(deviceId);
+}
+
+QFuture<bool> RestartTool::queryRoot(const QString &deviceId)
+{
+    return AdbEmbedded::instance().shellAsync(deviceId, "su -c \"echo root\"")
+        .then(this, [this, deviceId](const AdbCommandResult &result) {
+            bool hasRoot = result.succeeded() && result.stdOut.contains("root");
+            // 设备未授权、连接失败等情况下命令未执行，不缓存，下次重新检查
+            if (hasRoot || result.error.isEmpty()) {
+                m_rootCache.insert(deviceId, hasRoot);
+            }
+            return hasRoot;
+        });
+}
+
+void RestartTool::reportResult(const QString &deviceId, RestartMode targetMode, bool success, const QString &result)
+{
     emit outputMessage(QString("📋 命令结果: %1").arg(result));
     
-    if (result.contains("Error") || result.contains("error") || result.contains("failed")) {
+    if (!success) {
         emit outputMessage("❌ 重启命令执行失败", true);
         
         // 提供特定错误的建议
@@ -93,22 +402,62 @@ QString RestartTool::restartDevice(const QString &deviceId, DeviceDetector::Devi
         }
     }
     
-    return result;
+    emit restartFinished(deviceId, success);
 }
 
-bool RestartTool::checkRootPermission(const QString &deviceId)
+void RestartTool::reportBatch(QList<RestartOutcome> outcomes, RestartMode targetMode, qint64 elapsedMs)
 {
-    // 检查root权限
-    QString result = AdbEmbedded::instance().executeCommand(
-        QString("-s %1 shell su -c \"echo root\"").arg(deviceId));
+    std::sort(outcomes.begin(), outcomes.end(), [](const RestartOutcome &a, const RestartOutcome &b) {
+        return a.deviceId < b.deviceId;
+    });
     
-    if (result.contains("root")) {
-        emit outputMessage("✅ 设备具有Root权限");
-        return true;
-    } else {
-        emit outputMessage("⚠️ 设备没有Root权限，尝试普通重启");
-        return false;
+    // 汇总表：设备、结果、耗时、命令或失败原因，一条消息输出
+    int width = 4;
+    int failed = 0;
+    for (const RestartOutcome &outcome : std::as_const(outcomes)) {
+        width = qMax(width, static_cast<int>(outcome.deviceId.size()));
+        if (!outcome.success) {
+            ++failed;
+        }
+    }
+    
+    QStringList lines;
+    lines << QString("📋 批量重启结果 (%1, 总耗时 %2 ms):").arg(getModeName(targetMode)).arg(elapsedMs);
+    lines << QString("  %1  结果  耗时(ms)  命令/信息").arg(QString("设备").leftJustified(width));
+    for (const RestartOutcome &outcome : std::as_const(outcomes)) {
+        QString detail = outcome.success ? outcome.command : outcome.result.simplified();
+        if (outcome.success && outcome.command.isEmpty()) {
+            detail = outcome.result;
+        }
+        lines << QString("  %1  %2    %3  %4")
+            .arg(outcome.deviceId.leftJustified(width))
+            .arg(outcome.success ? "✅" : "❌")
+            .arg(outcome.elapsedMs, 8)
+            .arg(detail);
     }
+    lines << QString("%1 成功 %2 台，失败 %3 台")
+        .arg(failed == 0 ? "✅" : "⚠️")
+        .arg(outcomes.size() - failed)
+        .arg(failed);
+    
+    qDebug().noquote() << QString("Batch reboot to %1: %2 devices, %3 failed, %4 ms")
+        .arg(static_cast<int>(targetMode)).arg(outcomes.size()).arg(failed).arg(elapsedMs);
+    emit outputMessage(lines.join('\n'), failed > 0);
+    emit batchRestartFinished(outcomes);
+}
+
+QFuture<bool> RestartTool::checkRootPermission(const QString &deviceId)
+{
+    // 检查root权限，结果同时写入缓存
+    return queryRoot(deviceId)
+        .then(this, [this](bool hasRoot) {
+            if (hasRoot) {
+                emit outputMessage("✅ 设备具有Root权限");
+                return true;
+            }
+            emit outputMessage("⚠️ 设备没有Root权限，尝试普通重启");
+            return false;
+        });
 }
 
 QString RestartTool::getModeName(RestartMode mode) const
@@ -124,102 +473,34 @@ QString RestartTool::getModeName(RestartMode mode) const
     }
 }
 
-QString RestartTool::getRestartCommand(const QString &deviceId, DeviceDetector::DeviceMode currentMode, RestartMode targetMode, bool hasRoot)
+AdbCommand RestartTool::getAdbRestartCommand(const QString &deviceId, RestartMode targetMode, bool hasRoot)
 {
-    QString command;
-    
-    if (currentMode == DeviceDetector::MODE_ADB) {
-        // ADB模式下的重启命令
-        switch (targetMode) {
-        case MODE_SYSTEM:
-            command = QString("-s %1 reboot").arg(deviceId);
-            break;
-        case MODE_RECOVERY:
-            if (hasRoot) {
-                command = QString("-s %1 shell su -c \"reboot recovery\"").arg(deviceId);
-            } else {
-                command = QString("-s %1 reboot recovery").arg(deviceId);
-            }
-            break;
-        case MODE_BOOTLOADER:
-            if (hasRoot) {
-                command = QString("-s %1 shell su -c \"reboot bootloader\"").arg(deviceId);
-            } else {
-                command = QString("-s %1 reboot bootloader").arg(deviceId);
-            }
-            break;
-        case MODE_FASTBOOT:
-            // 从ADB重启到Fastbootd
-            if (hasRoot) {
-                command = QString("-s %1 shell su -c \"reboot fastboot\"").arg(deviceId);
-            } else {
-                // 尝试使用 reboot fastboot，如果不支持则使用 reboot bootloader
-                command = QString("-s %1 reboot fastboot").arg(deviceId);
-            }
-            break;
-        case MODE_EDL:
-            if (hasRoot) {
-                command = QString("-s %1 shell su -c \"reboot edl\"").arg(deviceId);
-            } else {
-                command = QString("-s %1 reboot edl").arg(deviceId);
-            }
-            break;
-        case MODE_SHUTDOWN:
-            if (hasRoot) {
-                command = QString("-s %1 shell su -c \"reboot -p\"").arg(deviceId);
-            } else {
-                command = QString("-s %1 shell reboot -p").arg(deviceId);
-            }
-            break;
-        }
-    } else if (currentMode == DeviceDetector::MODE_FASTBOOT) {
-        // 传统Fastboot模式下的重启命令
-        switch (targetMode) {
-        case MODE_SYSTEM:
-            command = "reboot";
-            break;
-        case MODE_RECOVERY:
-            command = "reboot-recovery";
-            break;
-        case MODE_BOOTLOADER:
-            command = "reboot-bootloader";
-            break;
-        case MODE_FASTBOOT:
-            // 从传统Fastboot重启到Fastbootd
-            command = "reboot-fastboot";
-            break;
-        case MODE_SHUTDOWN:
-            command = "shutdown";
-            break;
-        case MODE_EDL:
-            emit outputMessage("❌ 传统Fastboot模式不支持直接重启到EDL", true);
-            break;
-        }
-    } else if (currentMode == DeviceDetector::MODE_FASTBOOTD) {
-        // Fastbootd模式下的重启命令
-        switch (targetMode) {
-        case MODE_SYSTEM:
-            command = "reboot";
-            break;
-        case MODE_RECOVERY:
-            command = "reboot-recovery";
-            break;
-        case MODE_BOOTLOADER:
-            // 从Fastbootd重启到传统Fastboot
-            command = "reboot-bootloader";
-            break;
-        case MODE_FASTBOOT:
-            // 已经在Fastbootd模式
-            emit outputMessage("ℹ️ 设备已在Fastbootd模式", false);
-            break;
-        case MODE_SHUTDOWN:
-            command = "shutdown";
-            break;
-        case MODE_EDL:
-            emit outputMessage("❌ Fastbootd模式不支持直接重启到EDL", true);
-            break;
-        }
+    // ADB模式下的重启命令，有Root时通过 su 执行，脚本整体交给设备端 shell
+    QString target;
+    switch (targetMode) {
+    case MODE_SYSTEM:
+        return AdbCommand::reboot(deviceId);
+    case MODE_RECOVERY:
+        target = "recovery";
+        break;
+    case MODE_BOOTLOADER:
+        target = "bootloader";
+        break;
+    case MODE_FASTBOOT:
+        // 从ADB重启到Fastbootd
+        target = "fastboot";
+        break;
+    case MODE_EDL:
+        target = "edl";
+        break;
+    case MODE_SHUTDOWN:
+        return AdbCommand::shell(deviceId, hasRoot ? "su -c 'reboot -p'" : "reboot -p");
+    default:
+        return AdbCommand();
     }
     
-    return command;
+    if (hasRoot) {
+        return AdbCommand::shell(deviceId, QString("su -c 'reboot %1'").arg(target));
+    }
+    return AdbCommand::reboot(deviceId, target);
 }
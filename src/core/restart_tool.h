@@ -1,9 +1,18 @@
 #ifndef RESTART_TOOL_H
 #define RESTART_TOOL_H
 
+#include <QFuture>
+#include <QHash>
+#include <QList>
+#include <QMap>
 #include <QObject>
 #include <QString>
+#include <memory>
 #include "device_detector.h"
+#include "adb_command.h"
+
+class QThreadPool;
+class QTimer;
 
 class RestartTool : public QObject
 {
@@ -11,7 +20,7 @@ class RestartTool : public QObject
 
 public:
     explicit RestartTool(QObject *parent = nullptr);
-    
+
     enum RestartMode {
         MODE_SYSTEM = 0,
         MODE_RECOVERY = 1,
@@ -21,15 +30,64 @@ public:
         MODE_SHUTDOWN = 5
     };
 
-    QString restartDevice(const QString &deviceId, DeviceDetector::DeviceMode currentMode, RestartMode targetMode);
-    bool checkRootPermission(const QString &deviceId);
+    // 一台设备的重启结果
+    struct RestartOutcome {
+        QString deviceId;
+        bool success = false;
+        QString command;        // 实际发送的命令，无法生成时为空
+        QString result;         // 命令输出或失败原因
+        qint64 elapsedMs = 0;
+    };
+
+    // 异步执行，完成后发出 restartFinished
+    void restartDevice(const QString &deviceId, DeviceDetector::DeviceMode currentMode, RestartMode targetMode);
+    // 所有设备的命令同时发出，全部完成后输出汇总表并发出 batchRestartFinished
+    void restartDevices(const QMap<QString, DeviceDetector::DeviceMode> &devices, RestartMode targetMode);
+    // 多跳路径需要在中间模式等待设备重新出现，未设置检测器时只执行单跳重启
+    void setDeviceDetector(DeviceDetector *detector);
+    QFuture<bool> checkRootPermission(const QString &deviceId);
     QString getModeName(RestartMode mode) const;
 
 signals:
     void outputMessage(const QString &message, bool isError = false);
+    void restartFinished(const QString &deviceId, bool success);
+    void batchRestartFinished(const QList<RestartTool::RestartOutcome> &outcomes);
+
+private slots:
+    void onDeviceConnected(const DeviceInfo &info);
+    void onDeviceModeChanged(const QString &serial, DeviceDetector::DeviceMode newMode);
 
 private:
-    QString getRestartCommand(const QString &deviceId, DeviceDetector::DeviceMode currentMode, RestartMode targetMode, bool hasRoot);
+    static const int MAX_PARALLEL_COMMANDS = 64;    // 原生fastboot会话上同时执行的命令数
+    static const int HOP_TIMEOUT_FACTOR = 3;        // 等待中间模式的时间为估计耗时的倍数
+    static const int MIN_HOP_TIMEOUT = 30000;
+
+    // 一台设备正在执行的重启路径，只在本对象所在线程中访问
+    struct RebootChain;
+
+    // 按 RebootPlanner 的路径逐跳发送命令，跳与跳之间等待检测器报告设备进入中间模式
+    QFuture<RestartOutcome> runPlan(const QString &deviceId, DeviceDetector::DeviceMode currentMode,
+                                    RestartMode targetMode, bool verbose);
+    void runHop(const std::shared_ptr<RebootChain> &chain);
+    void onHopLanded(const QString &serial, DeviceDetector::DeviceMode mode);
+    void finishChain(const std::shared_ptr<RebootChain> &chain, RestartOutcome outcome);
+    QString describePlan(DeviceDetector::DeviceMode currentMode, const QList<RestartMode> &targets, int estimatedMs) const;
+
+    // 只发送命令不输出消息，批量和单台重启共用
+    QFuture<RestartOutcome> sendRestart(const QString &deviceId, DeviceDetector::DeviceMode currentMode,
+                                        RestartMode targetMode, bool hasRoot);
+    // 优先使用缓存的Root检查结果，只有目标模式需要 su 时才检查
+    QFuture<bool> rootCapability(const QString &deviceId, DeviceDetector::DeviceMode currentMode, RestartMode targetMode);
+    // 执行 su 检查并更新缓存，不输出消息
+    QFuture<bool> queryRoot(const QString &deviceId);
+    void reportResult(const QString &deviceId, RestartMode targetMode, bool success, const QString &result);
+    void reportBatch(QList<RestartOutcome> outcomes, RestartMode targetMode, qint64 elapsedMs);
+    AdbCommand getAdbRestartCommand(const QString &deviceId, RestartMode targetMode, bool hasRoot);
+
+    QThreadPool *m_commandPool;
+    DeviceDetector *m_detector;
+    QHash<QString, std::shared_ptr<RebootChain>> m_chains;  // 序列号 -> 正在执行的路径
+    QHash<QString, bool> m_rootCache;       // 序列号 -> 是否有Root，只在本对象所在线程中访问
 };
 
 #endif // RESTART_TOOL_H
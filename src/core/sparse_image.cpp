@@ -0,0 +1,456 @@
+#include "sparse_image.h"
+#include "block_scan.h"
+#include <QtEndian>
+#include <cstring>
+
+namespace {
+
+const int FILE_HEADER_SIZE = 28;
+const int CHUNK_HEADER_SIZE = 12;
+const quint16 MAJOR_VERSION = 1;
+const qint64 MAX_DOWNLOAD_SIZE = 0xffffffffLL;
+// 块头的 total_sz 为 32 位，包含块头自身
+const qint64 MAX_CHUNK_SIZE = 0xffffffffLL;
+// 每个分片固定有文件头和末尾的 DONT_CARE；每个区间最多需要一个前置 DONT_CARE 和自身的块头
+const qint64 FIXED_COST = FILE_HEADER_SIZE + CHUNK_HEADER_SIZE;
+const qint64 CHUNK_COST = 2 * CHUNK_HEADER_SIZE;
+const qint64 EXPAND_BUFFER_SIZE = 1024 * 1024;
+
+void setError(QString *error, const QString &message)
+{
+    if (error) {
+        *error = message;
+    }
+}
+
+void append16(QByteArray &data, quint16 value)
+{
+    char buffer[2];
+    qToLittleEndian(value, buffer);
+    data.append(buffer, sizeof(buffer));
+}
+
+void append32(QByteArray &data, quint32 value)
+{
+    char buffer[4];
+    qToLittleEndian(value, buffer);
+    data.append(buffer, sizeof(buffer));
+}
+
+void appendChunkHeader(QByteArray &data, quint16 type, quint32 blocks, quint32 totalSize)
+{
+    append16(data, type);
+    append16(data, 0);
+    append32(data, blocks);
+    append32(data, totalSize);
+}
+
+} // namespace
+
+qint64 SparseImage::Segment::size() const
+{
+    return bytes.isEmpty() ? sourceSize : bytes.size();
+}
+
+SparseImage::SparseImage()
+    : m_sparse(false)
+    , m_sourceSize(0)
+    , m_blockSize(DEFAULT_BLOCK_SIZE)
+    , m_totalBlocks(0)
+{
+}
+
+bool SparseImage::isSparseImage(const uchar *data, qint64 size)
+{
+    return size >= FILE_HEADER_SIZE && qFromLittleEndian<quint32>(data) == SPARSE_MAGIC;
+}
+
+bool SparseImage::isSparse() const
+{
+    return m_sparse;
+}
+
+quint32 SparseImage::blockSize() const
+{
+    return m_blockSize;
+}
+
+qint64 SparseImage::expandedSize() const
+{
+    return m_sparse ? static_cast<qint64>(m_totalBlocks) * m_blockSize : m_sourceSize;
+}
+
+bool SparseImage::load(const uchar *data, qint64 size, QString *error)
+{
+    m_chunks.clear();
+    m_sourceSize = size;
+    m_sparse = isSparseImage(data, size);
+
+    if (!m_sparse) {
+        m_blockSize = DEFAULT_BLOCK_SIZE;
+        const qint64 blocks = (size + m_blockSize - 1) / m_blockSize;
+        if (size <= 0 || blocks > 0xffffffffLL) {
+            setError(error, QString("Unsupported image size %1").arg(size));
+            return false;
+        }
+        m_totalBlocks = static_cast<quint32>(blocks);
+        // 分块扫描要读完整个镜像，推迟到确实需要编码时
+        return true;
+    }
+
+    // 文件头：magic, major, minor, file_hdr_sz, chunk_hdr_sz, blk_sz, total_blks, total_chunks, checksum
+    const quint16 major = qFromLittleEndian<quint16>(data + 4);
+    const quint16 fileHeaderSize = qFromLittleEndian<quint16>(data + 8);
+    const quint16 chunkHeaderSize = qFromLittleEndian<quint16>(data + 10);
+    m_blockSize = qFromLittleEndian<quint32>(data + 12);
+    m_totalBlocks = qFromLittleEndian<quint32>(data + 16);
+    const quint32 totalChunks = qFromLittleEndian<quint32>(data + 20);
+    if (major != MAJOR_VERSION || fileHeaderSize < FILE_HEADER_SIZE || chunkHeaderSize < CHUNK_HEADER_SIZE
+        || m_blockSize == 0 || m_blockSize % 4 != 0) {
+        setError(error, "Unsupported sparse image header");
+        return false;
+    }
+
+    qint64 offset = fileHeaderSize;
+    quint64 block = 0;
+    for (quint32 i = 0; i < totalChunks; ++i) {
+        if (offset + chunkHeaderSize > size) {
+            setError(error, QString("Sparse image truncated at chunk %1").arg(i));
+            return false;
+        }
+
+        const uchar *header = data + offset;
+        const quint16 type = qFromLittleEndian<quint16>(header);
+        const quint32 blocks = qFromLittleEndian<quint32>(header + 4);
+        const quint32 totalSize = qFromLittleEndian<quint32>(header + 8);
+        const qint64 dataOffset = offset + chunkHeaderSize;
+        const qint64 dataSize = static_cast<qint64>(totalSize) - chunkHeaderSize;
+        if (dataSize < 0 || offset + totalSize > size) {
+            setError(error, QString("Invalid sparse chunk %1").arg(i));
+            return false;
+        }
+
+        Chunk chunk;
+        chunk.startBlock = static_cast<quint32>(block);
+        chunk.blocks = blocks;
+        switch (type) {
+        case CHUNK_RAW:
+            if (dataSize != static_cast<qint64>(blocks) * m_blockSize) {
+                setError(error, QString("Sparse RAW chunk %1 has wrong size").arg(i));
+                return false;
+            }
+            chunk.type = CHUNK_RAW;
+            chunk.sourceOffset = dataOffset;
+            chunk.sourceSize = dataSize;
+            m_chunks.append(chunk);
+            break;
+        case CHUNK_FILL:
+            if (dataSize < 4) {
+                setError(error, QString("Sparse FILL chunk %1 has no value").arg(i));
+                return false;
+            }
+            chunk.type = CHUNK_FILL;
+            chunk.fillValue = qFromLittleEndian<quint32>(data + dataOffset);
+            m_chunks.append(chunk);
+            break;
+        case CHUNK_DONT_CARE:
+        case CHUNK_CRC32:
+            // 切分后由分片之间的 DONT_CARE 表示；校验和是可选的，不转发
+            break;
+        default:
+            setError(error, QString("Unknown sparse chunk type 0x%1").arg(type, 4, 16, QChar('0')));
+            return false;
+        }
+
+        block += blocks;
+        offset += totalSize;
+    }
+
+    if (block != m_totalBlocks) {
+        setError(error, QString("Sparse image covers %1 blocks, header says %2").arg(block).arg(m_totalBlocks));
+        return false;
+    }
+    return true;
+}
+
+void SparseImage::scan(const uchar *data)
+{
+    if (m_sparse) {
+        return;
+    }
+    m_chunks.clear();
+    for (quint32 block = 0; block < m_totalBlocks; block += m_chunks.last().blocks) {
+        m_chunks.append(scanRun(data, block, m_totalBlocks));
+    }
+}
+
+SparseImage::Chunk SparseImage::scanRun(const uchar *source, quint32 startBlock, qint64 maxBlocks) const
+{
+    // 最后不足一块的部分总是 RAW，在生成 sparse 时补零
+    // RAW 区间不超过一个块头能描述的长度
+    const qint64 fullBlocks = m_sourceSize / m_blockSize;
+    const qint64 maxRawBlocks = qMin<qint64>(maxBlocks, (MAX_CHUNK_SIZE - CHUNK_HEADER_SIZE) / m_blockSize);
+    Chunk chunk;
+    chunk.startBlock = startBlock;
+    chunk.sourceOffset = static_cast<qint64>(startBlock) * m_blockSize;
+    for (qint64 block = startBlock; block < m_totalBlocks; ++block) {
+        const qint64 offset = block * m_blockSize;
+        quint32 value = 0;
+        const bool fill = block < fullBlocks && BlockScan::fillValue(source + offset, m_blockSize, value);
+        value = qFromLittleEndian(value);
+
+        if (chunk.blocks == 0) {
+            chunk.type = fill ? CHUNK_FILL : CHUNK_RAW;
+            chunk.fillValue = value;
+        } else if (fill != (chunk.type == CHUNK_FILL)
+                   || (fill ? chunk.fillValue != value : chunk.blocks >= maxRawBlocks)) {
+            break;
+        }
+        ++chunk.blocks;
+        if (!fill) {
+            chunk.sourceSize += qMin<qint64>(m_blockSize, m_sourceSize - offset);
+        }
+    }
+    return chunk;
+}
+
+qint64 SparseImage::encodedSize() const
+{
+    qint64 size = FILE_HEADER_SIZE;
+    quint32 block = 0;
+    for (const Chunk &chunk : m_chunks) {
+        if (chunk.startBlock > block) {
+            size += CHUNK_HEADER_SIZE;
+        }
+        size += CHUNK_HEADER_SIZE
+            + (chunk.type == CHUNK_FILL ? 4 : static_cast<qint64>(chunk.blocks) * m_blockSize);
+        block = chunk.startBlock + chunk.blocks;
+    }
+    if (block < m_totalBlocks) {
+        size += CHUNK_HEADER_SIZE;
+    }
+    return size;
+}
+
+bool SparseImage::encode(Download &download, QString *error) const
+{
+    return buildDownload(m_chunks, download, error);
+}
+
+bool SparseImage::expand(const uchar *source, const DataSink &sink, QString *error) const
+{
+    // FILL 和 DONT_CARE 区间由一个固定大小的缓冲区重复输出
+    QByteArray buffer;
+    quint32 bufferValue = 0;
+    auto emitRepeated = [&](quint32 value, qint64 size) {
+        if (buffer.isEmpty() || bufferValue != value) {
+            buffer.resize(static_cast<int>(EXPAND_BUFFER_SIZE));
+            char pattern[4];
+            qToLittleEndian(value, pattern);
+            for (qint64 i = 0; i < EXPAND_BUFFER_SIZE; i += 4) {
+                std::memcpy(buffer.data() + i, pattern, sizeof(pattern));
+            }
+            bufferValue = value;
+        }
+        for (qint64 done = 0; done < size;) {
+            qint64 length = qMin(EXPAND_BUFFER_SIZE, size - done);
+            if (!sink(buffer.constData(), length)) {
+                return false;
+            }
+            done += length;
+        }
+        return true;
+    };
+
+    bool ok = true;
+    quint32 block = 0;
+    for (const Chunk &chunk : m_chunks) {
+        if (ok && chunk.startBlock > block) {
+            ok = emitRepeated(0, static_cast<qint64>(chunk.startBlock - block) * m_blockSize);
+        }
+        if (ok && chunk.type == CHUNK_FILL) {
+            ok = emitRepeated(chunk.fillValue, static_cast<qint64>(chunk.blocks) * m_blockSize);
+        } else if (ok) {
+            // RAW 数据直接从源数据输出，不经过缓冲区
+            const char *data = reinterpret_cast<const char*>(source + chunk.sourceOffset);
+            for (qint64 done = 0; ok && done < chunk.sourceSize;) {
+                qint64 length = qMin(EXPAND_BUFFER_SIZE, chunk.sourceSize - done);
+                ok = sink(data + done, length);
+                done += length;
+            }
+        }
+        block = chunk.startBlock + chunk.blocks;
+    }
+    if (ok && block < m_totalBlocks) {
+        ok = emitRepeated(0, static_cast<qint64>(m_totalBlocks - block) * m_blockSize);
+    }
+
+    if (!ok) {
+        setError(error, "Sparse expansion aborted");
+    }
+    return ok;
+}
+
+SparseImage::Splitter::Splitter(const SparseImage &image, const uchar *source, qint64 maxDownloadSize)
+    : m_image(image)
+    , m_source(source)
+    // download 命令的长度为 8 位十六进制
+    , m_maxDownloadSize(qMin<qint64>(maxDownloadSize, MAX_DOWNLOAD_SIZE))
+    , m_scanLimit(qMax<qint64>(1, (m_maxDownloadSize - FIXED_COST - CHUNK_COST) / image.m_blockSize))
+    , m_started(false)
+    , m_finished(false)
+    , m_nextChunk(0)
+    , m_nextBlock(0)
+{
+}
+
+bool SparseImage::Splitter::nextChunk(Chunk &chunk)
+{
+    if (m_image.m_sparse) {
+        if (m_nextChunk >= m_image.m_chunks.size()) {
+            return false;
+        }
+        chunk = m_image.m_chunks.at(m_nextChunk++);
+        return true;
+    }
+    if (m_nextBlock >= m_image.m_totalBlocks) {
+        return false;
+    }
+    chunk = m_image.scanRun(m_source, m_nextBlock, m_scanLimit);
+    m_nextBlock += chunk.blocks;
+    return true;
+}
+
+bool SparseImage::Splitter::next(Download &download, QString *error)
+{
+    if (m_finished) {
+        return false;
+    }
+
+    const qint64 blockSize = m_image.m_blockSize;
+    if (!m_started) {
+        m_started = true;
+        if (m_image.m_sourceSize <= m_maxDownloadSize) {
+            download = Download();
+            Segment segment;
+            segment.sourceSize = m_image.m_sourceSize;
+            download.segments.append(segment);
+            download.size = m_image.m_sourceSize;
+            m_finished = true;
+            return true;
+        }
+        if (m_maxDownloadSize < FIXED_COST + CHUNK_COST + blockSize) {
+            setError(error, QString("max-download-size %1 too small for sparse images").arg(m_maxDownloadSize));
+            m_finished = true;
+            return false;
+        }
+    }
+
+    QList<Chunk> current;
+    qint64 used = FIXED_COST;
+    while (m_remaining.blocks > 0 || nextChunk(m_remaining)) {
+        const qint64 available = m_maxDownloadSize - used - CHUNK_COST;
+        if (m_remaining.type == CHUNK_FILL) {
+            if (available >= 4) {
+                current.append(m_remaining);
+                used += CHUNK_COST + 4;
+                m_remaining.blocks = 0;
+                continue;
+            }
+        } else if (available >= blockSize) {
+            // RAW 区间按块拆分到多个分片
+            Chunk part = m_remaining;
+            part.blocks = static_cast<quint32>(qMin<qint64>(available / blockSize, m_remaining.blocks));
+            const qint64 partBytes = static_cast<qint64>(part.blocks) * blockSize;
+            part.sourceSize = qMin(m_remaining.sourceSize, partBytes);
+            current.append(part);
+            used += CHUNK_COST + partBytes;
+
+            m_remaining.startBlock += part.blocks;
+            m_remaining.blocks -= part.blocks;
+            m_remaining.sourceOffset += partBytes;
+            m_remaining.sourceSize -= part.sourceSize;
+            continue;
+        }
+        // 当前分片已满，剩余部分留给下一个分片
+        break;
+    }
+
+    if (current.isEmpty() || !m_image.buildDownload(current, download, error)) {
+        m_finished = true;
+        return false;
+    }
+    return true;
+}
+
+bool SparseImage::buildDownload(const QList<Chunk> &chunks, Download &download, QString *error) const
+{
+    quint32 chunkCount = 0;
+    quint32 block = 0;
+    for (const Chunk &chunk : chunks) {
+        if (chunk.type == CHUNK_RAW
+            && CHUNK_HEADER_SIZE + static_cast<qint64>(chunk.blocks) * m_blockSize > MAX_CHUNK_SIZE) {
+            setError(error, QString("Sparse RAW chunk at block %1 too large: %2 blocks")
+                .arg(chunk.startBlock).arg(chunk.blocks));
+            return false;
+        }
+        chunkCount += chunk.startBlock > block ? 2 : 1;
+        block = chunk.startBlock + chunk.blocks;
+    }
+    if (block < m_totalBlocks) {
+        ++chunkCount;
+    }
+
+    QByteArray pending;
+    append32(pending, SPARSE_MAGIC);
+    append16(pending, MAJOR_VERSION);
+    append16(pending, 0);
+    append16(pending, FILE_HEADER_SIZE);
+    append16(pending, CHUNK_HEADER_SIZE);
+    append32(pending, m_blockSize);
+    append32(pending, m_totalBlocks);
+    append32(pending, chunkCount);
+    append32(pending, 0);
+
+    download = Download();
+    auto flush = [&download, &pending]() {
+        if (!pending.isEmpty()) {
+            Segment segment;
+            segment.bytes = pending;
+            download.segments.append(segment);
+            download.size += pending.size();
+            pending.clear();
+        }
+    };
+
+    block = 0;
+    for (const Chunk &chunk : chunks) {
+        if (chunk.startBlock > block) {
+            appendChunkHeader(pending, CHUNK_DONT_CARE, chunk.startBlock - block, CHUNK_HEADER_SIZE);
+        }
+
+        if (chunk.type == CHUNK_FILL) {
+            appendChunkHeader(pending, CHUNK_FILL, chunk.blocks, CHUNK_HEADER_SIZE + 4);
+            append32(pending, chunk.fillValue);
+        } else {
+            const qint64 bytes = static_cast<qint64>(chunk.blocks) * m_blockSize;
+            appendChunkHeader(pending, CHUNK_RAW, chunk.blocks, static_cast<quint32>(CHUNK_HEADER_SIZE + bytes));
+            flush();
+
+            Segment segment;
+            segment.sourceOffset = chunk.sourceOffset;
+            segment.sourceSize = chunk.sourceSize;
+            download.segments.append(segment);
+            download.size += segment.sourceSize;
+            // 原始镜像最后不足一块的部分补零
+            pending.append(static_cast<int>(bytes - chunk.sourceSize), '\0');
+        }
+        block = chunk.startBlock + chunk.blocks;
+    }
+
+    if (block < m_totalBlocks) {
+        appendChunkHeader(pending, CHUNK_DONT_CARE, m_totalBlocks - block, CHUNK_HEADER_SIZE);
+    }
+    flush();
+    return true;
+}
@@ -0,0 +1,117 @@
+#ifndef SPARSE_IMAGE_H
+#define SPARSE_IMAGE_H
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <functional>
+
+// Android sparse 镜像 (与 libsparse 格式兼容)：编码、解码，以及按设备的 max-download-size
+// 切分成多个独立的 sparse 镜像 (见 Splitter)
+// 只描述块区间，数据仍引用源镜像 (通常为内存映射) 中的区间，不复制镜像内容
+class SparseImage
+{
+public:
+    static const quint32 SPARSE_MAGIC = 0xed26ff3a;
+    static const quint32 DEFAULT_BLOCK_SIZE = 4096;
+
+    // 一次 download 的一段内容：生成的头部字节，或源镜像中的一个区间
+    struct Segment {
+        QByteArray bytes;
+        qint64 sourceOffset = 0;
+        qint64 sourceSize = 0;
+
+        qint64 size() const;
+    };
+
+    // 一次 download:/flash: 的全部内容
+    struct Download {
+        QList<Segment> segments;
+        qint64 size = 0;
+    };
+
+    // 返回 false 时中止解码
+    using DataSink = std::function<bool(const char *data, qint64 size)>;
+
+    class Splitter;
+
+    SparseImage();
+
+    // 解析 sparse 镜像；非 sparse 的镜像只记录大小，分块扫描推迟到 scan() 或 Splitter 生成下载时
+    bool load(const uchar *data, qint64 size, QString *error = nullptr);
+    // 逐块扫描整个原始镜像：同一个字重复组成的块 (含全零块) 记为 FILL，其余连续的块合并为 RAW
+    // 原始镜像须先扫描才能调用 encodedSize()、encode() 和 expand()；对 sparse 镜像不做任何事
+    void scan(const uchar *data);
+    bool isSparse() const;
+    quint32 blockSize() const;
+    // 写入分区后的大小
+    qint64 expandedSize() const;
+    // 编码为单个 sparse 镜像后的大小
+    qint64 encodedSize() const;
+
+    // 整个镜像编码为一个 sparse 镜像，依次拼接各段即为 sparse 文件内容
+    bool encode(Download &download, QString *error = nullptr) const;
+    // 流式展开为原始数据，source 为 load() 时的数据；DONT_CARE 区间输出为零
+    // 原始镜像编码后展开得到原来的字节，sparse 镜像展开为 total_blks 个块
+    bool expand(const uchar *source, const DataSink &sink, QString *error = nullptr) const;
+
+    static bool isSparseImage(const uchar *data, qint64 size);
+
+private:
+    enum ChunkType : quint16 {
+        CHUNK_RAW = 0xcac1,
+        CHUNK_FILL = 0xcac2,
+        CHUNK_DONT_CARE = 0xcac3,
+        CHUNK_CRC32 = 0xcac4
+    };
+
+    // 有内容的块区间；DONT_CARE 和 CRC32 不记录
+    struct Chunk {
+        ChunkType type = CHUNK_RAW;
+        quint32 startBlock = 0;
+        quint32 blocks = 0;
+        qint64 sourceOffset = 0;
+        qint64 sourceSize = 0;      // RAW 数据在源镜像中的长度，原始镜像的最后一块可能不足一块
+        quint32 fillValue = 0;
+    };
+
+    // 从 startBlock 开始扫描一个 FILL 或 RAW 区间，RAW 区间最多 maxBlocks 块
+    Chunk scanRun(const uchar *source, quint32 startBlock, qint64 maxBlocks) const;
+    // 块头长度放不进 32 位的 RAW 区间返回 false
+    bool buildDownload(const QList<Chunk> &chunks, Download &download, QString *error) const;
+
+    bool m_sparse;
+    qint64 m_sourceSize;
+    quint32 m_blockSize;
+    quint32 m_totalBlocks;
+    QList<Chunk> m_chunks;
+};
+
+// 把镜像切分为若干个不超过 maxDownloadSize 的下载，每次只生成一个
+// 镜像不超过上限时原样发送，不扫描；否则以 sparse 分片发送，每个分片的头部都覆盖全部块，
+// 分片之间以 DONT_CARE 跳过其他分片写入的范围
+// 原始镜像在生成每个分片时才扫描该分片覆盖的块，调用方可在发送上一个分片的同时生成下一个
+// 引用的 SparseImage 和源数据须在使用期间保持有效；不同的 Splitter 可以在多个线程中共用同一个 SparseImage
+class SparseImage::Splitter
+{
+public:
+    Splitter(const SparseImage &image, const uchar *source, qint64 maxDownloadSize);
+
+    // 生成下一个下载；全部生成完毕或出错时返回 false，出错时设置 error
+    bool next(Download &download, QString *error = nullptr);
+
+private:
+    bool nextChunk(Chunk &chunk);
+
+    const SparseImage &m_image;
+    const uchar *m_source;
+    qint64 m_maxDownloadSize;
+    qint64 m_scanLimit;             // 原始镜像每次最多扫描的 RAW 块数，约为一个分片
+    bool m_started;
+    bool m_finished;
+    int m_nextChunk;                // sparse 镜像中下一个区间
+    quint32 m_nextBlock;            // 原始镜像中下一个要扫描的块
+    Chunk m_remaining;              // 上一个分片放不下的剩余部分
+};
+
+#endif // SPARSE_IMAGE_H
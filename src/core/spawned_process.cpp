@@ -0,0 +1,351 @@
+#include "spawned_process.h"
+#include <QFile>
+#include <QProcess>
+#include <QSocketNotifier>
+#include <QTimer>
+#include <QDebug>
+
+#ifndef Q_OS_WIN
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+extern char **environ;
+#endif
+
+#ifdef Q_OS_WIN
+
+SpawnedProcess::SpawnedProcess(QObject *parent)
+    : QObject(parent)
+    , m_process(new QProcess(this))
+    , m_running(false)
+{
+    connect(m_process, &QProcess::readyReadStandardOutput, this, [this]() {
+        emit standardOutput(m_process->readAllStandardOutput());
+    });
+    connect(m_process, &QProcess::readyReadStandardError, this, [this]() {
+        emit standardError(m_process->readAllStandardError());
+    });
+    connect(m_process, &QProcess::finished, this, [this](int exitCode, QProcess::ExitStatus status) {
+        m_running = false;
+        emit finished(exitCode, status == QProcess::CrashExit);
+    });
+}
+
+SpawnedProcess::~SpawnedProcess()
+{
+    m_process->disconnect(this);
+}
+
+bool SpawnedProcess::start(const QString &program, const QStringList &arguments,
+                           const QByteArray &stdIn, QString *error)
+{
+    m_process->start(program, arguments);
+    if (!m_process->waitForStarted()) {
+        if (error) {
+            *error = m_process->errorString();
+        }
+        return false;
+    }
+    if (!stdIn.isEmpty()) {
+        m_process->write(stdIn);
+    }
+    m_process->closeWriteChannel();
+    m_running = true;
+    return true;
+}
+
+void SpawnedProcess::kill()
+{
+    if (m_running) {
+        m_process->kill();
+    }
+}
+
+#else
+
+namespace {
+
+bool setNonBlocking(int fd)
+{
+    int flags = fcntl(fd, F_GETFL);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+bool createPipe(int fds[2])
+{
+    // 带 O_CLOEXEC 创建，子进程中只有 dup2 到 0/1/2 的副本会保留
+#ifdef Q_OS_LINUX
+    return pipe2(fds, O_CLOEXEC) == 0;
+#else
+    if (pipe(fds) != 0) {
+        return false;
+    }
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+    return true;
+#endif
+}
+
+bool createStdInChannel(int fds[2])
+{
+    // 标准输入使用 socketpair，写入时可以避免子进程提前退出引发 SIGPIPE
+    int type = SOCK_STREAM;
+#ifdef SOCK_CLOEXEC
+    type |= SOCK_CLOEXEC;
+#endif
+    if (socketpair(AF_UNIX, type, 0, fds) != 0) {
+        return false;
+    }
+#ifndef SOCK_CLOEXEC
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+#endif
+#ifdef SO_NOSIGPIPE
+    int on = 1;
+    setsockopt(fds[1], SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+    return true;
+}
+
+void closeAll(std::initializer_list<int> fds)
+{
+    for (int fd : fds) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+}
+
+} // namespace
+
+SpawnedProcess::SpawnedProcess(QObject *parent)
+    : QObject(parent)
+    , m_pid(-1)
+    , m_stdInFd(-1)
+    , m_stdOutFd(-1)
+    , m_stdErrFd(-1)
+    , m_stdInNotifier(nullptr)
+    , m_stdOutNotifier(nullptr)
+    , m_stdErrNotifier(nullptr)
+    , m_reapTimer(new QTimer(this))
+    , m_running(false)
+{
+    m_reapTimer->setSingleShot(true);
+    connect(m_reapTimer, &QTimer::timeout, this, &SpawnedProcess::tryReap);
+}
+
+SpawnedProcess::~SpawnedProcess()
+{
+    closeChannel(m_stdInFd, m_stdInNotifier);
+    closeChannel(m_stdOutFd, m_stdOutNotifier);
+    closeChannel(m_stdErrFd, m_stdErrNotifier);
+
+    // 不留下僵尸进程
+    if (m_running) {
+        ::kill(static_cast<pid_t>(m_pid), SIGKILL);
+        waitpid(static_cast<pid_t>(m_pid), nullptr, 0);
+    }
+}
+
+bool SpawnedProcess::start(const QString &program, const QStringList &arguments,
+                           const QByteArray &stdIn, QString *error)
+{
+    auto setError = [error](const QString &message) {
+        if (error) {
+            *error = message;
+        }
+    };
+
+    int inFds[2] = {-1, -1};
+    int outFds[2] = {-1, -1};
+    int errFds[2] = {-1, -1};
+    if (!createStdInChannel(inFds) || !createPipe(outFds) || !createPipe(errFds)) {
+        setError(QString::fromLocal8Bit(strerror(errno)));
+        closeAll({inFds[0], inFds[1], outFds[0], outFds[1], errFds[0], errFds[1]});
+        return false;
+    }
+
+    // argv 指向的内存在 posix_spawn 返回前必须保持有效
+    QByteArray programPath = QFile::encodeName(program);
+    QList<QByteArray> argumentData;
+    argumentData.reserve(arguments.size());
+    for (const QString &argument : arguments) {
+        argumentData.append(argument.toLocal8Bit());
+    }
+    std::vector<char *> argv;
+    argv.reserve(arguments.size() + 2);
+    argv.push_back(programPath.data());
+    for (QByteArray &argument : argumentData) {
+        argv.push_back(argument.data());
+    }
+    argv.push_back(nullptr);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, inFds[0], STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, outFds[1], STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, errFds[1], STDERR_FILENO);
+
+    // 子进程恢复默认的 SIGPIPE 处理
+    posix_spawnattr_t attributes;
+    posix_spawnattr_init(&attributes);
+    sigset_t defaultSignals;
+    sigemptyset(&defaultSignals);
+    sigaddset(&defaultSignals, SIGPIPE);
+    posix_spawnattr_setsigdefault(&attributes, &defaultSignals);
+    posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETSIGDEF);
+
+    pid_t pid = -1;
+    int rc = posix_spawn(&pid, programPath.constData(), &actions, &attributes, argv.data(), environ);
+
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attributes);
+    closeAll({inFds[0], outFds[1], errFds[1]});
+
+    if (rc != 0) {
+        setError(QString::fromLocal8Bit(strerror(rc)));
+        closeAll({inFds[1], outFds[0], errFds[0]});
+        return false;
+    }
+
+    m_pid = pid;
+    m_running = true;
+    m_stdInFd = inFds[1];
+    m_stdOutFd = outFds[0];
+    m_stdErrFd = errFds[0];
+    setNonBlocking(m_stdInFd);
+    setNonBlocking(m_stdOutFd);
+    setNonBlocking(m_stdErrFd);
+
+    m_stdOutNotifier = new QSocketNotifier(m_stdOutFd, QSocketNotifier::Read, this);
+    connect(m_stdOutNotifier, &QSocketNotifier::activated, this, [this]() {
+        readChannel(m_stdOutFd, m_stdOutNotifier, false);
+    });
+    m_stdErrNotifier = new QSocketNotifier(m_stdErrFd, QSocketNotifier::Read, this);
+    connect(m_stdErrNotifier, &QSocketNotifier::activated, this, [this]() {
+        readChannel(m_stdErrFd, m_stdErrNotifier, true);
+    });
+
+    m_pendingStdIn = stdIn;
+    if (m_pendingStdIn.isEmpty()) {
+        closeChannel(m_stdInFd, m_stdInNotifier);
+    } else {
+        m_stdInNotifier = new QSocketNotifier(m_stdInFd, QSocketNotifier::Write, this);
+        connect(m_stdInNotifier, &QSocketNotifier::activated, this, &SpawnedProcess::writeStdIn);
+    }
+    return true;
+}
+
+void SpawnedProcess::kill()
+{
+    // 管道随子进程退出关闭，之后在 tryReap 中回收
+    if (m_running) {
+        ::kill(static_cast<pid_t>(m_pid), SIGKILL);
+    }
+}
+
+void SpawnedProcess::readChannel(int &fd, QSocketNotifier *&notifier, bool isStdErr)
+{
+    char buffer[65536];
+    for (;;) {
+        ssize_t count = ::read(fd, buffer, sizeof(buffer));
+        if (count > 0) {
+            QByteArray data(buffer, static_cast<qsizetype>(count));
+            if (isStdErr) {
+                emit standardError(data);
+            } else {
+                emit standardOutput(data);
+            }
+            continue;
+        }
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return;
+        }
+
+        // EOF 或读取错误
+        closeChannel(fd, notifier);
+        tryReap();
+        return;
+    }
+}
+
+void SpawnedProcess::writeStdIn()
+{
+    while (!m_pendingStdIn.isEmpty()) {
+        int flags = 0;
+#ifdef MSG_NOSIGNAL
+        flags = MSG_NOSIGNAL;
+#endif
+        ssize_t count = ::send(m_stdInFd, m_pendingStdIn.constData(),
+                               static_cast<size_t>(m_pendingStdIn.size()), flags);
+        if (count > 0) {
+            m_pendingStdIn.remove(0, static_cast<qsizetype>(count));
+            continue;
+        }
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return;
+        }
+        // 子进程已关闭标准输入
+        m_pendingStdIn.clear();
+    }
+    closeChannel(m_stdInFd, m_stdInNotifier);
+}
+
+void SpawnedProcess::closeChannel(int &fd, QSocketNotifier *&notifier)
+{
+    if (notifier) {
+        notifier->setEnabled(false);
+        notifier->deleteLater();
+        notifier = nullptr;
+    }
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+void SpawnedProcess::tryReap()
+{
+    // 输出管道都关闭后子进程通常已经退出，否则稍后再查询
+    if (!m_running || m_stdOutFd >= 0 || m_stdErrFd >= 0) {
+        return;
+    }
+
+    int status = 0;
+    pid_t result = waitpid(static_cast<pid_t>(m_pid), &status, WNOHANG);
+    if (result == 0) {
+        m_reapTimer->start(10);
+        return;
+    }
+
+    m_running = false;
+    closeChannel(m_stdInFd, m_stdInNotifier);
+    if (result < 0) {
+        qWarning() << "waitpid failed for" << m_pid << ":" << strerror(errno);
+        emit finished(-1, true);
+    } else if (WIFEXITED(status)) {
+        emit finished(WEXITSTATUS(status), false);
+    } else {
+        emit finished(-1, true);
+    }
+}
+
+#endif
+
+bool SpawnedProcess::isRunning() const
+{
+    return m_running;
+}
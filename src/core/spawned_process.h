@@ -0,0 +1,57 @@
+#ifndef SPAWNED_PROCESS_H
+#define SPAWNED_PROCESS_H
+
+#include <QByteArray>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+
+class QProcess;
+class QSocketNotifier;
+class QTimer;
+
+// 轻量子进程封装，必须在有事件循环的线程中使用
+// Unix 下通过 posix_spawn (glibc 内部为 vfork 式 clone) 启动，标准输入输出在启动前建立好，
+// 读写由 QSocketNotifier 驱动；Windows 下由 QProcess 实现
+class SpawnedProcess : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SpawnedProcess(QObject *parent = nullptr);
+    ~SpawnedProcess();
+
+    // stdIn 写完后关闭子进程的标准输入；为空时立即关闭
+    bool start(const QString &program, const QStringList &arguments,
+               const QByteArray &stdIn, QString *error = nullptr);
+    void kill();
+    bool isRunning() const;
+
+signals:
+    void standardOutput(const QByteArray &data);
+    void standardError(const QByteArray &data);
+    void finished(int exitCode, bool crashed);
+
+private:
+#ifdef Q_OS_WIN
+    QProcess *m_process;
+#else
+    void readChannel(int &fd, QSocketNotifier *&notifier, bool isStdErr);
+    void writeStdIn();
+    void closeChannel(int &fd, QSocketNotifier *&notifier);
+    void tryReap();
+
+    qint64 m_pid;
+    int m_stdInFd;
+    int m_stdOutFd;
+    int m_stdErrFd;
+    QSocketNotifier *m_stdInNotifier;
+    QSocketNotifier *m_stdOutNotifier;
+    QSocketNotifier *m_stdErrNotifier;
+    QByteArray m_pendingStdIn;
+    QTimer *m_reapTimer;
+#endif
+    bool m_running;
+};
+
+#endif // SPAWNED_PROCESS_H
@@ -0,0 +1,82 @@
+#include "startup_timing.h"
+#include <QEvent>
+#include <QMutexLocker>
+#include <QTimer>
+#include <QWidget>
+#include <QDebug>
+#include <cstring>
+
+namespace {
+
+class FirstFrameFilter : public QObject
+{
+public:
+    using QObject::QObject;
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override
+    {
+        if (event->type() == QEvent::Paint || event->type() == QEvent::UpdateRequest) {
+            // 事件处理完后内容才会提交到屏幕
+            QTimer::singleShot(0, []() { StartupTiming::mark("first-frame"); });
+            watched->removeEventFilter(this);
+            deleteLater();
+        }
+        return false;
+    }
+};
+
+} // namespace
+
+StartupTiming &StartupTiming::instance()
+{
+    static StartupTiming timing;
+    return timing;
+}
+
+void StartupTiming::begin(int argc, char *argv[])
+{
+    StartupTiming &timing = instance();
+    timing.m_timer.start();
+
+    timing.m_enabled = !qEnvironmentVariableIsEmpty("PTB_STARTUP_TIMING");
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--startup-timing") == 0) {
+            timing.m_enabled = true;
+        }
+    }
+}
+
+bool StartupTiming::isEnabled()
+{
+    return instance().m_enabled;
+}
+
+void StartupTiming::mark(const QString &stage)
+{
+    StartupTiming &timing = instance();
+    if (!timing.m_enabled) {
+        return;
+    }
+
+    QMutexLocker locker(&timing.m_mutex);
+    if (timing.m_reached.contains(stage)) {
+        return;
+    }
+    timing.m_reached.insert(stage);
+
+    qint64 elapsed = timing.m_timer.elapsed();
+    qInfo().noquote() << QString("[startup] %1 ms (+%2 ms) %3")
+                             .arg(elapsed, 6)
+                             .arg(elapsed - timing.m_lastMark, 5)
+                             .arg(stage);
+    timing.m_lastMark = elapsed;
+}
+
+void StartupTiming::watchFirstFrame(QWidget *window)
+{
+    if (!isEnabled() || !window) {
+        return;
+    }
+    window->installEventFilter(new FirstFrameFilter(window));
+}
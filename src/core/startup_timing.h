@@ -0,0 +1,35 @@
+#ifndef STARTUP_TIMING_H
+#define STARTUP_TIMING_H
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QSet>
+#include <QString>
+
+class QWidget;
+
+// 启动耗时统计，通过 --startup-timing 参数或 PTB_STARTUP_TIMING 环境变量开启
+// 各阶段只记录第一次到达的时间，输出距进程启动的总耗时和距上一阶段的耗时
+class StartupTiming
+{
+public:
+    // 在 main() 最开始调用，计时从此处开始
+    static void begin(int argc, char *argv[]);
+    static bool isEnabled();
+
+    // 可在任意线程调用
+    static void mark(const QString &stage);
+    // 窗口第一次绘制完成时记录 first-frame
+    static void watchFirstFrame(QWidget *window);
+
+private:
+    static StartupTiming &instance();
+
+    QElapsedTimer m_timer;
+    QMutex m_mutex;
+    QSet<QString> m_reached;
+    qint64 m_lastMark = 0;
+    bool m_enabled = false;
+};
+
+#endif // STARTUP_TIMING_H
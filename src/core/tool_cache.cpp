@@ -0,0 +1,262 @@
+#include "tool_cache.h"
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QLockFile>
+#include <QResource>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QDebug>
+
+#ifdef PTB_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+namespace {
+
+const char COMPLETE_MARKER[] = ".complete";
+const int LOCK_TIMEOUT = 30000;
+const int INFLATE_CHUNK_SIZE = 256 * 1024;
+
+void setError(QString *error, const QString &message)
+{
+    if (error) {
+        *error = message;
+    }
+}
+
+#ifdef PTB_HAVE_ZLIB
+// rcc 的 zlib 压缩格式与 qCompress 相同：4字节大端原始长度 + zlib 数据流
+// 分块解压并直接写入文件，不在内存中保留完整的解压结果
+bool inflateToFile(const QResource &resource, QFile &output, QString *error)
+{
+    const uchar *data = resource.data();
+    qint64 size = resource.size();
+    if (size < 4) {
+        setError(error, "Corrupt compressed resource " + resource.fileName());
+        return false;
+    }
+
+    z_stream stream = {};
+    if (inflateInit(&stream) != Z_OK) {
+        setError(error, "inflateInit failed");
+        return false;
+    }
+    stream.next_in = const_cast<Bytef *>(data + 4);
+    stream.avail_in = static_cast<uInt>(size - 4);
+
+    QByteArray buffer(INFLATE_CHUNK_SIZE, Qt::Uninitialized);
+    int rc = Z_OK;
+    while (rc != Z_STREAM_END) {
+        stream.next_out = reinterpret_cast<Bytef *>(buffer.data());
+        stream.avail_out = static_cast<uInt>(buffer.size());
+        rc = inflate(&stream, Z_NO_FLUSH);
+        if (rc != Z_OK && rc != Z_STREAM_END) {
+            inflateEnd(&stream);
+            setError(error, QString("Failed to inflate %1: %2")
+                     .arg(resource.fileName(), stream.msg ? stream.msg : "zlib error"));
+            return false;
+        }
+        qint64 produced = buffer.size() - stream.avail_out;
+        if (output.write(buffer.constData(), produced) != produced) {
+            inflateEnd(&stream);
+            setError(error, "Failed to write " + output.fileName() + ": " + output.errorString());
+            return false;
+        }
+    }
+    inflateEnd(&stream);
+
+    if (output.size() != resource.uncompressedSize()) {
+        setError(error, "Size mismatch after inflating " + resource.fileName());
+        return false;
+    }
+    return true;
+}
+#endif
+
+bool writeResource(const QString &resourcePath, const QString &outputPath, QString *error)
+{
+    QResource resource(resourcePath);
+    if (!resource.isValid()) {
+        setError(error, "Resource file not found: " + resourcePath);
+        return false;
+    }
+
+    QFile::remove(outputPath);
+    QFile output(outputPath);
+    if (!output.open(QIODevice::WriteOnly)) {
+        setError(error, "Failed to create " + outputPath + ": " + output.errorString());
+        return false;
+    }
+
+    switch (resource.compressionAlgorithm()) {
+    case QResource::NoCompression:
+        if (output.write(reinterpret_cast<const char *>(resource.data()), resource.size()) != resource.size()) {
+            setError(error, "Failed to write " + outputPath + ": " + output.errorString());
+            return false;
+        }
+        return true;
+#ifdef PTB_HAVE_ZLIB
+    case QResource::ZlibCompression:
+        return inflateToFile(resource, output, error);
+#endif
+    default:
+        break;
+    }
+
+    // 其他压缩格式交给Qt整体解压
+    output.close();
+    QFile::remove(outputPath);
+    QFile resourceFile(resourcePath);
+    if (!resourceFile.copy(outputPath)) {
+        setError(error, "Failed to copy " + resourcePath + " to " + outputPath
+                 + ": " + resourceFile.errorString());
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+ToolCache::ToolCache(const QList<Entry> &entries)
+    : m_entries(entries)
+    , m_key(computeKey())
+{
+}
+
+QString ToolCache::key() const
+{
+    return m_key;
+}
+
+bool ToolCache::prepare(QString &directory, QString *error)
+{
+    QString root = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if (root.isEmpty() || m_key.isEmpty()) {
+        setError(error, "No cache location available");
+        return false;
+    }
+    root += "/tools";
+    if (!QDir().mkpath(root)) {
+        setError(error, "Cannot create cache directory " + root);
+        return false;
+    }
+
+    const QString target = root + "/" + m_key;
+
+    // 热启动：已完整解压则直接使用
+    if (isComplete(target)) {
+        directory = target;
+        return true;
+    }
+
+    QLockFile lock(root + "/" + m_key + ".lock");
+    lock.setStaleLockTime(LOCK_TIMEOUT * 2);
+    if (!lock.tryLock(LOCK_TIMEOUT)) {
+        setError(error, "Timed out waiting for tool cache lock");
+        return false;
+    }
+
+    // 等待锁期间其他实例可能已完成解压
+    if (isComplete(target)) {
+        directory = target;
+        return true;
+    }
+
+    // 上次解压中断留下的残缺目录
+    if (QFileInfo::exists(target) && !QDir(target).removeRecursively()) {
+        setError(error, "Cannot remove incomplete tool cache " + target);
+        return false;
+    }
+
+    QTemporaryDir staging(root + "/" + m_key + "-XXXXXX");
+    if (!staging.isValid()) {
+        setError(error, "Cannot create staging directory: " + staging.errorString());
+        return false;
+    }
+    if (!extractTo(m_entries, staging.path(), error)) {
+        return false;
+    }
+
+    QFile marker(staging.path() + "/" + COMPLETE_MARKER);
+    if (!marker.open(QIODevice::WriteOnly) || marker.write(m_key.toLatin1()) != m_key.size()) {
+        setError(error, "Cannot write tool cache marker");
+        return false;
+    }
+    marker.close();
+
+    if (!QDir().rename(staging.path(), target)) {
+        setError(error, "Cannot move tool cache into place: " + target);
+        return false;
+    }
+    staging.setAutoRemove(false);
+
+    qDebug() << "Embedded tools cached in" << target;
+    directory = target;
+    return true;
+}
+
+bool ToolCache::extractTo(const QList<Entry> &entries, const QString &directory, QString *error)
+{
+    for (const Entry &entry : entries) {
+        const QString outputPath = directory + "/" + entry.fileName;
+        if (!writeResource(entry.resourcePath, outputPath, error)) {
+            return false;
+        }
+
+        // 补上可执行权限
+        QFileDevice::Permissions permissions = QFileDevice::ReadOwner | QFileDevice::WriteOwner
+            | QFileDevice::ExeOwner | QFileDevice::ReadGroup | QFileDevice::ExeGroup
+            | QFileDevice::ReadOther | QFileDevice::ExeOther;
+        if (!QFile::setPermissions(outputPath, permissions)) {
+            setError(error, "Failed to set executable permissions for " + outputPath);
+            return false;
+        }
+
+        qDebug() << "Extracted:" << outputPath;
+    }
+    return true;
+}
+
+bool ToolCache::isComplete(const QString &directory) const
+{
+    // 完成标记在所有文件写入后才创建
+    QFile marker(directory + "/" + COMPLETE_MARKER);
+    if (!marker.open(QIODevice::ReadOnly) || marker.readAll() != m_key.toLatin1()) {
+        return false;
+    }
+
+    for (const Entry &entry : m_entries) {
+        QFileInfo file(directory + "/" + entry.fileName);
+        QResource resource(entry.resourcePath);
+        bool valid = file.isFile() && file.size() == resource.uncompressedSize();
+#ifndef Q_OS_WIN
+        valid = valid && file.isExecutable();
+#endif
+        if (!valid) {
+            qWarning() << "Tool cache entry invalid:" << file.filePath();
+            return false;
+        }
+    }
+    return true;
+}
+
+QString ToolCache::computeKey() const
+{
+#ifdef PTB_EMBEDDED_TOOLS_HASH
+    return QStringLiteral(PTB_EMBEDDED_TOOLS_HASH).left(32);
+#else
+    // 构建系统未提供哈希时对资源内容计算 (资源已映射在内存中，不涉及磁盘读取)
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    for (const Entry &entry : m_entries) {
+        QFile resourceFile(entry.resourcePath);
+        if (!resourceFile.open(QIODevice::ReadOnly)) {
+            return QString();
+        }
+        hash.addData(entry.fileName.toUtf8());
+        hash.addData(&resourceFile);
+    }
+    return QString::fromLatin1(hash.result().toHex().left(32));
+#endif
+}
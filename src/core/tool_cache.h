@@ -0,0 +1,36 @@
+#ifndef TOOL_CACHE_H
+#define TOOL_CACHE_H
+
+#include <QList>
+#include <QString>
+
+// 内嵌 adb/fastboot 的持久化缓存，位于用户缓存目录下的 tools/<内容哈希>
+// 哈希由 CMake 在配置时根据内嵌二进制计算 (PTB_EMBEDDED_TOOLS_HASH)，未定义时在运行时对资源计算
+// 热启动只校验完成标记和文件大小，不重新解压；首次解压由 QLockFile 串行化，
+// 先写入临时目录再整体重命名，多个实例可以安全共用同一份文件
+class ToolCache
+{
+public:
+    struct Entry {
+        QString resourcePath;
+        QString fileName;
+    };
+
+    explicit ToolCache(const QList<Entry> &entries);
+
+    // 成功时 directory 为可直接使用的工具目录
+    bool prepare(QString &directory, QString *error = nullptr);
+    QString key() const;
+
+    // 解压到指定目录并设置可执行权限，zlib 压缩的资源分块流式解压；也供缓存不可用时回退使用
+    static bool extractTo(const QList<Entry> &entries, const QString &directory, QString *error = nullptr);
+
+private:
+    bool isComplete(const QString &directory) const;
+    QString computeKey() const;
+
+    QList<Entry> m_entries;
+    QString m_key;
+};
+
+#endif // TOOL_CACHE_H
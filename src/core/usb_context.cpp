@@ -0,0 +1,161 @@
+#include "usb_context.h"
+#include <QDebug>
+#include <QMutexLocker>
+#include <QSet>
+#include <libusb.h>
+
+namespace {
+
+// Android USB 接口定义 (system/core/adb/adb.h, fastboot/usb.h)
+const quint8 ANDROID_INTERFACE_CLASS = 0xff;
+const quint8 ANDROID_INTERFACE_SUBCLASS = 0x42;
+const quint8 ADB_INTERFACE_PROTOCOL = 0x01;
+const quint8 FASTBOOT_INTERFACE_PROTOCOL = 0x03;
+
+} // namespace
+
+bool UsbDeviceDescription::hasInterface(quint8 cls, quint8 subClass, quint8 protocol) const
+{
+    for (const UsbInterfaceClass &iface : interfaces) {
+        if (iface.interfaceClass == cls
+            && iface.interfaceSubClass == subClass
+            && iface.interfaceProtocol == protocol) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool UsbDeviceDescription::isAdbInterface() const
+{
+    return hasInterface(ANDROID_INTERFACE_CLASS, ANDROID_INTERFACE_SUBCLASS, ADB_INTERFACE_PROTOCOL);
+}
+
+bool UsbDeviceDescription::isFastbootInterface() const
+{
+    return hasInterface(ANDROID_INTERFACE_CLASS, ANDROID_INTERFACE_SUBCLASS, FASTBOOT_INTERFACE_PROTOCOL);
+}
+
+UsbContext::UsbContext()
+    : m_context(nullptr)
+{
+    int result = libusb_init(&m_context);
+    if (result != LIBUSB_SUCCESS) {
+        qWarning() << "Failed to initialize libusb:" << libusb_error_name(result);
+        m_context = nullptr;
+    }
+}
+
+UsbContext::~UsbContext()
+{
+    for (auto it = m_descriptionCache.begin(); it != m_descriptionCache.end(); ++it) {
+        libusb_unref_device(it.key());
+    }
+    m_descriptionCache.clear();
+
+    if (m_context) {
+        libusb_exit(m_context);
+    }
+}
+
+UsbContext& UsbContext::instance()
+{
+    static UsbContext instance;
+    return instance;
+}
+
+bool UsbContext::isValid() const
+{
+    return m_context != nullptr;
+}
+
+libusb_context *UsbContext::context() const
+{
+    return m_context;
+}
+
+bool UsbContext::describeDevice(libusb_device *device, UsbDeviceDescription &description)
+{
+    libusb_device_descriptor descriptor;
+    if (libusb_get_device_descriptor(device, &descriptor) != LIBUSB_SUCCESS) {
+        return false;
+    }
+
+    description.vendorId = descriptor.idVendor;
+    description.productId = descriptor.idProduct;
+    description.busNumber = libusb_get_bus_number(device);
+    description.deviceAddress = libusb_get_device_address(device);
+
+    // 端口路径在设备重新枚举后保持不变，可作为无序列号设备的标识
+    uint8_t ports[8];
+    int depth = libusb_get_port_numbers(device, ports, sizeof(ports));
+    description.portPath = QString::number(description.busNumber);
+    for (int i = 0; i < depth; ++i) {
+        description.portPath += (i == 0 ? "-" : ".") + QString::number(ports[i]);
+    }
+
+    // 读取当前配置描述符不需要打开设备
+    description.interfaces.clear();
+    libusb_config_descriptor *config = nullptr;
+    if (libusb_get_active_config_descriptor(device, &config) == LIBUSB_SUCCESS && config) {
+        for (int i = 0; i < config->bNumInterfaces; ++i) {
+            const libusb_interface &iface = config->interface[i];
+            for (int alt = 0; alt < iface.num_altsetting; ++alt) {
+                const libusb_interface_descriptor &setting = iface.altsetting[alt];
+                UsbInterfaceClass interfaceClass;
+                interfaceClass.interfaceClass = setting.bInterfaceClass;
+                interfaceClass.interfaceSubClass = setting.bInterfaceSubClass;
+                interfaceClass.interfaceProtocol = setting.bInterfaceProtocol;
+                description.interfaces.append(interfaceClass);
+            }
+        }
+        libusb_free_config_descriptor(config);
+    }
+    return true;
+}
+
+bool UsbContext::devices(QList<UsbDeviceDescription> &devices)
+{
+    if (!m_context) {
+        return false;
+    }
+
+    QMutexLocker locker(&m_cacheMutex);
+
+    libusb_device **list = nullptr;
+    ssize_t count = libusb_get_device_list(m_context, &list);
+    if (count < 0) {
+        return false;
+    }
+
+    QSet<libusb_device*> present;
+    present.reserve(static_cast<int>(count));
+    for (ssize_t i = 0; i < count; ++i) {
+        libusb_device *device = list[i];
+        present.insert(device);
+
+        auto cached = m_descriptionCache.constFind(device);
+        if (cached != m_descriptionCache.constEnd()) {
+            devices.append(cached.value());
+            continue;
+        }
+
+        UsbDeviceDescription description;
+        if (describeDevice(device, description)) {
+            m_descriptionCache.insert(libusb_ref_device(device), description);
+            devices.append(description);
+        }
+    }
+    libusb_free_device_list(list, 1);
+
+    // 释放已拔出设备的引用
+    for (auto it = m_descriptionCache.begin(); it != m_descriptionCache.end();) {
+        if (!present.contains(it.key())) {
+            libusb_unref_device(it.key());
+            it = m_descriptionCache.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,63 @@
+#ifndef USB_CONTEXT_H
+#define USB_CONTEXT_H
+
+#include <QHash>
+#include <QList>
+#include <QMetaType>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+
+struct libusb_context;
+struct libusb_device;
+
+// USB接口的类/子类/协议三元组
+struct UsbInterfaceClass {
+    quint8 interfaceClass = 0;
+    quint8 interfaceSubClass = 0;
+    quint8 interfaceProtocol = 0;
+};
+
+// 无需打开设备即可从描述符获得的信息
+struct UsbDeviceDescription {
+    quint16 vendorId = 0;
+    quint16 productId = 0;
+    quint8 busNumber = 0;
+    quint8 deviceAddress = 0;
+    QString portPath;           // 形如 "1-2.3"，与 sysfs 及 fastboot devices -l 一致
+    QVector<UsbInterfaceClass> interfaces;
+
+    bool hasInterface(quint8 cls, quint8 subClass, quint8 protocol) const;
+    bool isAdbInterface() const;
+    bool isFastbootInterface() const;
+};
+
+Q_DECLARE_METATYPE(UsbDeviceDescription)
+
+// 进程内共享的 libusb 上下文
+class UsbContext
+{
+public:
+    static UsbContext& instance();
+
+    bool isValid() const;
+    libusb_context *context() const;
+
+    static bool describeDevice(libusb_device *device, UsbDeviceDescription &description);
+
+    // 当前连接的所有设备，可在任意线程调用
+    // 描述按设备缓存，只有新出现的设备才读取描述符，已知设备的扫描只需取一次设备列表
+    bool devices(QList<UsbDeviceDescription> &devices);
+
+private:
+    UsbContext();
+    ~UsbContext();
+    UsbContext(const UsbContext &) = delete;
+    UsbContext &operator=(const UsbContext &) = delete;
+
+    libusb_context *m_context;
+    QMutex m_cacheMutex;
+    QHash<libusb_device*, UsbDeviceDescription> m_descriptionCache;   // 持有设备引用，指针不会被复用
+};
+
+#endif // USB_CONTEXT_H
@@ -0,0 +1,201 @@
+#include "usb_hotplug_monitor.h"
+#include <QDebug>
+#include <QSet>
+#include <chrono>
+#include <libusb.h>
+
+namespace {
+
+int LIBUSB_CALL libusbHotplugCallback(libusb_context *, libusb_device *device,
+                                      libusb_hotplug_event event, void *userData)
+{
+    auto *source = static_cast<LibusbHotplugSource*>(userData);
+    source->handleEvent(device, event == LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED);
+    return 0; // 保持回调注册
+}
+
+const int POLL_FALLBACK_INTERVAL_MS = 500;
+
+} // namespace
+
+LibusbHotplugSource::LibusbHotplugSource()
+    : m_running(false)
+    , m_callbackHandle(0)
+    , m_hotplugRegistered(false)
+{
+}
+
+LibusbHotplugSource::~LibusbHotplugSource()
+{
+    stop();
+}
+
+bool LibusbHotplugSource::start(const Callback &callback)
+{
+    libusb_context *ctx = UsbContext::instance().context();
+    if (!ctx || m_running) {
+        return false;
+    }
+
+    m_callback = callback;
+    m_running = true;
+
+    if (libusb_has_capability(LIBUSB_CAP_HAS_HOTPLUG)) {
+        // ENUMERATE 标志会在注册时为已连接的设备补发插入事件
+        int result = libusb_hotplug_register_callback(
+            ctx,
+            static_cast<libusb_hotplug_event>(LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED | LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT),
+            LIBUSB_HOTPLUG_ENUMERATE,
+            LIBUSB_HOTPLUG_MATCH_ANY, LIBUSB_HOTPLUG_MATCH_ANY, LIBUSB_HOTPLUG_MATCH_ANY,
+            libusbHotplugCallback, this, &m_callbackHandle);
+
+        if (result == LIBUSB_SUCCESS) {
+            m_hotplugRegistered = true;
+            m_thread = std::thread(&LibusbHotplugSource::eventLoop, this);
+            return true;
+        }
+        qWarning() << "libusb hotplug registration failed:" << libusb_error_name(result);
+    }
+
+    qDebug() << "libusb hotplug not supported, falling back to device list polling";
+    m_thread = std::thread(&LibusbHotplugSource::pollLoop, this);
+    return true;
+}
+
+void LibusbHotplugSource::stop()
+{
+    if (!m_running) {
+        return;
+    }
+    m_running = false;
+
+    libusb_context *ctx = UsbContext::instance().context();
+    if (m_hotplugRegistered) {
+        // 注销回调会唤醒正在等待事件的线程
+        libusb_hotplug_deregister_callback(ctx, m_callbackHandle);
+        m_hotplugRegistered = false;
+    }
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+
+    for (auto it = m_knownDevices.begin(); it != m_knownDevices.end(); ++it) {
+        libusb_unref_device(it.key());
+    }
+    m_knownDevices.clear();
+}
+
+void LibusbHotplugSource::handleEvent(libusb_device *device, bool arrived)
+{
+    UsbDeviceDescription description;
+
+    if (arrived) {
+        if (m_knownDevices.contains(device) || !UsbContext::describeDevice(device, description)) {
+            return;
+        }
+        m_knownDevices.insert(libusb_ref_device(device), description);
+    } else {
+        auto it = m_knownDevices.find(device);
+        if (it == m_knownDevices.end()) {
+            return;
+        }
+        description = it.value();
+        m_knownDevices.erase(it);
+        libusb_unref_device(device);
+    }
+
+    if (m_callback) {
+        m_callback(arrived, description);
+    }
+}
+
+void LibusbHotplugSource::eventLoop()
+{
+    libusb_context *ctx = UsbContext::instance().context();
+    while (m_running) {
+        timeval timeout = {0, 250000};
+        libusb_handle_events_timeout_completed(ctx, &timeout, nullptr);
+    }
+}
+
+void LibusbHotplugSource::pollLoop()
+{
+    libusb_context *ctx = UsbContext::instance().context();
+    while (m_running) {
+        libusb_device **list = nullptr;
+        ssize_t count = libusb_get_device_list(ctx, &list);
+
+        QSet<libusb_device*> present;
+        for (ssize_t i = 0; i < count; ++i) {
+            present.insert(list[i]);
+            handleEvent(list[i], true);
+        }
+
+        const QList<libusb_device*> known = m_knownDevices.keys();
+        for (libusb_device *device : known) {
+            if (!present.contains(device)) {
+                handleEvent(device, false);
+            }
+        }
+
+        if (list) {
+            libusb_free_device_list(list, 1);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(POLL_FALLBACK_INTERVAL_MS));
+    }
+}
+
+UsbHotplugMonitor::UsbHotplugMonitor(QObject *parent)
+    : UsbHotplugMonitor(std::make_unique<LibusbHotplugSource>(), parent)
+{
+}
+
+UsbHotplugMonitor::UsbHotplugMonitor(std::unique_ptr<UsbHotplugSource> source, QObject *parent)
+    : QObject(parent)
+    , m_source(std::move(source))
+    , m_running(false)
+{
+    qRegisterMetaType<UsbDeviceDescription>();
+}
+
+UsbHotplugMonitor::~UsbHotplugMonitor()
+{
+    stop();
+}
+
+bool UsbHotplugMonitor::start()
+{
+    if (m_running) {
+        return true;
+    }
+
+    // 事件来自libusb线程，统一排队到本对象所在线程后再发出信号
+    m_running = m_source->start([this](bool arrived, const UsbDeviceDescription &device) {
+        QMetaObject::invokeMethod(this, [this, arrived, device]() {
+            if (arrived) {
+                emit deviceArrived(device);
+            } else {
+                emit deviceLeft(device);
+            }
+        }, Qt::QueuedConnection);
+    });
+
+    if (m_running) {
+        qDebug() << "USB hotplug monitoring started";
+    }
+    return m_running;
+}
+
+void UsbHotplugMonitor::stop()
+{
+    if (!m_running) {
+        return;
+    }
+    m_source->stop();
+    m_running = false;
+}
+
+bool UsbHotplugMonitor::isRunning() const
+{
+    return m_running;
+}
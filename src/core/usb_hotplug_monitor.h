@@ -0,0 +1,75 @@
+#ifndef USB_HOTPLUG_MONITOR_H
+#define USB_HOTPLUG_MONITOR_H
+
+#include <QObject>
+#include <QHash>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <thread>
+#include "usb_context.h"
+
+// USB插拔事件来源，可替换为测试用的模拟实现
+class UsbHotplugSource
+{
+public:
+    using Callback = std::function<void(bool arrived, const UsbDeviceDescription &device)>;
+
+    virtual ~UsbHotplugSource() = default;
+
+    // 回调可能在任意线程中被调用
+    virtual bool start(const Callback &callback) = 0;
+    virtual void stop() = 0;
+};
+
+// 基于 libusb 的事件来源，在独立线程中处理libusb事件
+// 平台不支持热插拔时退化为定时比较设备列表
+class LibusbHotplugSource : public UsbHotplugSource
+{
+public:
+    LibusbHotplugSource();
+    ~LibusbHotplugSource() override;
+
+    bool start(const Callback &callback) override;
+    void stop() override;
+
+    // 由libusb热插拔回调调用
+    void handleEvent(libusb_device *device, bool arrived);
+
+private:
+    void eventLoop();
+    void pollLoop();
+
+    Callback m_callback;
+    std::thread m_thread;
+    std::atomic<bool> m_running;
+    int m_callbackHandle;
+    bool m_hotplugRegistered;
+
+    // 设备拔出后无法再读取描述符，按设备指针保留插入时的描述
+    QHash<libusb_device*, UsbDeviceDescription> m_knownDevices;
+};
+
+class UsbHotplugMonitor : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit UsbHotplugMonitor(QObject *parent = nullptr);
+    UsbHotplugMonitor(std::unique_ptr<UsbHotplugSource> source, QObject *parent = nullptr);
+    ~UsbHotplugMonitor();
+
+    bool start();
+    void stop();
+    bool isRunning() const;
+
+signals:
+    void deviceArrived(const UsbDeviceDescription &device);
+    void deviceLeft(const UsbDeviceDescription &device);
+
+private:
+    std::unique_ptr<UsbHotplugSource> m_source;
+    bool m_running;
+};
+
+#endif // USB_HOTPLUG_MONITOR_H
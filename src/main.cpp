@@ -1,8 +1,10 @@
 #include <QApplication>
 #include "ui/main_window.h"
+#include "core/startup_timing.h"
 
 int main(int argc, char *argv[])
 {
+    StartupTiming::begin(argc, argv);
     QApplication app(argc, argv);
     
     // 设置应用信息
@@ -13,7 +15,11 @@ int main(int argc, char *argv[])
     // 设置应用程序样式
     app.setStyle("Fusion");
     
+    StartupTiming::mark("application");
+    
     MainWindow window;
+    StartupTiming::mark("window-created");
+    StartupTiming::watchFirstFrame(&window);
     window.show();
     
     return app.exec();
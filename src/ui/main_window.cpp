@@ -14,15 +14,11 @@ MainWindow::MainWindow(QWidget *parent)
     setupUI();
     setupConnections();
     
-    // 初始化ADB和设备检测
-    if (AdbEmbedded::instance().initialize()) {
-        m_deviceDetector.startMonitoring();
-        m_outputPanel->appendOutput("✅ ADB 初始化成功");
-    } else {
-        m_outputPanel->appendOutput("❌ 无法初始化嵌入式ADB工具", true);
-    }
-    
     m_outputPanel->appendOutput("🚀 Phone Toolbox 已启动");
+    
+    // 工具在后台启动，窗口无需等待；各工具就绪后设备检测自动跟进
+    m_outputPanel->appendOutput("⏳ 正在启动 ADB/Fastboot 工具...");
+    m_deviceDetector.startMonitoring();
 }
 
 MainWindow::~MainWindow()
@@ -74,6 +70,12 @@ void MainWindow::setupUI()
 
 void MainWindow::setupConnections()
 {
+    // 工具启动状态
+    connect(&AdbEmbedded::instance(), &AdbEmbedded::adbStateChanged,
+            this, &MainWindow::onAdbStateChanged);
+    connect(&AdbEmbedded::instance(), &AdbEmbedded::fastbootStateChanged,
+            this, &MainWindow::onFastbootStateChanged);
+    
     // 设备检测信号
     connect(&m_deviceDetector, &DeviceDetector::deviceConnected,
             this, &MainWindow::onDeviceConnected);
@@ -81,6 +83,10 @@ void MainWindow::setupConnections()
             this, &MainWindow::onDeviceDisconnected);
     connect(&m_deviceDetector, &DeviceDetector::deviceModeChanged,
             this, &MainWindow::onDeviceModeChanged);
+    connect(&m_deviceDetector, &DeviceDetector::deviceInfoUpdated,
+            this, &MainWindow::onDeviceInfoUpdated);
+    
+    m_toolPanel->setDeviceDetector(&m_deviceDetector);
     
     // 工具面板信号
     connect(m_toolPanel, &ToolPanel::deviceSelectionChanged,
@@ -91,6 +97,24 @@ void MainWindow::setupConnections()
             this, &MainWindow::onRefreshRequested);
 }
 
+void MainWindow::onAdbStateChanged(AdbEmbedded::ToolState state)
+{
+    if (state == AdbEmbedded::TOOL_READY) {
+        m_outputPanel->appendOutput("✅ ADB 初始化成功");
+    } else if (state == AdbEmbedded::TOOL_FAILED) {
+        m_outputPanel->appendOutput("❌ 无法启动 ADB 服务，仅检测 Fastboot 设备", true);
+    }
+}
+
+void MainWindow::onFastbootStateChanged(AdbEmbedded::ToolState state)
+{
+    if (state == AdbEmbedded::TOOL_READY) {
+        m_outputPanel->appendOutput("✅ Fastboot 自检通过");
+    } else if (state == AdbEmbedded::TOOL_FAILED) {
+        m_outputPanel->appendOutput("❌ 无法初始化嵌入式 Fastboot 工具", true);
+    }
+}
+
 void MainWindow::onDeviceConnected(const DeviceInfo &info)
 {
     m_currentDevices[info.serialNumber] = info;
@@ -124,7 +148,13 @@ void MainWindow::onDeviceDisconnected(const QString &serial)
 void MainWindow::onDeviceModeChanged(const QString &serial, DeviceDetector::DeviceMode newMode)
 {
     if (m_currentDevices.contains(serial)) {
-        m_currentDevices[serial].mode = newMode;
+        // 预期的重启完成后检测器已合并新模式的探测结果
+        DeviceInfo info = m_deviceDetector.currentDeviceInfo(serial);
+        if (info.serialNumber.isEmpty()) {
+            info = m_currentDevices[serial];
+        }
+        info.mode = newMode;
+        m_currentDevices[serial] = info;
         m_toolPanel->updateDeviceList(m_currentDevices);
         
         QString modeStr;
@@ -144,6 +174,17 @@ void MainWindow::onDeviceModeChanged(const QString &serial, DeviceDetector::Devi
     }
 }
 
+void MainWindow::onDeviceInfoUpdated(const DeviceInfo &info)
+{
+    if (!m_currentDevices.contains(info.serialNumber)) {
+        return;
+    }
+    m_currentDevices[info.serialNumber] = info;
+    if (m_toolPanel->getSelectedDevice() == info.serialNumber) {
+        m_deviceInfoPanel->updateDeviceInfo(info);
+    }
+}
+
 void MainWindow::onDeviceSelectionChanged(const QString &deviceId)
 {
     if (deviceId.isEmpty() || !m_currentDevices.contains(deviceId)) {
@@ -4,6 +4,7 @@
 #include <QMainWindow>
 #include <QSplitter>
 #include "core/device_detector.h"
+#include "core/adb_embedded.h"
 #include "ui/tool_panel.h"
 #include "ui/device_info_panel.h"
 #include "ui/output_panel.h"
@@ -17,9 +18,12 @@ public:
     ~MainWindow();
 
 private slots:
+    void onAdbStateChanged(AdbEmbedded::ToolState state);
+    void onFastbootStateChanged(AdbEmbedded::ToolState state);
     void onDeviceConnected(const DeviceInfo &info);
     void onDeviceDisconnected(const QString &serial);
     void onDeviceModeChanged(const QString &serial, DeviceDetector::DeviceMode newMode);
+    void onDeviceInfoUpdated(const DeviceInfo &info);
     void onDeviceSelectionChanged(const QString &deviceId);
     void onOutputMessage(const QString &message, bool isError = false);
     void onRefreshRequested();
@@ -4,6 +4,8 @@
 #include <QGroupBox>
 #include <QFormLayout>
 #include <QLabel>
+#include <QFileDialog>
+#include <QHeaderView>
 
 ToolPanel::ToolPanel(QWidget *parent)
     : QWidget(parent)
@@ -11,7 +13,13 @@ ToolPanel::ToolPanel(QWidget *parent)
     , m_restartModeCombo(nullptr)
     , m_restartButton(nullptr)
     , m_refreshButton(nullptr)
+    , m_recipeEdit(nullptr)
+    , m_recipeBrowseButton(nullptr)
+    , m_flashStartButton(nullptr)
+    , m_flashCancelButton(nullptr)
+    , m_flashStatusTree(nullptr)
     , m_restartTool(new RestartTool(this))
+    , m_flashStation(new FlashStation(this))
     , m_currentSelectedDevice("")
 {
     setupUI();
@@ -27,7 +35,8 @@ void ToolPanel::setupUI()
     QGroupBox *deviceGroup = new QGroupBox("设备列表", this);
     QVBoxLayout *deviceLayout = new QVBoxLayout(deviceGroup);
     m_deviceList = new QListWidget(this);
-    m_deviceList->setSelectionMode(QAbstractItemView::SingleSelection);
+    // 可多选，批量刷机作用于所有选中的设备；其他工具使用第一个选中的设备
+    m_deviceList->setSelectionMode(QAbstractItemView::ExtendedSelection);
     
     // 设置设备列表样式
     m_deviceList->setStyleSheet("QListWidget { "
@@ -66,6 +75,36 @@ void ToolPanel::setupUI()
     modeHelp->setStyleSheet("color: #666; font-size: 10px;");
     restartLayout->addRow(modeHelp);
     
+    // 批量刷机
+    QGroupBox *flashGroup = new QGroupBox("批量刷机", this);
+    QVBoxLayout *flashLayout = new QVBoxLayout(flashGroup);
+    
+    QHBoxLayout *recipeLayout = new QHBoxLayout();
+    m_recipeEdit = new QLineEdit(this);
+    m_recipeEdit->setPlaceholderText("刷机配方 (JSON)");
+    m_recipeBrowseButton = new QPushButton("浏览...", this);
+    recipeLayout->addWidget(m_recipeEdit);
+    recipeLayout->addWidget(m_recipeBrowseButton);
+    
+    QHBoxLayout *flashButtonLayout = new QHBoxLayout();
+    m_flashStartButton = new QPushButton("刷写所选设备", this);
+    m_flashStartButton->setEnabled(false);
+    m_flashCancelButton = new QPushButton("取消", this);
+    m_flashCancelButton->setEnabled(false);
+    flashButtonLayout->addWidget(m_flashStartButton);
+    flashButtonLayout->addWidget(m_flashCancelButton);
+    
+    m_flashStatusTree = new QTreeWidget(this);
+    m_flashStatusTree->setColumnCount(5);
+    m_flashStatusTree->setHeaderLabels({"设备", "状态", "进度", "速度", "剩余"});
+    m_flashStatusTree->setRootIsDecorated(false);
+    m_flashStatusTree->setUniformRowHeights(true);
+    m_flashStatusTree->header()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    
+    flashLayout->addLayout(recipeLayout);
+    flashLayout->addLayout(flashButtonLayout);
+    flashLayout->addWidget(m_flashStatusTree);
+    
     // 工具按钮
     QHBoxLayout *toolLayout = new QHBoxLayout();
     m_refreshButton = new QPushButton("刷新设备", this);
@@ -76,6 +115,7 @@ void ToolPanel::setupUI()
     // 组装面板
     mainLayout->addWidget(deviceGroup);
     mainLayout->addWidget(restartGroup);
+    mainLayout->addWidget(flashGroup);
     mainLayout->addLayout(toolLayout);
     mainLayout->addStretch();
 }
@@ -90,11 +130,30 @@ void ToolPanel::setupConnections()
             this, &ToolPanel::onRefreshButtonClicked);
     connect(m_restartTool, &RestartTool::outputMessage,
             this, &ToolPanel::onRestartToolOutput);
+    connect(m_recipeBrowseButton, &QPushButton::clicked,
+            this, &ToolPanel::onBrowseRecipeClicked);
+    connect(m_flashStartButton, &QPushButton::clicked,
+            this, &ToolPanel::onFlashStartClicked);
+    connect(m_flashCancelButton, &QPushButton::clicked,
+            this, &ToolPanel::onFlashCancelClicked);
+    
+    // 刷机状态由工作线程发出，以排队连接送达
+    connect(m_flashStation, &FlashStation::outputMessage,
+            this, &ToolPanel::outputMessage);
+    connect(m_flashStation, &FlashStation::deviceStateChanged,
+            this, &ToolPanel::onFlashDeviceStateChanged);
+    connect(m_flashStation, &FlashStation::deviceProgress,
+            this, &ToolPanel::onFlashDeviceProgress);
+    connect(m_flashStation, &FlashStation::finished,
+            this, &ToolPanel::onFlashFinished);
 }
 
 void ToolPanel::updateDeviceList(const QMap<QString, DeviceInfo> &devices)
 {
+    // 重建列表时保留已选中的设备，批量操作的选择不会因设备状态刷新而丢失
+    const QStringList selected = getSelectedDevices();
     m_currentDevices = devices;
+    m_deviceList->blockSignals(true);
     m_deviceList->clear();
     
     for (const DeviceInfo &info : m_currentDevices) {
@@ -115,6 +174,7 @@ void ToolPanel::updateDeviceList(const QMap<QString, DeviceInfo> &devices)
         
         QListWidgetItem *item = new QListWidgetItem(displayText, m_deviceList);
         item->setData(Qt::UserRole, info.serialNumber);
+        item->setSelected(selected.contains(info.serialNumber));
     }
     
     // 如果没有设备，显示提示
@@ -123,6 +183,9 @@ void ToolPanel::updateDeviceList(const QMap<QString, DeviceInfo> &devices)
         item->setFlags(item->flags() & ~Qt::ItemIsSelectable);
         m_restartButton->setEnabled(false);
     }
+    
+    m_deviceList->blockSignals(false);
+    onDeviceListSelectionChanged();
 }
 
 QString ToolPanel::getSelectedDevice() const
@@ -130,9 +193,22 @@ QString ToolPanel::getSelectedDevice() const
     return m_currentSelectedDevice;
 }
 
+QStringList ToolPanel::getSelectedDevices() const
+{
+    QStringList serials;
+    for (QListWidgetItem *item : m_deviceList->selectedItems()) {
+        QString serial = item->data(Qt::UserRole).toString();
+        if (m_currentDevices.contains(serial)) {
+            serials.append(serial);
+        }
+    }
+    return serials;
+}
+
 void ToolPanel::onDeviceListSelectionChanged()
 {
     QList<QListWidgetItem*> selectedItems = m_deviceList->selectedItems();
+    m_flashStartButton->setEnabled(!getSelectedDevices().isEmpty() && !m_flashStation->isRunning());
     
     if (selectedItems.isEmpty()) {
         m_currentSelectedDevice = "";
@@ -170,10 +246,21 @@ void ToolPanel::onRestartButtonClicked()
         return;
     }
     
-    const DeviceInfo &info = m_currentDevices[m_currentSelectedDevice];
     RestartTool::RestartMode targetMode = static_cast<RestartTool::RestartMode>(
         m_restartModeCombo->currentData().toInt());
     
+    // 选中多台设备时并行重启，完成后输出汇总表
+    const QStringList selected = getSelectedDevices();
+    if (selected.size() > 1) {
+        QMap<QString, DeviceDetector::DeviceMode> devices;
+        for (const QString &serial : selected) {
+            devices.insert(serial, static_cast<DeviceDetector::DeviceMode>(m_currentDevices[serial].mode));
+        }
+        m_restartTool->restartDevices(devices, targetMode);
+        return;
+    }
+    
+    const DeviceInfo &info = m_currentDevices[m_currentSelectedDevice];
     // 替换原来的调用
     m_restartTool->restartDevice(
         m_currentSelectedDevice, 
@@ -182,6 +269,12 @@ void ToolPanel::onRestartButtonClicked()
     );
 }
 
+void ToolPanel::setDeviceDetector(DeviceDetector *detector)
+{
+    // 重启工具在多跳路径的中间模式上等待检测器事件
+    m_restartTool->setDeviceDetector(detector);
+}
+
 void ToolPanel::onRefreshButtonClicked()
 {
     emit refreshRequested();
@@ -191,3 +284,93 @@ void ToolPanel::onRestartToolOutput(const QString &message, bool isError)
 {
     emit outputMessage(message, isError);
 }
+
+void ToolPanel::onBrowseRecipeClicked()
+{
+    QString path = QFileDialog::getOpenFileName(this, "选择刷机配方", m_recipeEdit->text(),
+                                                "刷机配方 (*.json);;所有文件 (*)");
+    if (!path.isEmpty()) {
+        m_recipeEdit->setText(path);
+    }
+}
+
+void ToolPanel::onFlashStartClicked()
+{
+    QStringList serials = getSelectedDevices();
+    if (serials.isEmpty()) {
+        emit outputMessage("❌ 请先选择要刷写的设备", true);
+        return;
+    }
+    
+    FlashRecipe recipe;
+    QString error;
+    if (!FlashRecipe::load(m_recipeEdit->text(), recipe, &error)) {
+        emit outputMessage("❌ 无法加载刷机配方: " + error, true);
+        return;
+    }
+    
+    m_flashStatusTree->clear();
+    m_flashItems.clear();
+    if (!m_flashStation->start(recipe, serials, &error)) {
+        emit outputMessage("❌ " + error, true);
+        return;
+    }
+    
+    QStringList steps;
+    for (const FlashRecipe::Step &step : recipe.steps) {
+        steps.append(step.describe());
+    }
+    emit outputMessage(QString("🚀 开始批量刷机 %1 台设备: %2").arg(serials.size()).arg(steps.join(", ")));
+    m_flashStartButton->setEnabled(false);
+    m_flashCancelButton->setEnabled(true);
+}
+
+void ToolPanel::onFlashCancelClicked()
+{
+    m_flashStation->cancel();
+    m_flashCancelButton->setEnabled(false);
+    emit outputMessage("⏹️ 正在取消批量刷机，各设备将在当前步骤完成后停止");
+}
+
+QTreeWidgetItem *ToolPanel::flashItem(const QString &serial)
+{
+    QTreeWidgetItem *item = m_flashItems.value(serial);
+    if (!item) {
+        item = new QTreeWidgetItem(m_flashStatusTree, {serial, "", "0%", "", ""});
+        m_flashItems.insert(serial, item);
+    }
+    return item;
+}
+
+void ToolPanel::onFlashDeviceStateChanged(const QString &serial, FlashStation::DeviceState state,
+                                          const QString &detail)
+{
+    QTreeWidgetItem *item = flashItem(serial);
+    item->setText(1, FlashStation::stateName(state));
+    item->setToolTip(1, detail);
+    if (state == FlashStation::STATE_DONE || state == FlashStation::STATE_FAILED
+        || state == FlashStation::STATE_CANCELLED) {
+        item->setText(4, "");
+        emit outputMessage(QString("%1 %2: %3 %4")
+                           .arg(state == FlashStation::STATE_DONE ? "✅" : "❌")
+                           .arg(serial, FlashStation::stateName(state), detail),
+                           state != FlashStation::STATE_DONE);
+    }
+}
+
+void ToolPanel::onFlashDeviceProgress(const QString &serial, int percent, double mbps, int etaSeconds)
+{
+    QTreeWidgetItem *item = flashItem(serial);
+    item->setText(2, QString("%1%").arg(percent));
+    item->setText(3, QString("%1 MB/s").arg(mbps, 0, 'f', 1));
+    item->setText(4, etaSeconds < 0 ? QString("--")
+                  : QString("%1:%2").arg(etaSeconds / 60).arg(etaSeconds % 60, 2, 10, QChar('0')));
+}
+
+void ToolPanel::onFlashFinished(int succeeded, int failed)
+{
+    Q_UNUSED(succeeded);
+    Q_UNUSED(failed);
+    m_flashCancelButton->setEnabled(false);
+    m_flashStartButton->setEnabled(!getSelectedDevices().isEmpty());
+}
@@ -5,8 +5,12 @@
 #include <QListWidget>
 #include <QPushButton>
 #include <QComboBox>
+#include <QHash>
+#include <QLineEdit>
+#include <QTreeWidget>
 #include "core/device_detector.h"
 #include "core/restart_tool.h"
+#include "core/flash_station.h"
 
 class ToolPanel : public QWidget
 {
@@ -16,7 +20,9 @@ public:
     explicit ToolPanel(QWidget *parent = nullptr);
     
     void updateDeviceList(const QMap<QString, DeviceInfo> &devices);
+    void setDeviceDetector(DeviceDetector *detector);
     QString getSelectedDevice() const;
+    QStringList getSelectedDevices() const;
 
 signals:
     void deviceSelectionChanged(const QString &deviceId);
@@ -28,17 +34,31 @@ private slots:
     void onRestartButtonClicked();
     void onRefreshButtonClicked();
     void onRestartToolOutput(const QString &message, bool isError);
+    void onBrowseRecipeClicked();
+    void onFlashStartClicked();
+    void onFlashCancelClicked();
+    void onFlashDeviceStateChanged(const QString &serial, FlashStation::DeviceState state, const QString &detail);
+    void onFlashDeviceProgress(const QString &serial, int percent, double mbps, int etaSeconds);
+    void onFlashFinished(int succeeded, int failed);
 
 private:
     void setupUI();
     void setupConnections();
+    QTreeWidgetItem *flashItem(const QString &serial);
     
     QListWidget *m_deviceList;
     QComboBox *m_restartModeCombo;
     QPushButton *m_restartButton;
     QPushButton *m_refreshButton;
+    QLineEdit *m_recipeEdit;
+    QPushButton *m_recipeBrowseButton;
+    QPushButton *m_flashStartButton;
+    QPushButton *m_flashCancelButton;
+    QTreeWidget *m_flashStatusTree;
     
     RestartTool *m_restartTool;
+    FlashStation *m_flashStation;
+    QHash<QString, QTreeWidgetItem*> m_flashItems;     // 序列号 -> 批量刷机状态行
     QMap<QString, DeviceInfo> m_currentDevices;
     QString m_currentSelectedDevice;
 };